@@ -20,13 +20,12 @@
 #ifndef GPU_GUARD_COMMON_ASSEMBLY_ENTITIES_FWD_HH
 #define GPU_GUARD_COMMON_ASSEMBLY_ENTITIES_FWD_HH 1
 
-#include <utils/memory.hh>
-
 namespace gpu
 {
     struct AssemblyEntity;
 
-    typedef std::tr1::shared_ptr<AssemblyEntity> AssemblyEntityPtr;
+    /// AssemblyEntities are owned by the Arena they have been created in.
+    typedef const AssemblyEntity * AssemblyEntityPtr;
 
     struct Comment;
 
@@ -38,7 +37,7 @@ namespace gpu
 
     struct Label;
 
-    struct Line;
+    struct LexedInstruction;
 }
 
 #endif
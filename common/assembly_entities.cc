@@ -49,7 +49,7 @@ namespace gpu
     {
     }
 
-    Directive::Directive(const std::string & name, const std::string & params) :
+    Directive::Directive(const Atom & name, const std::string & params) :
         name(name),
         params(params)
     {
@@ -91,7 +91,7 @@ namespace gpu
     {
     }
 
-    Instruction::Instruction(const std::string & mnemonic) :
+    Instruction::Instruction(const Atom & mnemonic) :
         mnemonic(mnemonic)
     {
     }
@@ -111,7 +111,7 @@ namespace gpu
     {
     }
 
-    Label::Label(const std::string & text) :
+    Label::Label(const Atom & text) :
         text(text)
     {
     }
@@ -131,23 +131,55 @@ namespace gpu
     {
     }
 
-    Line::Line(unsigned number) :
-        number(number)
+    LexedInstruction::LexedInstruction(const Atom & mnemonic, const char * buffer, const std::vector<Token> & operands) :
+        mnemonic(mnemonic),
+        buffer(buffer),
+        operands(operands)
     {
     }
 
-    Line::~Line()
+    std::string
+    LexedInstruction::operand(unsigned i) const
     {
+        return std::string(begin(i), end(i));
     }
 
-    void
-    Line::accept(AssemblyEntityVisitor & v) const
+    Instruction
+    LexedInstruction::instruction() const
     {
-        static_cast<ConstVisits<Line> *>(&v)->visit(*this);
+        Instruction result(mnemonic);
+        for (unsigned i(0), i_end(operands.size()) ; i != i_end ; ++i)
+        {
+            result.operands.append(operand(i));
+        }
+
+        return result;
     }
 
     template <>
-    ConstVisits<Line>::~ConstVisits()
+    ConstVisits<LexedInstruction>::~ConstVisits()
+    {
+    }
+
+    namespace internal
+    {
+        static std::string join_operands(const Instruction & instruction, std::vector<Token> & operands)
+        {
+            std::string result;
+            for (Sequence<std::string>::Iterator o(instruction.operands.begin()), o_end(instruction.operands.end()) ;
+                    o != o_end ; ++o)
+            {
+                operands.push_back(Token(result.size(), o->size()));
+                result += *o;
+            }
+
+            return result;
+        }
+    }
+
+    InstructionTokens::InstructionTokens(const Instruction & instruction) :
+        _buffer(internal::join_operands(instruction, _operands)),
+        lexed(instruction.mnemonic, _buffer.data(), _operands)
     {
     }
 
@@ -203,12 +235,6 @@ namespace gpu
         this->_imp->stream << "Label '" << l.text << "'" << std::endl;
     }
 
-    void
-    AssemblyEntityPrinter::visit(const Line & l)
-    {
-        this->_imp->stream << "Line '" << l.number << "'" << std::endl;
-    }
-
     std::string
     AssemblyEntityPrinter::output() const
     {
@@ -21,15 +21,18 @@
 #define GPU_GUARD_COMMON_ASSEMBLY_ENTITIES_HH 1
 
 #include <common/assembly_entities-fwd.hh>
+#include <common/assembly_lexer.hh>
 #include <common/expression-fwd.hh>
+#include <utils/atom.hh>
 #include <utils/sequence.hh>
 #include <utils/visitor.hh>
 
 #include <string>
+#include <vector>
 
 namespace gpu
 {
-    typedef ConstVisitorTag<Comment, Data, Directive, Instruction, Label, Line> AssemblyEntities;
+    typedef ConstVisitorTag<Comment, Data, Directive, Instruction, Label> AssemblyEntities;
 
     typedef ConstVisitor<AssemblyEntities> AssemblyEntityVisitor;
 
@@ -68,13 +71,13 @@ namespace gpu
     struct Directive :
         public AssemblyEntity
     {
-        Directive(const std::string & name, const std::string & params);
+        Directive(const Atom & name, const std::string & params);
 
         ~Directive();
 
         void accept(AssemblyEntityVisitor &) const;
 
-        std::string name;
+        Atom name;
 
         std::string params;
     };
@@ -82,13 +85,13 @@ namespace gpu
     struct Instruction :
         public AssemblyEntity
     {
-        Instruction(const std::string & mnemonic);
+        Instruction(const Atom & mnemonic);
 
         ~Instruction();
 
         void accept(AssemblyEntityVisitor &) const;
 
-        std::string mnemonic;
+        Atom mnemonic;
 
         Sequence<std::string> operands;
     };
@@ -96,25 +99,76 @@ namespace gpu
     struct Label :
         public AssemblyEntity
     {
-        Label(const std::string & text);
+        Label(const Atom & text);
 
         ~Label();
 
         void accept(AssemblyEntityVisitor &) const;
 
-        std::string text;
+        Atom text;
     };
 
-    struct Line :
-        public AssemblyEntity
+    /**
+     * LexedInstruction is an instruction whose operands are still tokens in
+     * a lexer buffer, so that a backend can convert it without building an
+     * Instruction first. It is only valid while it is being visited.
+     */
+    struct LexedInstruction
     {
-        Line(unsigned number);
+        LexedInstruction(const Atom & mnemonic, const char * buffer, const std::vector<Token> & operands);
 
-        ~Line();
+        Atom mnemonic;
 
-        void accept(AssemblyEntityVisitor &) const;
+        const char * buffer;
+
+        const std::vector<Token> & operands;
+
+        /// Return the start of operand i.
+        const char * begin(unsigned i) const
+        {
+            return buffer + operands[i].offset;
+        }
 
-        unsigned number;
+        /// Return the end of operand i.
+        const char * end(unsigned i) const
+        {
+            return buffer + operands[i].offset + operands[i].length;
+        }
+
+        /// Return a copy of the text of operand i.
+        std::string operand(unsigned i) const;
+
+        /// Return an Instruction with copies of all operands.
+        Instruction instruction() const;
+    };
+
+    /**
+     * InstructionTokens lays out the operands of an Instruction in a buffer
+     * of its own, so that it can be handed on as a LexedInstruction.
+     */
+    class InstructionTokens
+    {
+        private:
+            std::vector<Token> _operands;
+
+            std::string _buffer;
+
+        public:
+            InstructionTokens(const Instruction & instruction);
+
+            const LexedInstruction lexed;
+    };
+
+    /**
+     * LexedEntityVisitor is an AssemblyEntityVisitor that also accepts
+     * LexedInstructions. A parser that streams into it hands over each
+     * instruction of the source as a LexedInstruction instead of an
+     * Instruction.
+     */
+    class LexedEntityVisitor :
+        public AssemblyEntityVisitor,
+        public ConstVisits<LexedInstruction>
+    {
     };
 
     class AssemblyEntityPrinter :
@@ -136,8 +190,6 @@ namespace gpu
 
             void visit(const Label &);
 
-            void visit(const Line &);
-
             std::string output() const;
     };
 
@@ -19,7 +19,7 @@
 
 #include <tests/tests.hh>
 #include <common/assembly_entities.hh>
-#include <utils/memory.hh>
+#include <utils/arena.hh>
 #include <utils/sequence-impl.hh>
 
 #include <sstream>
@@ -49,22 +49,23 @@ struct AssemblyEntitiesTest :
                 "  Operand '0x1234'\n");
 
         AssemblyEntityPrinter p;
-        Sequence<std::tr1::shared_ptr<AssemblyEntity> > entities;
+        Arena arena;
+        Sequence<AssemblyEntityPtr> entities;
 
-        entities.append(make_shared_ptr(new Directive("file", "stdin")));
-        entities.append(make_shared_ptr(new Comment("tuuuraluuraluu")));
-        entities.append(make_shared_ptr(new Directive("section", "text")));
-        entities.append(make_shared_ptr(new Label("main")));
-        entities.append(make_shared_ptr(new Instruction("nop")));
+        entities.append(arena.make<Directive>("file", "stdin"));
+        entities.append(arena.make<Comment>("tuuuraluuraluu"));
+        entities.append(arena.make<Directive>("section", "text"));
+        entities.append(arena.make<Label>("main"));
+        entities.append(arena.make<Instruction>("nop"));
 
-        Instruction * instruction(new Instruction("add"));
+        Instruction * instruction(arena.make<Instruction>("add"));
         instruction->operands.append("$1");
         instruction->operands.append("$1");
         instruction->operands.append("0x1234");
 
-        entities.append(make_shared_ptr(instruction));
+        entities.append(instruction);
 
-        for (Sequence<std::tr1::shared_ptr<AssemblyEntity> >::Iterator i(entities.begin()), i_end(entities.end()) ;
+        for (Sequence<AssemblyEntityPtr>::Iterator i(entities.begin()), i_end(entities.end()) ;
                 i != i_end ; ++i)
         {
             (*i)->accept(p);
@@ -0,0 +1,176 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/assembly_lexer.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+
+#include <cstring>
+
+namespace
+{
+    inline bool is_blank(char c)
+    {
+        return (' ' == c) || ('\t' == c);
+    }
+
+    inline const char * skip_blanks(const char * begin, const char * end)
+    {
+        while ((begin != end) && is_blank(*begin))
+            ++begin;
+
+        return begin;
+    }
+
+    inline const char * strip_trailing_blanks(const char * begin, const char * end)
+    {
+        while ((begin != end) && is_blank(*(end - 1)))
+            --end;
+
+        return end;
+    }
+
+    inline gpu::Token make_token(const char * base, const char * begin, const char * end)
+    {
+        return gpu::Token(begin - base, end - begin);
+    }
+}
+
+namespace gpu
+{
+    template <>
+    struct Implementation<AssemblyLexer>
+    {
+        const char * const begin;
+
+        const char * const end;
+
+        const char * current;
+
+        unsigned number;
+
+        Implementation(const char * b, const char * e, unsigned first_line) :
+            begin(b),
+            end(e),
+            current(b),
+            number(first_line - 1)
+        {
+        }
+    };
+
+    AssemblyLexer::AssemblyLexer(const char * begin, const char * end, unsigned first_line) :
+        PrivateImplementationPattern<AssemblyLexer>(new Implementation<AssemblyLexer>(begin, end, first_line))
+    {
+    }
+
+    AssemblyLexer::~AssemblyLexer()
+    {
+    }
+
+    const char *
+    AssemblyLexer::buffer() const
+    {
+        return _imp->begin;
+    }
+
+    bool
+    AssemblyLexer::next(LexedLine & line)
+    {
+        if (_imp->current == _imp->end)
+            return false;
+
+        const char * eol(static_cast<const char *>(std::memchr(_imp->current, '\n', _imp->end - _imp->current)));
+        if (! eol)
+            eol = _imp->end;
+
+        ++_imp->number;
+        lex(_imp->begin, _imp->current, eol, line);
+        line.number = _imp->number;
+
+        _imp->current = (eol == _imp->end) ? eol : eol + 1;
+
+        return true;
+    }
+
+    std::string
+    AssemblyLexer::text(const Token & token) const
+    {
+        return std::string(_imp->begin + token.offset, token.length);
+    }
+
+    void
+    AssemblyLexer::lex(const char * base, const char * begin, const char * end, LexedLine & line)
+    {
+        line.label = Token();
+        line.directive = false;
+        line.mnemonic = Token();
+        line.params = Token();
+        line.operands.clear();
+
+        // Everything from the first '#' onwards is a comment.
+        begin = skip_blanks(begin, end);
+        const char * comment(static_cast<const char *>(std::memchr(begin, '#', end - begin)));
+        if (comment)
+            end = comment;
+        end = strip_trailing_blanks(begin, end);
+
+        // A label ends in ':', which needs to precede any blanks.
+        const char * c(begin);
+        while ((c != end) && (':' != *c) && ! is_blank(*c))
+            ++c;
+
+        if ((c != end) && (':' == *c))
+        {
+            line.label = make_token(base, begin, c);
+            begin = skip_blanks(c + 1, end);
+        }
+
+        if (begin == end)
+            return;
+
+        line.directive = ('.' == *begin);
+
+        const char * word_end(begin);
+        while ((word_end != end) && ! is_blank(*word_end))
+            ++word_end;
+
+        line.mnemonic = make_token(base, line.directive ? begin + 1 : begin, word_end);
+        begin = skip_blanks(word_end, end);
+
+        if (line.directive)
+        {
+            line.params = make_token(base, begin, end);
+            return;
+        }
+
+        // Operands are separated by commas. Leading blanks are dropped, trailing blanks are kept.
+        while (begin != end)
+        {
+            const char * comma(static_cast<const char *>(std::memchr(begin, ',', end - begin)));
+            if (! comma)
+                comma = end;
+
+            line.operands.push_back(make_token(base, begin, comma));
+
+            begin = comma;
+            while ((begin != end) && (',' == *begin))
+                ++begin;
+            begin = skip_blanks(begin, end);
+        }
+    }
+}
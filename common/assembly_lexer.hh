@@ -0,0 +1,114 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_ASSEMBLY_LEXER_HH
+#define GPU_GUARD_COMMON_ASSEMBLY_LEXER_HH 1
+
+#include <utils/private_implementation_pattern.hh>
+
+#include <string>
+#include <vector>
+
+namespace gpu
+{
+    /**
+     * A Token refers to a range of characters inside the lexer's input
+     * buffer. It never owns the text.
+     */
+    struct Token
+    {
+        unsigned offset;
+
+        unsigned length;
+
+        Token() :
+            offset(0),
+            length(0)
+        {
+        }
+
+        Token(unsigned o, unsigned l) :
+            offset(o),
+            length(l)
+        {
+        }
+
+        bool empty() const
+        {
+            return 0 == length;
+        }
+    };
+
+    /**
+     * LexedLine holds the tokens of one source line.
+     *
+     * For directives, mnemonic holds the directive's name without the
+     * leading '.', and params holds the remainder of the line. For
+     * instructions, the comma-separated operands are held in operands.
+     *
+     * The operands vector is reused between lines, so a single LexedLine
+     * should be passed to AssemblyLexer::next repeatedly.
+     */
+    struct LexedLine
+    {
+        unsigned number;
+
+        Token label;
+
+        bool directive;
+
+        Token mnemonic;
+
+        Token params;
+
+        std::vector<Token> operands;
+    };
+
+    /**
+     * AssemblyLexer splits a buffer of assembly source into lines and tokens,
+     * without copying any of the text.
+     *
+     * The buffer must outlive the lexer and all tokens obtained from it.
+     */
+    class AssemblyLexer :
+        public PrivateImplementationPattern<AssemblyLexer>
+    {
+        public:
+            AssemblyLexer(const char * begin, const char * end, unsigned first_line = 1);
+
+            ~AssemblyLexer();
+
+            /// Return the start of the input buffer, which all offsets are relative to.
+            const char * buffer() const;
+
+            /// Lex the next line into line. Return false at the end of the buffer.
+            bool next(LexedLine & line);
+
+            /// Return a copy of the text a token refers to.
+            std::string text(const Token & token) const;
+
+            /**
+             * Lex the single line [begin, end) into line, with offsets
+             * relative to base.
+             */
+            static void lex(const char * base, const char * begin, const char * end, LexedLine & line);
+    };
+}
+
+#endif
@@ -0,0 +1,84 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/assembly_lexer.hh>
+#include <tests/tests.hh>
+
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+struct AssemblyLexerTest :
+    public Test
+{
+    AssemblyLexerTest() :
+        Test("assembly_lexer_test")
+    {
+    }
+
+    virtual void run()
+    {
+        std::string input(
+                "main: # comment\n"
+                "\t.section .text\n"
+                "\n"
+                "loop:\tADD R0.x , R1.y,,R2.z  # comment\n"
+                "  NOP");
+
+        AssemblyLexer lexer(input.data(), input.data() + input.size());
+        LexedLine line;
+
+        TEST_CHECK(lexer.next(line));
+        TEST_CHECK_EQUAL(line.number, 1);
+        TEST_CHECK_EQUAL(line.label.offset, 0);
+        TEST_CHECK_EQUAL(lexer.text(line.label), "main");
+        TEST_CHECK(line.mnemonic.empty());
+
+        TEST_CHECK(lexer.next(line));
+        TEST_CHECK_EQUAL(line.number, 2);
+        TEST_CHECK(line.label.empty());
+        TEST_CHECK(line.directive);
+        TEST_CHECK_EQUAL(lexer.text(line.mnemonic), "section");
+        TEST_CHECK_EQUAL(lexer.text(line.params), ".text");
+
+        TEST_CHECK(lexer.next(line));
+        TEST_CHECK_EQUAL(line.number, 3);
+        TEST_CHECK(line.label.empty());
+        TEST_CHECK(line.mnemonic.empty());
+
+        TEST_CHECK(lexer.next(line));
+        TEST_CHECK_EQUAL(line.number, 4);
+        TEST_CHECK_EQUAL(lexer.text(line.label), "loop");
+        TEST_CHECK(! line.directive);
+        TEST_CHECK_EQUAL(lexer.text(line.mnemonic), "ADD");
+        TEST_CHECK_EQUAL(line.operands.size(), 3);
+        TEST_CHECK_EQUAL(lexer.text(line.operands[0]), "R0.x ");
+        TEST_CHECK_EQUAL(lexer.text(line.operands[1]), "R1.y");
+        TEST_CHECK_EQUAL(lexer.text(line.operands[2]), "R2.z");
+        TEST_CHECK_EQUAL(line.operands[2].offset, input.find("R2.z"));
+
+        TEST_CHECK(lexer.next(line));
+        TEST_CHECK_EQUAL(line.number, 5);
+        TEST_CHECK_EQUAL(lexer.text(line.mnemonic), "NOP");
+        TEST_CHECK(line.operands.empty());
+
+        TEST_CHECK(! lexer.next(line));
+    }
+} assembly_lexer_test;
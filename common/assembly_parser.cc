@@ -18,128 +18,715 @@
  */
 
 #include <common/assembly_entities.hh>
+#include <common/assembly_lexer.hh>
 #include <common/assembly_parser.hh>
 #include <common/expression.hh>
+#include <common/include_cache.hh>
+#include <common/line_table.hh>
+#include <common/macro_processor.hh>
+#include <common/syntax.hh>
+#include <utils/mapped_file.hh>
+#include <utils/perfect_hash.hh>
+#include <utils/private_implementation_pattern-impl.hh>
 #include <utils/sequence-impl.hh>
-#include <utils/text_manipulation.hh>
+#include <utils/tuple.hh>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <new>
 #include <string>
-#include <map>
+#include <vector>
 
-namespace
+#include <pthread.h>
+#include <unistd.h>
+
+namespace gpu
 {
-    std::string split_comment(std::string & line)
+    namespace internal
     {
-        std::string::size_type pos(line.find('#'));
-        std::string result;
+        /// A LexedLineSink that also receives the entities of included files.
+        struct EntitySink :
+            public LexedLineSink
+        {
+            virtual ~EntitySink()
+            {
+            }
 
-        if (std::string::npos != pos)
+            /// Handle the entities of file, included at line.
+            virtual void include(const IncludedFile & file, unsigned line) = 0;
+        };
+
+        struct EntityCollector :
+            public AssemblyEntityVisitor,
+            public EntitySink
         {
-            result = line.substr(pos);
-            line.erase(pos);
-        }
+            Arena & arena;
 
-        return result;
+            Sequence<AssemblyEntityPtr> entities;
+
+            LineTable lines;
+
+            /// Line of the entities that are currently being visited.
+            unsigned line;
+
+            EntityCollector(Arena & arena, const LineTable & lines) :
+                arena(arena),
+                lines(lines),
+                line(0)
+            {
+            }
+
+            void visit(const Comment & c)
+            {
+                entities.append(arena.make<Comment>(c));
+                lines.append(line);
+            }
+
+            void visit(const Data & d)
+            {
+                entities.append(arena.make<Data>(d));
+                lines.append(line);
+            }
+
+            void visit(const Directive & d)
+            {
+                entities.append(arena.make<Directive>(d));
+                lines.append(line);
+            }
+
+            void visit(const Instruction & i)
+            {
+                entities.append(arena.make<Instruction>(i));
+                lines.append(line);
+            }
+
+            void visit(const Label & l)
+            {
+                entities.append(arena.make<Label>(l));
+                lines.append(line);
+            }
+
+            void emit(const char * buffer, const LexedLine & l);
+
+            void include(const IncludedFile & file, unsigned line);
+        };
+
+        /// Turn lines into entities, and hand them to a sink.
+        struct EntityEmitter :
+            public EntitySink
+        {
+            AssemblyEntityVisitor & sink;
+
+            /// Receives instructions as tokens, if the sink accepts them.
+            ConstVisits<LexedInstruction> * instructions;
+
+            EntityEmitter(AssemblyEntityVisitor & sink) :
+                sink(sink),
+                instructions(0)
+            {
+            }
+
+            EntityEmitter(LexedEntityVisitor & sink) :
+                sink(sink),
+                instructions(&sink)
+            {
+            }
+
+            void emit(const char * buffer, const LexedLine & l);
+
+            void include(const IncludedFile & file, unsigned line);
+        };
+
+        /// Hand lines on to a sink, handling the .include directives among them, also those from block expansions.
+        struct IncludingSink :
+            public LexedLineSink
+        {
+            EntitySink & sink;
+
+            /// The directory that relative paths are resolved against.
+            std::string directory;
+
+            /// The processor whose lines are received, which learns the macros of included files.
+            MacroProcessor * macros;
+
+            IncludingSink(EntitySink & sink, const std::string & directory) :
+                sink(sink),
+                directory(directory),
+                macros(0)
+            {
+            }
+
+            void emit(const char * buffer, const LexedLine & l);
+        };
     }
 
-    std::string split_label(std::string & line)
+    static void emit_directive(const Atom & name, const std::string & params, AssemblyEntityVisitor & sink)
     {
-        std::string::size_type pos(line.find_first_of(": \t"));
-        std::string result;
+        /*
+         * directive name
+         * data size
+         */
+        typedef Tuple<std::string, unsigned> RawData;
+        const static RawData raw_data[] =
+        {
+            RawData("byte", 1),
+            RawData("word", 4),
+            RawData("long", 8)
+        };
+        const static PerfectHash<RawData> data(raw_data, raw_data + sizeof(raw_data) / sizeof(RawData));
 
-        if ((std::string::npos != pos) && (':' == line[pos]))
+        const RawData * d(data.find(name));
+        if (d)
         {
-            result = line.substr(0, pos);
-            line.erase(0, pos + 1);
+            // one entity per item of a comma separated list
+            std::string::size_type begin(0);
+            unsigned depth(0);
+            for (std::string::size_type i(0), i_end(params.size()) ; i <= i_end ; ++i)
+            {
+                if ((i == i_end) || ((',' == params[i]) && (0 == depth)))
+                {
+                    Data(d->second, ExpressionParser::parse(params.substr(begin, i - begin))).accept(sink);
+                    begin = i + 1;
+                }
+                else if ('(' == params[i])
+                {
+                    ++depth;
+                }
+                else if ((')' == params[i]) && (0 != depth))
+                {
+                    --depth;
+                }
+            }
+        }
+        else
+        {
+            Directive(name, params).accept(sink);
         }
+    }
 
-        return result;
+    static void emit_entities(const char * buffer, const LexedLine & line, AssemblyEntityVisitor & sink,
+            ConstVisits<LexedInstruction> * instructions = 0)
+    {
+        SyntaxContext::Line(line.number);
+
+        if (! line.label.empty())
+            Label(Atom(buffer + line.label.offset, buffer + line.label.offset + line.label.length)).accept(sink);
+
+        if (line.directive)
+        {
+            emit_directive(Atom(buffer + line.mnemonic.offset, buffer + line.mnemonic.offset + line.mnemonic.length),
+                    std::string(buffer + line.params.offset, line.params.length), sink);
+        }
+        else if (instructions && ! line.mnemonic.empty())
+        {
+            instructions->visit(LexedInstruction(Atom(buffer + line.mnemonic.offset, buffer + line.mnemonic.offset + line.mnemonic.length),
+                        buffer, line.operands));
+        }
+        else if (! line.mnemonic.empty())
+        {
+            Instruction i(Atom(buffer + line.mnemonic.offset, buffer + line.mnemonic.offset + line.mnemonic.length));
+            for (std::vector<Token>::const_iterator o(line.operands.begin()), o_end(line.operands.end()) ;
+                    o != o_end ; ++o)
+            {
+                i.operands.append(std::string(buffer + o->offset, o->length));
+            }
+
+            i.accept(sink);
+        }
     }
 
-    bool is_directive(const std::string & s)
+    void
+    internal::EntityCollector::emit(const char * buffer, const LexedLine & l)
     {
-        return '.' == s[0];
+        line = l.number;
+        emit_entities(buffer, l, *this);
     }
-}
 
-namespace gpu
-{
-    static std::tr1::shared_ptr<AssemblyEntity> make_directive(const std::string & name, const std::string & params)
+    void
+    internal::EntityCollector::include(const IncludedFile & file, unsigned line)
     {
-#define RAW_DATA(n, x) std::pair<const std::string, unsigned>(n, x)
-        const static std::pair<const std::string, unsigned> raw_data[] = {
-            RAW_DATA("byte", 1),
-            RAW_DATA("word", 4),
-            RAW_DATA("long", 8)
-        };
-#undef RAW_DATA
-        const static std::map<std::string, unsigned> data(raw_data, raw_data + sizeof(raw_data) / sizeof(raw_data[0]));
+        // Cached entities are shared, not copied. Appending file.entities as a
+        // whole would move them out of the cache.
+        arena.attach(file.arena);
+        for (Sequence<AssemblyEntityPtr>::Iterator e(file.entities.begin()), e_end(file.entities.end()) ;
+                e != e_end ; ++e)
+        {
+            entities.append(*e);
+            lines.append(line);
+        }
+    }
 
-        std::tr1::shared_ptr<AssemblyEntity> result;
+    void
+    internal::EntityEmitter::emit(const char * buffer, const LexedLine & l)
+    {
+        emit_entities(buffer, l, sink, instructions);
+    }
 
-        std::map<std::string, unsigned>::const_iterator d(data.find(name));
-        if (data.end() != d)
+    void
+    internal::EntityEmitter::include(const IncludedFile & file, unsigned line)
+    {
+        SyntaxContext::Line l(line);
+
+        for (Sequence<AssemblyEntityPtr>::Iterator e(file.entities.begin()), e_end(file.entities.end()) ;
+                e != e_end ; ++e)
         {
-            result = make_shared_ptr(new Data(d->second, ExpressionParser::parse(params)));
+            (*e)->accept(sink);
         }
-        else
+    }
+
+    /**
+     * Handle an .include directive in line, if there is one.
+     *
+     * Relative paths are resolved against directory. Returns false if line is
+     * not an .include directive.
+     */
+    static bool include(const char * buffer, const LexedLine & line, const std::string & directory,
+            MacroProcessor & macros, internal::EntitySink & sink)
+    {
+        if ((! line.directive) || (7 != line.mnemonic.length) || (0 != std::memcmp(buffer + line.mnemonic.offset, "include", 7)))
+            return false;
+
+        SyntaxContext::Line(line.number);
+
+        const char * begin(buffer + line.params.offset), * end(begin + line.params.length);
+        while ((begin != end) && std::isspace(*begin))
+            ++begin;
+        while ((begin != end) && std::isspace(*(end - 1)))
+            --end;
+
+        if ((end - begin < 2) || ('"' != *begin) || ('"' != *(end - 1)))
+            throw CommonSyntaxError(".include expects a quoted file name");
+
+        std::string path(begin + 1, end - 1);
+        if (path.empty())
+            throw CommonSyntaxError(".include expects a quoted file name");
+
+        if (('/' != path[0]) && (! directory.empty()))
+            path = directory + "/" + path;
+
+        if (! line.label.empty())
         {
-            result = make_shared_ptr(new Directive(name, params));
+            LexedLine label(line);
+            label.directive = false;
+            label.mnemonic = Token();
+            sink.emit(buffer, label);
         }
 
-        return result;
+        IncludedFilePtr file(IncludeCache::instance().get(path));
+        sink.include(*file, line.number);
+        macros.define(file->macros);
+
+        return true;
     }
 
-    Sequence<std::tr1::shared_ptr<AssemblyEntity> >
-    AssemblyParser::parse(std::istream & input)
+    void
+    internal::IncludingSink::emit(const char * buffer, const LexedLine & l)
     {
-        Sequence<std::tr1::shared_ptr<AssemblyEntity> > result;
+        if (! gpu::include(buffer, l, directory, *macros, sink))
+            sink.emit(buffer, l);
+    }
+
+    /// Return the directory part of filename, or an empty string if there is none.
+    static std::string directory_of(const std::string & filename)
+    {
+        std::string::size_type slash(filename.rfind('/'));
+        if (std::string::npos == slash)
+            return std::string();
+
+        return filename.substr(0, std::max<std::string::size_type>(slash, 1));
+    }
+
+    static void process_stream(std::istream & input, internal::EntitySink & sink)
+    {
+        internal::IncludingSink including(sink, std::string());
+        MacroProcessor macros(including);
+        including.macros = &macros;
+        LexedLine lexed;
         std::string line;
         unsigned number(0);
 
         while (std::getline(input, line))
         {
             ++number;
-            result.append(make_shared_ptr(new Line(number)));
 
-            line = strip_whitespaces(line);
+            const char * begin(line.data());
+            AssemblyLexer::lex(begin, begin, begin + line.size(), lexed);
+            lexed.number = number;
+
+            macros.process(begin, lexed);
+        }
+
+        macros.finish();
+    }
+
+    static void process_buffer(const MappedFile & file, internal::EntitySink & sink, MacroDefinitions & definitions)
+    {
+        // errors name the file, as they do when it is parsed in parallel
+        SyntaxContext::File context(file.filename());
+        internal::IncludingSink including(sink, directory_of(file.filename()));
+        MacroProcessor macros(including);
+        including.macros = &macros;
+        AssemblyLexer lexer(file.begin(), file.end());
+        LexedLine lexed;
+
+        while (lexer.next(lexed))
+        {
+            macros.process(lexer.buffer(), lexed);
+        }
+
+        macros.finish();
+        definitions = macros.definitions();
+    }
+
+    static void process_buffer(const MappedFile & file, internal::EntitySink & sink)
+    {
+        MacroDefinitions definitions;
+
+        process_buffer(file, sink, definitions);
+    }
+
+    void
+    AssemblyParser::parse(std::istream & input, AssemblyEntityVisitor & sink)
+    {
+        internal::EntityEmitter emitter(sink);
+
+        process_stream(input, emitter);
+    }
+
+    void
+    AssemblyParser::parse(const MappedFile & file, AssemblyEntityVisitor & sink)
+    {
+        internal::EntityEmitter emitter(sink);
+
+        process_buffer(file, emitter);
+    }
+
+    void
+    AssemblyParser::parse(std::istream & input, LexedEntityVisitor & sink)
+    {
+        internal::EntityEmitter emitter(sink);
+
+        process_stream(input, emitter);
+    }
+
+    void
+    AssemblyParser::parse(const MappedFile & file, LexedEntityVisitor & sink)
+    {
+        internal::EntityEmitter emitter(sink);
+
+        process_buffer(file, emitter);
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(std::istream & input, Arena & arena, LineTable & lines)
+    {
+        internal::EntityCollector collector(arena, lines);
+
+        process_stream(input, collector);
+
+        return collector.entities;
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(std::istream & input, Arena & arena)
+    {
+        LineTable lines;
+
+        return parse(input, arena, lines);
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(const MappedFile & file, Arena & arena, LineTable & lines, MacroDefinitions & macros)
+    {
+        internal::EntityCollector collector(arena, lines);
+
+        process_buffer(file, collector, macros);
+
+        return collector.entities;
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(const MappedFile & file, Arena & arena, LineTable & lines)
+    {
+        MacroDefinitions macros;
+
+        return parse(file, arena, lines, macros);
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(const MappedFile & file, Arena & arena)
+    {
+        LineTable lines;
+
+        return parse(file, arena, lines);
+    }
+
+    template <>
+    struct Implementation<AssemblyLineCollector>
+    {
+        internal::EntityCollector collector;
+
+        Implementation(Arena & arena, LineTable & lines) :
+            collector(arena, lines)
+        {
+        }
+    };
+
+    AssemblyLineCollector::AssemblyLineCollector(Arena & arena, LineTable & lines) :
+        PrivateImplementationPattern<AssemblyLineCollector>(new Implementation<AssemblyLineCollector>(arena, lines))
+    {
+    }
+
+    AssemblyLineCollector::~AssemblyLineCollector()
+    {
+    }
+
+    void
+    AssemblyLineCollector::emit(const char * buffer, const LexedLine & line)
+    {
+        _imp->collector.emit(buffer, line);
+    }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyLineCollector::entities() const
+    {
+        return _imp->collector.entities;
+    }
+
+    namespace internal
+    {
+        struct ParseJob
+        {
+            std::string filename;
+
+            const char * begin;
+
+            const char * end;
+
+            unsigned first_line;
 
-            std::string comment(strip_whitespaces(split_comment(line)));
-            std::string label(strip_whitespaces(split_label(line)));
-            std::string rest(strip_whitespaces(line));
+            unsigned lines;
 
-            if (! label.empty())
-                result.append(make_shared_ptr(new Label(label)));
+            /// Whether the chunk may use macros or includes, which need to be processed in one piece.
+            bool serial;
 
-            if (! rest.empty())
+            Arena arena;
+
+            Sequence<AssemblyEntityPtr> entities;
+
+            LineTable line_table;
+
+            enum { none, syntax_error, other_error, out_of_memory } failure;
+
+            std::string message;
+
+            ParseJob(const std::string & f, const char * b, const char * e) :
+                filename(f),
+                begin(b),
+                end(e),
+                first_line(1),
+                lines(0),
+                serial(false),
+                failure(none)
             {
-                if (is_directive(rest))
+            }
+        };
+
+        typedef std::tr1::shared_ptr<ParseJob> ParseJobPtr;
+
+        /// Return whether [begin, end) may contain an .include directive.
+        static bool mentions_include(const char * begin, const char * end)
+        {
+            const static char needle[] = ".include";
+            const unsigned size(sizeof(needle) - 1);
+
+            for (const char * c(begin) ; unsigned(end - c) >= size ; ++c)
+            {
+                c = static_cast<const char *>(std::memchr(c, '.', end - c - size + 1));
+                if (! c)
+                    break;
+
+                if (0 == std::memcmp(c, needle, size))
+                    return true;
+            }
+
+            return false;
+        }
+
+        /// Count the lines that start in a job's chunk, and look for macros and includes.
+        static void * count_job(void * argument)
+        {
+            ParseJob * job(static_cast<ParseJob *>(argument));
+
+            job->lines = std::count(job->begin, job->end, '\n');
+            if ((job->begin != job->end) && ('\n' != *(job->end - 1)))
+                ++job->lines;
+
+            job->serial = MacroProcessor::mentioned_in(job->begin, job->end)
+                || mentions_include(job->begin, job->end);
+
+            return 0;
+        }
+
+        /// Parse a job's chunk, starting at its first line.
+        static void * parse_job(void * argument)
+        {
+            ParseJob * job(static_cast<ParseJob *>(argument));
+
+            try
+            {
+                SyntaxContext::File f(job->filename);
+                EntityCollector collector(job->arena, job->line_table);
+                AssemblyLexer lexer(job->begin, job->end, job->first_line);
+                LexedLine lexed;
+
+                while (lexer.next(lexed))
                 {
-                    std::string name(split_first_word("\t ", rest).substr(1));
-                    std::string params(strip_whitespaces(rest));
+                    collector.emit(lexer.buffer(), lexed);
+                }
+
+                job->entities = collector.entities;
+            }
+            catch (SyntaxError & e)
+            {
+                job->failure = ParseJob::syntax_error;
+                job->message = e.message();
+            }
+            catch (Exception & e)
+            {
+                job->failure = ParseJob::other_error;
+                job->message = e.message();
+            }
+            catch (std::bad_alloc &)
+            {
+                job->failure = ParseJob::out_of_memory;
+            }
+            catch (std::exception & e)
+            {
+                job->failure = ParseJob::other_error;
+                job->message = e.what();
+            }
+            catch (...)
+            {
+                // nothing may escape the start routine of a thread
+                job->failure = ParseJob::other_error;
+                job->message = "Unknown exception";
+            }
+
+            return 0;
+        }
 
-                    result.append(make_directive(name, params));
+        /// Run function on all jobs, using the calling thread for the first one.
+        static void run_jobs(void * (* function)(void *), const std::vector<ParseJobPtr> & jobs)
+        {
+            std::vector<pthread_t> threads(jobs.size());
+            std::vector<bool> started(jobs.size(), false);
+
+            for (unsigned i(1) ; i < jobs.size() ; ++i)
+            {
+                started[i] = (0 == pthread_create(&threads[i], 0, function, jobs[i].get()));
+            }
+
+            function(jobs[0].get());
+
+            for (unsigned i(1) ; i < jobs.size() ; ++i)
+            {
+                if (started[i])
+                {
+                    pthread_join(threads[i], 0);
                 }
                 else
                 {
-                    std::string mnemonic(split_first_word("\t ", rest));
-                    std::string operands(strip_whitespaces(rest));
+                    // Could not spawn a thread; do the work ourselves.
+                    function(jobs[i].get());
+                }
+            }
+        }
+    }
 
-                    Instruction * i(new Instruction(mnemonic));
-                    while (! operands.empty())
-                    {
-                        i->operands.append(split_first_word(",", operands));
-                        operands = strip_whitespaces(operands);
-                    }
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(const MappedFile & file, Arena & arena, LineTable & lines, unsigned jobs)
+    {
+        if (0 == jobs)
+        {
+            // Chunks smaller than this are not worth a thread.
+            const static unsigned minimum_chunk_size(1 << 20);
 
-                    result.append(make_shared_ptr(i));
-                }
+            long processors(::sysconf(_SC_NPROCESSORS_ONLN));
+            jobs = (processors > 0) ? processors : 1;
+            jobs = std::max(1u, std::min(jobs, file.size() / minimum_chunk_size));
+        }
+
+        if (1 == jobs)
+            return parse(file, arena, lines);
+
+        std::vector<internal::ParseJobPtr> chunks;
+        const char * begin(file.begin()), * const end(file.end());
+        unsigned chunk_size(file.size() / jobs);
+        for (unsigned i(0) ; i < jobs ; ++i)
+        {
+            const char * chunk_end(end);
+            if ((i + 1 < jobs) && (chunk_size < unsigned(end - begin)))
+            {
+                const char * newline(static_cast<const char *>(std::memchr(begin + chunk_size, '\n', end - begin - chunk_size)));
+                if (newline)
+                    chunk_end = newline + 1;
             }
 
-            if (! comment.empty())
-                result.append(make_shared_ptr(new Comment(comment)));
+            chunks.push_back(internal::ParseJobPtr(new internal::ParseJob(file.filename(), begin, chunk_end)));
+
+            begin = chunk_end;
+        }
+
+        internal::run_jobs(&internal::count_job, chunks);
+
+        for (unsigned i(0) ; i < jobs ; ++i)
+        {
+            // Macros may be defined in one chunk and used in another.
+            if (chunks[i]->serial)
+                return parse(file, arena, lines);
+        }
+
+        for (unsigned i(1) ; i < jobs ; ++i)
+        {
+            chunks[i]->first_line = chunks[i - 1]->first_line + chunks[i - 1]->lines;
+        }
+
+        internal::run_jobs(&internal::parse_job, chunks);
+
+        Sequence<AssemblyEntityPtr> result;
+        for (std::vector<internal::ParseJobPtr>::const_iterator c(chunks.begin()), c_end(chunks.end()) ; c != c_end ; ++c)
+        {
+            switch ((*c)->failure)
+            {
+                case internal::ParseJob::none:
+                    break;
+
+                case internal::ParseJob::syntax_error:
+                    throw ForwardedSyntaxError((*c)->message);
+
+                case internal::ParseJob::other_error:
+                    throw InternalError("common", "Parallel parsing failed: " + (*c)->message);
+
+                case internal::ParseJob::out_of_memory:
+                    throw std::bad_alloc();
+            }
+
+            arena.attach((*c)->arena);
+            result.append((*c)->entities);
+            lines.append((*c)->line_table);
         }
 
         return result;
     }
+
+    Sequence<AssemblyEntityPtr>
+    AssemblyParser::parse(const MappedFile & file, Arena & arena, unsigned jobs)
+    {
+        LineTable lines;
+
+        return parse(file, arena, lines, jobs);
+    }
 }
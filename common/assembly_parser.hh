@@ -20,18 +20,119 @@
 #ifndef GPU_GUARD_COMMON_ASSEMBLY_PARSER_HH
 #define GPU_GUARD_COMMON_ASSEMBLY_PARSER_HH 1
 
-#include <common/assembly_entities-fwd.hh>
-#include <utils/memory.hh>
+#include <common/assembly_entities.hh>
+#include <common/line_table.hh>
+#include <common/macro_processor.hh>
+#include <utils/arena.hh>
+#include <utils/private_implementation_pattern.hh>
 #include <utils/sequence.hh>
 
 #include <istream>
 
 namespace gpu
 {
+    class MappedFile;
+
+    /**
+     * AssemblyParser turns assembly source into AssemblyEntities.
+     *
+     * All overloads expand .macro, .rept and .irp blocks through a
+     * MacroProcessor before creating any entities.
+     *
+     * An .include "file" directive splices in the entities of file, as
+     * parsed by the IncludeCache, along with the macros that file defines.
+     * Relative names are resolved against the directory of the including
+     * file, or against the working directory when parsing a stream. All
+     * included entities are recorded at the line of the .include directive.
+     * Within a .macro, .rept or .irp block, the file is included once per
+     * expansion.
+     */
     class AssemblyParser
     {
         public:
-            static Sequence<std::tr1::shared_ptr<AssemblyEntity> > parse(std::istream &);
+            /**
+             * Parse assembly source from a stream.
+             *
+             * All entities are created in arena, which needs to outlive the
+             * returned sequence. The source line of each entity is recorded
+             * in lines, in sequence order.
+             */
+            static Sequence<AssemblyEntityPtr> parse(std::istream &, Arena & arena, LineTable & lines);
+
+            /// Parse assembly source from a stream, discarding line information.
+            static Sequence<AssemblyEntityPtr> parse(std::istream &, Arena & arena);
+
+            /**
+             * Parse a memory-mapped source file.
+             *
+             * The file is lexed in place. Text is only copied into the
+             * resulting entities, which are created in arena.
+             */
+            static Sequence<AssemblyEntityPtr> parse(const MappedFile &, Arena & arena, LineTable & lines);
+
+            /// Parse a memory-mapped source file, and return the macros it defines in macros.
+            static Sequence<AssemblyEntityPtr> parse(const MappedFile &, Arena & arena, LineTable & lines, MacroDefinitions & macros);
+
+            /// Parse a memory-mapped source file, discarding line information.
+            static Sequence<AssemblyEntityPtr> parse(const MappedFile &, Arena & arena);
+
+            /**
+             * Parse a memory-mapped source file on several threads.
+             *
+             * The file is split into jobs chunks at line boundaries, and each
+             * chunk is parsed by its own worker. The result is identical to
+             * that of the serial parse. Pass 0 to use one job per online
+             * processor. Files that use macro or .include directives are
+             * parsed by a single worker.
+             */
+            static Sequence<AssemblyEntityPtr> parse(const MappedFile &, Arena & arena, LineTable & lines, unsigned jobs);
+
+            /// Parse a memory-mapped source file on several threads, discarding line information.
+            static Sequence<AssemblyEntityPtr> parse(const MappedFile &, Arena & arena, unsigned jobs);
+
+            /**
+             * Parse assembly source from a stream, and hand each entity to
+             * sink as soon as it has been parsed.
+             *
+             * Entities only live for the duration of the visit. A sink that
+             * needs to keep an entity has to copy it.
+             */
+            static void parse(std::istream &, AssemblyEntityVisitor & sink);
+
+            /// Parse a memory-mapped source file, and hand each entity to sink.
+            static void parse(const MappedFile &, AssemblyEntityVisitor & sink);
+
+            /**
+             * Parse assembly source from a stream, and hand each entity to
+             * sink. Instructions of the source are handed over as
+             * LexedInstructions, so no Instruction is built for them.
+             * Instructions from included files are still visited as such.
+             */
+            static void parse(std::istream &, LexedEntityVisitor & sink);
+
+            /// Parse a memory-mapped source file, handing over instructions as LexedInstructions.
+            static void parse(const MappedFile &, LexedEntityVisitor & sink);
+    };
+
+    /**
+     * AssemblyLineCollector turns lexed lines into AssemblyEntities, for
+     * callers that drive a MacroProcessor of their own.
+     *
+     * Entities are created in arena, and their lines recorded in lines.
+     */
+    class AssemblyLineCollector :
+        public LexedLineSink,
+        public PrivateImplementationPattern<AssemblyLineCollector>
+    {
+        public:
+            AssemblyLineCollector(Arena & arena, LineTable & lines);
+
+            ~AssemblyLineCollector();
+
+            void emit(const char * buffer, const LexedLine & line);
+
+            /// Return the entities collected so far.
+            Sequence<AssemblyEntityPtr> entities() const;
     };
 }
 
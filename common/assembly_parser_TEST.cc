@@ -20,6 +20,8 @@
 #include <tests/tests.hh>
 #include <common/assembly_entities.hh>
 #include <common/assembly_parser.hh>
+#include <common/syntax.hh>
+#include <utils/mapped_file.hh>
 #include <utils/memory.hh>
 #include <utils/sequence-impl.hh>
 
@@ -29,6 +31,35 @@
 using namespace gpu;
 using namespace tests;
 
+namespace
+{
+    /// Prints entities, and marks instructions that arrive as tokens.
+    struct LexedPrinter :
+        public LexedEntityVisitor
+    {
+        AssemblyEntityPrinter printer;
+
+        unsigned lexed;
+
+        LexedPrinter() :
+            lexed(0)
+        {
+        }
+
+        void visit(const Comment & c) { printer.visit(c); }
+        void visit(const Data & d) { printer.visit(d); }
+        void visit(const Directive & d) { printer.visit(d); }
+        void visit(const Instruction & i) { printer.visit(i); }
+        void visit(const Label & l) { printer.visit(l); }
+
+        void visit(const LexedInstruction & i)
+        {
+            ++lexed;
+            printer.visit(i.instruction());
+        }
+    };
+}
+
 struct AssemblyParserTest :
     public Test
 {
@@ -45,14 +76,26 @@ struct AssemblyParserTest :
         std::fstream input(input_name.c_str(), std::ios_base::in);
         std::fstream reference(reference_name.c_str(), std::ios_base::in);
 
+        Arena arena;
+
         AssemblyEntityPrinter p;
-        Sequence<std::tr1::shared_ptr<AssemblyEntity> > entities(AssemblyParser::parse(input));
-        for (Sequence<std::tr1::shared_ptr<AssemblyEntity> >::Iterator i(entities.begin()), i_end(entities.end()) ;
+        LineTable lines;
+        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+        for (Sequence<AssemblyEntityPtr>::Iterator i(entities.begin()), i_end(entities.end()) ;
                 i != i_end ; ++i)
         {
             (*i)->accept(p);
         }
 
+        AssemblyEntityPrinter q;
+        LineTable mapped_lines;
+        Sequence<AssemblyEntityPtr> mapped_entities(AssemblyParser::parse(MappedFile(input_name), arena, mapped_lines));
+        for (Sequence<AssemblyEntityPtr>::Iterator i(mapped_entities.begin()), i_end(mapped_entities.end()) ;
+                i != i_end ; ++i)
+        {
+            (*i)->accept(q);
+        }
+
         std::string ref_str(""), line;
         while (std::getline(reference, line))
         {
@@ -60,11 +103,89 @@ struct AssemblyParserTest :
         }
 
         TEST_CHECK_EQUAL(p.output(), ref_str);
+        TEST_CHECK_EQUAL(q.output(), ref_str);
+
+        TEST_CHECK_EQUAL(lines.size(), entities.size());
+        TEST_CHECK_EQUAL(mapped_lines.size(), entities.size());
+        for (unsigned i(0) ; i < lines.size() ; ++i)
+        {
+            TEST_CHECK_EQUAL(mapped_lines.line(i), lines.line(i));
+        }
+
+        for (unsigned jobs(2) ; jobs <= 5 ; ++jobs)
+        {
+            AssemblyEntityPrinter r;
+            LineTable parallel_lines;
+            Sequence<AssemblyEntityPtr> parallel_entities(AssemblyParser::parse(MappedFile(input_name), arena, parallel_lines, jobs));
+            for (Sequence<AssemblyEntityPtr>::Iterator i(parallel_entities.begin()), i_end(parallel_entities.end()) ;
+                    i != i_end ; ++i)
+            {
+                (*i)->accept(r);
+            }
+
+            TEST_CHECK_EQUAL(r.output(), ref_str);
+
+            TEST_CHECK_EQUAL(parallel_lines.size(), lines.size());
+            for (unsigned i(0) ; i < lines.size() ; ++i)
+            {
+                TEST_CHECK_EQUAL(parallel_lines.line(i), lines.line(i));
+            }
+        }
     }
 
     virtual void run()
     {
         run_one("sum");
+
+        // every line yields one entity, except for the empty third line and the second, which also holds a label
+        std::stringstream input(".text\nfoo: .globl foo\n\n\tnop\n");
+        Arena arena;
+        LineTable lines;
+        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+        TEST_CHECK_EQUAL(lines.size(), 4u);
+        TEST_CHECK_EQUAL(lines.line(0), 1u);
+        TEST_CHECK_EQUAL(lines.line(1), 2u);
+        TEST_CHECK_EQUAL(lines.line(2), 2u);
+        TEST_CHECK_EQUAL(lines.line(3), 4u);
+
+        // a LexedEntityVisitor receives the same instructions, as tokens
+        std::string source("l: mov $0.x, $1.x\n\t.byte 1\n\tnop\n\tadd\t$2.y,  $3.z , 0x10\n");
+        std::stringstream generic_input(source), lexed_input(source);
+        AssemblyEntityPrinter generic;
+        LexedPrinter lexed;
+        AssemblyParser::parse(generic_input, generic);
+        AssemblyParser::parse(lexed_input, lexed);
+        TEST_CHECK_EQUAL(lexed.printer.output(), generic.output());
+        TEST_CHECK_EQUAL(lexed.lexed, 3u);
+
+        // errors read the same, however many jobs parse the file
+        std::string bad_name(std::string(GPU_BUILDDIR) + "/common/assembly_parser_TEST_bad.s");
+        {
+            std::ofstream bad(bad_name.c_str());
+            for (unsigned i(1) ; i < 3002 ; ++i)
+                bad << "\tnop\n";
+            bad << "\t.byte 1+\n\tnop\n";
+        }
+
+        std::string serial(error_message(bad_name, 1)), parallel(error_message(bad_name, 4));
+        TEST_CHECK_EQUAL(serial.substr(0, bad_name.size() + 6), bad_name + ":3002:");
+        TEST_CHECK_EQUAL(parallel, serial);
+    }
+
+    std::string error_message(const std::string & name, unsigned jobs)
+    {
+        try
+        {
+            Arena arena;
+            LineTable lines;
+            AssemblyParser::parse(MappedFile(name), arena, lines, jobs);
+        }
+        catch (SyntaxError & e)
+        {
+            return e.message();
+        }
+
+        return "";
     }
 } assembly_parser_test;
 
@@ -0,0 +1,76 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/diagnostics.hh>
+#include <utils/exception.hh>
+
+namespace gpu
+{
+    Diagnostics::Diagnostics()
+    {
+    }
+
+    Diagnostics::~Diagnostics()
+    {
+    }
+
+    ParseStatus
+    Diagnostics::error(ParseStatus status, const std::string & message)
+    {
+        _messages.push_back(message);
+
+        return status;
+    }
+
+    void
+    Diagnostics::clear()
+    {
+        _messages.clear();
+    }
+
+    bool
+    Diagnostics::empty() const
+    {
+        return _messages.empty();
+    }
+
+    unsigned
+    Diagnostics::size() const
+    {
+        return _messages.size();
+    }
+
+    const std::string &
+    Diagnostics::message(unsigned index) const
+    {
+        if (index >= _messages.size())
+            throw InternalError("common", "Diagnostics index out of range");
+
+        return _messages[index];
+    }
+
+    const std::string &
+    Diagnostics::last() const
+    {
+        if (_messages.empty())
+            throw InternalError("common", "No diagnostics recorded");
+
+        return _messages.back();
+    }
+}
@@ -0,0 +1,75 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_DIAGNOSTICS_HH
+#define GPU_GUARD_COMMON_DIAGNOSTICS_HH 1
+
+#include <string>
+#include <vector>
+
+namespace gpu
+{
+    /**
+     * ParseStatus is returned by the non-throwing parser interfaces.
+     */
+    enum ParseStatus
+    {
+        ps_success = 0,
+        ps_empty_input,
+        ps_syntax_error,
+        ps_out_of_bounds
+    };
+
+    /**
+     * Diagnostics collects the messages of the non-throwing parser
+     * interfaces, which record one message for each failed parse.
+     *
+     * Nothing is allocated until the first message is recorded, so a
+     * Diagnostics object is cheap to create for a single parse, and can be
+     * reused across many parses through clear().
+     */
+    class Diagnostics
+    {
+        private:
+            std::vector<std::string> _messages;
+
+        public:
+            Diagnostics();
+
+            ~Diagnostics();
+
+            /// Record message, and return status for the convenience of the parsers.
+            ParseStatus error(ParseStatus status, const std::string & message);
+
+            /// Forget all messages.
+            void clear();
+
+            bool empty() const;
+
+            unsigned size() const;
+
+            /// Return the index-th message.
+            const std::string & message(unsigned index) const;
+
+            /// Return the most recently recorded message.
+            const std::string & last() const;
+    };
+}
+
+#endif
@@ -26,10 +26,14 @@ namespace gpu
 {
     struct Expression;
 
+    class CompiledExpression;
+
     typedef std::tr1::shared_ptr<Expression> ExpressionPtr;
 
     struct Difference;
 
+    struct Operation;
+
     struct Product;
 
     struct Sum;
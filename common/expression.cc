@@ -18,11 +18,17 @@
 */
 
 #include <common/expression.hh>
-#include <utils/destringify.hh>
+#include <common/syntax.hh>
+#include <utils/exception.hh>
+#include <utils/number_parser.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 #include <utils/stringify.hh>
 #include <utils/text_manipulation.hh>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -78,6 +84,121 @@ namespace gpu
         return _imp->rhs;
     }
 
+    template <>
+    Visits<Operation>::~Visits()
+    {
+    }
+
+    template <>
+    struct Implementation<Operation>
+    {
+        Operation::Operator op;
+
+        ExpressionPtr lhs;
+
+        ExpressionPtr rhs;
+
+        Implementation(Operation::Operator op, const ExpressionPtr & lhs, const ExpressionPtr & rhs) :
+            op(op),
+            lhs(lhs),
+            rhs(rhs)
+        {
+        }
+    };
+
+    Operation::Operation(Operator op, const ExpressionPtr & lhs, const ExpressionPtr & rhs) :
+        PrivateImplementationPattern<Operation>(new Implementation<Operation>(op, lhs, rhs))
+    {
+    }
+
+    Operation::~Operation()
+    {
+    }
+
+    void
+    Operation::accept(ExpressionVisitor & visitor)
+    {
+        static_cast<Visits<Operation> *>(&visitor)->visit(*this);
+    }
+
+    ExpressionPtr
+    Operation::left_hand_side() const
+    {
+        return _imp->lhs;
+    }
+
+    ExpressionPtr
+    Operation::right_hand_side() const
+    {
+        return _imp->rhs;
+    }
+
+    Operation::Operator
+    Operation::op() const
+    {
+        return _imp->op;
+    }
+
+    unsigned
+    Operation::apply(Operator op, unsigned lhs, unsigned rhs)
+    {
+        switch (op)
+        {
+            case bitwise_or:
+                return lhs | rhs;
+
+            case bitwise_xor:
+                return lhs ^ rhs;
+
+            case bitwise_and:
+                return lhs & rhs;
+
+            case shift_left:
+                return rhs < 32 ? lhs << rhs : 0;
+
+            case shift_right:
+                if (int(lhs) < 0)
+                    return rhs < 32 ? ~(~lhs >> rhs) : ~0u;
+
+                return rhs < 32 ? lhs >> rhs : 0;
+
+            case product:
+                return lhs * rhs;
+
+            case quotient:
+                if (0 == rhs)
+                    throw CommonSyntaxError("division by zero");
+
+                // the only quotient that overflows wraps around
+                if (~0u == rhs)
+                    return -lhs;
+
+                return int(lhs) / int(rhs);
+
+            case remainder:
+                if (0 == rhs)
+                    throw CommonSyntaxError("division by zero");
+
+                if (~0u == rhs)
+                    return 0;
+
+                return int(lhs) % int(rhs);
+        }
+
+        throw InternalError("common", "unknown operator " + stringify(unsigned(op)));
+    }
+
+    const char *
+    Operation::text(Operator op)
+    {
+        static const char * const texts[] =
+        {
+            "|", "^", "&", "<<", ">>", "*", "/", "%"
+        };
+
+        return texts[op];
+    }
+
     template <>
     Visits<Sum>::~Visits()
     {
@@ -223,177 +344,463 @@ namespace gpu
     }
 }
 
-namespace
+namespace gpu
 {
-    bool is_dec_value(const std::string & input)
+    namespace internal
     {
-        static std::string allowed_chars("1234567890");
-        static std::string allowed_first_chars("+-" + allowed_chars);
+        /// Recursive descent over the text of one expression, by precedence.
+        class ExpressionReader
+        {
+            private:
+                enum Kind
+                {
+                    k_sum = -2,
+                    k_difference = -1
+                };
 
-        if (std::string::npos == allowed_first_chars.find(input[0]))
-            return false;
+                struct BinaryOperator
+                {
+                    const char * text;
 
-        if (std::string::npos != input.substr(1).find_first_not_of(allowed_chars))
-            return false;
+                    unsigned level;
 
-        return true;
-    }
+                    int kind;
+                };
 
-    bool is_hex_value(const std::string & input)
-    {
-        static std::string allowed_chars("1234567890abcdefgABCDEF");
+                static const unsigned levels = 6;
 
-        if ("0x" != input.substr(0, 2))
-            return false;
+                const std::string & _text;
 
-        if (std::string::npos != input.substr(2).find_first_not_of(allowed_chars))
-            return false;
+                std::string::size_type _position;
 
-        return true;
-    }
+                void fail(const std::string & message) const
+                {
+                    throw CommonSyntaxError("malformed expression '" + strip_whitespaces(_text) + "': " + message);
+                }
 
-    long dehexify(const std::string & s)
-    {
-        long result;
-        std::stringstream ss(s);
-        ss.setf(std::ios::hex, std::ios::basefield);
+                void skip()
+                {
+                    while ((_position < _text.size()) && std::isspace(static_cast<unsigned char>(_text[_position])))
+                        ++_position;
+                }
 
-        ss >> result;
+                bool accept(const char * token)
+                {
+                    skip();
 
-        return result;
+                    std::string::size_type size(std::strlen(token));
+                    if (0 != _text.compare(_position, size, token))
+                        return false;
+
+                    _position += size;
+
+                    return true;
+                }
+
+                static bool symbol_character(char c, bool first)
+                {
+                    return std::isalpha(static_cast<unsigned char>(c)) || ('_' == c) || ('.' == c) || ('$' == c)
+                        || ((! first) && std::isdigit(static_cast<unsigned char>(c)));
+                }
+
+                static Value * constant(const ExpressionPtr & e)
+                {
+                    return dynamic_cast<Value *>(e.get());
+                }
+
+                static ExpressionPtr combine(int kind, const ExpressionPtr & lhs, const ExpressionPtr & rhs)
+                {
+                    Value * l(constant(lhs)), * r(constant(rhs));
+
+                    switch (kind)
+                    {
+                        case k_sum:
+                            if (l && r)
+                                return ExpressionPtr(new Value(l->value() + r->value()));
+
+                            return ExpressionPtr(new Sum(lhs, rhs));
+
+                        case k_difference:
+                            if (l && r)
+                                return ExpressionPtr(new Value(l->value() - r->value()));
+
+                            return ExpressionPtr(new Difference(lhs, rhs));
+                    }
+
+                    Operation::Operator op(static_cast<Operation::Operator>(kind));
+                    if (l && r)
+                        return ExpressionPtr(new Value(Operation::apply(op, l->value(), r->value())));
+
+                    return ExpressionPtr(new Operation(op, lhs, rhs));
+                }
+
+                ExpressionPtr primary()
+                {
+                    skip();
+
+                    std::string::size_type begin(_position);
+                    if ((_position < _text.size()) && std::isdigit(static_cast<unsigned char>(_text[_position])))
+                    {
+                        while ((_position < _text.size()) && symbol_character(_text[_position], false))
+                            ++_position;
+
+                        long value;
+                        if ((! NumberParser::parse(_text.data() + begin, _text.data() + _position, value)) || (value > 0xffffffffL))
+                            fail("'" + _text.substr(begin, _position - begin) + "' is not a 32 bit number");
+
+                        return ExpressionPtr(new Value(value));
+                    }
+
+                    if ((_position < _text.size()) && symbol_character(_text[_position], true))
+                    {
+                        while ((_position < _text.size()) && symbol_character(_text[_position], false))
+                            ++_position;
+
+                        return ExpressionPtr(new Variable(_text.substr(begin, _position - begin)));
+                    }
+
+                    if (_position == _text.size())
+                        fail("expected an operand at the end");
+
+                    fail("expected an operand at '" + _text.substr(_position) + "'");
+
+                    return ExpressionPtr();
+                }
+
+                ExpressionPtr unary()
+                {
+                    if (accept("-"))
+                        return combine(k_difference, ExpressionPtr(new Value(0)), unary());
+
+                    if (accept("~"))
+                        return combine(Operation::bitwise_xor, unary(), ExpressionPtr(new Value(~0u)));
+
+                    if (accept("+"))
+                        return unary();
+
+                    if (accept("("))
+                    {
+                        ExpressionPtr result(binary(0));
+                        if (! accept(")"))
+                            fail("expected ')'");
+
+                        return result;
+                    }
+
+                    return primary();
+                }
+
+                ExpressionPtr binary(unsigned level)
+                {
+                    static const BinaryOperator operators[] =
+                    {
+                        { "|",  0, Operation::bitwise_or },
+                        { "^",  1, Operation::bitwise_xor },
+                        { "&",  2, Operation::bitwise_and },
+                        { "<<", 3, Operation::shift_left },
+                        { ">>", 3, Operation::shift_right },
+                        { "+",  4, k_sum },
+                        { "-",  4, k_difference },
+                        { "*",  5, Operation::product },
+                        { "/",  5, Operation::quotient },
+                        { "%",  5, Operation::remainder }
+                    };
+                    static const BinaryOperator * operators_end(operators + sizeof(operators) / sizeof(BinaryOperator));
+
+                    if (levels == level)
+                        return unary();
+
+                    ExpressionPtr result(binary(level + 1));
+                    while (true)
+                    {
+                        const BinaryOperator * o(operators);
+                        for ( ; o != operators_end ; ++o)
+                        {
+                            if ((level == o->level) && accept(o->text))
+                                break;
+                        }
+
+                        if (operators_end == o)
+                            return result;
+
+                        result = combine(o->kind, result, binary(level + 1));
+                    }
+                }
+
+            public:
+                ExpressionReader(const std::string & text) :
+                    _text(text),
+                    _position(0)
+                {
+                }
+
+                ExpressionPtr read()
+                {
+                    skip();
+                    if (_text.size() == _position)
+                        fail("expected an expression");
+
+                    ExpressionPtr result(binary(0));
+
+                    skip();
+                    if (_text.size() != _position)
+                        fail("unexpected '" + _text.substr(_position) + "'");
+
+                    return result;
+                }
+        };
     }
-}
 
-namespace gpu
-{
     ExpressionPtr
     ExpressionParser::parse(const std::string & expression)
     {
-        const static std::string operators("+-");
+        return internal::ExpressionReader(expression).read();
+    }
 
-        Expression * result(0);
-        std::string input(strip_whitespaces(expression));
+    RelocatableValue::RelocatableValue(unsigned value) :
+        addend(value)
+    {
+    }
 
-        if (input.empty())
-            return ExpressionPtr(); // ToDo: Throw!
+    RelocatableValue::RelocatableValue(const Atom & symbol, unsigned addend) :
+        symbol(symbol),
+        addend(addend)
+    {
+    }
 
-        std::string::size_type pos(input.find_first_of(operators));
-        std::string first(input.substr(0, pos));
-        input.erase(0, pos);
+    template <>
+    struct Implementation<CompiledExpression> :
+        public ExpressionVisitor
+    {
+        std::vector<unsigned> code;
+
+        std::vector<Atom> symbols;
+
+        unsigned depth;
+
+        unsigned current_depth;
 
-        if (is_dec_value(first))
+        Implementation(const ExpressionPtr & expression) :
+            depth(0),
+            current_depth(0)
         {
-            result = new Value(destringify<long>(first));
+            if (expression)
+                expression->accept(*this);
         }
-        else if (is_hex_value(first))
+
+        virtual ~Implementation()
+        {
+        }
+
+        void push()
         {
-            result = new Value(dehexify(first));
+            ++current_depth;
+            depth = std::max(depth, current_depth);
         }
-        else
+
+        void binary(CompiledExpression::Opcode op, Expression & e)
         {
-            result = new Variable(strip_whitespaces(first));
+            e.left_hand_side()->accept(*this);
+            e.right_hand_side()->accept(*this);
+
+            code.push_back(op);
+            --current_depth;
         }
 
-        while (! input.empty())
+        virtual void visit(Difference & d)
         {
-            char op(input[0]);
+            binary(CompiledExpression::op_subtract, d);
+        }
 
-            if (std::string::npos == operators.find(op))
-                return ExpressionPtr(); // ToDo: Throw!
+        virtual void visit(Operation & o)
+        {
+            binary(CompiledExpression::op_operation, o);
+            code.push_back(o.op());
+        }
 
-            input.erase(0, 1);
-            pos = input.find_first_of(operators);
-            std::string operand(input.substr(0, pos));
-            input.erase(0, pos);
+        virtual void visit(Sum & s)
+        {
+            binary(CompiledExpression::op_add, s);
+        }
 
-            Expression * rhs(0);
-            if (is_dec_value(operand))
-            {
-                rhs = new Value(destringify<long>(operand));
-            }
-            else if (is_hex_value(operand))
-            {
-                rhs = new Value(dehexify(operand));
-            }
-            else
-            {
-                rhs = new Variable(strip_whitespaces(operand));
-            }
+        virtual void visit(Value & v)
+        {
+            code.push_back(CompiledExpression::op_value);
+            code.push_back(v.value());
+            push();
+        }
 
-            if ('+' == op)
-            {
-                result = new Sum(ExpressionPtr(result), ExpressionPtr(rhs));
-            }
-            else if ('-' == op)
-            {
-                result = new Difference(ExpressionPtr(result), ExpressionPtr(rhs));
-            }
-            else
-            {
-                return ExpressionPtr(); // ToDo: Throw!
-            }
+        virtual void visit(Variable & v)
+        {
+            Atom symbol(v.variable());
+            std::vector<Atom>::const_iterator s(std::find(symbols.begin(), symbols.end(), symbol));
+            if (symbols.end() == s)
+                s = symbols.insert(symbols.end(), symbol);
+
+            code.push_back(CompiledExpression::op_symbol);
+            code.push_back(s - symbols.begin());
+            push();
         }
+    };
+
+    CompiledExpression::CompiledExpression(const ExpressionPtr & expression) :
+        PrivateImplementationPattern<CompiledExpression>(new Implementation<CompiledExpression>(expression))
+    {
+    }
+
+    CompiledExpression::~CompiledExpression()
+    {
+    }
+
+    const std::vector<unsigned> &
+    CompiledExpression::code() const
+    {
+        return _imp->code;
+    }
+
+    const std::vector<Atom> &
+    CompiledExpression::symbols() const
+    {
+        return _imp->symbols;
+    }
+
+    unsigned
+    CompiledExpression::depth() const
+    {
+        return _imp->depth;
+    }
+
+    namespace internal
+    {
+        /// A value during evaluation: addend + weight * symbol.
+        struct Term
+        {
+            unsigned addend;
+
+            Atom symbol;
 
-        return ExpressionPtr(result);
+            int weight;
+        };
     }
 
     template <>
-    struct Implementation<ExpressionEvaluator> :
-        public ExpressionVisitor
+    struct Implementation<ExpressionEvaluator>
     {
         ExpressionEvaluator::LookupFunction lookup;
 
-        std::vector<unsigned> stack;
+        /// Symbols that have been resolved already.
+        std::map<Atom, internal::Term> resolved;
+
+        const Atom location;
+
+        std::vector<internal::Term> values;
+
+        std::vector<internal::Term> stack;
 
         Implementation(const ExpressionEvaluator::LookupFunction & lookup) :
             lookup(lookup),
-            stack(0)
+            location(".")
         {
         }
 
-        virtual ~Implementation()
+        static internal::Term term(const RelocatableValue & value)
         {
-        }
+            internal::Term result = { value.addend, value.symbol, value.absolute() ? 0 : 1 };
 
-        void clear()
-        {
-            stack.clear();
+            return result;
         }
 
-        virtual void visit(Difference & d)
+        internal::Term resolve(const Atom & symbol)
         {
-            d.left_hand_side()->accept(*this);
-            d.right_hand_side()->accept(*this);
+            if (location == symbol)
+                return term(lookup(symbol.str()));
 
-            unsigned subtrahend(stack.back());
-            stack.pop_back();
+            std::map<Atom, internal::Term>::const_iterator r(resolved.find(symbol));
+            if (resolved.end() != r)
+                return r->second;
 
-            unsigned minuend(stack.back());
+            internal::Term result(term(lookup(symbol.str())));
+            resolved.insert(std::make_pair(symbol, result));
 
-            stack.back() = minuend - subtrahend;
+            return result;
         }
 
-        virtual void visit(Sum & s)
+        static void add(internal::Term & lhs, const internal::Term & rhs, int sign)
         {
-            s.left_hand_side()->accept(*this);
-            s.right_hand_side()->accept(*this);
-
-            unsigned addend(stack.back());
-            stack.pop_back();
+            if (0 == lhs.weight)
+            {
+                lhs.symbol = rhs.symbol;
+            }
+            else if ((0 != rhs.weight) && (lhs.symbol != rhs.symbol))
+            {
+                throw CommonSyntaxError("cannot combine values relative to '" + lhs.symbol.str()
+                        + "' and to '" + rhs.symbol.str() + "'");
+            }
 
-            unsigned augent(stack.back());
+            lhs.addend += sign * rhs.addend;
+            lhs.weight += sign * rhs.weight;
 
-            stack.back() = augent + addend;
+            if (0 == lhs.weight)
+                lhs.symbol = Atom();
         }
 
-        virtual void visit(Value & v)
+        internal::Term evaluate(const CompiledExpression & expression)
         {
-            stack.push_back(v.value());
-        }
+            if (expression.code().empty())
+                throw InternalError("common", "cannot evaluate an empty expression");
 
-        virtual void visit(Variable & v)
-        {
-            stack.push_back(lookup(v.variable()));
+            const std::vector<Atom> & symbols(expression.symbols());
+            values.resize(symbols.size());
+            for (unsigned i(0), i_end(symbols.size()) ; i != i_end ; ++i)
+            {
+                values[i] = resolve(symbols[i]);
+            }
+
+            stack.resize(expression.depth());
+            internal::Term * top(&stack[0]);
+
+            const std::vector<unsigned> & code(expression.code());
+            for (std::vector<unsigned>::const_iterator c(code.begin()), c_end(code.end()) ; c != c_end ; ++c)
+            {
+                switch (*c)
+                {
+                    case CompiledExpression::op_value:
+                        top->addend = *++c;
+                        top->symbol = Atom();
+                        top->weight = 0;
+                        ++top;
+                        break;
+
+                    case CompiledExpression::op_symbol:
+                        *top++ = values[*++c];
+                        break;
+
+                    case CompiledExpression::op_add:
+                        --top;
+                        add(top[-1], top[0], 1);
+                        break;
+
+                    case CompiledExpression::op_subtract:
+                        --top;
+                        add(top[-1], top[0], -1);
+                        break;
+
+                    case CompiledExpression::op_operation:
+                        {
+                            Operation::Operator op(static_cast<Operation::Operator>(*++c));
+
+                            --top;
+                            if ((0 != top[-1].weight) || (0 != top[0].weight))
+                                throw CommonSyntaxError(std::string("cannot apply '") + Operation::text(op)
+                                        + "' to a value relative to '" + (top[-1].weight ? top[-1] : top[0]).symbol.str() + "'");
+
+                            top[-1].addend = Operation::apply(op, top[-1].addend, top[0].addend);
+                        }
+                        break;
+                }
+            }
+
+            return stack[0];
         }
     };
 
@@ -409,10 +816,32 @@ namespace gpu
     unsigned
     ExpressionEvaluator::evaluate(const ExpressionPtr & expression)
     {
-        _imp->clear();
-        expression->accept(*_imp);
+        return evaluate(CompiledExpression(expression));
+    }
+
+    unsigned
+    ExpressionEvaluator::evaluate(const CompiledExpression & expression)
+    {
+        internal::Term result(_imp->evaluate(expression));
 
-        return _imp->stack.front();
+        if (0 != result.weight)
+            throw CommonSyntaxError("value relative to '" + result.symbol.str() + "' is not known at assembly time");
+
+        return result.addend;
+    }
+
+    RelocatableValue
+    ExpressionEvaluator::relocate(const CompiledExpression & expression)
+    {
+        internal::Term result(_imp->evaluate(expression));
+
+        if (0 == result.weight)
+            return RelocatableValue(result.addend);
+
+        if (1 != result.weight)
+            throw CommonSyntaxError("value is a multiple of the address of '" + result.symbol.str() + "'");
+
+        return RelocatableValue(result.symbol, result.addend);
     }
 
     template <>
@@ -455,6 +884,21 @@ namespace gpu
         _imp->output += ")";
     }
 
+    void
+    ExpressionPrinter::visit(Operation & o)
+    {
+        _imp->output += Operation::text(o.op());
+        _imp->output += "(";
+
+        o.left_hand_side()->accept(*this);
+
+        _imp->output += ",";
+
+        o.right_hand_side()->accept(*this);
+
+        _imp->output += ")";
+    }
+
     void
     ExpressionPrinter::visit(Sum & s)
     {
@@ -21,15 +21,17 @@
 #define GPU_GUARD_COMMON_EXPRESSION_HH 1
 
 #include <common/expression-fwd.hh>
+#include <utils/atom.hh>
 #include <utils/memory.hh>
 #include <utils/private_implementation_pattern.hh>
 #include <utils/visitor.hh>
 
 #include <tr1/functional>
+#include <vector>
 
 namespace gpu
 {
-    typedef VisitorTag<Difference, Sum, Value, Variable> Expressions;
+    typedef VisitorTag<Difference, Operation, Sum, Value, Variable> Expressions;
 
     typedef Visitor<Expressions> ExpressionVisitor;
 
@@ -62,6 +64,51 @@ namespace gpu
             virtual ExpressionPtr right_hand_side() const;
     };
 
+    /**
+     * Operation is a binary operation other than a sum or a difference.
+     *
+     * Operations on 32 bit values wrap around. As in GNU as, quotients,
+     * remainders and right shifts treat their values as signed, so -8 / 2 is -4
+     * and -1 >> 1 is -1. Quotients round towards zero. Shifting left by 32 bits
+     * or more yields 0, shifting right only leaves the sign.
+     */
+    class Operation :
+        public Expression,
+        public PrivateImplementationPattern<Operation>
+    {
+        public:
+            /// Operators, in order of increasing precedence of their groups.
+            enum Operator
+            {
+                bitwise_or,
+                bitwise_xor,
+                bitwise_and,
+                shift_left,
+                shift_right,
+                product,
+                quotient,
+                remainder
+            };
+
+            Operation(Operator op, const ExpressionPtr & lhs, const ExpressionPtr & rhs);
+
+            virtual ~Operation();
+
+            virtual void accept(ExpressionVisitor & visitor);
+
+            virtual ExpressionPtr left_hand_side() const;
+
+            virtual ExpressionPtr right_hand_side() const;
+
+            Operator op() const;
+
+            /// Return the result of op, throwing CommonSyntaxError on division by zero.
+            static unsigned apply(Operator op, unsigned lhs, unsigned rhs);
+
+            /// Return the source text of op.
+            static const char * text(Operator op);
+    };
+
     class Sum :
         public Expression,
         public PrivateImplementationPattern<Sum>
@@ -114,22 +161,112 @@ namespace gpu
             std::string variable() const;
     };
 
+    /**
+     * ExpressionParser parses expressions with the operators and precedence
+     * of C: unary '-', '~' and '+', then '*', '/' and '%', then '+' and '-',
+     * then '<<' and '>>', then '&', '^' and '|'. Parentheses group.
+     *
+     * Operations on constants are folded while parsing. Malformed input
+     * raises CommonSyntaxError.
+     */
     struct ExpressionParser
     {
         static ExpressionPtr parse(const std::string & expression);
     };
 
+    /**
+     * RelocatableValue is the value of an expression at assembly time.
+     *
+     * It is either absolute, or an addend to the address of a symbol that is
+     * only known after linking. Symbols that are defined in a section are
+     * given relative to the section, so that differences of symbols within
+     * the same section become absolute.
+     */
+    struct RelocatableValue
+    {
+        /// The symbol, or the empty atom for absolute values.
+        Atom symbol;
+
+        unsigned addend;
+
+        RelocatableValue(unsigned value);
+
+        RelocatableValue(const Atom & symbol, unsigned addend);
+
+        bool absolute() const
+        {
+            return symbol.empty();
+        }
+    };
+
+    /**
+     * CompiledExpression is an expression in flat postfix bytecode.
+     *
+     * Every distinct symbol of the expression is assigned a slot, so that
+     * it needs to be resolved only once per evaluation, however often it
+     * is referenced. Copies share the same code.
+     */
+    class CompiledExpression :
+        public PrivateImplementationPattern<CompiledExpression>
+    {
+        public:
+            enum Opcode
+            {
+                op_value,    ///< Push the following word.
+                op_symbol,   ///< Push the value of the symbol in the slot given by the following word.
+                op_add,
+                op_subtract,
+                op_operation ///< Apply the Operation::Operator given by the following word.
+            };
+
+            CompiledExpression(const ExpressionPtr & expression);
+
+            ~CompiledExpression();
+
+            /// Return the bytecode, in postfix order.
+            const std::vector<unsigned> & code() const;
+
+            /// Return the symbols, indexed by their slot.
+            const std::vector<Atom> & symbols() const;
+
+            /// Return the stack depth that evaluation needs.
+            unsigned depth() const;
+    };
+
+    /**
+     * ExpressionEvaluator evaluates expressions for one context.
+     *
+     * Symbols are resolved through the lookup function the first time
+     * they are used and remembered afterwards, so an evaluator must not
+     * outlive the symbol values it has seen. The location counter '.' is
+     * looked up anew on every evaluation.
+     *
+     * The lookup function may return plain numbers for absolute symbols.
+     */
     class ExpressionEvaluator :
         public PrivateImplementationPattern<ExpressionEvaluator>
     {
         public:
-            typedef std::tr1::function<unsigned (const std::string &)> LookupFunction;
+            typedef std::tr1::function<RelocatableValue (const std::string &)> LookupFunction;
 
             ExpressionEvaluator(const LookupFunction & lookup);
 
             ~ExpressionEvaluator();
 
+            /// Evaluate an expression that needs to be absolute.
             unsigned evaluate(const ExpressionPtr & expression);
+
+            /// Evaluate an expression that needs to be absolute.
+            unsigned evaluate(const CompiledExpression & expression);
+
+            /**
+             * Evaluate an expression that may be relative to one symbol,
+             * e.g. for a relocation.
+             *
+             * Symbols can only be added to or subtracted from each other,
+             * and only if all of them are relative to the same symbol.
+             */
+            RelocatableValue relocate(const CompiledExpression & expression);
     };
 
     class ExpressionPrinter :
@@ -145,6 +282,8 @@ namespace gpu
 
             virtual void visit(Difference & d);
 
+            virtual void visit(Operation & o);
+
             virtual void visit(Sum & s);
 
             virtual void visit(Value & v);
@@ -18,6 +18,7 @@
  */
 
 #include <common/expression.hh>
+#include <common/syntax.hh>
 #include <tests/tests.hh>
 #include <utils/exception.hh>
 #include <utils/visitor-impl.hh>
@@ -42,6 +43,28 @@ class ExpressionParserTest :
             Test("expression_parser_test")
         {
             data.push_back(DataPair(". - main", "-(.,main)"));
+            data.push_back(DataPair("a + b * c - d", "-(+(a,*(b,c)),d)"));
+            data.push_back(DataPair("a << 2 | b & 0xff ^ c", "|(<<(a,2),^(&(b,255),c))"));
+            data.push_back(DataPair("(a + b) % c", "%(+(a,b),c)"));
+            data.push_back(DataPair("-a", "-(0,a)"));
+
+            // constants are folded while parsing
+            data.push_back(DataPair("2 + 3 * 4", "14"));
+            data.push_back(DataPair("(1 << 4) - 1 + main", "+(15,main)"));
+            data.push_back(DataPair("0x7fffffff >> 27", "15"));
+            data.push_back(DataPair("-1", "4294967295"));
+            data.push_back(DataPair("1 << 32", "0"));
+
+            // quotients, remainders and right shifts are signed
+            data.push_back(DataPair("-8 / 2", "4294967292"));
+            data.push_back(DataPair("7 / -2", "4294967293"));
+            data.push_back(DataPair("-7 % 2", "4294967295"));
+            data.push_back(DataPair("(1 << 31) / -1", "2147483648"));
+            data.push_back(DataPair("(1 << 31) % -1", "0"));
+            data.push_back(DataPair("~0 >> 28", "4294967295"));
+            data.push_back(DataPair("-1 >> 1", "4294967295"));
+            data.push_back(DataPair("(1 << 31) >> 28", "4294967288"));
+            data.push_back(DataPair("-1 >> 32", "4294967295"));
         }
 
         void run_one(const DataPair & x)
@@ -57,6 +80,14 @@ class ExpressionParserTest :
         {
             std::for_each(data.begin(), data.end(),
                     std::tr1::bind(std::tr1::mem_fn(&ExpressionParserTest::run_one), this, std::tr1::placeholders::_1));
+
+            TEST_CHECK_THROWS(ExpressionParser::parse(""), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("a +"), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("(a + b"), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("a b"), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("0x1g"), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("0x100000000"), CommonSyntaxError);
+            TEST_CHECK_THROWS(ExpressionParser::parse("1 / (2 - 2)"), CommonSyntaxError);
         }
 } expression_parser_test;
 
@@ -104,3 +135,104 @@ class ExpressionEvaluatorTest :
         }
 } expression_evaluator_test;
 
+
+class CompiledExpressionTest :
+    public Test
+{
+    private:
+        std::map<std::string, unsigned> lookups;
+
+    public:
+        CompiledExpressionTest() :
+            Test("compiled_expression_test")
+        {
+        }
+
+        unsigned lookup(const std::string & name)
+        {
+            ++lookups[name];
+
+            return "." == name ? 100 + lookups[name] : 7;
+        }
+
+        virtual void run()
+        {
+            CompiledExpression expression(ExpressionParser::parse(". - main + 4 - main"));
+
+            // main gets a single slot, however often it is used
+            TEST_CHECK_EQUAL(expression.symbols().size(), 2u);
+            TEST_CHECK_EQUAL(expression.depth(), 2u);
+            TEST_CHECK_EQUAL(expression.code().size(), 11u);
+            TEST_CHECK_EQUAL(expression.code().back(), unsigned(CompiledExpression::op_subtract));
+
+            ExpressionEvaluator evaluator(std::tr1::bind(std::tr1::mem_fn(&CompiledExpressionTest::lookup), this, std::tr1::placeholders::_1));
+            TEST_CHECK_EQUAL(evaluator.evaluate(expression), 101u - 7u + 4u - 7u);
+            TEST_CHECK_EQUAL(evaluator.evaluate(expression), 102u - 7u + 4u - 7u);
+            TEST_CHECK_EQUAL(evaluator.evaluate(ExpressionParser::parse("main + 1")), 8u);
+
+            // the location counter is looked up anew, all other symbols only once
+            TEST_CHECK_EQUAL(lookups["."], 2u);
+            TEST_CHECK_EQUAL(lookups["main"], 1u);
+
+            TEST_CHECK_THROWS(evaluator.evaluate(CompiledExpression(ExpressionPtr())), InternalError);
+        }
+} compiled_expression_test;
+
+class RelocatableExpressionTest :
+    public Test
+{
+    public:
+        RelocatableExpressionTest() :
+            Test("relocatable_expression_test")
+        {
+        }
+
+        static RelocatableValue lookup(const std::string & name)
+        {
+            if ("external" == name)
+                return RelocatableValue(Atom(name), 0);
+
+            if ("data" == name)
+                return RelocatableValue(Atom(".data"), 16);
+
+            // '.' and all other symbols are defined in .text
+            return RelocatableValue(Atom(".text"), "." == name ? 64 : 8);
+        }
+
+        RelocatableValue relocate(const std::string & expression)
+        {
+            ExpressionEvaluator evaluator(&RelocatableExpressionTest::lookup);
+
+            return evaluator.relocate(CompiledExpression(ExpressionParser::parse(expression)));
+        }
+
+        unsigned evaluate(const std::string & expression)
+        {
+            ExpressionEvaluator evaluator(&RelocatableExpressionTest::lookup);
+
+            return evaluator.evaluate(ExpressionParser::parse(expression));
+        }
+
+        virtual void run()
+        {
+            // differences within a section are resolved during assembly
+            TEST_CHECK_EQUAL(evaluate(". - main"), 56u);
+            TEST_CHECK_EQUAL(evaluate("(. - main) / 8 * 2"), 14u);
+            TEST_CHECK(relocate("(. - main) >> 3").absolute());
+
+            // only references that remain after that need relocations
+            RelocatableValue external(relocate("external + (. - main) + 4"));
+            TEST_CHECK_EQUAL(external.symbol, Atom("external"));
+            TEST_CHECK_EQUAL(external.addend, 60u);
+
+            RelocatableValue local(relocate("data + 4"));
+            TEST_CHECK_EQUAL(local.symbol, Atom(".data"));
+            TEST_CHECK_EQUAL(local.addend, 20u);
+
+            TEST_CHECK_THROWS(evaluate("external + 4"), CommonSyntaxError);
+            TEST_CHECK_THROWS(relocate("data - main"), CommonSyntaxError);
+            TEST_CHECK_THROWS(relocate("external * 2"), CommonSyntaxError);
+            TEST_CHECK_THROWS(relocate("main + main"), CommonSyntaxError);
+            TEST_CHECK_THROWS(evaluate("main % (. - .)"), CommonSyntaxError);
+        }
+} relocatable_expression_test;
@@ -20,8 +20,6 @@
 #ifndef GPU_GUARD_COMMON_GPGPU_DATA_ENTITIES_FWD_HH
 #define GPU_GUARD_COMMON_GPGPU_DATA_ENTITIES_FWD_HH 1
 
-#include <utils/memory.hh>
-
 namespace gpu
 {
     namespace common
@@ -32,7 +30,8 @@ namespace gpu
 
         struct DataEntity;
 
-        typedef std::tr1::shared_ptr<DataEntity> DataEntityPtr;
+        /// DataEntities are owned by the Arena of their section.
+        typedef const DataEntity * DataEntityPtr;
     }
 }
 
@@ -20,7 +20,9 @@
 #include <common/assembly_entities.hh>
 #include <common/gpgpu_data_entities.hh>
 #include <common/syntax.hh>
+#include <utils/perfect_hash.hh>
 #include <utils/sequence-impl.hh>
+#include <utils/tuple.hh>
 #include <utils/visitor-impl.hh>
 
 namespace gpu
@@ -39,14 +41,36 @@ namespace gpu
     {
         namespace internal
         {
+            enum DirectiveKind
+            {
+                dk_buffer,
+                dk_counter
+            };
+
+            /*
+             * directive name
+             * directive kind
+             */
+            typedef Tuple<std::string, unsigned> KnownDirective;
+            const static KnownDirective known_directives[] =
+            {
+                KnownDirective("buffer",        dk_buffer),
+                KnownDirective("counter",       dk_counter)
+            };
+            const static PerfectHash<KnownDirective> directive_table(known_directives, known_directives + sizeof(known_directives) / sizeof(KnownDirective));
+
             struct DataEntityConverter :
                 public AssemblyEntityVisitor
             {
+                Arena & arena;
+
                 DataEntityPtr result;
 
-                DataEntityConverter(const AssemblyEntityPtr & entity)
+                DataEntityConverter(const AssemblyEntity & entity, Arena & arena) :
+                    arena(arena),
+                    result(0)
                 {
-                    entity->accept(*this);
+                    entity.accept(*this);
                 }
 
                 // AssemblyEntityVisitor
@@ -60,28 +84,25 @@ namespace gpu
 
                 void visit(const Directive & d)
                 {
-                    if ("buffer" == d.name)
-                    {
-                        result = DataEntityPtr(new Buffer(d.params));
-                    }
-                    else if ("counter" == d.name)
-                    {
-                        result = DataEntityPtr(new Counter(d.params));
-                    }
-                    else
+                    const KnownDirective * directive(directive_table.find(d.name));
+                    if (! directive)
+                        throw CommonSyntaxError("Unexpected directive '." + d.name.str() + "' in section '.gpgpu.data'");
+
+                    switch (directive->second)
                     {
-                        throw CommonSyntaxError("Unexpected directive '." + d.name + "' in section '.gpgpu.data'");
+                        case dk_buffer:
+                            result = arena.make<Buffer>(d.params);
+                            break;
+
+                        case dk_counter:
+                            result = arena.make<Counter>(d.params);
+                            break;
                     }
                 }
 
                 void visit(const Instruction & i)
                 {
-                    throw CommonSyntaxError("Unexpected instruction '" + i.mnemonic + "' in section '.gpgpu.data'");
-                }
-
-                void visit(const Line & l)
-                {
-                    SyntaxContext::Line(l.number);
+                    throw CommonSyntaxError("Unexpected instruction '" + i.mnemonic.str() + "' in section '.gpgpu.data'");
                 }
             };
         }
@@ -90,7 +111,7 @@ namespace gpu
         {
         }
 
-        Buffer::Buffer(const std::string & name) :
+        Buffer::Buffer(const Atom & name) :
             name(name)
         {
         }
@@ -105,7 +126,7 @@ namespace gpu
             static_cast<ConstVisits<Buffer> *>(&v)->visit(*this);
         }
 
-        Counter::Counter(const std::string & name) :
+        Counter::Counter(const Atom & name) :
             name(name)
         {
         }
@@ -121,9 +142,9 @@ namespace gpu
         }
 
         DataEntityPtr
-        DataEntityConverter::convert(const AssemblyEntityPtr & entity)
+        DataEntityConverter::convert(const AssemblyEntity & entity, Arena & arena)
         {
-            internal::DataEntityConverter c(entity);
+            internal::DataEntityConverter c(entity, arena);
 
             return c.result;
         }
@@ -22,11 +22,11 @@
 
 #include <common/assembly_entities-fwd.hh>
 #include <common/gpgpu_data_entities-fwd.hh>
+#include <utils/arena.hh>
+#include <utils/atom.hh>
 #include <utils/sequence.hh>
 #include <utils/visitor.hh>
 
-#include <string>
-
 namespace gpu
 {
     namespace common
@@ -44,9 +44,9 @@ namespace gpu
         struct Buffer :
             public DataEntity
         {
-            std::string name;
+            Atom name;
 
-            Buffer(const std::string & name);
+            Buffer(const Atom & name);
 
             ~Buffer();
 
@@ -56,9 +56,9 @@ namespace gpu
         struct Counter :
             public DataEntity
         {
-            std::string name;
+            Atom name;
 
-            Counter(const std::string & name);
+            Counter(const Atom & name);
 
             ~Counter();
 
@@ -67,7 +67,7 @@ namespace gpu
 
         struct DataEntityConverter
         {
-            static DataEntityPtr convert(const AssemblyEntityPtr &);
+            static DataEntityPtr convert(const AssemblyEntity &, Arena &);
         };
     }
 }
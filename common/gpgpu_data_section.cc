@@ -49,7 +49,7 @@ namespace gpu
                     }
                 }
 
-                void add_symbol(const std::string & name, unsigned type)
+                void add_symbol(const Atom & name, unsigned type)
                 {
                     elf::Symbol symbol(name);
                     symbol.section = ".gpgpu.data";
@@ -81,18 +81,20 @@ namespace gpu
         }
 
         void
-        GPGPUDataSection::append(const AssemblyEntityPtr & entity)
+        GPGPUDataSection::append(const AssemblyEntity & entity)
         {
-            DataEntityPtr data_entity(DataEntityConverter::convert(entity));
+            DataEntityPtr data_entity(DataEntityConverter::convert(entity, arena));
 
-            if (data_entity.get())
+            if (data_entity)
                 entities.append(data_entity);
         }
 
-        std::string
+        Atom
         GPGPUDataSection::name() const
         {
-            return ".gpgpu.data";
+            static const Atom name(".gpgpu.data");
+
+            return name;
         }
 
         Sequence<elf::Section>
@@ -22,6 +22,7 @@
 
 #include <common/gpgpu_data_entities-fwd.hh>
 #include <common/section.hh>
+#include <utils/arena.hh>
 #include <utils/sequence.hh>
 
 namespace gpu
@@ -31,15 +32,17 @@ namespace gpu
         struct GPGPUDataSection :
             public Section
         {
+            Arena arena;
+
             Sequence<DataEntityPtr> entities;
 
             GPGPUDataSection();
 
             virtual ~GPGPUDataSection();
 
-            virtual void append(const AssemblyEntityPtr &);
+            virtual void append(const AssemblyEntity &);
 
-            virtual std::string name() const;
+            virtual Atom name() const;
 
             virtual Sequence<elf::Section> sections(const elf::SymbolTable &, const Sequence<elf::Symbol> &) const;
 
@@ -38,15 +38,17 @@ namespace gpu
     }
 
     void
-    GPGPUNotesSection::append(const AssemblyEntityPtr &)
+    GPGPUNotesSection::append(const AssemblyEntity &)
     {
         throw CommonSyntaxError("Section '.gpgpu.notes' does not accept any entities.");
     }
 
-    std::string
+    Atom
     GPGPUNotesSection::name() const
     {
-        return ".gpgpu.notes";
+        static const Atom name(".gpgpu.notes");
+
+        return name;
     }
 
     Sequence<elf::Section>
@@ -32,9 +32,9 @@ namespace gpu
 
         virtual ~GPGPUNotesSection();
 
-        virtual void append(const AssemblyEntityPtr &);
+        virtual void append(const AssemblyEntity &);
 
-        virtual std::string name() const;
+        virtual Atom name() const;
 
         virtual Sequence<elf::Section> sections(const elf::SymbolTable &, const Sequence<elf::Symbol> &) const;
 
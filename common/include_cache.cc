@@ -0,0 +1,309 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/assembly_parser.hh>
+#include <common/include_cache.hh>
+#include <common/syntax.hh>
+#include <utils/mapped_file.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+#include <utils/sequence-impl.hh>
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+namespace gpu
+{
+    namespace internal
+    {
+        struct CachedFile
+        {
+            struct timespec mtime;
+
+            off_t size;
+
+            uint64_t hash;
+
+            IncludedFilePtr file;
+        };
+
+        /// FNV-1a hash of the bytes in [begin, end).
+        static uint64_t hash(const char * begin, const char * end)
+        {
+            uint64_t result(14695981039346656037ULL);
+            for (const char * c(begin) ; c != end ; ++c)
+            {
+                result ^= static_cast<unsigned char>(*c);
+                result *= 1099511628211ULL;
+            }
+
+            return result;
+        }
+
+        static bool unchanged(const CachedFile & cached, const struct stat & s)
+        {
+            return (cached.mtime.tv_sec == s.st_mtim.tv_sec) && (cached.mtime.tv_nsec == s.st_mtim.tv_nsec)
+                && (cached.size == s.st_size);
+        }
+    }
+
+    template <>
+    struct Implementation<IncludeCache>
+    {
+        /// Guards the members below, but is not held while a file is parsed.
+        pthread_mutex_t mutex;
+
+        /// Signalled whenever a file is no longer being parsed.
+        pthread_cond_t parsed;
+
+        std::map<std::string, internal::CachedFile> files;
+
+        /// Files that some thread is currently parsing, which others wait for.
+        std::set<std::string> parsing;
+
+        unsigned long parses;
+
+        unsigned long hits;
+
+        Implementation() :
+            parses(0),
+            hits(0)
+        {
+            pthread_mutex_init(&mutex, 0);
+            pthread_cond_init(&parsed, 0);
+        }
+
+        ~Implementation()
+        {
+            pthread_cond_destroy(&parsed);
+            pthread_mutex_destroy(&mutex);
+        }
+    };
+
+    namespace internal
+    {
+        class IncludeLock
+        {
+            private:
+                pthread_mutex_t & _mutex;
+
+            public:
+                IncludeLock(pthread_mutex_t & mutex) : _mutex(mutex) { pthread_mutex_lock(&_mutex); }
+
+                ~IncludeLock() { pthread_mutex_unlock(&_mutex); }
+        };
+
+        /**
+         * Marks a file as being parsed by this thread for as long as it is in
+         * scope, to detect recursive inclusion. The files that a thread parses
+         * form a chain, innermost first.
+         */
+        class ParsingGuard
+        {
+            private:
+                static __thread const ParsingGuard * innermost;
+
+                const std::string _path;
+
+                const ParsingGuard * const _outer;
+
+            public:
+                ParsingGuard(const std::string & path) :
+                    _path(path),
+                    _outer(innermost)
+                {
+                    for (const ParsingGuard * g(_outer) ; g ; g = g->_outer)
+                    {
+                        if (g->_path == _path)
+                            throw CommonSyntaxError("recursive inclusion of '" + _path + "'");
+                    }
+
+                    innermost = this;
+                }
+
+                ~ParsingGuard()
+                {
+                    innermost = _outer;
+                }
+
+                /// Return whether the file is included from another file that this thread parses.
+                bool nested() const
+                {
+                    return 0 != _outer;
+                }
+        };
+
+        __thread const ParsingGuard * ParsingGuard::innermost = 0;
+
+        /// Releases the claim of a thread to parse a file, and wakes those waiting for it.
+        class ParsingClaim
+        {
+            private:
+                Implementation<IncludeCache> & _imp;
+
+                const std::string _path;
+
+                const bool _owner;
+
+            public:
+                /// To be constructed with the mutex held.
+                ParsingClaim(Implementation<IncludeCache> & imp, const std::string & path) :
+                    _imp(imp),
+                    _path(path),
+                    _owner(imp.parsing.insert(path).second)
+                {
+                }
+
+                ~ParsingClaim()
+                {
+                    if (! _owner)
+                        return;
+
+                    IncludeLock lock(_imp.mutex);
+                    _imp.parsing.erase(_path);
+                    pthread_cond_broadcast(&_imp.parsed);
+                }
+        };
+    }
+
+    IncludeCache::IncludeCache() :
+        PrivateImplementationPattern<IncludeCache>(new Implementation<IncludeCache>)
+    {
+    }
+
+    IncludeCache::~IncludeCache()
+    {
+    }
+
+    IncludeCache &
+    IncludeCache::instance()
+    {
+        static IncludeCache result;
+
+        return result;
+    }
+
+    IncludedFilePtr
+    IncludeCache::get(const std::string & path)
+    {
+        char resolved[PATH_MAX];
+        if (! ::realpath(path.c_str(), resolved))
+            throw CommonSyntaxError("cannot include '" + path + "': " + std::strerror(errno));
+
+        struct stat s;
+        if (-1 == ::stat(resolved, &s))
+            throw CommonSyntaxError("cannot include '" + path + "': " + std::strerror(errno));
+
+        internal::ParsingGuard guard(resolved);
+        std::tr1::shared_ptr<internal::ParsingClaim> claim;
+        std::map<std::string, internal::CachedFile>::iterator f;
+
+        {
+            internal::IncludeLock lock(_imp->mutex);
+
+            // Wait while another thread parses the file. A thread that is parsing an included file
+            // itself parses it as well instead, as waiting could deadlock on files that include
+            // each other.
+            while (true)
+            {
+                f = _imp->files.find(resolved);
+                if ((_imp->files.end() != f) && internal::unchanged(f->second, s))
+                {
+                    ++_imp->hits;
+                    return f->second.file;
+                }
+
+                if (guard.nested() || (_imp->parsing.end() == _imp->parsing.find(resolved)))
+                    break;
+
+                pthread_cond_wait(&_imp->parsed, &_imp->mutex);
+            }
+
+            claim.reset(new internal::ParsingClaim(*_imp, resolved));
+        }
+
+        MappedFile mapped(resolved);
+        uint64_t hash(internal::hash(mapped.begin(), mapped.end()));
+
+        {
+            internal::IncludeLock lock(_imp->mutex);
+
+            f = _imp->files.find(resolved);
+            if ((_imp->files.end() != f) && (f->second.hash == hash))
+            {
+                // Touched, but not changed.
+                f->second.mtime = s.st_mtim;
+                f->second.size = s.st_size;
+
+                ++_imp->hits;
+                return f->second.file;
+            }
+        }
+
+        std::tr1::shared_ptr<IncludedFile> file(new IncludedFile);
+        file->path = resolved;
+        {
+            SyntaxContext::File context(resolved);
+            file->entities = AssemblyParser::parse(mapped, file->arena, file->lines, file->macros);
+        }
+
+        internal::IncludeLock lock(_imp->mutex);
+        ++_imp->parses;
+
+        internal::CachedFile & cached(_imp->files[resolved]);
+        cached.mtime = s.st_mtim;
+        cached.size = s.st_size;
+        cached.hash = hash;
+        cached.file = file;
+
+        return file;
+    }
+
+    void
+    IncludeCache::clear()
+    {
+        internal::IncludeLock lock(_imp->mutex);
+
+        _imp->files.clear();
+    }
+
+    unsigned long
+    IncludeCache::parses() const
+    {
+        internal::IncludeLock lock(_imp->mutex);
+
+        return _imp->parses;
+    }
+
+    unsigned long
+    IncludeCache::hits() const
+    {
+        internal::IncludeLock lock(_imp->mutex);
+
+        return _imp->hits;
+    }
+}
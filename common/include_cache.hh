@@ -0,0 +1,108 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_INCLUDE_CACHE_HH
+#define GPU_GUARD_COMMON_INCLUDE_CACHE_HH 1
+
+#include <common/assembly_entities.hh>
+#include <common/line_table.hh>
+#include <common/macro_processor.hh>
+#include <utils/arena.hh>
+#include <utils/private_implementation_pattern.hh>
+#include <utils/sequence.hh>
+
+#include <string>
+#include <tr1/memory>
+
+namespace gpu
+{
+    /**
+     * IncludedFile holds the result of parsing a file that is named by an
+     * .include directive.
+     *
+     * Its contents are shared by every parse that includes the file, and must
+     * not be modified.
+     */
+    struct IncludedFile
+    {
+        /// Canonical path of the file.
+        std::string path;
+
+        /// Arena that owns the entities.
+        Arena arena;
+
+        Sequence<AssemblyEntityPtr> entities;
+
+        /// Source lines of the entities, within the included file.
+        LineTable lines;
+
+        /// Macros that the file defines.
+        MacroDefinitions macros;
+    };
+
+    typedef std::tr1::shared_ptr<const IncludedFile> IncludedFilePtr;
+
+    /**
+     * IncludeCache keeps every included file in its parsed form, so that a
+     * header which is included by many sources is only parsed once per
+     * process.
+     *
+     * Files are keyed by their canonical path. A cached file is reused as
+     * long as its modification time, to the nanosecond, and size are
+     * unchanged. Otherwise its contents are hashed, and the file is only
+     * parsed again if the hash differs from that of the cached contents.
+     *
+     * Files are parsed without holding the lock of the cache, so threads
+     * that include different files do not wait for each other. A thread
+     * that needs a file which another one is parsing waits for the result.
+     *
+     * Included files are parsed in a context of their own: macros of the
+     * including source are not visible within them.
+     */
+    class IncludeCache :
+        public PrivateImplementationPattern<IncludeCache>
+    {
+        private:
+            IncludeCache();
+
+            IncludeCache(const IncludeCache &);
+
+            IncludeCache & operator= (const IncludeCache &);
+
+        public:
+            ~IncludeCache();
+
+            /// Return the process-wide cache.
+            static IncludeCache & instance();
+
+            /// Return the parsed contents of the file at path, parsing it if needed.
+            IncludedFilePtr get(const std::string & path);
+
+            /// Forget all cached files.
+            void clear();
+
+            /// Return the number of times that a file has been parsed.
+            unsigned long parses() const;
+
+            /// Return the number of times that a cached file has been reused.
+            unsigned long hits() const;
+    };
+}
+
+#endif
@@ -0,0 +1,241 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <common/assembly_entities.hh>
+#include <common/assembly_parser.hh>
+#include <common/include_cache.hh>
+#include <common/syntax.hh>
+#include <utils/mapped_file.hh>
+#include <utils/sequence-impl.hh>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace gpu;
+using namespace tests;
+
+namespace
+{
+    /// A parse of a file on a thread of its own.
+    struct ParseJob
+    {
+        std::string path;
+
+        unsigned entities;
+    };
+
+    void * parse(void * argument)
+    {
+        ParseJob * job(static_cast<ParseJob *>(argument));
+        Arena arena;
+
+        job->entities = AssemblyParser::parse(MappedFile(job->path), arena).size();
+
+        return 0;
+    }
+
+    /// Set the modification time of the file at path.
+    void touch(const std::string & path, time_t seconds, long nanoseconds)
+    {
+        struct timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = seconds;
+        times[0].tv_nsec = times[1].tv_nsec = nanoseconds;
+        ::utimensat(AT_FDCWD, path.c_str(), times, 0);
+    }
+}
+
+struct IncludeCacheTest :
+    public Test
+{
+    std::string directory;
+
+    IncludeCacheTest() :
+        Test("include_cache_test")
+    {
+    }
+
+    std::string write(const std::string & name, const std::string & contents)
+    {
+        std::string path(directory + "/" + name);
+        std::ofstream file(path.c_str());
+        file << contents;
+
+        return path;
+    }
+
+    std::string print(const Sequence<AssemblyEntityPtr> & entities)
+    {
+        AssemblyEntityPrinter p;
+        for (Sequence<AssemblyEntityPtr>::Iterator i(entities.begin()), i_end(entities.end()) ;
+                i != i_end ; ++i)
+        {
+            (*i)->accept(p);
+        }
+
+        return p.output();
+    }
+
+    std::string print(const std::string & name, LineTable & lines)
+    {
+        Arena arena;
+
+        return print(AssemblyParser::parse(MappedFile(directory + "/" + name), arena, lines));
+    }
+
+    std::string print(const std::string & name)
+    {
+        LineTable lines;
+
+        return print(name, lines);
+    }
+
+    std::string source(const std::string & text)
+    {
+        std::stringstream input(text);
+        Arena arena;
+
+        return print(AssemblyParser::parse(input, arena));
+    }
+
+    std::string error(const std::string & name)
+    {
+        try
+        {
+            print(name);
+        }
+        catch (SyntaxError & e)
+        {
+            return e.message();
+        }
+
+        return "";
+    }
+
+    virtual void run()
+    {
+        char pattern[] = "/tmp/include_cache_TEST.XXXXXX";
+        TEST_CHECK(0 != ::mkdtemp(pattern));
+        directory = pattern;
+
+        IncludeCache & cache(IncludeCache::instance());
+        cache.clear();
+
+        std::string header(write("header.s",
+                    ".macro store r\n"
+                    "\tmov \\r, 0\n"
+                    ".endm\n"
+                    "\t.byte 1\n"));
+        write("first.s", "first:\n.include \"header.s\"\n\tstore $0\n");
+        write("second.s", "second: .include \"header.s\"\n\tstore $1\n");
+
+        // each header is parsed once, and its macros are usable after the .include
+        unsigned long parses(cache.parses()), hits(cache.hits());
+        LineTable lines;
+        TEST_CHECK_EQUAL(print("first.s", lines), source("first:\n\t.byte 1\n\tmov $0, 0\n"));
+        TEST_CHECK_EQUAL(print("second.s"), source("second:\n\t.byte 1\n\tmov $1, 0\n"));
+        TEST_CHECK_EQUAL(source(".include \"" + header + "\"\n"), source("\t.byte 1\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 1u);
+        TEST_CHECK_EQUAL(cache.hits() - hits, 2u);
+
+        // included entities carry the line of the .include
+        TEST_CHECK_EQUAL(lines.size(), 3u);
+        TEST_CHECK_EQUAL(lines.line(1), 2u);
+        TEST_CHECK_EQUAL(lines.line(2), 3u);
+
+        // rewriting identical contents keeps the cached entities
+        ::sleep(1);
+        write("header.s", ".macro store r\n\tmov \\r, 0\n.endm\n\t.byte 1\n");
+        TEST_CHECK_EQUAL(print("first.s"), source("first:\n\t.byte 1\n\tmov $0, 0\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 1u);
+
+        // changed contents are parsed again
+        write("header.s", ".macro store r\n\tmov \\r, 1\n.endm\n\t.byte 2, 3\n");
+        TEST_CHECK_EQUAL(print("first.s"), source("first:\n\t.byte 2, 3\n\tmov $0, 1\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 2u);
+
+        // so are contents changed within the same second, at the same size
+        touch(header, 1000000000, 1);
+        TEST_CHECK_EQUAL(print("first.s"), source("first:\n\t.byte 2, 3\n\tmov $0, 1\n"));
+        write("header.s", ".macro store r\n\tmov \\r, 2\n.endm\n\t.byte 4, 5\n");
+        touch(header, 1000000000, 2);
+        TEST_CHECK_EQUAL(print("first.s"), source("first:\n\t.byte 4, 5\n\tmov $0, 2\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 3u);
+        write("header.s", ".macro store r\n\tmov \\r, 1\n.endm\n\t.byte 2, 3\n");
+        TEST_CHECK_EQUAL(print("first.s"), source("first:\n\t.byte 2, 3\n\tmov $0, 1\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 4u);
+
+        // blocks may include files as well
+        write("repeat.s", ".rept 2\n.include \"header.s\"\n.endr\n.macro load\n.include \"header.s\"\n.endm\n\tload\n\tstore $2\n");
+        TEST_CHECK_EQUAL(print("repeat.s"), source("\t.byte 2, 3\n\t.byte 2, 3\n\t.byte 2, 3\n\tmov $2, 1\n"));
+        TEST_CHECK_EQUAL(cache.parses() - parses, 4u);
+
+        // concurrent parses share a single parse of the header
+        cache.clear();
+        parses = cache.parses();
+        ParseJob jobs[4];
+        pthread_t threads[4];
+        for (unsigned i(0) ; i < 4 ; ++i)
+        {
+            jobs[i].path = directory + "/" + (i % 2 ? "first.s" : "second.s");
+            jobs[i].entities = 0;
+            TEST_CHECK_EQUAL(pthread_create(&threads[i], 0, &parse, &jobs[i]), 0);
+        }
+        for (unsigned i(0) ; i < 4 ; ++i)
+        {
+            pthread_join(threads[i], 0);
+            TEST_CHECK_EQUAL(jobs[i].entities, 4u);
+        }
+        TEST_CHECK_EQUAL(cache.parses() - parses, 1u);
+
+        // errors name the file they occur in
+        write("a.s", ".include \"b.s\"\n");
+        write("b.s", "\tnop\n.include \"a.s\"\n");
+        write("broken.s", "\tnop\n.rept 2\n");
+        write("twice.s", ".include \"header.s\"\n.macro store\n.endm\n");
+        write("quote.s", ".include header.s\n");
+        write("missing.s", "\tnop\n.include \"missing.inc\"\n");
+        // a.s itself is not parsed by the cache, so the cycle closes when a.s includes b.s again
+        TEST_CHECK_EQUAL(error("a.s"), directory + "/a.s:1: (common) recursive inclusion of '" + directory + "/b.s'");
+        TEST_CHECK_EQUAL(error("twice.s"), directory + "/twice.s:2: (common) macro 'store' is already defined");
+        TEST_CHECK_EQUAL(error("quote.s"), directory + "/quote.s:1: (common) .include expects a quoted file name");
+        TEST_CHECK_EQUAL(error("missing.s"), directory + "/missing.s:2: (common) cannot include '" + directory + "/missing.inc': No such file or directory");
+
+        write("include_broken.s", ".include \"broken.s\"\n");
+        TEST_CHECK_EQUAL(error("include_broken.s"), directory + "/broken.s:2: (common) unterminated '.rept'");
+
+        // the including file is reported again once the .include is done
+        TEST_CHECK_EQUAL(error("twice.s"), directory + "/twice.s:2: (common) macro 'store' is already defined");
+
+        const char * names[] = { "header.s", "first.s", "second.s", "a.s", "b.s", "broken.s", "twice.s", "quote.s", "missing.s", "include_broken.s", "repeat.s" };
+        for (unsigned i(0) ; i < sizeof(names) / sizeof(names[0]) ; ++i)
+        {
+            std::remove((directory + "/" + names[i]).c_str());
+        }
+        ::rmdir(directory.c_str());
+    }
+} include_cache_test;
@@ -0,0 +1,551 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/assembly_lexer.hh>
+#include <common/assembly_parser.hh>
+#include <common/kernel_template.hh>
+#include <common/macro_processor.hh>
+#include <common/syntax.hh>
+#include <utils/atom.hh>
+#include <utils/mapped_file.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+#include <utils/sequence-impl.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+namespace gpu
+{
+    namespace internal
+    {
+        /// A run of top-level lines and blocks that are either all shared, or all parameter-dependent.
+        struct TemplatePiece
+        {
+            bool dependent;
+
+            /// The lines of a dependent piece, as [first, last).
+            unsigned first;
+
+            unsigned last;
+
+            /// The entities of a shared piece.
+            Sequence<AssemblyEntityPtr> entities;
+
+            LineTable lines;
+        };
+
+        /// Hands lines on to the collector of the current piece.
+        struct PieceSink :
+            public LexedLineSink
+        {
+            std::tr1::shared_ptr<AssemblyLineCollector> collector;
+
+            void emit(const char * buffer, const LexedLine & line)
+            {
+                collector->emit(buffer, line);
+            }
+        };
+
+        inline bool is_parameter_character(char c)
+        {
+            return (('a' <= c) && (c <= 'z')) || (('A' <= c) && (c <= 'Z')) || (('0' <= c) && (c <= '9')) || ('_' == c);
+        }
+
+        inline bool is_blank(char c)
+        {
+            return (' ' == c) || ('\t' == c);
+        }
+
+        static std::string strip(const char * begin, const char * end)
+        {
+            while ((begin != end) && is_blank(*begin))
+                ++begin;
+
+            while ((begin != end) && is_blank(*(end - 1)))
+                --end;
+
+            return std::string(begin, end);
+        }
+
+        static bool is_directive(const char * buffer, const LexedLine & line, const char * name)
+        {
+            unsigned length(std::strlen(name));
+
+            return line.directive && (line.mnemonic.length == length) && (0 == std::memcmp(buffer + line.mnemonic.offset, name, length));
+        }
+
+        /// Return the words of [begin, end), separated by blanks or commas.
+        static std::vector<std::string> words(const char * begin, const char * end)
+        {
+            std::vector<std::string> result;
+            for (const char * c(begin) ; c != end ; )
+            {
+                while ((c != end) && (is_blank(*c) || (',' == *c)))
+                    ++c;
+
+                const char * word_end(c);
+                while ((word_end != end) && ! (is_blank(*word_end) || (',' == *word_end)))
+                    ++word_end;
+
+                if (c != word_end)
+                    result.push_back(std::string(c, word_end));
+
+                c = word_end;
+            }
+
+            return result;
+        }
+    }
+
+    template <>
+    struct Implementation<KernelTemplate>
+    {
+        std::string text;
+
+        std::vector<LexedLine> lines;
+
+        std::vector<std::string> parameters;
+
+        std::vector<std::string> defaults;
+
+        std::vector<bool> has_default;
+
+        // the parameters of the blocks around each line, which shadow template parameters of the same name
+        std::vector<std::vector<std::string> > scopes;
+
+        std::vector<unsigned> line_scopes;
+
+        Arena arena;
+
+        MacroDefinitions macros;
+
+        std::vector<internal::TemplatePiece> pieces;
+
+        unsigned shared_entities;
+
+        Implementation(const std::string & t) :
+            text(t),
+            shared_entities(0)
+        {
+            AssemblyLexer lexer(text.data(), text.data() + text.size());
+            LexedLine lexed;
+
+            while (lexer.next(lexed))
+            {
+                if (internal::is_directive(text.data(), lexed, "param"))
+                {
+                    declare(lexed);
+
+                    // Keep the label, if any
+                    if (lexed.label.empty())
+                        continue;
+
+                    lexed.directive = false;
+                    lexed.mnemonic = Token();
+                    lexed.params = Token();
+                    lexed.operands.clear();
+                }
+
+                lines.push_back(lexed);
+            }
+
+            scope();
+            split();
+        }
+
+        /// Find the parameters of .macro and .irp blocks that are in scope on each line.
+        void scope()
+        {
+            std::vector<unsigned> open(1, 0);
+            scopes.assign(1, std::vector<std::string>());
+            line_scopes.reserve(lines.size());
+
+            for (std::vector<LexedLine>::const_iterator l(lines.begin()), l_end(lines.end()) ; l != l_end ; ++l)
+            {
+                int change(MacroProcessor::nesting_change(text.data(), *l));
+                line_scopes.push_back(open.back());
+
+                if ((change < 0) && (open.size() > 1))
+                    open.pop_back();
+
+                if (change <= 0)
+                    continue;
+
+                std::vector<std::string> names(internal::words(text.data() + l->params.offset, text.data() + l->params.offset + l->params.length));
+                std::vector<std::string> shadowed(scopes[open.back()]);
+                if (internal::is_directive(text.data(), *l, "macro"))
+                {
+                    // the name of the macro, then its parameters with optional defaults
+                    for (unsigned i(1) ; i < names.size() ; ++i)
+                        shadowed.push_back(names[i].substr(0, names[i].find('=')));
+                }
+                else if (internal::is_directive(text.data(), *l, "irp") && ! names.empty())
+                {
+                    shadowed.push_back(names.front());
+                }
+
+                if (shadowed.size() == scopes[open.back()].size())
+                {
+                    open.push_back(open.back());
+                }
+                else
+                {
+                    open.push_back(scopes.size());
+                    scopes.push_back(shadowed);
+                }
+            }
+        }
+
+        void declare(const LexedLine & line)
+        {
+            SyntaxContext::Line l(line.number);
+
+            const char * begin(text.data() + line.params.offset), * end(begin + line.params.length);
+            const char * comma(static_cast<const char *>(std::memchr(begin, ',', end - begin)));
+
+            std::string name(internal::strip(begin, comma ? comma : end));
+            if (! valid_name(name))
+                throw CommonSyntaxError("'" + name + "' is not a valid parameter name");
+
+            if (0 <= parameter(name.data(), name.data() + name.size()))
+                throw CommonSyntaxError("parameter '" + name + "' is already declared");
+
+            parameters.push_back(name);
+            defaults.push_back(comma ? internal::strip(comma + 1, end) : std::string());
+            has_default.push_back(0 != comma);
+        }
+
+        static bool valid_name(const std::string & name)
+        {
+            if (name.empty() || (('0' <= name[0]) && (name[0] <= '9')))
+                return false;
+
+            for (std::string::const_iterator c(name.begin()), c_end(name.end()) ; c != c_end ; ++c)
+            {
+                if (! internal::is_parameter_character(*c))
+                    return false;
+            }
+
+            return true;
+        }
+
+        /// Return the index of the parameter named [begin, end), or -1.
+        int parameter(const char * begin, const char * end) const
+        {
+            for (unsigned i(0) ; i < parameters.size() ; ++i)
+            {
+                if ((parameters[i].size() == unsigned(end - begin)) && (0 == parameters[i].compare(0, end - begin, begin, end - begin)))
+                    return i;
+            }
+
+            return -1;
+        }
+
+        /**
+         * Append token to buffer, replacing references to parameters with
+         * values. Without values, only check for references. References to
+         * shadowed names are left alone. Returns whether there has been any
+         * reference.
+         */
+        bool substitute(const Token & token, const std::vector<std::string> * values, const std::vector<std::string> & shadowed,
+                std::string & buffer) const
+        {
+            const char * c(text.data() + token.offset), * const end(c + token.length);
+            bool result(false);
+
+            while (c != end)
+            {
+                const char * backslash(static_cast<const char *>(std::memchr(c, '\\', end - c)));
+                if (! backslash)
+                    backslash = end;
+
+                const char * name_end(backslash == end ? end : backslash + 1);
+                while ((name_end != end) && internal::is_parameter_character(*name_end))
+                    ++name_end;
+
+                int p(backslash == end ? -1 : parameter(backslash + 1, name_end));
+                if ((0 <= p) && (shadowed.end() != std::find(shadowed.begin(), shadowed.end(), parameters[p])))
+                    p = -1;
+
+                if (p < 0)
+                {
+                    if (values)
+                        buffer.append(c, name_end);
+
+                    c = name_end;
+                    continue;
+                }
+
+                result = true;
+                if (values)
+                {
+                    buffer.append(c, backslash);
+                    buffer.append((*values)[p]);
+                }
+
+                // \() separates a reference from text that follows it
+                c = name_end;
+                if ((end - c >= 3) && (0 == std::memcmp(c, "\\()", 3)))
+                    c += 3;
+            }
+
+            return result;
+        }
+
+        /// Append the substitution of token to buffer, and return the resulting token.
+        Token expand(const Token & token, const std::vector<std::string> & values, const std::vector<std::string> & shadowed,
+                std::string & buffer) const
+        {
+            unsigned offset(buffer.size());
+            substitute(token, &values, shadowed, buffer);
+
+            return Token(offset, buffer.size() - offset);
+        }
+
+        bool references(unsigned index) const
+        {
+            const LexedLine & line(lines[index]);
+            const std::vector<std::string> & shadowed(scopes[line_scopes[index]]);
+            std::string unused;
+            bool result(substitute(line.label, 0, shadowed, unused) || substitute(line.mnemonic, 0, shadowed, unused)
+                    || substitute(line.params, 0, shadowed, unused));
+
+            for (std::vector<Token>::const_iterator o(line.operands.begin()), o_end(line.operands.end()) ;
+                    (o != o_end) && ! result ; ++o)
+            {
+                result = substitute(*o, 0, shadowed, unused);
+            }
+
+            return result;
+        }
+
+        /// Return whether line invokes one of macros.
+        bool invokes(const LexedLine & line, const std::set<Atom> & macros) const
+        {
+            if (line.directive || line.mnemonic.empty())
+                return false;
+
+            const char * mnemonic(text.data() + line.mnemonic.offset);
+
+            return macros.end() != macros.find(Atom(mnemonic, mnemonic + line.mnemonic.length));
+        }
+
+        /// Split the lines into pieces, and create the entities of all shared pieces.
+        void split()
+        {
+            std::set<Atom> dependent_macros;
+            internal::PieceSink sink;
+            MacroProcessor processor(sink);
+
+            for (unsigned first(0), last(0) ; first < lines.size() ; first = last)
+            {
+                // Find the end of the top-level line or block at first
+                bool dependent(false);
+                int depth(0);
+                last = first;
+                do
+                {
+                    const LexedLine & l(lines[last]);
+
+                    depth += MacroProcessor::nesting_change(text.data(), l);
+                    dependent = dependent || references(last) || invokes(l, dependent_macros);
+                    ++last;
+                }
+                while ((depth > 0) && (last < lines.size()));
+
+                const LexedLine & l(lines[first]);
+                if (dependent && internal::is_directive(text.data(), l, "macro"))
+                {
+                    const char * begin(text.data() + l.params.offset), * end(begin + l.params.length), * name_end(begin);
+                    while ((begin != end) && internal::is_blank(*begin))
+                        ++begin;
+
+                    for (name_end = begin ; (name_end != end) && (! internal::is_blank(*name_end)) && (',' != *name_end) ; ++name_end)
+                    {
+                    }
+
+                    dependent_macros.insert(Atom(begin, name_end));
+                }
+
+                if (dependent)
+                {
+                    if (pieces.empty() || ! pieces.back().dependent)
+                    {
+                        pieces.push_back(internal::TemplatePiece());
+                        pieces.back().dependent = true;
+                        pieces.back().first = first;
+                    }
+
+                    pieces.back().last = last;
+                }
+                else
+                {
+                    if (pieces.empty() || pieces.back().dependent)
+                    {
+                        pieces.push_back(internal::TemplatePiece());
+                        pieces.back().dependent = false;
+                        sink.collector.reset(new AssemblyLineCollector(arena, pieces.back().lines));
+                        pieces.back().entities = sink.collector->entities();
+                    }
+
+                    for (unsigned i(first) ; i != last ; ++i)
+                    {
+                        processor.process(text.data(), lines[i]);
+                    }
+                }
+            }
+
+            processor.finish();
+            macros = processor.definitions();
+
+            for (std::vector<internal::TemplatePiece>::const_iterator p(pieces.begin()), p_end(pieces.end()) ;
+                    p != p_end ; ++p)
+            {
+                if (! p->dependent)
+                    shared_entities += p->entities.size();
+            }
+        }
+    };
+
+    namespace internal
+    {
+        static std::string read(std::istream & input)
+        {
+            return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        }
+    }
+
+    KernelTemplate::KernelTemplate(std::istream & input) :
+        PrivateImplementationPattern<KernelTemplate>(new Implementation<KernelTemplate>(internal::read(input)))
+    {
+    }
+
+    KernelTemplate::KernelTemplate(const MappedFile & input) :
+        PrivateImplementationPattern<KernelTemplate>(new Implementation<KernelTemplate>(std::string(input.begin(), input.end())))
+    {
+    }
+
+    KernelTemplate::~KernelTemplate()
+    {
+    }
+
+    const std::vector<std::string> &
+    KernelTemplate::parameters() const
+    {
+        return _imp->parameters;
+    }
+
+    unsigned
+    KernelTemplate::shared_entities() const
+    {
+        return _imp->shared_entities;
+    }
+
+    Sequence<AssemblyEntityPtr>
+    KernelTemplate::instantiate(const Bindings & bindings, Arena & arena, LineTable & lines) const
+    {
+        std::vector<std::string> values(_imp->defaults);
+        std::vector<bool> bound(_imp->has_default);
+
+        for (Bindings::const_iterator b(bindings.begin()), b_end(bindings.end()) ; b != b_end ; ++b)
+        {
+            int p(_imp->parameter(b->first.data(), b->first.data() + b->first.size()));
+            if (p < 0)
+                throw CommonSyntaxError("unknown parameter '" + b->first + "'");
+
+            values[p] = b->second;
+            bound[p] = true;
+        }
+
+        for (unsigned i(0) ; i < bound.size() ; ++i)
+        {
+            if (! bound[i])
+                throw CommonSyntaxError("parameter '" + _imp->parameters[i] + "' has no value");
+        }
+
+        Sequence<AssemblyEntityPtr> result;
+        internal::PieceSink sink;
+        MacroProcessor processor(sink);
+        processor.define(_imp->macros);
+
+        if (0 != _imp->shared_entities)
+            arena.attach(_imp->arena);
+
+        std::string buffer;
+        LexedLine expanded;
+        for (std::vector<internal::TemplatePiece>::const_iterator p(_imp->pieces.begin()), p_end(_imp->pieces.end()) ;
+                p != p_end ; ++p)
+        {
+            if (! p->dependent)
+            {
+                // Shared entities are appended one by one, as appending p->entities as a whole would move them
+                for (Sequence<AssemblyEntityPtr>::Iterator e(p->entities.begin()), e_end(p->entities.end()) ;
+                        e != e_end ; ++e)
+                {
+                    result.append(*e);
+                }
+
+                lines.append(p->lines);
+                continue;
+            }
+
+            sink.collector.reset(new AssemblyLineCollector(arena, lines));
+
+            for (unsigned i(p->first) ; i != p->last ; ++i)
+            {
+                const LexedLine & l(_imp->lines[i]);
+                const std::vector<std::string> & shadowed(_imp->scopes[_imp->line_scopes[i]]);
+
+                buffer.clear();
+                expanded.number = l.number;
+                expanded.directive = l.directive;
+                expanded.label = _imp->expand(l.label, values, shadowed, buffer);
+                expanded.mnemonic = _imp->expand(l.mnemonic, values, shadowed, buffer);
+                expanded.params = _imp->expand(l.params, values, shadowed, buffer);
+                expanded.operands.clear();
+                for (std::vector<Token>::const_iterator o(l.operands.begin()), o_end(l.operands.end()) ;
+                        o != o_end ; ++o)
+                {
+                    expanded.operands.push_back(_imp->expand(*o, values, shadowed, buffer));
+                }
+
+                processor.process(buffer.data(), expanded);
+            }
+
+            result.append(sink.collector->entities());
+        }
+
+        processor.finish();
+
+        return result;
+    }
+
+    Sequence<AssemblyEntityPtr>
+    KernelTemplate::instantiate(const Bindings & bindings, Arena & arena) const
+    {
+        LineTable lines;
+
+        return instantiate(bindings, arena, lines);
+    }
+}
@@ -0,0 +1,92 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_KERNEL_TEMPLATE_HH
+#define GPU_GUARD_COMMON_KERNEL_TEMPLATE_HH 1
+
+#include <common/assembly_entities.hh>
+#include <common/line_table.hh>
+#include <utils/arena.hh>
+#include <utils/private_implementation_pattern.hh>
+#include <utils/sequence.hh>
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gpu
+{
+    class MappedFile;
+
+    /**
+     * KernelTemplate is assembly source that is parsed once, and can then be
+     * instantiated many times with different values for its parameters.
+     *
+     * Parameters are declared at the top level as '.param name' or
+     * '.param name, default', and referenced anywhere as \\name. Names
+     * consist of letters, digits and underscores, so \\reg.x refers to the
+     * parameter reg. References are replaced by text before macros are
+     * expanded, so a parameter may also serve as a .rept count or as the
+     * argument of a macro. Within a .macro or .irp block, the parameters of
+     * the block shadow template parameters of the same name.
+     *
+     * The source is split into top-level lines and blocks. Those which
+     * neither reference a parameter nor invoke a macro that does are turned
+     * into entities once, and shared by all instantiations. Only the
+     * remaining ones are substituted and parsed again on each instantiation.
+     * Note that \\@ is counted separately for both kinds.
+     *
+     * Templates cannot use .include.
+     */
+    class KernelTemplate :
+        public PrivateImplementationPattern<KernelTemplate>
+    {
+        public:
+            /// Values of parameters, by name.
+            typedef std::map<std::string, std::string> Bindings;
+
+            KernelTemplate(std::istream & input);
+
+            KernelTemplate(const MappedFile & input);
+
+            ~KernelTemplate();
+
+            /// Return the names of all parameters, in order of declaration.
+            const std::vector<std::string> & parameters() const;
+
+            /// Return the number of entities that are shared by all instantiations.
+            unsigned shared_entities() const;
+
+            /**
+             * Instantiate the template with bindings. Parameters that are not
+             * bound take their defaults.
+             *
+             * New entities are created in arena, which also keeps the shared
+             * entities alive. The source line of each entity is recorded in
+             * lines.
+             */
+            Sequence<AssemblyEntityPtr> instantiate(const Bindings & bindings, Arena & arena, LineTable & lines) const;
+
+            /// Instantiate the template, discarding line information.
+            Sequence<AssemblyEntityPtr> instantiate(const Bindings & bindings, Arena & arena) const;
+    };
+}
+
+#endif
@@ -0,0 +1,172 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <common/assembly_entities.hh>
+#include <common/assembly_parser.hh>
+#include <common/kernel_template.hh>
+#include <common/syntax.hh>
+#include <utils/sequence-impl.hh>
+
+#include <sstream>
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+struct KernelTemplateTest :
+    public Test
+{
+    KernelTemplateTest() :
+        Test("kernel_template_test")
+    {
+    }
+
+    std::string print(const Sequence<AssemblyEntityPtr> & entities)
+    {
+        AssemblyEntityPrinter p;
+        for (Sequence<AssemblyEntityPtr>::Iterator i(entities.begin()), i_end(entities.end()) ;
+                i != i_end ; ++i)
+        {
+            (*i)->accept(p);
+        }
+
+        return p.output();
+    }
+
+    std::string print(const std::string & source)
+    {
+        std::stringstream input(source);
+        Arena arena;
+
+        return print(AssemblyParser::parse(input, arena));
+    }
+
+    std::string instantiate(const KernelTemplate & t, const KernelTemplate::Bindings & bindings)
+    {
+        Arena arena;
+
+        return print(t.instantiate(bindings, arena));
+    }
+
+    std::string error(const std::string & source, const KernelTemplate::Bindings & bindings = KernelTemplate::Bindings())
+    {
+        try
+        {
+            std::stringstream input(source);
+            KernelTemplate t(input);
+            instantiate(t, bindings);
+        }
+        catch (SyntaxError & e)
+        {
+            return e.message();
+        }
+
+        return "";
+    }
+
+    virtual void run()
+    {
+        std::stringstream input(
+                ".param count, 2\n"
+                ".param reg\n"
+                ".macro clear r\n"
+                "\tmov \\r, 0\n"
+                ".endm\n"
+                ".macro load r\n"
+                "\tmov \\r, \\reg\n"
+                ".endm\n"
+                "start:\n"
+                "\tclear $0.x\n"
+                ".rept \\count\n"
+                "\tadd $\\reg.x, $\\reg\\()1.y\n"
+                ".endr\n"
+                "\tload $2.z\n"
+                "\tclear $3.w\n"
+                "\t.byte 0x10\n");
+        KernelTemplate t(input);
+
+        TEST_CHECK_EQUAL(t.parameters().size(), 2u);
+        TEST_CHECK_EQUAL(t.parameters()[0], "count");
+        TEST_CHECK_EQUAL(t.parameters()[1], "reg");
+
+        // start, the first clear, the second clear and .byte
+        TEST_CHECK_EQUAL(t.shared_entities(), 4u);
+
+        KernelTemplate::Bindings bindings;
+        bindings["reg"] = "7";
+        TEST_CHECK_EQUAL(instantiate(t, bindings), print(
+                    "start:\n"
+                    "\tmov $0.x, 0\n"
+                    "\tadd $7.x, $71.y\n"
+                    "\tadd $7.x, $71.y\n"
+                    "\tmov $2.z, 7\n"
+                    "\tmov $3.w, 0\n"
+                    "\t.byte 0x10\n"));
+
+        bindings["count"] = "0";
+        bindings["reg"] = "4";
+        TEST_CHECK_EQUAL(instantiate(t, bindings), print(
+                    "start:\n"
+                    "\tmov $0.x, 0\n"
+                    "\tmov $2.z, 4\n"
+                    "\tmov $3.w, 0\n"
+                    "\t.byte 0x10\n"));
+
+        // shared and new entities carry their source lines
+        Arena arena;
+        LineTable lines;
+        bindings["count"] = "1";
+        TEST_CHECK_EQUAL(t.instantiate(bindings, arena, lines).size(), 6u);
+        TEST_CHECK_EQUAL(lines.size(), 6u);
+        TEST_CHECK_EQUAL(lines.line(0), 9u);
+        TEST_CHECK_EQUAL(lines.line(1), 10u);
+        TEST_CHECK_EQUAL(lines.line(2), 11u);
+        TEST_CHECK_EQUAL(lines.line(3), 14u);
+        TEST_CHECK_EQUAL(lines.line(5), 16u);
+
+        // parameters of macros and .irp blocks shadow those of the template
+        std::stringstream shadowing(
+                ".param n, 3\n"
+                ".macro foo n\n"
+                "\tMOV R\\n, R\\m\n"
+                ".endm\n"
+                ".param m\n"
+                ".irp n, 1\n"
+                "\tMOV R\\n, R\\m\n"
+                ".endr\n"
+                "\tfoo 7\n"
+                "\tMOV R\\n, R0\n");
+        KernelTemplate s(shadowing);
+        KernelTemplate::Bindings values;
+        values["n"] = "5";
+        values["m"] = "2";
+        TEST_CHECK_EQUAL(instantiate(s, values), print(
+                    "\tMOV R1, R2\n"
+                    "\tMOV R7, R2\n"
+                    "\tMOV R5, R0\n"));
+
+        SyntaxContext::File f("template.s");
+        TEST_CHECK_EQUAL(error(".param x\n.param x\n"), "template.s:2: (common) parameter 'x' is already declared");
+        TEST_CHECK_EQUAL(error(".param 1x\n"), "template.s:1: (common) '1x' is not a valid parameter name");
+        TEST_CHECK_EQUAL(error(".param x\n\tnop \\x\n"), "template.s:1: (common) parameter 'x' has no value");
+        TEST_CHECK_EQUAL(error(".param x, 1\n", bindings), "template.s:1: (common) unknown parameter 'count'");
+        TEST_CHECK_EQUAL(error(".param x, y\n.rept \\x\n.endr\n"), "template.s:2: (common) 'y' is not a valid repeat count");
+    }
+} kernel_template_test;
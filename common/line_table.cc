@@ -0,0 +1,190 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/line_table.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+
+#include <vector>
+
+namespace gpu
+{
+    template <>
+    struct Implementation<LineTable>
+    {
+        /// Closed runs, each encoded as zigzag line delta and entity count.
+        std::vector<unsigned char> runs;
+
+        unsigned entities;
+
+        /// Line of the last closed run, which the next delta refers to.
+        unsigned encoded_line;
+
+        /// Line and entity count of the open run.
+        unsigned line;
+
+        unsigned count;
+
+        Implementation() :
+            entities(0),
+            encoded_line(0),
+            line(0),
+            count(0)
+        {
+        }
+
+        void put(unsigned long value)
+        {
+            while (value >= 0x80)
+            {
+                runs.push_back(0x80 | (value & 0x7f));
+                value >>= 7;
+            }
+
+            runs.push_back(value);
+        }
+
+        static unsigned long get(const unsigned char * & p)
+        {
+            unsigned long result(0);
+            unsigned shift(0);
+
+            do
+            {
+                result |= static_cast<unsigned long>(*p & 0x7f) << shift;
+                shift += 7;
+            }
+            while (*p++ & 0x80);
+
+            return result;
+        }
+
+        void close()
+        {
+            if (0 == count)
+                return;
+
+            long delta(long(line) - long(encoded_line));
+            put(delta < 0 ? 2 * (-delta) - 1 : 2 * delta);
+            put(count);
+
+            encoded_line = line;
+            count = 0;
+        }
+
+        void add(unsigned l, unsigned n)
+        {
+            if ((0 != count) && (l == line))
+            {
+                count += n;
+            }
+            else
+            {
+                close();
+                line = l;
+                count = n;
+            }
+
+            entities += n;
+        }
+
+        /// Replay the closed runs in encoded as if they had been added one by one.
+        void add_runs(const std::vector<unsigned char> & encoded)
+        {
+            if (encoded.empty())
+                return;
+
+            const unsigned char * p(&encoded[0]), * const p_end(p + encoded.size());
+            unsigned l(0);
+            while (p != p_end)
+            {
+                unsigned long delta(get(p));
+                l += (delta & 1) ? -long((delta + 1) / 2) : long(delta / 2);
+                add(l, get(p));
+            }
+        }
+    };
+
+    LineTable::LineTable() :
+        PrivateImplementationPattern<LineTable>(new Implementation<LineTable>)
+    {
+    }
+
+    LineTable::~LineTable()
+    {
+    }
+
+    void
+    LineTable::append(unsigned line)
+    {
+        _imp->add(line, 1);
+    }
+
+    void
+    LineTable::append(const LineTable & other)
+    {
+        const Implementation<LineTable> & o(*other._imp);
+        unsigned line(o.line), count(o.count);
+
+        if (other._imp == _imp)
+        {
+            std::vector<unsigned char> runs(o.runs);
+            _imp->add_runs(runs);
+        }
+        else
+        {
+            _imp->add_runs(o.runs);
+        }
+
+        if (0 != count)
+            _imp->add(line, count);
+    }
+
+    unsigned
+    LineTable::line(unsigned index) const
+    {
+        if (index >= _imp->entities)
+            return 0;
+
+        const unsigned char * p(_imp->runs.empty() ? 0 : &_imp->runs[0]), * const p_end(p + _imp->runs.size());
+        unsigned line(0), first(0);
+        while (p != p_end)
+        {
+            unsigned long delta(Implementation<LineTable>::get(p));
+            line += (delta & 1) ? -long((delta + 1) / 2) : long(delta / 2);
+            first += Implementation<LineTable>::get(p);
+
+            if (index < first)
+                return line;
+        }
+
+        return _imp->line;
+    }
+
+    unsigned
+    LineTable::size() const
+    {
+        return _imp->entities;
+    }
+
+    unsigned long
+    LineTable::bytes() const
+    {
+        return _imp->runs.size();
+    }
+}
@@ -0,0 +1,63 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_LINE_TABLE_HH
+#define GPU_GUARD_COMMON_LINE_TABLE_HH 1
+
+#include <utils/private_implementation_pattern.hh>
+
+namespace gpu
+{
+    /**
+     * LineTable records the source line of each entity in a parsed sequence.
+     *
+     * Entities are identified by their index in the sequence. Consecutive
+     * entities from the same line form a run, and runs are stored as pairs
+     * of line delta and entity count in a variable-length byte encoding.
+     * Looking up a line decodes the runs up to the requested index, which is
+     * only meant to happen when a diagnostic is actually raised.
+     *
+     * Copies of a LineTable share their contents.
+     */
+    class LineTable :
+        public PrivateImplementationPattern<LineTable>
+    {
+        public:
+            LineTable();
+
+            ~LineTable();
+
+            /// Record that the next entity stems from line.
+            void append(unsigned line);
+
+            /// Record the entities of other after our own.
+            void append(const LineTable & other);
+
+            /// Return the line of the entity at index, or 0 if index is out of range.
+            unsigned line(unsigned index) const;
+
+            /// Return the number of entities recorded so far.
+            unsigned size() const;
+
+            /// Return the number of bytes used by the encoded runs.
+            unsigned long bytes() const;
+    };
+}
+
+#endif
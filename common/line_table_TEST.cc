@@ -0,0 +1,99 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <common/line_table.hh>
+#include <common/syntax.hh>
+
+#include <vector>
+
+using namespace gpu;
+using namespace tests;
+
+struct LineTableTest :
+    public Test
+{
+    LineTableTest() :
+        Test("line_table_test")
+    {
+    }
+
+    virtual void run()
+    {
+        const unsigned lines[] = { 1, 1, 2, 5, 5, 5, 4, 100000, 100001, 3, 3, 70000 };
+        const unsigned count(sizeof(lines) / sizeof(lines[0]));
+
+        LineTable table;
+        std::vector<unsigned> reference;
+        for (unsigned i(0) ; i < count ; ++i)
+        {
+            table.append(lines[i]);
+            reference.push_back(lines[i]);
+        }
+
+        TEST_CHECK_EQUAL(table.size(), count);
+        for (unsigned i(0) ; i < count ; ++i)
+        {
+            TEST_CHECK_EQUAL(table.line(i), lines[i]);
+        }
+        TEST_CHECK_EQUAL(table.line(count), 0u);
+
+        // appending continues runs across the boundary
+        LineTable other;
+        other.append(70000);
+        other.append(70000);
+        other.append(12);
+        table.append(other);
+        reference.push_back(70000);
+        reference.push_back(70000);
+        reference.push_back(12);
+
+        table.append(table);
+        reference.insert(reference.end(), reference.begin(), reference.end());
+
+        TEST_CHECK_EQUAL(table.size(), reference.size());
+        for (unsigned i(0) ; i < reference.size() ; ++i)
+        {
+            TEST_CHECK_EQUAL(table.line(i), reference[i]);
+        }
+
+        // one entity per line needs two bytes per line
+        LineTable dense;
+        for (unsigned i(1) ; i <= 1000 ; ++i)
+        {
+            dense.append(i);
+        }
+        TEST_CHECK_EQUAL(dense.line(999), 1000u);
+        TEST_CHECK(dense.bytes() <= 2 * 1000);
+
+        // errors look up their line in the active table
+        unsigned index(4);
+        SyntaxContext::File f("test.s");
+        {
+            SyntaxContext::Lines l(dense, index);
+            TEST_CHECK_EQUAL(CommonSyntaxError("foo").message(), "test.s:5: (common) foo");
+
+            index = 41;
+            TEST_CHECK_EQUAL(CommonSyntaxError("foo").message(), "test.s:42: (common) foo");
+        }
+
+        SyntaxContext::Line(7);
+        TEST_CHECK_EQUAL(CommonSyntaxError("foo").message(), "test.s:7: (common) foo");
+    }
+} line_table_test;
@@ -0,0 +1,803 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/macro_processor.hh>
+#include <common/syntax.hh>
+#include <utils/atom.hh>
+#include <utils/number_parser.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+#include <utils/stringify.hh>
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <tr1/memory>
+
+namespace gpu
+{
+    namespace internal
+    {
+        enum MacroDirective
+        {
+            md_none,
+            md_macro,
+            md_endm,
+            md_rept,
+            md_irp,
+            md_endr
+        };
+
+        static MacroDirective macro_directive(const char * name, unsigned length)
+        {
+            switch (length)
+            {
+                case 3:
+                    if (0 == std::memcmp(name, "irp", 3))
+                        return md_irp;
+                    break;
+
+                case 4:
+                    if (0 == std::memcmp(name, "endm", 4))
+                        return md_endm;
+                    if (0 == std::memcmp(name, "rept", 4))
+                        return md_rept;
+                    if (0 == std::memcmp(name, "endr", 4))
+                        return md_endr;
+                    break;
+
+                case 5:
+                    if (0 == std::memcmp(name, "macro", 5))
+                        return md_macro;
+                    break;
+            }
+
+            return md_none;
+        }
+
+        static const char * directive_name(MacroDirective directive)
+        {
+            switch (directive)
+            {
+                case md_macro:
+                    return ".macro";
+
+                case md_rept:
+                    return ".rept";
+
+                case md_irp:
+                    return ".irp";
+
+                case md_endm:
+                    return ".endm";
+
+                case md_endr:
+                    return ".endr";
+
+                case md_none:
+                    break;
+            }
+
+            return "";
+        }
+
+        inline bool is_separator(char c)
+        {
+            return (' ' == c) || ('\t' == c) || (',' == c);
+        }
+
+        inline bool is_identifier(char c)
+        {
+            return (('a' <= c) && (c <= 'z')) || (('A' <= c) && (c <= 'Z')) || (('0' <= c) && (c <= '9')) || ('_' == c) || ('$' == c) || ('.' == c);
+        }
+
+        static std::string strip(const char * begin, const char * end)
+        {
+            while ((begin != end) && is_separator(*begin))
+                ++begin;
+
+            while ((begin != end) && is_separator(*(end - 1)))
+                --end;
+
+            return std::string(begin, end);
+        }
+
+        /// A part of a body token: either text, or a reference to a parameter or the expansion counter.
+        struct MacroSegment
+        {
+            enum { text = -1, counter = -2 };
+
+            unsigned offset;
+
+            unsigned length;
+
+            int parameter;
+
+            MacroSegment(unsigned o, unsigned l, int p) :
+                offset(o),
+                length(l),
+                parameter(p)
+            {
+            }
+        };
+
+        struct MacroToken
+        {
+            unsigned first;
+
+            unsigned count;
+        };
+
+        struct MacroLine
+        {
+            bool directive;
+
+            bool substituted;
+
+            MacroToken label;
+
+            MacroToken mnemonic;
+
+            MacroToken params;
+
+            unsigned first_operand;
+
+            unsigned operands;
+        };
+
+        /// A body of lines that have been lexed once, and are ready for expansion.
+        struct MacroBody
+        {
+            std::vector<std::string> parameters;
+
+            std::vector<std::string> defaults;
+
+            std::string text;
+
+            std::vector<MacroSegment> segments;
+
+            std::vector<MacroToken> operands;
+
+            std::vector<MacroLine> lines;
+
+            MacroToken add_token(const char * buffer, const Token & token, bool & substituted)
+            {
+                MacroToken result;
+                result.first = segments.size();
+                result.count = 0;
+
+                const char * c(buffer + token.offset), * const end(c + token.length);
+
+                while (c != end)
+                {
+                    const char * backslash(static_cast<const char *>(std::memchr(c, '\\', end - c)));
+                    if (! backslash)
+                        backslash = end;
+
+                    if (c != backslash)
+                        add_text(c, backslash, result);
+
+                    if (backslash == end)
+                        break;
+
+                    c = backslash + 1;
+
+                    if ((c != end) && ('@' == *c))
+                    {
+                        segments.push_back(MacroSegment(0, 0, MacroSegment::counter));
+                        ++result.count;
+                        substituted = true;
+                        ++c;
+                        continue;
+                    }
+
+                    if ((c + 1 < end) && ('(' == c[0]) && (')' == c[1]))
+                    {
+                        substituted = true;
+                        c += 2;
+                        continue;
+                    }
+
+                    const char * name_end(c);
+                    while ((name_end != end) && is_identifier(*name_end))
+                        ++name_end;
+
+                    int parameter(find_parameter(c, name_end));
+                    if (parameter < 0)
+                    {
+                        // Not a parameter, so the backslash is kept
+                        add_text(backslash, c, result);
+                        continue;
+                    }
+
+                    segments.push_back(MacroSegment(0, 0, parameter));
+                    ++result.count;
+                    substituted = true;
+                    c = name_end;
+                }
+
+                return result;
+            }
+
+            /// Append text to token, merging it with a directly preceding text segment.
+            void add_text(const char * begin, const char * end, MacroToken & token)
+            {
+                if ((0 != token.count) && (MacroSegment::text == segments.back().parameter))
+                {
+                    segments.back().length += end - begin;
+                }
+                else
+                {
+                    segments.push_back(MacroSegment(text.size(), end - begin, MacroSegment::text));
+                    ++token.count;
+                }
+
+                text.append(begin, end);
+            }
+
+            int find_parameter(const char * begin, const char * end) const
+            {
+                for (unsigned i(0) ; i < parameters.size() ; ++i)
+                {
+                    if ((parameters[i].size() == unsigned(end - begin)) && (0 == parameters[i].compare(0, end - begin, begin, end - begin)))
+                        return i;
+                }
+
+                return -1;
+            }
+
+            void add_line(const char * buffer, const LexedLine & line)
+            {
+                MacroLine l;
+                l.directive = line.directive;
+                l.substituted = false;
+                l.label = add_token(buffer, line.label, l.substituted);
+                l.mnemonic = add_token(buffer, line.mnemonic, l.substituted);
+                l.params = add_token(buffer, line.params, l.substituted);
+                l.first_operand = operands.size();
+                l.operands = line.operands.size();
+
+                for (std::vector<Token>::const_iterator o(line.operands.begin()), o_end(line.operands.end()) ;
+                        o != o_end ; ++o)
+                {
+                    operands.push_back(add_token(buffer, *o, l.substituted));
+                }
+
+                lines.push_back(l);
+            }
+
+            /// Return the token of a line without substitutions, which refers to text directly.
+            Token plain_token(const MacroToken & token) const
+            {
+                if (0 == token.count)
+                    return Token();
+
+                return Token(segments[token.first].offset, segments[token.first].length);
+            }
+
+            /// Append the expansion of token to buffer, and return the resulting token.
+            Token expand_token(const MacroToken & token, const std::vector<std::string> & arguments,
+                    const std::string & counter, std::string & buffer) const
+            {
+                unsigned offset(buffer.size());
+
+                for (unsigned i(token.first), i_end(token.first + token.count) ; i != i_end ; ++i)
+                {
+                    const MacroSegment & s(segments[i]);
+
+                    switch (s.parameter)
+                    {
+                        case MacroSegment::text:
+                            buffer.append(text, s.offset, s.length);
+                            break;
+
+                        case MacroSegment::counter:
+                            buffer.append(counter);
+                            break;
+
+                        default:
+                            buffer.append(arguments[s.parameter]);
+                    }
+                }
+
+                return Token(offset, buffer.size() - offset);
+            }
+        };
+
+        typedef std::tr1::shared_ptr<MacroBody> MacroBodyPtr;
+    }
+
+    LexedLineSink::~LexedLineSink()
+    {
+    }
+
+    template <>
+    struct Implementation<MacroDefinitions>
+    {
+        std::map<Atom, internal::MacroBodyPtr> macros;
+    };
+
+    MacroDefinitions::MacroDefinitions() :
+        PrivateImplementationPattern<MacroDefinitions>(new Implementation<MacroDefinitions>)
+    {
+    }
+
+    MacroDefinitions::~MacroDefinitions()
+    {
+    }
+
+    unsigned
+    MacroDefinitions::size() const
+    {
+        return _imp->macros.size();
+    }
+
+    template <>
+    struct Implementation<MacroProcessor>
+    {
+        /// Expansions may not nest deeper than this, to catch endless recursion.
+        static const unsigned maximum_nesting = 256;
+
+        LexedLineSink & sink;
+
+        std::map<Atom, internal::MacroBodyPtr> macros;
+
+        /// The blocks that are open while recording a body, innermost last.
+        std::vector<internal::MacroDirective> open;
+
+        /// The line that opened the outermost block.
+        unsigned open_line;
+
+        internal::MacroBodyPtr body;
+
+        Atom name;
+
+        unsigned repetitions;
+
+        std::vector<std::string> values;
+
+        unsigned expansions;
+
+        unsigned nesting;
+
+        Implementation(LexedLineSink & sink) :
+            sink(sink),
+            open_line(0),
+            repetitions(0),
+            expansions(0),
+            nesting(0)
+        {
+        }
+
+        void begin_block(internal::MacroDirective directive, const char * begin, const char * end, unsigned number)
+        {
+            using namespace internal;
+
+            open.push_back(directive);
+            open_line = number;
+            body.reset(new MacroBody);
+            values.clear();
+
+            switch (directive)
+            {
+                case md_macro:
+                    {
+                        // name, then parameters with optional defaults, all separated by blanks or commas
+                        std::vector<std::string> words;
+                        for (const char * c(begin) ; c != end ; )
+                        {
+                            while ((c != end) && is_separator(*c))
+                                ++c;
+
+                            const char * word_end(c);
+                            while ((word_end != end) && ! is_separator(*word_end))
+                                ++word_end;
+
+                            if (c != word_end)
+                                words.push_back(std::string(c, word_end));
+
+                            c = word_end;
+                        }
+
+                        if (words.empty())
+                            throw CommonSyntaxError("missing macro name");
+
+                        name = Atom(words.front());
+                        if (macros.end() != macros.find(name))
+                            throw CommonSyntaxError("macro '" + name.str() + "' is already defined");
+
+                        for (std::vector<std::string>::const_iterator w(words.begin() + 1), w_end(words.end()) ;
+                                w != w_end ; ++w)
+                        {
+                            std::string::size_type equals(w->find('='));
+                            body->parameters.push_back(w->substr(0, equals));
+                            body->defaults.push_back(std::string::npos == equals ? std::string() : w->substr(equals + 1));
+                        }
+                    }
+                    break;
+
+                case md_rept:
+                    {
+                        std::string count(strip(begin, end));
+                        if (! NumberParser::parse(count, repetitions))
+                            throw CommonSyntaxError("'" + count + "' is not a valid repeat count");
+                    }
+                    break;
+
+                case md_irp:
+                    {
+                        const char * c(begin);
+                        while ((c != end) && is_separator(*c))
+                            ++c;
+
+                        const char * symbol_end(c);
+                        while ((symbol_end != end) && ! is_separator(*symbol_end))
+                            ++symbol_end;
+
+                        if (c == symbol_end)
+                            throw CommonSyntaxError("missing symbol in .irp");
+
+                        body->parameters.push_back(std::string(c, symbol_end));
+
+                        for (c = symbol_end ; c != end ; )
+                        {
+                            while ((c != end) && is_separator(*c))
+                                ++c;
+
+                            const char * value_end(static_cast<const char *>(std::memchr(c, ',', end - c)));
+                            if (! value_end)
+                                value_end = end;
+
+                            if (c != value_end)
+                                values.push_back(strip(c, value_end));
+
+                            c = value_end;
+                        }
+
+                        // Without any values, the body is expanded once with an empty argument
+                        if (values.empty())
+                            values.push_back(std::string());
+                    }
+                    break;
+
+                default:
+                    throw InternalError("common", "begin_block called for '" + std::string(directive_name(directive)) + "'");
+            }
+        }
+
+        void end_block()
+        {
+            using namespace internal;
+
+            MacroDirective directive(open.front());
+            MacroBodyPtr b(body);
+
+            open.clear();
+            body.reset();
+
+            switch (directive)
+            {
+                case md_macro:
+                    macros[name] = b;
+                    break;
+
+                case md_rept:
+                    for (unsigned i(0) ; i < repetitions ; ++i)
+                    {
+                        expand(*b, std::vector<std::string>(), open_line);
+                    }
+                    break;
+
+                case md_irp:
+                    {
+                        std::vector<std::string> current(values), arguments(1);
+                        for (std::vector<std::string>::const_iterator v(current.begin()), v_end(current.end()) ;
+                                v != v_end ; ++v)
+                        {
+                            arguments[0] = *v;
+                            expand(*b, arguments, open_line);
+                        }
+                    }
+                    break;
+
+                default:
+                    throw InternalError("common", "end_block called for '" + std::string(directive_name(directive)) + "'");
+            }
+        }
+
+        void invoke(const internal::MacroBody & macro, const char * buffer, const LexedLine & line)
+        {
+            std::vector<std::string> arguments(macro.defaults);
+
+            unsigned position(0);
+            for (std::vector<Token>::const_iterator o(line.operands.begin()), o_end(line.operands.end()) ;
+                    o != o_end ; ++o)
+            {
+                std::string argument(internal::strip(buffer + o->offset, buffer + o->offset + o->length));
+
+                std::string::size_type equals(argument.find('='));
+                if (std::string::npos != equals)
+                {
+                    int parameter(macro.find_parameter(argument.data(), argument.data() + equals));
+                    if (parameter >= 0)
+                    {
+                        arguments[parameter] = argument.substr(equals + 1);
+                        continue;
+                    }
+                }
+
+                if (position >= arguments.size())
+                    throw CommonSyntaxError("too many arguments for macro '" + std::string(buffer + line.mnemonic.offset, line.mnemonic.length) + "'");
+
+                if (! argument.empty())
+                    arguments[position] = argument;
+
+                ++position;
+            }
+
+            expand(macro, arguments, line.number);
+        }
+
+        void expand(const internal::MacroBody & b, const std::vector<std::string> & arguments, unsigned number)
+        {
+            if (nesting >= maximum_nesting)
+                throw CommonSyntaxError("macro expansions nested too deeply");
+
+            ++nesting;
+
+            std::string counter(stringify(expansions++)), buffer;
+            LexedLine expanded;
+            expanded.number = number;
+
+            for (std::vector<internal::MacroLine>::const_iterator l(b.lines.begin()), l_end(b.lines.end()) ;
+                    l != l_end ; ++l)
+            {
+                expanded.directive = l->directive;
+                expanded.operands.clear();
+
+                if (! l->substituted)
+                {
+                    expanded.label = b.plain_token(l->label);
+                    expanded.mnemonic = b.plain_token(l->mnemonic);
+                    expanded.params = b.plain_token(l->params);
+                    for (unsigned o(l->first_operand), o_end(l->first_operand + l->operands) ; o != o_end ; ++o)
+                    {
+                        expanded.operands.push_back(b.plain_token(b.operands[o]));
+                    }
+
+                    process(b.text.data(), expanded);
+                }
+                else
+                {
+                    buffer.clear();
+                    expanded.label = b.expand_token(l->label, arguments, counter, buffer);
+                    expanded.mnemonic = b.expand_token(l->mnemonic, arguments, counter, buffer);
+                    expanded.params = b.expand_token(l->params, arguments, counter, buffer);
+                    for (unsigned o(l->first_operand), o_end(l->first_operand + l->operands) ; o != o_end ; ++o)
+                    {
+                        expanded.operands.push_back(b.expand_token(b.operands[o], arguments, counter, buffer));
+                    }
+
+                    process(buffer.data(), expanded);
+                }
+            }
+
+            --nesting;
+        }
+
+        void process(const char * buffer, const LexedLine & line)
+        {
+            using namespace internal;
+
+            if (! open.empty())
+            {
+                MacroDirective directive(line.directive ? macro_directive(buffer + line.mnemonic.offset, line.mnemonic.length) : md_none);
+
+                switch (directive)
+                {
+                    case md_macro:
+                    case md_rept:
+                    case md_irp:
+                        open.push_back(directive);
+                        break;
+
+                    case md_endm:
+                    case md_endr:
+                        if ((md_endm == directive) != (md_macro == open.back()))
+                        {
+                            SyntaxContext::Line(line.number);
+                            throw CommonSyntaxError("'" + std::string(directive_name(directive)) + "' does not close '"
+                                    + directive_name(open.back()) + "'");
+                        }
+
+                        if (1 == open.size())
+                        {
+                            end_block();
+                            return;
+                        }
+
+                        open.pop_back();
+                        break;
+
+                    case md_none:
+                        break;
+                }
+
+                body->add_line(buffer, line);
+                return;
+            }
+
+            if (line.directive)
+            {
+                MacroDirective directive(macro_directive(buffer + line.mnemonic.offset, line.mnemonic.length));
+
+                if (md_none != directive)
+                {
+                    SyntaxContext::Line(line.number);
+
+                    if ((md_endm == directive) || (md_endr == directive))
+                        throw CommonSyntaxError("'" + std::string(directive_name(directive)) + "' without matching block");
+
+                    emit_label(buffer, line);
+                    begin_block(directive, buffer + line.params.offset, buffer + line.params.offset + line.params.length, line.number);
+
+                    return;
+                }
+            }
+            else if ((! macros.empty()) && (! line.mnemonic.empty()))
+            {
+                std::map<Atom, internal::MacroBodyPtr>::const_iterator m(macros.find(Atom(buffer + line.mnemonic.offset,
+                                buffer + line.mnemonic.offset + line.mnemonic.length)));
+
+                if (macros.end() != m)
+                {
+                    SyntaxContext::Line(line.number);
+
+                    // Keep the body alive, even if the expansion should redefine the macro
+                    internal::MacroBodyPtr b(m->second);
+
+                    emit_label(buffer, line);
+                    invoke(*b, buffer, line);
+
+                    return;
+                }
+            }
+
+            sink.emit(buffer, line);
+        }
+
+        /// Emit the label of a line that is otherwise consumed.
+        void emit_label(const char * buffer, const LexedLine & line)
+        {
+            if (line.label.empty())
+                return;
+
+            LexedLine label;
+            label.number = line.number;
+            label.label = line.label;
+            label.directive = false;
+
+            sink.emit(buffer, label);
+        }
+    };
+
+    MacroProcessor::MacroProcessor(LexedLineSink & sink) :
+        PrivateImplementationPattern<MacroProcessor>(new Implementation<MacroProcessor>(sink))
+    {
+    }
+
+    MacroProcessor::~MacroProcessor()
+    {
+    }
+
+    void
+    MacroProcessor::process(const char * buffer, const LexedLine & line)
+    {
+        _imp->process(buffer, line);
+    }
+
+    void
+    MacroProcessor::finish()
+    {
+        if (! _imp->open.empty())
+        {
+            SyntaxContext::Line(_imp->open_line);
+            throw CommonSyntaxError("unterminated '" + std::string(internal::directive_name(_imp->open.front())) + "'");
+        }
+    }
+
+    bool
+    MacroProcessor::recording() const
+    {
+        return ! _imp->open.empty();
+    }
+
+    MacroDefinitions
+    MacroProcessor::definitions() const
+    {
+        MacroDefinitions result;
+        result._imp->macros = _imp->macros;
+
+        return result;
+    }
+
+    void
+    MacroProcessor::define(const MacroDefinitions & definitions)
+    {
+        for (std::map<Atom, internal::MacroBodyPtr>::const_iterator m(definitions._imp->macros.begin()), m_end(definitions._imp->macros.end()) ;
+                m != m_end ; ++m)
+        {
+            std::map<Atom, internal::MacroBodyPtr>::iterator n(_imp->macros.find(m->first));
+            if (_imp->macros.end() == n)
+            {
+                _imp->macros.insert(*m);
+            }
+            else if (n->second != m->second)
+            {
+                throw CommonSyntaxError("macro '" + m->first.str() + "' is already defined");
+            }
+        }
+    }
+
+    int
+    MacroProcessor::nesting_change(const char * buffer, const LexedLine & line)
+    {
+        if (! line.directive)
+            return 0;
+
+        switch (internal::macro_directive(buffer + line.mnemonic.offset, line.mnemonic.length))
+        {
+            case internal::md_macro:
+            case internal::md_rept:
+            case internal::md_irp:
+                return 1;
+
+            case internal::md_endm:
+            case internal::md_endr:
+                return -1;
+
+            case internal::md_none:
+                break;
+        }
+
+        return 0;
+    }
+
+    bool
+    MacroProcessor::mentioned_in(const char * begin, const char * end)
+    {
+        for (const char * c(begin) ; c != end ; ++c)
+        {
+            c = static_cast<const char *>(std::memchr(c, '.', end - c));
+            if (! c)
+                break;
+
+            const char * name_end(c + 1);
+            while ((name_end != end) && ('a' <= *name_end) && (*name_end <= 'z'))
+                ++name_end;
+
+            if (internal::md_none != internal::macro_directive(c + 1, name_end - c - 1))
+                return true;
+
+            c = name_end - 1;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,110 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_COMMON_MACRO_PROCESSOR_HH
+#define GPU_GUARD_COMMON_MACRO_PROCESSOR_HH 1
+
+#include <common/assembly_lexer.hh>
+#include <utils/private_implementation_pattern.hh>
+
+namespace gpu
+{
+    /**
+     * LexedLineSink receives lexed lines, together with the buffer that
+     * their tokens refer to. Both are only valid during the call.
+     */
+    class LexedLineSink
+    {
+        public:
+            virtual ~LexedLineSink();
+
+            virtual void emit(const char * buffer, const LexedLine & line) = 0;
+    };
+
+    /**
+     * MacroDefinitions holds the macros that a MacroProcessor has defined,
+     * so that they can be made available to another MacroProcessor.
+     */
+    class MacroDefinitions :
+        public PrivateImplementationPattern<MacroDefinitions>
+    {
+        friend class MacroProcessor;
+
+        public:
+            MacroDefinitions();
+
+            ~MacroDefinitions();
+
+            /// Return the number of macros.
+            unsigned size() const;
+    };
+
+    /**
+     * MacroProcessor expands the .macro/.endm, .rept/.endr and .irp/.endr
+     * blocks of GNU as on lexed lines.
+     *
+     * Block bodies are lexed only once. Their tokens are stored split into
+     * text and parameter references (written as \\name, with \\() as an
+     * empty separator and \\@ for the number of the current expansion), so
+     * an expansion only splices text and arguments together. Lines without
+     * any parameter reference are handed on without copying.
+     *
+     * Macros are invoked like instructions, with comma-separated arguments
+     * that are bound by position or as name=value. Expanded lines carry the
+     * line number of the line that started the expansion.
+     */
+    class MacroProcessor :
+        public PrivateImplementationPattern<MacroProcessor>
+    {
+        public:
+            MacroProcessor(LexedLineSink & sink);
+
+            ~MacroProcessor();
+
+            /// Process one line, and hand all resulting lines to the sink.
+            void process(const char * buffer, const LexedLine & line);
+
+            /// Check that no block is left open at the end of the input.
+            void finish();
+
+            /// Return whether lines are currently recorded into a block body.
+            bool recording() const;
+
+            /// Return the macros defined so far.
+            MacroDefinitions definitions() const;
+
+            /// Make all macros in definitions available, as if they had been defined here.
+            void define(const MacroDefinitions & definitions);
+
+            /**
+             * Return by how much line changes the nesting depth of blocks:
+             * 1 if it opens a block, -1 if it closes one, and 0 otherwise.
+             */
+            static int nesting_change(const char * buffer, const LexedLine & line);
+
+            /**
+             * Return whether the text [begin, end) mentions any of the
+             * directives of MacroProcessor, and hence needs to be processed
+             * in one piece.
+             */
+            static bool mentioned_in(const char * begin, const char * end);
+    };
+}
+
+#endif
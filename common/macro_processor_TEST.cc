@@ -0,0 +1,147 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <common/assembly_entities.hh>
+#include <common/assembly_parser.hh>
+#include <common/macro_processor.hh>
+#include <common/syntax.hh>
+#include <utils/sequence-impl.hh>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+struct MacroProcessorTest :
+    public Test
+{
+    MacroProcessorTest() :
+        Test("macro_processor_test")
+    {
+    }
+
+    std::string print(const std::string & source, LineTable & lines)
+    {
+        std::stringstream input(source);
+        Arena arena;
+        AssemblyEntityPrinter p;
+
+        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+        for (Sequence<AssemblyEntityPtr>::Iterator i(entities.begin()), i_end(entities.end()) ;
+                i != i_end ; ++i)
+        {
+            (*i)->accept(p);
+        }
+
+        return p.output();
+    }
+
+    std::string print(const std::string & source)
+    {
+        LineTable lines;
+
+        return print(source, lines);
+    }
+
+    std::string error(const std::string & source)
+    {
+        try
+        {
+            print(source);
+        }
+        catch (SyntaxError & e)
+        {
+            return e.message();
+        }
+
+        return "";
+    }
+
+    bool mentioned(const char * text)
+    {
+        return MacroProcessor::mentioned_in(text, text + std::strlen(text));
+    }
+
+    virtual void run()
+    {
+        // parameters, defaults, keyword arguments, \() and \@
+        TEST_CHECK_EQUAL(print(
+                    ".macro madd dst, a, b=R2.x\n"
+                    "l\\@: mul \\dst, \\a, \\b\n"
+                    "\tadd \\dst\\().x, \\dst\n"
+                    ".endm\n"
+                    "\tmadd R0, R1.x\n"
+                    "\tmadd b=R3.y, dst=R4, a=R5.z\n"),
+                print(
+                    "l0: mul R0, R1.x, R2.x\n"
+                    "\tadd R0.x, R0\n"
+                    "l1: mul R4, R5.z, R3.y\n"
+                    "\tadd R4.x, R4\n"));
+
+        // nested blocks, and macros that use other macros
+        TEST_CHECK_EQUAL(print(
+                    ".macro one r\n"
+                    "\tmov \\r, 1\n"
+                    ".endm\n"
+                    ".macro all\n"
+                    ".irp reg, $0, $1\n"
+                    "\tone \\reg\n"
+                    ".endr\n"
+                    ".endm\n"
+                    "start: .rept 2\n"
+                    "\tall\n"
+                    ".endr\n"
+                    "\t.byte 0x10\n"),
+                print(
+                    "start:\n"
+                    "\tmov $0, 1\n"
+                    "\tmov $1, 1\n"
+                    "\tmov $0, 1\n"
+                    "\tmov $1, 1\n"
+                    "\t.byte 0x10\n"));
+
+        // unknown backslash sequences are kept, and .rept 0 drops its body
+        TEST_CHECK_EQUAL(print(".irp x, a\n\t.ascii \"\\n\\x\"\n.endr\n.rept 0\n\tnop\n.endr\n"),
+                print("\t.ascii \"\\na\"\n"));
+
+        // expanded entities carry the line of the expansion
+        LineTable lines;
+        print(".rept 2\n\tnop\n\tnop\n.endr\n\tret\n", lines);
+        TEST_CHECK_EQUAL(lines.size(), 5u);
+        TEST_CHECK_EQUAL(lines.line(0), 1u);
+        TEST_CHECK_EQUAL(lines.line(3), 1u);
+        TEST_CHECK_EQUAL(lines.line(4), 5u);
+
+        SyntaxContext::File f("macro.s");
+        TEST_CHECK_EQUAL(error("\tnop\n.rept 2\n\tnop\n"), "macro.s:2: (common) unterminated '.rept'");
+        TEST_CHECK_EQUAL(error("\tnop\n.endm\n"), "macro.s:2: (common) '.endm' without matching block");
+        TEST_CHECK_EQUAL(error(".macro m\n.endr\n"), "macro.s:2: (common) '.endr' does not close '.macro'");
+        TEST_CHECK_EQUAL(error(".macro m a\n.endm\n\tm 1, 2\n"), "macro.s:3: (common) too many arguments for macro 'm'");
+        TEST_CHECK_EQUAL(error(".macro m\n.endm\n.macro m\n.endm\n"), "macro.s:3: (common) macro 'm' is already defined");
+        TEST_CHECK_EQUAL(error(".macro m\n\tm\n.endm\n\tm\n"), "macro.s:4: (common) macro expansions nested too deeply");
+        TEST_CHECK_EQUAL(error(".rept x\n.endr\n"), "macro.s:1: (common) 'x' is not a valid repeat count");
+
+        TEST_CHECK(mentioned("\tnop\n.macro m\n"));
+        TEST_CHECK(mentioned("\t.irp"));
+        TEST_CHECK(! mentioned("\tmov $0.x, $1.x\n\t.irpc\n\t.reptx\n"));
+    }
+} macro_processor_test;
@@ -17,6 +17,7 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/assembly_entities.hh>
 #include <common/gpgpu_data_section.hh>
 #include <common/gpgpu_notes_section.hh>
 #include <common/section.hh>
@@ -30,6 +31,12 @@ namespace gpu
     {
     }
 
+    void
+    Section::append(const LexedInstruction & instruction)
+    {
+        append(instruction.instruction());
+    }
+
     bool
     SectionFactory::valid(const std::string & name)
     {
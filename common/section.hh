@@ -24,6 +24,7 @@
 #include <elf/section.hh>
 #include <elf/symbol.hh>
 #include <elf/symbol_table.hh>
+#include <utils/atom.hh>
 #include <utils/memory.hh>
 #include <utils/sequence.hh>
 
@@ -36,9 +37,12 @@ namespace gpu
         public:
             virtual ~Section() = 0;
 
-            virtual void append(const AssemblyEntityPtr &) = 0;
+            virtual void append(const AssemblyEntity &) = 0;
 
-            virtual std::string name() const = 0;
+            /// Append an instruction that is still in token form. By default, it is appended as an Instruction.
+            virtual void append(const LexedInstruction &);
+
+            virtual Atom name() const = 0;
 
             virtual Sequence<elf::Section> sections(const elf::SymbolTable &, const Sequence<elf::Symbol> &) const = 0;
 
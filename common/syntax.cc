@@ -17,6 +17,7 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/line_table.hh>
 #include <common/syntax.hh>
 #include <utils/exception.hh>
 #include <utils/stringify.hh>
@@ -32,9 +33,15 @@ namespace gpu
         static __thread std::string * file = 0;
 
         static __thread unsigned line = 0;
+
+        static __thread const LineTable * lines = 0;
+
+        static __thread const unsigned * index = 0;
     }
 
-    SyntaxContext::File::File(const std::string & file)
+    SyntaxContext::File::File(const std::string & file) :
+        _had_previous(0 != internal::file),
+        _previous(internal::file ? *internal::file : std::string())
     {
         if (! internal::file)
         {
@@ -48,6 +55,15 @@ namespace gpu
 
     SyntaxContext::File::~File()
     {
+        if (_had_previous)
+        {
+            *internal::file = _previous;
+        }
+        else
+        {
+            delete internal::file;
+            internal::file = 0;
+        }
     }
 
     SyntaxContext::Line::Line(unsigned line)
@@ -59,6 +75,20 @@ namespace gpu
     {
     }
 
+    SyntaxContext::Lines::Lines(const LineTable & table, const unsigned & index) :
+        _previous_table(internal::lines),
+        _previous_index(internal::index)
+    {
+        internal::lines = &table;
+        internal::index = &index;
+    }
+
+    SyntaxContext::Lines::~Lines()
+    {
+        internal::lines = _previous_table;
+        internal::index = _previous_index;
+    }
+
     static std::string make_prefix()
     {
         std::string file("<none>");
@@ -67,7 +97,13 @@ namespace gpu
             file = *internal::file;
         }
 
-        return file + ":" + stringify(internal::line);
+        unsigned line(internal::line);
+        if (internal::lines)
+        {
+            line = internal::lines->line(*internal::index);
+        }
+
+        return file + ":" + stringify(line);
     }
 
     SyntaxError::SyntaxError(const std::string & backend, const std::string & message) :
@@ -75,8 +111,18 @@ namespace gpu
     {
     }
 
+    SyntaxError::SyntaxError(const std::string & message) :
+        Exception(message)
+    {
+    }
+
     CommonSyntaxError::CommonSyntaxError(const std::string & message) :
         SyntaxError("common", message)
     {
     }
+
+    ForwardedSyntaxError::ForwardedSyntaxError(const std::string & message) :
+        SyntaxError(message)
+    {
+    }
 }
@@ -24,13 +24,25 @@
 
 namespace gpu
 {
+    class LineTable;
+
     struct SyntaxContext
     {
-        struct File
+        /**
+         * While in scope, SyntaxErrors report file. The previous file is
+         * restored once it goes out of scope.
+         */
+        class File
         {
-            File(const std::string & file);
+            private:
+                const bool _had_previous;
+
+                const std::string _previous;
 
-            ~File();
+            public:
+                File(const std::string & file);
+
+                ~File();
         };
 
         struct Line
@@ -39,6 +51,24 @@ namespace gpu
 
             ~Line();
         };
+
+        /**
+         * While in scope, SyntaxErrors report the line that table records for
+         * the entity at index. The line is only looked up once an error is
+         * actually raised, so index may change freely in the meantime.
+         */
+        class Lines
+        {
+            private:
+                const LineTable * const _previous_table;
+
+                const unsigned * const _previous_index;
+
+            public:
+                Lines(const LineTable & table, const unsigned & index);
+
+                ~Lines();
+        };
     };
 
     class SyntaxError :
@@ -46,6 +76,9 @@ namespace gpu
     {
         protected:
             SyntaxError(const std::string & backend, const std::string & message);
+
+            /// Constructor for messages that already carry their file:line prefix.
+            SyntaxError(const std::string & message);
     };
 
     class CommonSyntaxError :
@@ -54,6 +87,17 @@ namespace gpu
         public:
             CommonSyntaxError(const std::string & message);
     };
+
+    /**
+     * ForwardedSyntaxError carries a SyntaxError that has been raised on a
+     * worker thread, including the file:line context of that thread.
+     */
+    class ForwardedSyntaxError :
+        public SyntaxError
+    {
+        public:
+            ForwardedSyntaxError(const std::string & message);
+    };
 }
 
 #endif
@@ -0,0 +1,227 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <elf/compression.hh>
+#include <utils/exception.hh>
+#include <utils/stringify.hh>
+
+#include <algorithm>
+#include <cstring>
+
+#include <elf.h>
+
+#ifdef GPU_HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+#ifdef GPU_HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+#ifndef ELFCOMPRESS_ZSTD
+# define ELFCOMPRESS_ZSTD 2
+#endif
+
+namespace gpu
+{
+    namespace elf
+    {
+        namespace internal
+        {
+            /// Compress size bytes at source into target, which holds capacity bytes. Return the compressed size, or 0.
+            static unsigned compress(unsigned type, char * target, unsigned capacity, const char * source, unsigned size)
+            {
+                switch (type)
+                {
+#ifdef GPU_HAVE_ZLIB
+                    case ELFCOMPRESS_ZLIB:
+                        {
+                            uLongf result(capacity);
+                            if (Z_OK != ::compress2(reinterpret_cast<Bytef *>(target), &result,
+                                        reinterpret_cast<const Bytef *>(source), size, Z_DEFAULT_COMPRESSION))
+                                return 0;
+
+                            return result;
+                        }
+#endif
+
+#ifdef GPU_HAVE_ZSTD
+                    case ELFCOMPRESS_ZSTD:
+                        {
+                            std::size_t result(::ZSTD_compress(target, capacity, source, size, 3));
+                            if (::ZSTD_isError(result))
+                                return 0;
+
+                            return result;
+                        }
+#endif
+                }
+
+                return 0;
+            }
+
+            /// Return an upper bound of the compressed size of size bytes.
+            static unsigned compress_bound(unsigned type, unsigned size)
+            {
+                switch (type)
+                {
+#ifdef GPU_HAVE_ZLIB
+                    case ELFCOMPRESS_ZLIB:
+                        return ::compressBound(size);
+#endif
+
+#ifdef GPU_HAVE_ZSTD
+                    case ELFCOMPRESS_ZSTD:
+                        return ::ZSTD_compressBound(size);
+#endif
+                }
+
+                return 0;
+            }
+
+            /// Return how many times larger than its compressed form data of type can get.
+            static unsigned max_expansion(unsigned type)
+            {
+                switch (type)
+                {
+                    case ELFCOMPRESS_ZLIB:
+                        // the limit of deflate, whose shortest match codes 258 bytes in two bits
+                        return 1032;
+
+                    case ELFCOMPRESS_ZSTD:
+                        // a block of 128 KiB needs at least 4 bytes
+                        return 32768;
+                }
+
+                return 0;
+            }
+
+            /// Decompress size bytes at source into target, which needs to be filled exactly.
+            static bool decompress(unsigned type, char * target, unsigned capacity, const char * source, unsigned size)
+            {
+                switch (type)
+                {
+#ifdef GPU_HAVE_ZLIB
+                    case ELFCOMPRESS_ZLIB:
+                        {
+                            uLongf result(capacity);
+                            if (Z_OK != ::uncompress(reinterpret_cast<Bytef *>(target), &result,
+                                        reinterpret_cast<const Bytef *>(source), size))
+                                return false;
+
+                            return capacity == result;
+                        }
+#endif
+
+#ifdef GPU_HAVE_ZSTD
+                    case ELFCOMPRESS_ZSTD:
+                        {
+                            std::size_t result(::ZSTD_decompress(target, capacity, source, size));
+                            if (::ZSTD_isError(result))
+                                return false;
+
+                            return capacity == result;
+                        }
+#endif
+                }
+
+                return false;
+            }
+        }
+
+        bool
+        compression_supported(unsigned type)
+        {
+            switch (type)
+            {
+#ifdef GPU_HAVE_ZLIB
+                case ELFCOMPRESS_ZLIB:
+                    return true;
+#endif
+
+#ifdef GPU_HAVE_ZSTD
+                case ELFCOMPRESS_ZSTD:
+                    return true;
+#endif
+            }
+
+            return false;
+        }
+
+        Data
+        compress(const Data & data, unsigned type, unsigned alignment)
+        {
+            if (! compression_supported(type))
+                throw InternalError("elf", "Compression type '" + stringify(type) + "' is not supported");
+
+            if (data.size() <= sizeof(Elf32_Chdr))
+                return Data();
+
+            Elf32_Chdr chdr;
+            chdr.ch_type = type;
+            chdr.ch_size = data.size();
+            chdr.ch_addralign = std::max(1u, alignment);
+
+            Data result;
+            DataWriter writer(result);
+            writer.put(&chdr, sizeof(Elf32_Chdr));
+
+            unsigned capacity(internal::compress_bound(type, data.size()));
+            unsigned size(internal::compress(type, writer.reserve(capacity), capacity,
+                        static_cast<const char *>(data.buffer()), data.size()));
+
+            if ((0 == size) || (sizeof(Elf32_Chdr) + size >= data.size()))
+                return Data();
+
+            result.resize(sizeof(Elf32_Chdr) + size);
+
+            return result;
+        }
+
+        Data
+        decompress(const Data & data, unsigned & type, unsigned & alignment)
+        {
+            if (data.size() < sizeof(Elf32_Chdr))
+                throw InternalError("elf", "Compressed section is too small to hold its header");
+
+            Elf32_Chdr chdr;
+            data.read(0, reinterpret_cast<char *>(&chdr), sizeof(Elf32_Chdr));
+
+            if (! compression_supported(chdr.ch_type))
+                throw InternalError("elf", "Compression type '" + stringify(chdr.ch_type) + "' is not supported");
+
+            // ch_size is not trusted to allocate more than the compressed data can expand to
+            unsigned size(data.size() - sizeof(Elf32_Chdr));
+            if (chdr.ch_size / internal::max_expansion(chdr.ch_type) >= size)
+                throw InternalError("elf", "Compressed section claims an uncompressed size of '" + stringify(chdr.ch_size)
+                        + "' bytes from only '" + stringify(size) + "' bytes");
+
+            Data result;
+            DataWriter writer(result);
+            if (! internal::decompress(chdr.ch_type, writer.reserve(chdr.ch_size), chdr.ch_size,
+                        static_cast<const char *>(data.buffer()) + sizeof(Elf32_Chdr), size))
+                throw InternalError("elf", "Compressed section is corrupt");
+
+            type = chdr.ch_type;
+            alignment = chdr.ch_addralign;
+
+            return result;
+        }
+    }
+}
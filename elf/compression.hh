@@ -0,0 +1,64 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_ELF_COMPRESSION_HH
+#define GPU_GUARD_ELF_COMPRESSION_HH 1
+
+#include <elf/data.hh>
+
+namespace gpu
+{
+    namespace elf
+    {
+        /**
+         * \name Section compression
+         *
+         * Sections with SHF_COMPRESSED start with an Elf32_Chdr, which holds
+         * the compression type (one of the ELFCOMPRESS_* constants), the
+         * size and the alignment of the uncompressed contents. The
+         * compressed stream follows right after it.
+         *
+         * \{
+         */
+
+        /// Return whether this build can compress and decompress sections of type.
+        bool compression_supported(unsigned type);
+
+        /**
+         * Return the compressed contents of a section, headed by their Elf32_Chdr.
+         *
+         * If the result would not be smaller than data, an empty Data is
+         * returned instead, and the section should be written as it is.
+         */
+        Data compress(const Data & data, unsigned type, unsigned alignment);
+
+        /**
+         * Return the uncompressed contents of a section with SHF_COMPRESSED.
+         *
+         * The type and alignment from its Elf32_Chdr are returned in type
+         * and alignment. An uncompressed size that the compressed data
+         * cannot expand to is rejected before anything is allocated.
+         */
+        Data decompress(const Data & data, unsigned & type, unsigned & alignment);
+
+        /// \}
+    }
+}
+
+#endif
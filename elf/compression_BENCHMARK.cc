@@ -0,0 +1,169 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <elf/file.hh>
+#include <utils/destringify.hh>
+#include <utils/exception.hh>
+#include <utils/mapped_file.hh>
+#include <utils/stringify.hh>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <elf.h>
+#include <sys/time.h>
+
+#ifndef ELFCOMPRESS_ZSTD
+# define ELFCOMPRESS_ZSTD 2
+#endif
+
+using namespace gpu;
+
+namespace
+{
+    double now()
+    {
+        struct timeval tv;
+        ::gettimeofday(&tv, 0);
+
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    /*
+     * Fill a data section the way kernel libraries do: a table of
+     * coefficients, zero-initialised buffers and small integer indices,
+     * a quarter, a quarter and half of the section respectively.
+     */
+    void fill_data(elf::Section section, unsigned size)
+    {
+        elf::DataWriter writer(section.data());
+
+        for (unsigned i(0) ; i < size / 16 ; ++i)
+        {
+            float coefficient(std::sin(i * 0.001f));
+            unsigned bits;
+            std::memcpy(&bits, &coefficient, sizeof(unsigned));
+            writer.put32(bits);
+        }
+
+        std::memset(writer.reserve(size / 4), 0, size / 4);
+
+        while (writer.size() + 4 <= size)
+            writer.put32((writer.size() / 4) % 1024);
+    }
+
+    /// Fill a debug section with line records for size bytes of source.
+    void fill_debug(elf::Section section, unsigned size)
+    {
+        elf::DataWriter writer(section.data());
+
+        for (unsigned line(1) ; writer.size() < size ; ++line)
+        {
+            std::string record("kernel.s:" + stringify(line) + ": fadd $" + stringify(line % 128)
+                    + ".x, $" + stringify((line + 1) % 128) + ".x, $1.x\n");
+            writer.put(record.data(), record.size());
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    std::string mode("zlib");
+    unsigned kilobytes(65536);
+
+    if (argc > 1)
+        mode = argv[1];
+
+    if (argc > 2)
+        kilobytes = destringify<unsigned>(argv[2]);
+
+    if ((argc > 3) || (("none" != mode) && ("zlib" != mode) && ("zstd" != mode)))
+    {
+        std::cerr << "Usage: " << argv[0] << " [none|zlib|zstd] [KILOBYTES]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const std::string filename("compression_BENCHMARK.output");
+        unsigned type("zlib" == mode ? ELFCOMPRESS_ZLIB : "zstd" == mode ? ELFCOMPRESS_ZSTD : 0);
+
+        // three data sections and one debug section, to be compressed in parallel
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(0xA600)
+                    .type(ET_REL)));
+
+        unsigned size(0);
+        const char * const names[] = { ".gpgpu.data", ".gpgpu.data.1", ".gpgpu.data.2", ".debug_line" };
+        for (unsigned i(0) ; i < 4 ; ++i)
+        {
+            elf::Section section(elf::Section::Parameters()
+                    .alignment(16)
+                    .compression(type)
+                    .name(names[i])
+                    .type(SHT_PROGBITS));
+
+            if (3 == i)
+                fill_debug(section, kilobytes * 256);
+            else
+                fill_data(section, kilobytes * 256);
+
+            size += section.data().size();
+            file.append(section);
+        }
+
+        double start(now());
+        file.write(filename);
+        double written(now());
+
+        unsigned file_size(MappedFile(filename).size());
+
+        // reading only maps the file; the sections are decompressed when they are used
+        double reading(now());
+        elf::File copy(elf::File::open(filename));
+        double opened(now());
+
+        unsigned checksum(0);
+        for (unsigned i(0) ; i < 4 ; ++i)
+        {
+            elf::Data data(copy.find(names[i])->data());
+            checksum += static_cast<const unsigned char *>(data.buffer())[data.size() / 2];
+        }
+
+        double stop(now());
+
+        std::cout << "mode: " << mode << std::endl;
+        std::cout << "sections: " << size << " bytes" << std::endl;
+        std::cout << "file: " << file_size << " bytes, ratio " << double(size) / file_size << std::endl;
+        std::cout << "write: " << (written - start) << " s, " << size / (written - start) / 1e6 << " MB/s" << std::endl;
+        std::cout << "open: " << (opened - reading) << " s" << std::endl;
+        std::cout << "first access: " << (stop - opened) << " s, " << size / (stop - opened) / 1e6 << " MB/s (checksum " << checksum << ")" << std::endl;
+    }
+    catch (Exception & e)
+    {
+        std::cerr << "Caught exception: " << e.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <elf/compression.hh>
+#include <elf/file.hh>
+#include <utils/exception.hh>
+#include <utils/stringify.hh>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <elf.h>
+
+#ifndef ELFCOMPRESS_ZSTD
+# define ELFCOMPRESS_ZSTD 2
+#endif
+
+using namespace gpu;
+using namespace tests;
+
+namespace
+{
+    /// Return a section's worth of repetitive data, as found in initializers.
+    elf::Data make_data(unsigned size)
+    {
+        elf::Data result(size);
+        for (unsigned i(0) ; i < size ; i += 4)
+        {
+            unsigned value(i % 256 < 128 ? i / 64 : 0);
+            result.write(i, reinterpret_cast<const char *>(&value), std::min(4u, size - i));
+        }
+
+        return result;
+    }
+
+    std::string contents(elf::Data data)
+    {
+        return std::string(static_cast<const char *>(data.buffer()), data.size());
+    }
+
+    void fill(elf::Section section, unsigned size)
+    {
+        section.data().resize(size);
+        section.data().write(0, static_cast<const char *>(make_data(size).buffer()), size);
+    }
+}
+
+struct ElfCompressionTest :
+    public Test
+{
+    ElfCompressionTest() :
+        Test("elf_compression_test")
+    {
+    }
+
+    void run_one(unsigned type)
+    {
+        elf::Data data(make_data(4096));
+        elf::Data compressed(elf::compress(data, type, 16));
+        TEST_CHECK(compressed.size() > sizeof(Elf32_Chdr));
+        TEST_CHECK(compressed.size() < data.size());
+
+        Elf32_Chdr chdr;
+        compressed.read(0, reinterpret_cast<char *>(&chdr), sizeof(Elf32_Chdr));
+        TEST_CHECK_EQUAL(chdr.ch_type, type);
+        TEST_CHECK_EQUAL(chdr.ch_size, 4096u);
+        TEST_CHECK_EQUAL(chdr.ch_addralign, 16u);
+
+        unsigned result_type(0), result_alignment(0);
+        TEST_CHECK_EQUAL(contents(elf::decompress(compressed, result_type, result_alignment)), contents(data));
+        TEST_CHECK_EQUAL(result_type, type);
+        TEST_CHECK_EQUAL(result_alignment, 16u);
+
+        // data that does not get smaller is left alone
+        TEST_CHECK_EQUAL(elf::compress(make_data(16), type, 4).size(), 0u);
+
+        // so is a size that the stream cannot expand to, before it is allocated
+        elf::Data inflated(compressed.size());
+        inflated.write(0, static_cast<const char *>(compressed.buffer()), compressed.size());
+        chdr.ch_size = 0xfffffff0u;
+        inflated.write(0, reinterpret_cast<const char *>(&chdr), sizeof(Elf32_Chdr));
+        TEST_CHECK_THROWS(elf::decompress(inflated, result_type, result_alignment), InternalError);
+
+        // a damaged stream is noticed
+        compressed.write(compressed.size() / 2, "\xff\xff\xff\xff", 4);
+        TEST_CHECK_THROWS(elf::decompress(compressed, result_type, result_alignment), InternalError);
+        TEST_CHECK_THROWS(elf::decompress(compressed.slice(0, 8), result_type, result_alignment), InternalError);
+    }
+
+    void run()
+    {
+        if (elf::compression_supported(ELFCOMPRESS_ZLIB))
+            run_one(ELFCOMPRESS_ZLIB);
+
+        if (elf::compression_supported(ELFCOMPRESS_ZSTD))
+            run_one(ELFCOMPRESS_ZSTD);
+
+        TEST_CHECK(! elf::compression_supported(0));
+        TEST_CHECK_THROWS(elf::compress(make_data(4096), ELFCOMPRESS_LOOS, 4), InternalError);
+    }
+} elf_compression_test;
+
+struct ElfFileCompressionTest :
+    public Test
+{
+    ElfFileCompressionTest() :
+        Test("elf_file_compression_test")
+    {
+    }
+
+    void run_one(unsigned type)
+    {
+        std::string filename(stringify(GPU_BUILDDIR) + "/elf/compression_TEST_" + stringify(type) + ".output");
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(EM_PPC)
+                    .type(ET_REL)));
+
+        elf::Section text(elf::Section::Parameters()
+                    .alignment(8)
+                    .compression(type)
+                    .flags(SHF_ALLOC | SHF_EXECINSTR)
+                    .name(".text")
+                    .type(SHT_PROGBITS));
+        fill(text, 12);
+        file.append(text);
+
+        elf::Section data(elf::Section::Parameters()
+                    .alignment(16)
+                    .compression(type)
+                    .name(".gpgpu.data")
+                    .type(SHT_PROGBITS));
+        fill(data, 65536);
+        file.append(data);
+
+        elf::Section debug(elf::Section::Parameters()
+                    .alignment(1)
+                    .compression(type)
+                    .name(".debug_line")
+                    .type(SHT_PROGBITS));
+        fill(debug, 20000);
+        file.append(debug);
+
+        file.write(filename);
+
+        std::vector<char> bytes;
+        file.write(bytes);
+        TEST_CHECK(bytes.size() < 65536u);
+
+        Elf32_Ehdr ehdr;
+        std::memcpy(&ehdr, &bytes[0], sizeof(Elf32_Ehdr));
+        std::vector<Elf32_Shdr> shdrs(ehdr.e_shnum);
+        std::memcpy(&shdrs[0], &bytes[ehdr.e_shoff], ehdr.e_shnum * sizeof(Elf32_Shdr));
+
+        // only sections that get smaller are compressed
+        TEST_CHECK_EQUAL(shdrs[2].sh_flags, unsigned(SHF_ALLOC | SHF_EXECINSTR));
+        TEST_CHECK_EQUAL(shdrs[2].sh_size, 12u);
+        TEST_CHECK_EQUAL(shdrs[3].sh_flags, unsigned(SHF_COMPRESSED));
+        TEST_CHECK_EQUAL(shdrs[3].sh_addralign, 4u);
+        TEST_CHECK(shdrs[3].sh_size < 65536u);
+        TEST_CHECK_EQUAL(shdrs[4].sh_flags, unsigned(SHF_COMPRESSED));
+
+        // sections are decompressed when they are first used, and keep their compression
+        elf::File copy(elf::File::open(filename));
+        elf::File::Iterator copy_data(copy.find(".gpgpu.data"));
+        TEST_CHECK(copy.end() != copy_data);
+        TEST_CHECK_EQUAL(contents(copy_data->data()), contents(make_data(65536)));
+        TEST_CHECK_EQUAL(contents(copy.find(".debug_line")->data()), contents(make_data(20000)));
+
+        std::vector<char> copy_bytes;
+        copy.write(copy_bytes);
+        TEST_CHECK(bytes == copy_bytes);
+
+        // as do sections that are written without being used
+        std::string untouched_name(stringify(GPU_BUILDDIR) + "/elf/compression_TEST_untouched_" + stringify(type) + ".output");
+        elf::File::open(filename).write(untouched_name);
+
+        std::vector<char> untouched_bytes;
+        elf::File untouched(elf::File::open(untouched_name));
+        untouched.write(untouched_bytes);
+        TEST_CHECK(bytes == untouched_bytes);
+        TEST_CHECK_EQUAL(contents(untouched.find(".gpgpu.data")->data()), contents(make_data(65536)));
+
+        // sections are compressed once, until their data changes
+        TEST_CHECK_EQUAL(file.size(), unsigned(bytes.size()));
+        data.data().write(0, "\xff\xff\xff\xff", 4);
+        file.write(filename);
+        TEST_CHECK_EQUAL(contents(elf::File::open(filename).find(".gpgpu.data")->data()).substr(0, 4), "\xff\xff\xff\xff");
+        TEST_CHECK_EQUAL(contents(elf::File::open(filename).find(".debug_line")->data()), contents(make_data(20000)));
+    }
+
+    void run()
+    {
+        if (elf::compression_supported(ELFCOMPRESS_ZLIB))
+            run_one(ELFCOMPRESS_ZLIB);
+
+        if (elf::compression_supported(ELFCOMPRESS_ZSTD))
+            run_one(ELFCOMPRESS_ZSTD);
+
+        // unsupported compression types fail before anything is written
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(EM_PPC)
+                    .type(ET_REL)));
+        file.append(elf::Section(elf::Section::Parameters()
+                    .compression(ELFCOMPRESS_LOOS)
+                    .name(".gpgpu.data")
+                    .type(SHT_PROGBITS)));
+        std::vector<char> bytes;
+        TEST_CHECK_THROWS(file.write(bytes), InternalError);
+    }
+} elf_file_compression_test;
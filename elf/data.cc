@@ -19,6 +19,7 @@
 
 #include <elf/data.hh>
 #include <utils/exception.hh>
+#include <utils/mapped_file.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 
 #include <algorithm>
@@ -29,21 +30,99 @@ namespace gpu
     template <>
     struct Implementation<elf::Data>
     {
-        std::vector<char> data;
+        // owned bytes, which slices may share
+        std::tr1::shared_ptr<std::vector<char> > storage;
+
+        // borrowed bytes, and what keeps them alive
+        bool borrowed;
+
+        const char * view;
+
+        unsigned view_size;
+
+        std::tr1::shared_ptr<const void> owner;
+
+        // the number of times the bytes have been handed out for changes
+        unsigned changes;
 
         Implementation(unsigned size) :
-            data(size, 0)
+            storage(new std::vector<char>(size, 0)),
+            borrowed(false),
+            view(0),
+            view_size(0),
+            changes(0)
+        {
+        }
+
+        Implementation(const char * view, unsigned size, const std::tr1::shared_ptr<const void> & owner) :
+            borrowed(true),
+            view(view),
+            view_size(size),
+            owner(owner),
+            changes(0)
+        {
+        }
+
+        const char * begin() const
         {
+            if (borrowed)
+                return view;
+
+            return storage->empty() ? 0 : &(*storage)[0];
+        }
+
+        unsigned size() const
+        {
+            return borrowed ? view_size : storage->size();
+        }
+
+        /// Return bytes that may be changed, copying shared or borrowed ones first.
+        std::vector<char> & own()
+        {
+            ++changes;
+
+            if (borrowed)
+            {
+                storage.reset(new std::vector<char>(view, view + view_size));
+                borrowed = false;
+                view = 0;
+                view_size = 0;
+                owner.reset();
+            }
+            else if (! storage.unique())
+            {
+                storage.reset(new std::vector<char>(*storage));
+            }
+
+            return *storage;
         }
     };
 
     namespace elf
     {
+        namespace internal
+        {
+            std::tr1::shared_ptr<const void> keep_mapped(const MappedFile & file, unsigned offset, unsigned size)
+            {
+                if ((offset > file.size()) || (size > file.size() - offset))
+                    throw InternalError("elf", "Data exceeds the mapped file '" + file.filename() + "'");
+
+                return std::tr1::shared_ptr<const void>(new MappedFile(file));
+            }
+        }
+
         Data::Data(unsigned size) :
             PrivateImplementationPattern<elf::Data>(new Implementation<elf::Data>(size))
         {
         }
 
+        Data::Data(const MappedFile & file, unsigned offset, unsigned size) :
+            PrivateImplementationPattern<elf::Data>(new Implementation<elf::Data>(
+                        0, size, internal::keep_mapped(file, offset, size)))
+        {
+            _imp->view = file.begin() + offset;
+        }
+
         Data::~Data()
         {
         }
@@ -51,37 +130,167 @@ namespace gpu
         const void *
         Data::buffer() const
         {
-            return &_imp->data[0];
+            return _imp->begin();
         }
 
         void
         Data::read(unsigned offset, char * data, unsigned size) const
         {
-            if (offset + size > _imp->data.size())
+            if (offset + size > _imp->size())
                 throw InternalError("elf", "out-of-bounds read");
 
-            std::copy(_imp->data.begin() + offset, _imp->data.begin() + offset + size, data);
+            std::copy(_imp->begin() + offset, _imp->begin() + offset + size, data);
         }
 
         void
         Data::resize(unsigned size)
         {
-            _imp->data.resize(size, 0);
+            _imp->own().resize(size, 0);
         }
 
         unsigned
         Data::size() const
         {
-            return _imp->data.size();
+            return _imp->size();
+        }
+
+        Data
+        Data::slice(unsigned offset, unsigned size) const
+        {
+            if ((offset > _imp->size()) || (size > _imp->size() - offset))
+                throw InternalError("elf", "out-of-bounds slice");
+
+            Data result(0);
+            if (_imp->borrowed)
+                result._imp.reset(new Implementation<elf::Data>(_imp->view + offset, size, _imp->owner));
+            else
+                result._imp.reset(new Implementation<elf::Data>(_imp->begin() + offset, size, _imp->storage));
+
+            return result;
+        }
+
+        bool
+        Data::same_as(const Data & other) const
+        {
+            return _imp == other._imp;
+        }
+
+        unsigned
+        Data::changes() const
+        {
+            return _imp->changes;
         }
 
         void
         Data::write(unsigned offset, const char * data, unsigned size)
         {
-            if (offset + size > _imp->data.size())
+            std::vector<char> & bytes(_imp->own());
+
+            if (offset + size > bytes.size())
+                throw InternalError("elf", "out-of-bounds read");
+
+            std::copy(data, data + size, bytes.begin() + offset);
+        }
+
+        DataWriter::DataWriter(Data data) :
+            _data(data)
+        {
+            _data._imp->own().clear();
+        }
+
+        DataWriter::~DataWriter()
+        {
+        }
+
+        void
+        DataWriter::put8(uint8_t value)
+        {
+            _data._imp->own().push_back(value);
+        }
+
+        void
+        DataWriter::put16(uint16_t value)
+        {
+            char * bytes(reserve(2));
+            bytes[0] = value;
+            bytes[1] = value >> 8;
+        }
+
+        void
+        DataWriter::put32(uint32_t value)
+        {
+            char * bytes(reserve(4));
+            bytes[0] = value;
+            bytes[1] = value >> 8;
+            bytes[2] = value >> 16;
+            bytes[3] = value >> 24;
+        }
+
+        void
+        DataWriter::put64(uint64_t value)
+        {
+            char * bytes(reserve(8));
+            for (unsigned i(0) ; i < 8 ; ++i, value >>= 8)
+                bytes[i] = value;
+        }
+
+        void
+        DataWriter::put(const void * bytes, unsigned size)
+        {
+            const char * begin(static_cast<const char *>(bytes));
+
+            std::vector<char> & storage(_data._imp->own());
+            storage.insert(storage.end(), begin, begin + size);
+        }
+
+        char *
+        DataWriter::reserve(unsigned size)
+        {
+            std::vector<char> & storage(_data._imp->own());
+            std::vector<char>::size_type offset(storage.size());
+
+            storage.resize(offset + size, 0);
+
+            return size ? &storage[offset] : 0;
+        }
+
+        void
+        DataWriter::align(unsigned alignment)
+        {
+            unsigned size(_data.size());
+
+            reserve((alignment - size % alignment) % alignment);
+        }
+
+        uint64_t
+        DataWriter::get64(unsigned offset) const
+        {
+            if (offset + 8 > _data.size())
                 throw InternalError("elf", "out-of-bounds read");
 
-            std::copy(data, data + size, _imp->data.begin() + offset);
+            const unsigned char * bytes(reinterpret_cast<const unsigned char *>(_data._imp->begin()) + offset);
+            uint64_t result(0);
+            for (unsigned i(8) ; i > 0 ; --i)
+                result = (result << 8) | bytes[i - 1];
+
+            return result;
+        }
+
+        void
+        DataWriter::patch64(unsigned offset, uint64_t value)
+        {
+            std::vector<char> & storage(_data._imp->own());
+            if (offset + 8 > storage.size())
+                throw InternalError("elf", "out-of-bounds write");
+
+            for (unsigned i(0) ; i < 8 ; ++i, value >>= 8)
+                storage[offset + i] = value;
+        }
+
+        unsigned
+        DataWriter::size() const
+        {
+            return _data.size();
         }
     }
 }
@@ -22,16 +22,38 @@
 
 #include <utils/private_implementation_pattern.hh>
 
+#include <stdint.h>
+
+namespace gpu
+{
+    class MappedFile;
+}
+
 namespace gpu
 {
     namespace elf
     {
+        class DataWriter;
+
+        /**
+         * Data holds the bytes of a section.
+         *
+         * Data either owns its bytes, or borrows them from a mapped file or
+         * from another Data. The first change to bytes that are borrowed, or
+         * lent to a slice, makes a private copy of them. Copies of a Data
+         * share the same bytes.
+         */
         class Data :
             public PrivateImplementationPattern<elf::Data>
         {
             public:
+                friend class DataWriter;
+
                 Data(unsigned size = 0);
 
+                /// Borrow size bytes at offset of a mapped file, which stays mapped while they are in use.
+                Data(const MappedFile & file, unsigned offset, unsigned size);
+
                 ~Data();
 
                 const void * buffer() const;
@@ -42,8 +64,64 @@ namespace gpu
 
                 unsigned size() const;
 
+                /// Return a Data that borrows size bytes at offset, without copying them.
+                Data slice(unsigned offset, unsigned size) const;
+
+                /// Return whether other is a copy of this Data, and so shares its changes.
+                bool same_as(const Data & other) const;
+
+                /// Return a count that grows with every change of the bytes, for caches of what is derived from them.
+                unsigned changes() const;
+
                 void write(unsigned offset, const char * data, unsigned size);
         };
+
+        /**
+         * DataWriter appends to the bytes of a Data, in place.
+         *
+         * Storage grows geometrically, so appending is amortized constant
+         * time. Integers are put in little endian byte order.
+         */
+        class DataWriter
+        {
+            private:
+                Data _data;
+
+            public:
+                /// Replace the bytes of data by what is appended.
+                DataWriter(Data data);
+
+                ~DataWriter();
+
+                void put8(uint8_t value);
+
+                void put16(uint16_t value);
+
+                void put32(uint32_t value);
+
+                void put64(uint64_t value);
+
+                void put(const void * bytes, unsigned size);
+
+                /**
+                 * Append size zero bytes, and return where they start.
+                 *
+                 * The pointer is valid until the next append.
+                 */
+                char * reserve(unsigned size);
+
+                /// Append zero bytes up to a multiple of alignment.
+                void align(unsigned alignment);
+
+                /// Return the 64-bit integer at offset.
+                uint64_t get64(unsigned offset) const;
+
+                /// Overwrite the 64-bit integer at offset.
+                void patch64(unsigned offset, uint64_t value);
+
+                /// Return the number of bytes written so far.
+                unsigned size() const;
+        };
     }
 }
 
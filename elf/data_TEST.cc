@@ -19,8 +19,10 @@
 
 #include <tests/tests.hh>
 #include <elf/data.hh>
+#include <utils/exception.hh>
 #include <utils/stringify.hh>
 
+#include <cstring>
 #include <string>
 
 using namespace gpu;
@@ -58,3 +60,87 @@ struct ElfDataTest :
         TEST_CHECK_EQUAL(stringify(ref_b), stringify(output_a));
     }
 } elf_data_test;
+
+struct ElfDataWriterTest :
+    public Test
+{
+    ElfDataWriterTest() :
+        Test("elf_data_writer_test")
+    {
+    }
+
+    void run()
+    {
+        elf::Data data(4);
+        elf::DataWriter writer(data);
+
+        // writing starts from scratch, and goes straight into data
+        TEST_CHECK_EQUAL(data.size(), 0u);
+
+        writer.put8(0x01);
+        writer.put16(0x0302);
+        writer.put32(0x07060504);
+        writer.put64(0x0f0e0d0c0b0a0908ULL);
+        TEST_CHECK_EQUAL(writer.size(), 15u);
+        TEST_CHECK_EQUAL(data.size(), 15u);
+
+        const unsigned char * bytes(static_cast<const unsigned char *>(data.buffer()));
+        for (unsigned i(0) ; i < 15 ; ++i)
+            TEST_CHECK_EQUAL(unsigned(bytes[i]), i + 1);
+
+        writer.align(8);
+        TEST_CHECK_EQUAL(data.size(), 16u);
+        writer.align(8);
+        TEST_CHECK_EQUAL(data.size(), 16u);
+
+        writer.put("abc", 3);
+        std::memcpy(writer.reserve(2), "de", 2);
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(data.buffer()) + 16, 5), "abcde");
+
+        TEST_CHECK_EQUAL(writer.get64(7), 0x0f0e0d0c0b0a0908ULL);
+        writer.patch64(7, 0x1122334455667788ULL);
+        TEST_CHECK_EQUAL(writer.get64(7), 0x1122334455667788ULL);
+        TEST_CHECK_EQUAL(unsigned(static_cast<const unsigned char *>(data.buffer())[7]), 0x88u);
+        TEST_CHECK_THROWS(writer.get64(14), InternalError);
+        TEST_CHECK_THROWS(writer.patch64(14, 0), InternalError);
+
+        // many small appends
+        for (unsigned i(0) ; i < 100000 ; ++i)
+            writer.put32(i);
+        TEST_CHECK_EQUAL(data.size(), 21u + 400000u);
+    }
+} elf_data_writer_test;
+
+struct ElfDataSliceTest :
+    public Test
+{
+    ElfDataSliceTest() :
+        Test("elf_data_slice_test")
+    {
+    }
+
+    void run()
+    {
+        elf::Data data(8);
+        data.write(0, "abcdefgh", 8);
+
+        // slices share the bytes
+        elf::Data slice(data.slice(2, 4));
+        TEST_CHECK_EQUAL(slice.size(), 4u);
+        TEST_CHECK(static_cast<const char *>(data.buffer()) + 2 == slice.buffer());
+
+        elf::Data nested(slice.slice(1, 2));
+        TEST_CHECK(static_cast<const char *>(data.buffer()) + 3 == nested.buffer());
+        TEST_CHECK_THROWS(slice.slice(3, 2), InternalError);
+
+        // until either side changes
+        data.write(2, "X", 1);
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(slice.buffer()), 4), "cdef");
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(data.buffer()), 8), "abXdefgh");
+
+        slice.write(0, "Y", 1);
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(slice.buffer()), 4), "Ydef");
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(nested.buffer()), 2), "de");
+        TEST_CHECK_EQUAL(std::string(static_cast<const char *>(data.buffer()), 8), "abXdefgh");
+    }
+} elf_data_slice_test;
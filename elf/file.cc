@@ -17,24 +17,77 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <elf/error.hh>
+#include <elf/compression.hh>
 #include <elf/file.hh>
 #include <elf/string_table.hh>
+#include <elf/symbol_hash.hh>
+#include <utils/mapped_file.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 #include <utils/sequence-impl.hh>
+#include <utils/stringify.hh>
 #include <utils/wrapped_forward_iterator-impl.hh>
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
 #include <vector>
+#include <tr1/unordered_map>
 
+#include <elf.h>
 #include <fcntl.h>
-#include <libelf.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 namespace gpu
 {
     template
     struct WrappedForwardIterator<elf::File::SectionIteratorTag, elf::Section>;
 
+    namespace elf
+    {
+        namespace internal
+        {
+            /// A section that is compressed on a worker thread.
+            struct CompressionJob
+            {
+                Atom name;
+
+                Data input;
+
+                unsigned type;
+
+                unsigned alignment;
+
+                Data output;
+
+                std::string failure;
+
+                // the changes of input that output was compressed from
+                unsigned changes;
+
+                CompressionJob(const Atom & n, const Data & i, unsigned t, unsigned a) :
+                    name(n),
+                    input(i),
+                    type(t),
+                    alignment(a),
+                    changes(i.changes())
+                {
+                }
+
+                /// Return whether output still holds what compressing data would yield.
+                bool current(const Data & data, unsigned t, unsigned a) const
+                {
+                    return input.same_as(data) && (data.changes() == changes) && (t == type) && (a == alignment);
+                }
+            };
+        }
+    }
+
     template <>
     struct Implementation<elf::File> :
         public elf::File::Parameters
@@ -45,37 +98,483 @@ namespace gpu
 
         elf::StringTable sh_strtab;
 
-        Implementation(const elf::File::Parameters & parameters) :
-            elf::File::Parameters(parameters)
+        // the position of .shstrtab in sections
+        unsigned shstrndx;
+
+        // the tables of opened files, which are decoded on first use
+        bool tables_located;
+
+        unsigned symtab;
+
+        elf::StringTable strtab;
+
+        std::tr1::shared_ptr<elf::SymbolHash> hash;
+
+        std::map<unsigned, elf::Symbol> symbol_cache;
+
+        bool symbols_decoded;
+
+        Sequence<elf::Symbol> symbols;
+
+        std::tr1::unordered_map<unsigned, unsigned> symbol_indices;
+
+        std::map<Atom, Sequence<elf::Relocation> > relocations;
+
+        // the layout of the last write, whose buffers are reused by the next
+        Elf32_Ehdr ehdr;
+
+        std::vector<Elf32_Shdr> shdrs;
+
+        std::vector<elf::Data> data;
+
+        std::vector<char> zeros;
+
+        std::vector<struct iovec> pieces;
+
+        // the compressed sections of the last layout, by position, reused while their data does not change
+        std::vector<elf::internal::CompressionJob> compressed;
+
+        Implementation(const elf::File::Parameters & parameters, bool opened = false) :
+            elf::File::Parameters(parameters),
+            shstrndx(0),
+            tables_located(false),
+            symtab(0),
+            symbols_decoded(false)
+        {
+            if (! opened)
+                add_shstrtab();
+        }
+
+        void add_shstrtab()
         {
             sections.push_back(elf::Section(elf::Section::Parameters()
                         .name(".shstrtab")
                         .type(SHT_STRTAB)
                         .flags(SHF_STRINGS)));
-            sh_strtab[".shstrtab"];
+            sh_strtab.insert(".shstrtab");
             section_table.append(".shstrtab");
         }
+
+        /// Forget all sections and decoded tables, but keep the allocations that can be reused.
+        void clear()
+        {
+            sections.clear();
+            section_table.clear();
+            sh_strtab.clear();
+            shstrndx = 0;
+
+            tables_located = false;
+            symtab = 0;
+            strtab = elf::StringTable();
+            hash.reset();
+            symbol_cache.clear();
+            symbols_decoded = false;
+            symbols = Sequence<elf::Symbol>();
+            symbol_indices.clear();
+            relocations.clear();
+            compressed.clear();
+
+            add_shstrtab();
+        }
+
+        const elf::Section::Parameters & parameters(unsigned index)
+        {
+            return sections[index - 1].parameters();
+        }
+
+        /// Find the symbol table, its string table and its hash section, if any.
+        void locate_tables()
+        {
+            if (tables_located)
+                return;
+
+            tables_located = true;
+
+            for (unsigned i(1) ; i <= sections.size() ; ++i)
+            {
+                if (SHT_SYMTAB != parameters(i)._type)
+                    continue;
+
+                symtab = i;
+                break;
+            }
+
+            if (0 == symtab)
+                return;
+
+            unsigned link(parameters(symtab)._link);
+            if ((0 == link) || (link > sections.size()))
+                throw InternalError("elf", "Symbol table is not linked to a string table");
+
+            strtab.read(sections[link - 1].data());
+
+            for (unsigned i(1) ; i <= sections.size() ; ++i)
+            {
+                if ((SHT_GNU_HASH != parameters(i)._type) || (symtab != parameters(i)._link))
+                    continue;
+
+                hash.reset(new elf::SymbolHash(sections[i - 1].data(), sections[symtab - 1].data(), strtab));
+                break;
+            }
+        }
+
+        unsigned symbol_count()
+        {
+            locate_tables();
+
+            return symtab ? sections[symtab - 1].data().size() / sizeof(Elf32_Sym) : 0;
+        }
+
+        const elf::Symbol & symbol(unsigned index)
+        {
+            std::map<unsigned, elf::Symbol>::const_iterator s(symbol_cache.find(index));
+            if (symbol_cache.end() != s)
+                return s->second;
+
+            if (index >= symbol_count())
+                throw InternalError("elf", "There is no symbol with index '" + stringify(index) + "'");
+
+            Elf32_Sym entry;
+            sections[symtab - 1].data().read(index * sizeof(Elf32_Sym), reinterpret_cast<char *>(&entry), sizeof(Elf32_Sym));
+
+            elf::Symbol result(strtab[entry.st_name]);
+            result.bind = ELF32_ST_BIND(entry.st_info);
+            result.type = ELF32_ST_TYPE(entry.st_info);
+            result.size = entry.st_size;
+            result.value = entry.st_value;
+            if ((SHN_UNDEF != entry.st_shndx) && (entry.st_shndx <= sections.size()))
+                result.section = sections[entry.st_shndx - 1].name();
+
+            return symbol_cache.insert(std::make_pair(index, result)).first->second;
+        }
+
+        void decode_symbols()
+        {
+            if (symbols_decoded)
+                return;
+
+            for (unsigned i(1), i_end(symbol_count()) ; i < i_end ; ++i)
+            {
+                const elf::Symbol & s(symbol(i));
+
+                symbols.append(s);
+                symbol_indices.insert(std::make_pair(s.name.id(), i));
+            }
+
+            symbols_decoded = true;
+        }
+
+        /// Lay out the file as pieces to be written in order, and return its size.
+        unsigned lay_out();
+
+        /// Copy the pieces of the last layout to target.
+        void copy(char * target) const
+        {
+            for (std::vector<struct iovec>::const_iterator p(pieces.begin()), p_end(pieces.end()) ;
+                    p != p_end ; ++p)
+            {
+                std::memcpy(target, p->iov_base, p->iov_len);
+                target += p->iov_len;
+            }
+        }
     };
 
     namespace elf
     {
         namespace internal
         {
-            struct SectionComparator
+            /// Return the data encoding of this host.
+            unsigned host_data()
             {
-                std::string name;
+                union
+                {
+                    unsigned word;
+                    char bytes[sizeof(unsigned)];
+                } probe;
+                probe.word = 1;
 
-                SectionComparator(const std::string & name) :
-                    name(name)
+                return probe.bytes[0] ? ELFDATA2LSB : ELFDATA2MSB;
+            }
+
+            unsigned align(unsigned offset, unsigned alignment)
+            {
+                return (offset + alignment - 1) / alignment * alignment;
+            }
+
+            /// Return the size of the entries of sections of a type, as libelf would fill it in.
+            unsigned entry_size(unsigned type)
+            {
+                switch (type)
                 {
+                    case SHT_SYMTAB:
+                    case SHT_DYNSYM:
+                        return sizeof(Elf32_Sym);
+
+                    case SHT_RELA:
+                        return sizeof(Elf32_Rela);
+
+                    case SHT_REL:
+                        return sizeof(Elf32_Rel);
+
+                    case SHT_DYNAMIC:
+                        return sizeof(Elf32_Dyn);
+
+                    case SHT_HASH:
+                    case SHT_GROUP:
+                    case SHT_SYMTAB_SHNDX:
+                        return sizeof(Elf32_Word);
                 }
 
-                bool operator() (const Section & section)
+                return 0;
+            }
+
+            void gather(std::vector<struct iovec> & pieces, const void * buffer, unsigned size)
+            {
+                if (0 == size)
+                    return;
+
+                struct iovec piece;
+                piece.iov_base = const_cast<void *>(buffer);
+                piece.iov_len = size;
+
+                pieces.push_back(piece);
+            }
+
+            /// Write all pieces, in as few calls as the system allows.
+            bool write_all(int fd, std::vector<struct iovec> & pieces)
+            {
+                std::vector<struct iovec>::iterator p(pieces.begin()), p_end(pieces.end());
+                while (p != p_end)
                 {
-                    return section.name() == name;
+                    int count(std::min<long>(std::distance(p, p_end), IOV_MAX));
+                    ssize_t written(::writev(fd, &*p, count));
+                    if (written < 0)
+                    {
+                        if (EINTR == errno)
+                            continue;
+
+                        return false;
+                    }
+
+                    // skip what has been written, and resume within a partially written piece
+                    for ( ; (p != p_end) && (std::size_t(written) >= p->iov_len) ; ++p)
+                        written -= p->iov_len;
+
+                    if (p != p_end)
+                    {
+                        p->iov_base = static_cast<char *>(p->iov_base) + written;
+                        p->iov_len -= written;
+                    }
                 }
+
+                return true;
+            }
+
+            /// The jobs of one worker: every stride-th job, from first on.
+            struct CompressionWorker
+            {
+                std::vector<CompressionJob> * jobs;
+
+                unsigned first;
+
+                unsigned stride;
             };
+
+            void * compress_jobs(void * argument)
+            {
+                CompressionWorker * worker(static_cast<CompressionWorker *>(argument));
+
+                for (unsigned i(worker->first) ; i < worker->jobs->size() ; i += worker->stride)
+                {
+                    CompressionJob & job((*worker->jobs)[i]);
+
+                    try
+                    {
+                        job.output = compress(job.input, job.type, job.alignment);
+                    }
+                    catch (Exception & e)
+                    {
+                        job.failure = e.message();
+                    }
+                    catch (std::bad_alloc &)
+                    {
+                        job.failure = "out of memory";
+                    }
+                }
+
+                return 0;
+            }
+
+            /// Run all jobs, on one thread per job but no more than there are processors.
+            void run_compression(std::vector<CompressionJob> & jobs)
+            {
+                long processors(::sysconf(_SC_NPROCESSORS_ONLN));
+                unsigned count(std::min<unsigned long>(jobs.size(), (processors > 0) ? processors : 1));
+                if (0 == count)
+                    return;
+
+                std::vector<CompressionWorker> workers(count);
+                std::vector<pthread_t> threads(count);
+                std::vector<bool> started(count, false);
+
+                for (unsigned i(0) ; i < count ; ++i)
+                {
+                    workers[i].jobs = &jobs;
+                    workers[i].first = i;
+                    workers[i].stride = count;
+                }
+
+                for (unsigned i(1) ; i < count ; ++i)
+                {
+                    started[i] = (0 == pthread_create(&threads[i], 0, &compress_jobs, &workers[i]));
+                }
+
+                compress_jobs(&workers[0]);
+
+                for (unsigned i(1) ; i < count ; ++i)
+                {
+                    if (started[i])
+                    {
+                        pthread_join(threads[i], 0);
+                    }
+                    else
+                    {
+                        // Could not spawn a thread; do the work ourselves.
+                        compress_jobs(&workers[i]);
+                    }
+                }
+
+                for (std::vector<CompressionJob>::const_iterator j(jobs.begin()), j_end(jobs.end()) ; j != j_end ; ++j)
+                {
+                    if (! j->failure.empty())
+                        throw InternalError("elf", "Could not compress section '" + j->name.str() + "': " + j->failure);
+                }
+            }
+        }
+    }
+
+    unsigned
+    Implementation<elf::File>::lay_out()
+    {
+        if (elf::internal::host_data() != _data)
+            throw InternalError("elf", "Writing in a foreign byte order is not supported");
+
+        sh_strtab.write(sections[shstrndx].data());
+
+        // lay out the file: header, sections and the section header table
+        shdrs.resize(sections.size() + 1);
+        std::memset(&shdrs[0], 0, sizeof(Elf32_Shdr));
+
+        data.clear();
+        data.reserve(sections.size());
+
+        // compress the sections that ask for it and changed since the last layout, each on a worker thread
+        compressed.resize(sections.size(), elf::internal::CompressionJob(Atom(), elf::Data(), 0, 0));
+
+        std::vector<elf::internal::CompressionJob> jobs;
+        std::vector<unsigned> job_indices;
+        for (unsigned i(0) ; i < sections.size() ; ++i)
+        {
+            elf::Section & s(sections[i]);
+            unsigned compression(s.parameters()._compression);
+
+            if ((0 == compression) || (SHT_NOBITS == s.parameters()._type))
+                continue;
+
+            if (! elf::compression_supported(compression))
+                throw InternalError("elf", "Compression type '" + stringify(compression) + "' of section '"
+                        + s.name().str() + "' is not supported");
+
+            // sections of opened files only know their alignment once decompressed
+            elf::Data contents(s.data());
+            if (compressed[i].current(contents, compression, s.parameters()._alignment))
+                continue;
+
+            jobs.push_back(elf::internal::CompressionJob(s.name(), contents, compression, s.parameters()._alignment));
+            job_indices.push_back(i);
+        }
+
+        elf::internal::run_compression(jobs);
+
+        for (unsigned j(0) ; j < jobs.size() ; ++j)
+            compressed[job_indices[j]] = jobs[j];
+
+        unsigned offset(sizeof(Elf32_Ehdr)), max_alignment(4);
+        for (unsigned i(0) ; i < sections.size() ; ++i)
+        {
+            elf::Section & s(sections[i]);
+            Elf32_Shdr & shdr(shdrs[i + 1]);
+
+            // decompressing a section of an opened file restores its flags and alignment
+            data.push_back(s.data());
+
+            unsigned alignment(std::max(1u, s.parameters()._alignment)), flags(s.parameters()._flags);
+
+            // sections that did not get smaller are written as they are
+            if ((SHT_NOBITS != s.parameters()._type) && (0 != compressed[i].output.size())
+                    && compressed[i].current(data.back(), s.parameters()._compression, s.parameters()._alignment))
+            {
+                data.back() = compressed[i].output;
+                alignment = sizeof(Elf32_Word);
+                flags |= SHF_COMPRESSED;
+            }
+
+            offset = elf::internal::align(offset, alignment);
+            max_alignment = std::max(max_alignment, alignment);
+
+            shdr.sh_name = sh_strtab[s.name()];
+            shdr.sh_type = s.parameters()._type;
+            shdr.sh_flags = flags;
+            shdr.sh_addr = 0;
+            shdr.sh_offset = offset;
+            shdr.sh_size = data.back().size();
+            shdr.sh_link = s.parameters()._link;
+            shdr.sh_info = s.parameters()._info;
+            shdr.sh_addralign = alignment;
+            shdr.sh_entsize = elf::internal::entry_size(shdr.sh_type);
+
+            if (SHT_NOBITS != shdr.sh_type)
+                offset += shdr.sh_size;
+        }
+
+        std::memset(&ehdr, 0, sizeof(Elf32_Ehdr));
+        std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+        ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+        ehdr.e_ident[EI_DATA] = _data;
+        ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+        ehdr.e_type = _type;
+        ehdr.e_machine = _machine;
+        ehdr.e_version = EV_CURRENT;
+        ehdr.e_shoff = elf::internal::align(offset, 4);
+        ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+        ehdr.e_shentsize = sizeof(Elf32_Shdr);
+        ehdr.e_shnum = shdrs.size();
+        ehdr.e_shstrndx = shstrndx + 1;
+
+        // gather all pieces, with zeros for the padding in between
+        zeros.assign(max_alignment, 0);
+        pieces.clear();
+        pieces.reserve(2 * shdrs.size() + 2);
+
+        elf::internal::gather(pieces, &ehdr, sizeof(Elf32_Ehdr));
+        offset = sizeof(Elf32_Ehdr);
+        for (unsigned i(1) ; i < shdrs.size() ; ++i)
+        {
+            if ((SHT_NOBITS == shdrs[i].sh_type) || (0 == shdrs[i].sh_size))
+                continue;
+
+            elf::internal::gather(pieces, &zeros[0], shdrs[i].sh_offset - offset);
+            elf::internal::gather(pieces, data[i - 1].buffer(), shdrs[i].sh_size);
+            offset = shdrs[i].sh_offset + shdrs[i].sh_size;
         }
+        elf::internal::gather(pieces, &zeros[0], ehdr.e_shoff - offset);
+        elf::internal::gather(pieces, &shdrs[0], shdrs.size() * sizeof(Elf32_Shdr));
+
+        return ehdr.e_shoff + shdrs.size() * sizeof(Elf32_Shdr);
+    }
+
+    namespace elf
+    {
 
         File::Parameters &
         File::Parameters::data(unsigned data)
@@ -106,6 +605,11 @@ namespace gpu
         {
         }
 
+        File::File(Implementation<elf::File> * imp) :
+            PrivateImplementationPattern<elf::File>(imp)
+        {
+        }
+
         File::~File()
         {
         }
@@ -125,13 +629,11 @@ namespace gpu
         void
         File::append(const Section & section)
         {
-            std::vector<Section>::const_iterator s(std::find_if(
-                        _imp->sections.begin(), _imp->sections.end(), internal::SectionComparator(section.name())));
-            if (_imp->sections.end() != s)
+            if (0 != _imp->section_table[section.name()])
                 throw InternalError("elf", "Trying to append a section that already exists");
 
             _imp->sections.push_back(section);
-            _imp->sh_strtab[section.name()];
+            _imp->sh_strtab.insert(section.name());
             _imp->section_table.append(section.name());
         }
 
@@ -154,71 +656,83 @@ namespace gpu
         unsigned
         File::index(const Section & section)
         {
-            std::vector<Section>::iterator s(std::find_if(
-                        _imp->sections.begin(), _imp->sections.end(), internal::SectionComparator(section.name())));
-            if (_imp->sections.end() == s)
+            unsigned result(_imp->section_table[section.name()]);
+            if (0 == result)
                 throw InternalError("elf", "Trying to get the index of a section that has not been added yet");
 
-            return std::distance(_imp->sections.begin(), s) + 1;
+            return result;
         }
 
         File
         File::open(const std::string & filename)
         {
-            if (elf_version(EV_CURRENT) == EV_NONE)
-                throw InternalError("elf", "libelf version mismatch");
+            MappedFile file(filename);
 
-            int fd(::open(filename.c_str(), O_RDONLY, 0777));
-            if (fd < 0)
-                throw InternalError("elf", "Could not open file '" + filename + "'");
+            Elf32_Ehdr ehdr;
+            if (file.size() < sizeof(Elf32_Ehdr))
+                throw InternalError("elf", "'" + filename + "' is not an ELF file");
 
-            Elf * e(elf_begin(fd, ELF_C_READ, NULL));
-            if (0 == e)
-                throw Error("elf_begin");
+            std::memcpy(&ehdr, file.begin(), sizeof(Elf32_Ehdr));
+            if (0 != std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG))
+                throw InternalError("elf", "'" + filename + "' is not an ELF file");
 
-            if (ELF_K_ELF != elf_kind(e))
-                throw InternalError("elf", "Not an ELF file");
+            if (ELFCLASS32 != ehdr.e_ident[EI_CLASS])
+                throw InternalError("elf", "'" + filename + "' is not a 32-bit ELF file");
 
-            Elf32_Ehdr * ehdr(elf32_getehdr(e));
-            if (0 == ehdr)
-                throw Error("elf32_getehdr");
+            if (internal::host_data() != ehdr.e_ident[EI_DATA])
+                throw InternalError("elf", "Reading '" + filename + "' in a foreign byte order is not supported");
 
-            File result(File::Parameters()
-                    .data(ehdr->e_ident[EI_DATA])
-                    .machine(ehdr->e_machine)
-                    .type(ehdr->e_type));
+            if ((0 != ehdr.e_shnum) && (sizeof(Elf32_Shdr) != ehdr.e_shentsize))
+                throw InternalError("elf", "'" + filename + "' has section headers of unknown size");
 
-            // load .shstrtab
-            {
-                size_t shstrndx(SHN_UNDEF);
-                if (0 != elf_getshstrndx(e, &shstrndx))
-                    throw Error("elf_getshstrndx");
+            if ((ehdr.e_shoff > file.size()) || (ehdr.e_shnum * sizeof(Elf32_Shdr) > file.size() - ehdr.e_shoff))
+                throw InternalError("elf", "'" + filename + "' has a truncated section header table");
 
-                Elf_Scn * shstrscn(elf_getscn(e, shstrndx));
-                Elf_Data * shstrdata(elf_getdata(shstrscn, 0));
+            if ((ehdr.e_shnum > 1) && ((SHN_UNDEF == ehdr.e_shstrndx) || (ehdr.e_shstrndx >= ehdr.e_shnum)))
+                throw InternalError("elf", "'" + filename + "' has no section names");
 
-                Data data;
-                data.resize(shstrdata->d_size);
-                data.write(0, reinterpret_cast<const char *>(shstrdata->d_buf), shstrdata->d_size);
+            std::vector<Elf32_Shdr> shdrs(ehdr.e_shnum);
+            if (! shdrs.empty())
+                std::memcpy(&shdrs[0], file.begin() + ehdr.e_shoff, shdrs.size() * sizeof(Elf32_Shdr));
 
-                result._imp->sh_strtab.read(data);
+            File result(new Implementation<elf::File>(File::Parameters()
+                    .data(ehdr.e_ident[EI_DATA])
+                    .machine(ehdr.e_machine)
+                    .type(ehdr.e_type), true));
+
+            if (shdrs.size() <= 1)
+                return result;
+
+            // sections borrow their bytes from the mapping, so that only the pages in use are ever read
+            std::vector<Data> data;
+            data.reserve(shdrs.size());
+            for (unsigned i(1) ; i < shdrs.size() ; ++i)
+            {
+                if (SHT_NOBITS == shdrs[i].sh_type)
+                    data.push_back(Data(0));
+                else
+                    data.push_back(Data(file, shdrs[i].sh_offset, shdrs[i].sh_size));
             }
 
-            // load sections
-            unsigned index(1);
-            for (Elf_Scn * scn(elf_nextscn(e, 0)) ; 0 != scn ; scn = elf_nextscn(e, scn), ++index)
+            result._imp->shstrndx = ehdr.e_shstrndx - 1;
+            result._imp->sh_strtab.read(data[result._imp->shstrndx]);
+
+            for (unsigned i(1) ; i < shdrs.size() ; ++i)
             {
-                Elf32_Shdr * shdr(elf32_getshdr(scn));
-                Elf_Data * data(elf_getdata(scn, 0));
+                // compressed sections are compressed again when written, as their Elf32_Chdr says
+                Elf32_Chdr chdr;
+                chdr.ch_type = 0;
+                if ((shdrs[i].sh_flags & SHF_COMPRESSED) && (data[i - 1].size() >= sizeof(Elf32_Chdr)))
+                    data[i - 1].read(0, reinterpret_cast<char *>(&chdr), sizeof(Elf32_Chdr));
 
                 Section section(Section::Parameters()
-                        .alignment(data->d_align)
-                        .flags(shdr->sh_flags)
-                        .link(shdr->sh_link)
-                        .name(result._imp->sh_strtab[shdr->sh_name])
-                        .type(shdr->sh_type));
-
-                section.data().resize(data->d_size);
+                        .alignment(shdrs[i].sh_addralign)
+                        .compression(chdr.ch_type)
+                        .flags(shdrs[i].sh_flags)
+                        .info(shdrs[i].sh_info)
+                        .link(shdrs[i].sh_link)
+                        .name(result._imp->sh_strtab[shdrs[i].sh_name])
+                        .type(shdrs[i].sh_type), data[i - 1]);
 
                 result._imp->sections.push_back(section);
                 result._imp->section_table.append(section.name());
@@ -227,77 +741,150 @@ namespace gpu
             return result;
         }
 
+        File::Iterator
+        File::find(const Atom & name)
+        {
+            unsigned index(_imp->section_table[name]);
+            if (0 == index)
+                return end();
+
+            return Iterator(_imp->sections.begin() + (index - 1));
+        }
+
+        Sequence<Symbol>
+        File::symbols()
+        {
+            _imp->decode_symbols();
+
+            return _imp->symbols;
+        }
+
+        const Symbol *
+        File::find_symbol(const Atom & name)
+        {
+            _imp->locate_tables();
+
+            if (_imp->hash)
+            {
+                unsigned index(_imp->hash->find(name.str()));
+
+                return index ? &_imp->symbol(index) : 0;
+            }
+
+            if (_imp->symbols_decoded)
+            {
+                std::tr1::unordered_map<unsigned, unsigned>::const_iterator i(_imp->symbol_indices.find(name.id()));
+                if (_imp->symbol_indices.end() == i)
+                    return 0;
+
+                return &_imp->symbol(i->second);
+            }
+
+            // Compare the names in place, so that only the symbol asked for is decoded and its name interned.
+            for (unsigned i(1), i_end(_imp->symbol_count()) ; i < i_end ; ++i)
+            {
+                Elf32_Sym entry;
+                _imp->sections[_imp->symtab - 1].data().read(i * sizeof(Elf32_Sym), reinterpret_cast<char *>(&entry), sizeof(Elf32_Sym));
+
+                if (_imp->strtab[entry.st_name] == name.str())
+                    return &_imp->symbol(i);
+            }
+
+            return 0;
+        }
+
+        Sequence<Relocation>
+        File::relocations(const Atom & name)
+        {
+            std::map<Atom, Sequence<Relocation> >::const_iterator r(_imp->relocations.find(name));
+            if (_imp->relocations.end() != r)
+                return r->second;
+
+            unsigned index(_imp->section_table[name]);
+            if (0 == index)
+                throw InternalError("elf", "There is no section '" + name.str() + "'");
+
+            unsigned type(_imp->parameters(index)._type);
+            if ((SHT_RELA != type) && (SHT_REL != type))
+                throw InternalError("elf", "Section '" + name.str() + "' holds no relocations");
+
+            Data data(_imp->sections[index - 1].data());
+            unsigned entry_size(internal::entry_size(type));
+
+            Sequence<Relocation> result;
+            for (unsigned offset(0) ; offset + entry_size <= data.size() ; offset += entry_size)
+            {
+                Elf32_Rela entry;
+                entry.r_addend = 0;
+                data.read(offset, reinterpret_cast<char *>(&entry), entry_size);
+
+                result.append(Relocation(entry.r_offset, _imp->symbol(ELF32_R_SYM(entry.r_info)).name,
+                            ELF32_R_TYPE(entry.r_info), entry.r_addend));
+            }
+
+            _imp->relocations.insert(std::make_pair(name, result));
+
+            return result;
+        }
+
+        void
+        File::clear()
+        {
+            _imp->clear();
+        }
+
         const SectionTable &
         File::section_table() const
         {
             return _imp->section_table;
         }
 
+        unsigned
+        File::size()
+        {
+            return _imp->lay_out();
+        }
+
         void
-        File::write(const std::string & filename)
+        File::write(void * buffer, unsigned size)
         {
-            if (elf_version(EV_CURRENT) == EV_NONE)
-                throw InternalError("elf", "libelf version mismatch");
+            if (size < _imp->lay_out())
+                throw InternalError("elf", "Buffer of size '" + stringify(size) + "' is too small to hold the file");
 
-            int fd(::open(filename.c_str(), O_WRONLY | O_CREAT, 0777));
-            if (fd < 0)
-                throw InternalError("elf", "Could not open file '" + filename + "'");
+            _imp->copy(static_cast<char *>(buffer));
+        }
 
-            Elf * e(elf_begin(fd, ELF_C_WRITE, NULL));
-            if (0 == e)
-                throw Error("elf_begin");
+        void
+        File::write(std::vector<char> & buffer)
+        {
+            buffer.resize(_imp->lay_out());
 
-            Elf32_Ehdr * ehdr(elf32_newehdr(e));
-            if (0 == ehdr)
-                throw Error("elf32_newehdr");
+            _imp->copy(&buffer[0]);
+        }
 
-            ehdr->e_ident[EI_DATA] = _imp->_data;
-            ehdr->e_machine = _imp->_machine;
-            ehdr->e_type = _imp->_type;
-            ehdr->e_version = EV_CURRENT;
+        void
+        File::write(int fd)
+        {
+            _imp->lay_out();
 
-            _imp->sh_strtab.write(_imp->sections.front().data());
-            bool shstrab(true);
-            for (std::vector<Section>::iterator s(_imp->sections.begin()), s_end(_imp->sections.end()) ;
-                    s != s_end ; ++s)
-            {
-                Elf_Scn * scn(elf_newscn(e));
-                if (0 == scn)
-                    throw Error("elf_newscn");
-
-                Elf_Data * data(elf_newdata(scn));
-                if (0 == scn)
-                    throw Error("elf_newdata");
-
-                data->d_align = s->parameters()._alignment;
-                data->d_buf = const_cast<void *>(s->data().buffer());
-                data->d_off = 0;
-                data->d_size = s->data().size();
-                data->d_type = ELF_T_WORD;
-                data->d_version = EV_CURRENT;
-
-                Elf32_Shdr * shdr(elf32_getshdr(scn));
-                if (0 == shdr)
-                    throw Error("elf32_getshdr");
-
-                shdr->sh_entsize = 0;
-                shdr->sh_flags = s->parameters()._flags;
-                shdr->sh_link = s->parameters()._link;
-                shdr->sh_name = _imp->sh_strtab[s->name()];
-                shdr->sh_type = s->parameters()._type;
-
-                if (shstrab)
-                {
-                    ehdr->e_shstrndx = elf_ndxscn(scn);
-                    shstrab = false;
-                }
-            }
+            if (! internal::write_all(fd, _imp->pieces))
+                throw InternalError("elf", "Could not write to file descriptor '" + stringify(fd) + "'");
+        }
+
+        void
+        File::write(const std::string & filename)
+        {
+            _imp->lay_out();
+
+            int fd(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0777));
+            if (fd < 0)
+                throw InternalError("elf", "Could not open file '" + filename + "'");
 
-            if (elf_update(e, ELF_C_WRITE) < 0)
-                throw Error("elf_update");
+            bool written(internal::write_all(fd, _imp->pieces));
+            ::close(fd);
 
-            elf_end(e);
-            close(fd);
+            if (! written)
+                throw InternalError("elf", "Could not write file '" + filename + "'");
         }
     }
 }
@@ -20,12 +20,17 @@
 #ifndef GPU_GUARD_ELF_FILE_HH
 #define GPU_GUARD_ELF_FILE_HH 1
 
+#include <elf/relocation_table.hh>
 #include <elf/section.hh>
 #include <elf/string_table.hh>
+#include <elf/symbol.hh>
 #include <utils/private_implementation_pattern.hh>
 #include <utils/sequence.hh>
 #include <utils/wrapped_forward_iterator.hh>
 
+#include <string>
+#include <vector>
+
 namespace gpu
 {
     namespace elf
@@ -56,7 +61,15 @@ namespace gpu
             private:
                 File(const Parameters & parameters);
 
+                File(Implementation<elf::File> * imp);
+
             public:
+                /**
+                 * Open an object file.
+                 *
+                 * The sections borrow their bytes from a read-only mapping of
+                 * the file, and its tables are only decoded on first use.
+                 */
                 static File open(const std::string & filename);
 
                 static File create(const Parameters & parameters);
@@ -70,6 +83,32 @@ namespace gpu
 
                 Iterator end();
 
+                /// Return the first section of the given name, or end().
+                Iterator find(const Atom & name);
+
+                /**
+                 * Return the symbols of an opened file, in the order of its symbol table.
+                 *
+                 * Decoding interns every symbol name as an Atom, which lives as
+                 * long as the process. Use find_symbol() to look up single names.
+                 */
+                Sequence<Symbol> symbols();
+
+                /**
+                 * Return the named symbol of an opened file, or 0.
+                 *
+                 * With a .gnu.hash section, only the symbols on the chain of
+                 * the name's hash are decoded, and only hashed symbols, that
+                 * is defined globals, are found. Without one, the names are
+                 * compared in place. Either way, only the name of the symbol
+                 * found is interned. The result stays valid as long as the
+                 * file.
+                 */
+                const Symbol * find_symbol(const Atom & name);
+
+                /// Return the relocations in the named relocation section of an opened file.
+                Sequence<Relocation> relocations(const Atom & section);
+
                 void append(const Section & section);
 
                 void append(const Sequence<Section> & sections);
@@ -78,7 +117,43 @@ namespace gpu
 
                 const SectionTable & section_table() const;
 
+                /**
+                 * Remove all sections, as if the file had just been created
+                 * with its parameters.
+                 *
+                 * The allocations of the file are kept for the next write.
+                 */
+                void clear();
+
+                /// \name Output
+                /// \{
+
+                /**
+                 * Return the size of the file, as written by any of the write
+                 * methods.
+                 *
+                 * This lays out the file, compressing sections as needed.
+                 */
+                unsigned size();
+
+                /// Write the file into buffer, which needs to hold at least size() bytes.
+                void write(void * buffer, unsigned size);
+
+                /// Write the file into buffer, which is resized to fit.
+                void write(std::vector<char> & buffer);
+
+                /**
+                 * Write the file to an open file descriptor, such as a pipe or
+                 * a memfd.
+                 *
+                 * The descriptor is written at its current position, and is
+                 * left open.
+                 */
+                void write(int fd);
+
                 void write(const std::string & filename);
+
+                /// \}
         };
     }
 }
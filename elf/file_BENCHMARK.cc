@@ -0,0 +1,236 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <elf/error.hh>
+#include <elf/file.hh>
+#include <elf/string_table.hh>
+#include <utils/destringify.hh>
+#include <utils/exception.hh>
+#include <utils/stringify.hh>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <libelf.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace gpu;
+
+namespace
+{
+    double now()
+    {
+        struct timeval tv;
+        ::gettimeofday(&tv, 0);
+
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    struct SectionSpec
+    {
+        const char * name;
+
+        unsigned type;
+
+        unsigned flags;
+
+        unsigned alignment;
+
+        unsigned size;
+    };
+
+    /// The sections of a typical small kernel, after the .shstrtab that every file starts with.
+    const SectionSpec sections[] =
+    {
+        { ".shstrtab", SHT_STRTAB, SHF_STRINGS, 0, 0 },
+        { ".cf", SHT_PROGBITS, 0, 8, 64 },
+        { ".cf.rel", SHT_RELA, 0, 8, 36 },
+        { ".alu", SHT_PROGBITS, 0, 8, 512 },
+        { ".tex", SHT_PROGBITS, 0, 16, 0 },
+        { ".gpgpu.notes", SHT_NOTE, 0, 1, 28 },
+        { ".gpgpu.data", SHT_LOUSER + 0xffffff, 0, 1, 0 },
+        { ".strtab", SHT_STRTAB, SHF_STRINGS, 4, 51 },
+        { ".symtab", SHT_SYMTAB, 0, 4, 144 }
+    };
+
+    const unsigned section_count(sizeof(sections) / sizeof(sections[0]));
+
+    elf::File kernel_object()
+    {
+        elf::File result(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(0xA600)
+                    .type(ET_REL)));
+
+        for (unsigned i(1) ; i < section_count ; ++i)
+        {
+            elf::Section section(elf::Section::Parameters()
+                    .alignment(sections[i].alignment)
+                    .flags(sections[i].flags)
+                    .name(sections[i].name)
+                    .type(sections[i].type));
+            section.data().resize(sections[i].size);
+            result.append(section);
+        }
+
+        return result;
+    }
+
+    /// Write an object file through libelf, as elf::File::write used to.
+    void write_with_libelf(elf::File & file, const std::string & filename)
+    {
+        if (elf_version(EV_CURRENT) == EV_NONE)
+            throw InternalError("elf", "libelf version mismatch");
+
+        int fd(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0777));
+        if (fd < 0)
+            throw InternalError("elf", "Could not open file '" + filename + "'");
+
+        Elf * e(elf_begin(fd, ELF_C_WRITE, NULL));
+        if (0 == e)
+            throw elf::Error("elf_begin");
+
+        Elf32_Ehdr * ehdr(elf32_newehdr(e));
+        if (0 == ehdr)
+            throw elf::Error("elf32_newehdr");
+
+        ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+        ehdr->e_machine = 0xA600;
+        ehdr->e_type = ET_REL;
+        ehdr->e_version = EV_CURRENT;
+
+        elf::StringTable sh_strtab;
+        for (elf::File::Iterator s(file.begin()), s_end(file.end()) ; s != s_end ; ++s)
+        {
+            sh_strtab.insert(s->name());
+        }
+        sh_strtab.write(file.begin()->data());
+
+        unsigned i(0);
+        for (elf::File::Iterator s(file.begin()), s_end(file.end()) ; s != s_end ; ++s, ++i)
+        {
+            Elf_Scn * scn(elf_newscn(e));
+            if (0 == scn)
+                throw elf::Error("elf_newscn");
+
+            Elf_Data * data(elf_newdata(scn));
+            if (0 == data)
+                throw elf::Error("elf_newdata");
+
+            data->d_align = sections[i].alignment;
+            data->d_buf = const_cast<void *>(s->data().buffer());
+            data->d_off = 0;
+            data->d_size = s->data().size();
+            data->d_type = ELF_T_WORD;
+            data->d_version = EV_CURRENT;
+
+            Elf32_Shdr * shdr(elf32_getshdr(scn));
+            if (0 == shdr)
+                throw elf::Error("elf32_getshdr");
+
+            shdr->sh_entsize = 0;
+            shdr->sh_flags = sections[i].flags;
+            shdr->sh_link = 0;
+            shdr->sh_name = sh_strtab[s->name()];
+            shdr->sh_type = sections[i].type;
+
+            if (0 == i)
+                ehdr->e_shstrndx = elf_ndxscn(scn);
+        }
+
+        if (elf_update(e, ELF_C_WRITE) < 0)
+            throw elf::Error("elf_update");
+
+        elf_end(e);
+        ::close(fd);
+    }
+
+    std::vector<char> contents(const std::string & filename)
+    {
+        std::ifstream input(filename.c_str(), std::ios::binary);
+
+        return std::vector<char>((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    std::string mode("native");
+    unsigned objects(10000);
+
+    if (argc > 1)
+        mode = argv[1];
+
+    if (argc > 2)
+        objects = destringify<unsigned>(argv[2]);
+
+    if ((argc > 3) || (("native" != mode) && ("libelf" != mode)))
+    {
+        std::cerr << "Usage: " << argv[0] << " [native|libelf] [OBJECTS]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const std::string native_name("file_BENCHMARK_native.output"), libelf_name("file_BENCHMARK_libelf.output");
+
+        // both writers must produce the same bytes
+        elf::File reference(kernel_object());
+        reference.write(native_name);
+        write_with_libelf(reference, libelf_name);
+        bool identical(contents(native_name) == contents(libelf_name));
+
+        // build the objects untimed, as an assembler would have done
+        std::vector<elf::File> files;
+        files.reserve(objects);
+        for (unsigned i(0) ; i < objects ; ++i)
+            files.push_back(kernel_object());
+
+        double start(now());
+
+        for (std::vector<elf::File>::iterator f(files.begin()), f_end(files.end()) ; f != f_end ; ++f)
+        {
+            if ("native" == mode)
+                f->write(native_name);
+            else
+                write_with_libelf(*f, libelf_name);
+        }
+
+        double stop(now());
+
+        std::cout << "mode: " << mode << std::endl;
+        std::cout << "objects: " << objects << std::endl;
+        std::cout << "time: " << (stop - start) << " s" << std::endl;
+        std::cout << "per object: " << (stop - start) / objects * 1e6 << " us" << std::endl;
+        std::cout << "identical output: " << (identical ? "yes" : "no") << std::endl;
+    }
+    catch (Exception & e)
+    {
+        std::cerr << "Caught exception: " << e.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -19,12 +19,20 @@
 
 #include <tests/tests.hh>
 #include <elf/file.hh>
+#include <elf/symbol_table.hh>
+#include <utils/exception.hh>
+#include <utils/mapped_file.hh>
+#include <utils/sequence-impl.hh>
 #include <utils/stringify.hh>
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <vector>
 
 #include <elf.h>
+#include <unistd.h>
 
 using namespace gpu;
 using namespace tests;
@@ -45,8 +53,98 @@ struct ElfFileWriteTest :
                     .machine(EM_PPC)
                     .type(ET_REL)));
 
+        elf::Section text(elf::Section::Parameters()
+                    .alignment(16)
+                    .flags(SHF_ALLOC | SHF_EXECINSTR)
+                    .name(".text")
+                    .type(SHT_PROGBITS));
+        text.data().resize(5);
+        text.data().write(0, "\x01\x02\x03\x04\x05", 5);
+        file.append(text);
+
+        elf::Section rela(elf::Section::Parameters()
+                    .alignment(4)
+                    .link(0)
+                    .name(".rela.text")
+                    .type(SHT_RELA));
+        rela.data().resize(sizeof(Elf32_Rela));
+        file.append(rela);
+
+        TEST_CHECK_EQUAL(file.index(text), 2u);
+        TEST_CHECK_EQUAL(file.index(rela), 3u);
+        TEST_CHECK_THROWS(file.append(text), InternalError);
+        TEST_CHECK_THROWS(file.index(elf::Section(elf::Section::Parameters().name(".data"))), InternalError);
 
         file.write(filename);
+
+        std::ifstream input(filename.c_str(), std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        TEST_CHECK(bytes.size() > sizeof(Elf32_Ehdr));
+
+        Elf32_Ehdr ehdr;
+        std::memcpy(&ehdr, &bytes[0], sizeof(Elf32_Ehdr));
+        TEST_CHECK(0 == std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG));
+        TEST_CHECK_EQUAL(unsigned(ehdr.e_ident[EI_CLASS]), unsigned(ELFCLASS32));
+        TEST_CHECK_EQUAL(ehdr.e_machine, EM_PPC);
+        TEST_CHECK_EQUAL(ehdr.e_shnum, 4);
+        TEST_CHECK_EQUAL(ehdr.e_shstrndx, 1);
+        TEST_CHECK_EQUAL(ehdr.e_shoff % 4, 0u);
+        TEST_CHECK_EQUAL(bytes.size(), ehdr.e_shoff + 4 * sizeof(Elf32_Shdr));
+
+        std::vector<Elf32_Shdr> shdrs(4);
+        std::memcpy(&shdrs[0], &bytes[ehdr.e_shoff], 4 * sizeof(Elf32_Shdr));
+
+        // sections follow the header in order, each at its alignment
+        TEST_CHECK_EQUAL(shdrs[1].sh_offset, sizeof(Elf32_Ehdr));
+        TEST_CHECK_EQUAL(shdrs[2].sh_offset % 16, 0u);
+        TEST_CHECK(shdrs[2].sh_offset >= shdrs[1].sh_offset + shdrs[1].sh_size);
+        TEST_CHECK_EQUAL(shdrs[2].sh_size, 5u);
+        TEST_CHECK_EQUAL(shdrs[2].sh_addralign, 16u);
+        TEST_CHECK_EQUAL(shdrs[3].sh_offset, shdrs[2].sh_offset + 8);
+        TEST_CHECK_EQUAL(shdrs[3].sh_entsize, sizeof(Elf32_Rela));
+        TEST_CHECK_EQUAL(unsigned(bytes[shdrs[2].sh_offset + 4]), 5u);
+        TEST_CHECK_EQUAL(std::string(&bytes[shdrs[1].sh_offset + shdrs[2].sh_name]), ".text");
+
+        // and libelf reads the result back
+        elf::File copy(elf::File::open(filename));
+        std::vector<std::string> names;
+        for (elf::File::Iterator i(copy.begin()), i_end(copy.end()) ; i != i_end ; ++i)
+        {
+            names.push_back(i->name().str());
+        }
+
+        TEST_CHECK(names.end() != std::find(names.begin(), names.end(), ".text"));
+        TEST_CHECK_EQUAL(names.back(), ".rela.text");
+
+        // writing into memory and to a pipe produces the same bytes
+        TEST_CHECK_EQUAL(file.size(), unsigned(bytes.size()));
+
+        std::vector<char> buffer;
+        file.write(buffer);
+        TEST_CHECK(bytes == buffer);
+        TEST_CHECK_THROWS(file.write(&buffer[0], buffer.size() - 1), InternalError);
+
+        int fds[2];
+        TEST_CHECK_EQUAL(::pipe(fds), 0);
+        file.write(fds[1]);
+        ::close(fds[1]);
+
+        std::vector<char> piped(bytes.size() + 1);
+        unsigned size(0);
+        for (ssize_t count(1) ; count > 0 ; size += count)
+            count = std::max<ssize_t>(::read(fds[0], &piped[size], piped.size() - size), 0);
+        ::close(fds[0]);
+
+        piped.resize(size);
+        TEST_CHECK(bytes == piped);
+
+        // a cleared file starts over
+        file.clear();
+        TEST_CHECK_EQUAL(std::distance(file.begin(), file.end()), 1);
+        file.append(text);
+        TEST_CHECK_EQUAL(file.index(text), 2u);
+        file.write(buffer);
+        TEST_CHECK(buffer.size() < bytes.size());
     }
 } elf_file_write_test;
 
@@ -66,9 +164,154 @@ struct ElfFileReadTest :
         std::vector<std::string> section_names;
         for (elf::File::Iterator i(file.begin()), i_end(file.end()) ; i != i_end ; ++i)
         {
-            section_names.push_back(i->name());
+            section_names.push_back(i->name().str());
         }
 
+        TEST_CHECK_EQUAL(section_names.size(), 9u);
+        TEST_CHECK_EQUAL(section_names.front(), ".shstrtab");
         TEST_CHECK(section_names.end() != find(section_names.begin(), section_names.end(), ".alu"));
+
+        // section data is read in place
+        MappedFile raw(filename);
+        elf::File::Iterator alu(file.find(".alu"));
+        TEST_CHECK(file.end() != alu);
+        TEST_CHECK_EQUAL(alu->data().size(), 32u);
+        TEST_CHECK(0 == std::memcmp(alu->data().buffer(), raw.begin() + 0xd8, 32));
+        TEST_CHECK(file.end() == file.find(".data"));
+
+        Sequence<elf::Symbol> symbols(file.symbols());
+        TEST_CHECK_EQUAL(symbols.size(), 8u);
+        TEST_CHECK_EQUAL(symbols.first().name, Atom(".cf"));
+        TEST_CHECK_EQUAL(symbols.last().name, Atom("input"));
+
+        const elf::Symbol * square(file.find_symbol("square"));
+        TEST_CHECK(0 != square);
+        TEST_CHECK_EQUAL(square->section, Atom(".alu"));
+        TEST_CHECK_EQUAL(square->size, 32u);
+        TEST_CHECK_EQUAL(square->type, unsigned(STT_FUNC));
+        TEST_CHECK(0 == file.find_symbol("cube"));
+
+        Sequence<elf::Relocation> relocations(file.relocations(".cf.rel"));
+        TEST_CHECK_EQUAL(relocations.size(), 4u);
+        TEST_CHECK_EQUAL(relocations.first().symbol, Atom("main"));
+        TEST_CHECK_EQUAL(relocations.first().addend, 0x20u);
+        TEST_CHECK_EQUAL(relocations.first().type, 6u);
+        TEST_CHECK_EQUAL(relocations.last().offset, 0x18u);
+        TEST_CHECK_THROWS(file.relocations(".alu"), InternalError);
+
+        // changing borrowed data copies it first
+        alu->data().write(0, "\xff", 1);
+        TEST_CHECK_EQUAL(unsigned(static_cast<const unsigned char *>(alu->data().buffer())[0]), 0xffu);
+        TEST_CHECK(0xff != static_cast<unsigned char>(raw.begin()[0xd8]));
+
+        TEST_CHECK_THROWS(elf::File::open(stringify(GPU_SRCDIR) + "/elf/file_TEST.cc"), InternalError);
     }
 } elf_file_read_test;
+
+struct ElfFileSymbolHashTest :
+    public Test
+{
+    ElfFileSymbolHashTest() :
+        Test("elf_file_symbol_hash_test")
+    {
+    }
+
+    void run()
+    {
+        std::string filename(stringify(GPU_BUILDDIR) + "/elf/file_TEST_hash.output");
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(EM_PPC)
+                    .type(ET_REL)));
+
+        elf::Section text(elf::Section::Parameters().alignment(4).name(".text").type(SHT_PROGBITS));
+        file.append(text);
+
+        elf::StringTable strtab;
+        elf::SymbolTable symtab(strtab);
+        symtab.enable_hash();
+        for (unsigned i(0) ; i < 100 ; ++i)
+        {
+            elf::Symbol symbol("kernel_" + stringify(i));
+            symbol.bind = STB_GLOBAL;
+            symbol.section = ".text";
+            symbol.value = 4 * i;
+            symtab.append(symbol);
+        }
+
+        elf::Section strtab_section(elf::Section::Parameters().alignment(4).name(".strtab").type(SHT_STRTAB));
+        file.append(strtab_section);
+        elf::Section symtab_section(elf::Section::Parameters().alignment(4).link(file.index(strtab_section))
+                .name(".symtab").type(SHT_SYMTAB));
+        file.append(symtab_section);
+        elf::Section hash_section(elf::Section::Parameters().alignment(4).link(file.index(symtab_section))
+                .name(".gnu.hash").type(SHT_GNU_HASH));
+        file.append(hash_section);
+
+        symtab.write(file.section_table(), symtab_section.data());
+        symtab.write_hash(hash_section.data());
+        strtab.write(strtab_section.data());
+        file.write(filename);
+
+        elf::File copy(elf::File::open(filename));
+        const elf::Symbol * symbol(copy.find_symbol("kernel_42"));
+        TEST_CHECK(0 != symbol);
+        TEST_CHECK_EQUAL(symbol->name, Atom("kernel_42"));
+        TEST_CHECK_EQUAL(symbol->value, 168u);
+        TEST_CHECK_EQUAL(symbol->section, Atom(".text"));
+        TEST_CHECK(0 == copy.find_symbol("kernel_100"));
+        TEST_CHECK_EQUAL(copy.symbols().size(), 100u);
+    }
+} elf_file_symbol_hash_test;
+
+struct ElfFileDuplicateSectionTest :
+    public Test
+{
+    ElfFileDuplicateSectionTest() :
+        Test("elf_file_duplicate_section_test")
+    {
+    }
+
+    static elf::Section section(const std::string & name, const char * contents)
+    {
+        elf::Section result(elf::Section::Parameters().alignment(1).name(name).type(SHT_PROGBITS));
+        result.data().resize(1);
+        result.data().write(0, contents, 1);
+
+        return result;
+    }
+
+    void run()
+    {
+        std::string filename(stringify(GPU_BUILDDIR) + "/elf/file_TEST_duplicate.output");
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(EM_PPC)
+                    .type(ET_REL)));
+        file.append(section(".a", "A"));
+        file.append(section(".x", "X"));
+        file.append(section(".b", "B"));
+
+        // name the second section .a as well, as groups of sections do
+        std::vector<char> bytes;
+        file.write(bytes);
+
+        Elf32_Ehdr ehdr;
+        std::memcpy(&ehdr, &bytes[0], sizeof(Elf32_Ehdr));
+        Elf32_Shdr * shdrs(reinterpret_cast<Elf32_Shdr *>(&bytes[ehdr.e_shoff]));
+        shdrs[3].sh_name = shdrs[2].sh_name;
+
+        std::ofstream output(filename.c_str(), std::ios_base::binary);
+        output.write(&bytes[0], bytes.size());
+        output.close();
+
+        // a repeated name finds its first section, and does not shift the others
+        elf::File copy(elf::File::open(filename));
+        TEST_CHECK_EQUAL(std::distance(copy.begin(), copy.end()), 4);
+        TEST_CHECK_EQUAL(*static_cast<const char *>(copy.find(".a")->data().buffer()), 'A');
+        TEST_CHECK_EQUAL(*static_cast<const char *>(copy.find(".b")->data().buffer()), 'B');
+        TEST_CHECK_EQUAL(copy.find(".shstrtab")->name(), Atom(".shstrtab"));
+        TEST_CHECK_EQUAL(copy.index(*copy.find(".b")), 4u);
+        TEST_CHECK(copy.end() == copy.find(".x"));
+    }
+} elf_file_duplicate_section_test;
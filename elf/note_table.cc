@@ -51,10 +51,7 @@ namespace gpu
 
         std::vector<elf::Note> entries;
 
-        unsigned size;
-
-        Implementation() :
-            size(0)
+        Implementation()
         {
         }
     };
@@ -81,37 +78,27 @@ namespace gpu
         void
         NoteTable::append(const Note & note)
         {
-            _imp->size += sizeof(Elf32_Nhdr)
-                + multiple_of_four(Implementation<NoteTable>::name.size())
-                + multiple_of_four(note.description.size());
             _imp->entries.push_back(note);
         }
 
         void
         NoteTable::write(Data data)
         {
-            const unsigned name_size(multiple_of_four(Implementation<NoteTable>::name.size()));
-            data.resize(_imp->size);
+            const std::string & name(Implementation<NoteTable>::name);
 
-            unsigned offset(0);
+            DataWriter writer(data);
             for (std::vector<Note>::const_iterator i(_imp->entries.begin()), i_end(_imp->entries.end()) ;
                     i != i_end ; ++i)
             {
-                unsigned desc_size(multiple_of_four(i->description.size()));
-                Elf32_Nhdr nhdr;
-
-                nhdr.n_namesz = name_size;
-                nhdr.n_descsz = desc_size;
-                nhdr.n_type = i->type;
-
-                data.write(offset, reinterpret_cast<char *>(&nhdr), sizeof(nhdr));
-                offset += sizeof(nhdr);
+                writer.put32(multiple_of_four(name.size()));
+                writer.put32(multiple_of_four(i->description.size()));
+                writer.put32(i->type);
 
-                data.write(offset, Implementation<NoteTable>::name.c_str(), Implementation<NoteTable>::name.size());
-                offset += name_size;
+                writer.put(name.c_str(), name.size());
+                writer.align(4);
 
-                data.write(offset, i->description.c_str(), i->description.size());
-                offset += desc_size;
+                writer.put(i->description.c_str(), i->description.size());
+                writer.align(4);
             }
         }
     }
@@ -46,7 +46,7 @@ namespace gpu
 
     namespace elf
     {
-        Relocation::Relocation(unsigned offset, const std::string & symbol, unsigned type, unsigned addend) :
+        Relocation::Relocation(unsigned offset, const Atom & symbol, unsigned type, unsigned addend) :
             addend(addend),
             offset(offset),
             symbol(symbol),
@@ -68,7 +68,7 @@ namespace gpu
         {
             unsigned symbol_index(_imp->symtab[r.symbol]);
             if (0 == symbol_index)
-                throw InternalError("elf", "Unresolved symbol '" + r.symbol + "'");
+                throw InternalError("elf", "Unresolved symbol '" + r.symbol.str() + "'");
 
             Elf32_Rela relocation;
             relocation.r_addend = r.addend;
@@ -81,10 +81,15 @@ namespace gpu
         void
         RelocationTable::write(Data data)
         {
-            unsigned size(_imp->entries.size() * sizeof(Elf32_Rela));
+            DataWriter writer(data);
 
-            data.resize(size);
-            data.write(0, reinterpret_cast<char *>(&_imp->entries[0]), size);
+            for (std::vector<Elf32_Rela>::const_iterator r(_imp->entries.begin()), r_end(_imp->entries.end()) ;
+                    r != r_end ; ++r)
+            {
+                writer.put32(r->r_offset);
+                writer.put32(r->r_info);
+                writer.put32(r->r_addend);
+            }
         }
     }
 }
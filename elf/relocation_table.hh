@@ -22,10 +22,9 @@
 
 #include <elf/data.hh>
 #include <elf/symbol_table.hh>
+#include <utils/atom.hh>
 #include <utils/private_implementation_pattern.hh>
 
-#include <string>
-
 namespace gpu
 {
     namespace elf
@@ -36,11 +35,11 @@ namespace gpu
 
             unsigned offset;
 
-            std::string symbol;
+            Atom symbol;
 
             unsigned type;
 
-            Relocation(unsigned offset, const std::string & symbol, unsigned type, unsigned addend);
+            Relocation(unsigned offset, const Atom & symbol, unsigned type, unsigned addend);
         };
 
         class RelocationTable :
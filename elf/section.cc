@@ -17,12 +17,14 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <elf/compression.hh>
 #include <elf/section.hh>
 #include <utils/exception.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 
-#include <map>
-#include <string>
+#include <tr1/unordered_map>
+
+#include <elf.h>
 
 namespace gpu
 {
@@ -32,9 +34,9 @@ namespace gpu
     {
         elf::Data data;
 
-        Implementation(const elf::Section::Parameters & parameters) :
+        Implementation(const elf::Section::Parameters & parameters, const elf::Data & data) :
             elf::Section::Parameters(parameters),
-            data(0)
+            data(data)
         {
         }
     };
@@ -42,15 +44,30 @@ namespace gpu
     template <>
     struct Implementation<elf::SectionTable>
     {
-        std::map<std::string, unsigned> sections;
+        // section indices by atom id, the first one for a repeated name
+        std::tr1::unordered_map<unsigned, unsigned> sections;
+
+        // the number of sections appended so far, including those with repeated names
+        unsigned count;
 
-        Implementation()
+        Implementation() :
+            count(0)
         {
         }
     };
 
     namespace elf
     {
+        Section::Parameters::Parameters() :
+            _alignment(0),
+            _compression(0),
+            _flags(0),
+            _info(0),
+            _link(0),
+            _type(0)
+        {
+        }
+
         Section::Parameters &
         Section::Parameters::alignment(unsigned alignment)
         {
@@ -59,6 +76,14 @@ namespace gpu
             return *this;
         }
 
+        Section::Parameters &
+        Section::Parameters::compression(unsigned compression)
+        {
+            _compression = compression;
+
+            return *this;
+        }
+
         Section::Parameters &
         Section::Parameters::flags(unsigned flags)
         {
@@ -67,6 +92,14 @@ namespace gpu
             return *this;
         }
 
+        Section::Parameters &
+        Section::Parameters::info(unsigned info)
+        {
+            _info = info;
+
+            return *this;
+        }
+
         Section::Parameters &
         Section::Parameters::link(unsigned link)
         {
@@ -76,7 +109,7 @@ namespace gpu
         }
 
         Section::Parameters &
-        Section::Parameters::name(const std::string & name)
+        Section::Parameters::name(const Atom & name)
         {
             _name = name;
 
@@ -92,7 +125,12 @@ namespace gpu
         }
 
         Section::Section(const Parameters & parameters) :
-            PrivateImplementationPattern<elf::Section>(new Implementation<elf::Section>(parameters))
+            PrivateImplementationPattern<elf::Section>(new Implementation<elf::Section>(parameters, Data(0)))
+        {
+        }
+
+        Section::Section(const Parameters & parameters, const Data & data) :
+            PrivateImplementationPattern<elf::Section>(new Implementation<elf::Section>(parameters, data))
         {
         }
 
@@ -103,16 +141,34 @@ namespace gpu
         Data
         Section::data()
         {
+            if (_imp->_flags & SHF_COMPRESSED)
+            {
+                _imp->data = decompress(_imp->data, _imp->_compression, _imp->_alignment);
+                _imp->_flags &= ~SHF_COMPRESSED;
+            }
+
             return _imp->data;
         }
 
+        void
+        Section::compression(unsigned compression)
+        {
+            _imp->_compression = compression;
+        }
+
+        void
+        Section::info(unsigned info)
+        {
+            _imp->_info = info;
+        }
+
         void
         Section::link(unsigned link)
         {
             _imp->_link = link;
         }
 
-        std::string
+        Atom
         Section::name() const
         {
             return _imp->_name;
@@ -134,15 +190,23 @@ namespace gpu
         }
 
         void
-        SectionTable::append(const std::string & section)
+        SectionTable::append(const Atom & section)
+        {
+            ++_imp->count;
+            _imp->sections.insert(std::make_pair(section.id(), _imp->count));
+        }
+
+        void
+        SectionTable::clear()
         {
-            _imp->sections.insert(std::pair<const std::string, unsigned>(section, _imp->sections.size() + 1));
+            _imp->sections.clear();
+            _imp->count = 0;
         }
 
         unsigned
-        SectionTable::operator[] (const std::string & section) const
+        SectionTable::operator[] (const Atom & section) const
         {
-            std::map<std::string, unsigned>::const_iterator s(_imp->sections.find(section));
+            std::tr1::unordered_map<unsigned, unsigned>::const_iterator s(_imp->sections.find(section.id()));
             if (_imp->sections.end() == s)
                 return 0;
 
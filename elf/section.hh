@@ -21,10 +21,9 @@
 #define GPU_GUARD_ELF_SECTION_HH 1
 
 #include <elf/data.hh>
+#include <utils/atom.hh>
 #include <utils/private_implementation_pattern.hh>
 
-#include <string>
-
 namespace gpu
 {
     namespace elf
@@ -40,38 +39,73 @@ namespace gpu
                     protected:
                         unsigned _alignment;
 
+                        unsigned _compression;
+
                         unsigned _flags;
 
+                        unsigned _info;
+
                         unsigned _link;
 
-                        std::string _name;
+                        Atom _name;
 
                         unsigned _type;
 
                     public:
                         friend class File;
+                        friend class Implementation<elf::File>;
                         friend class Section;
 
+                        Parameters();
+
                         Parameters & alignment(unsigned);
 
+                        /**
+                         * Compress the section when it is written, using one
+                         * of the ELFCOMPRESS_* types, or 0 for none.
+                         *
+                         * Sections that would not get any smaller are written
+                         * uncompressed. See elf/compression.hh.
+                         */
+                        Parameters & compression(unsigned);
+
                         Parameters & flags(unsigned);
 
+                        Parameters & info(unsigned);
+
                         Parameters & link(unsigned);
 
-                        Parameters & name(const std::string &);
+                        Parameters & name(const Atom &);
 
                         Parameters & type(unsigned);
                 };
 
+            private:
+                Section(const Parameters & parameters, const Data & data);
+
+            public:
+                friend class File;
+
                 Section(const Parameters & parameters);
 
                 ~Section();
 
+                /**
+                 * Return the contents of the section.
+                 *
+                 * The contents of a compressed section that has been read
+                 * are decompressed on first access. The section then keeps
+                 * its compression type for writing, but loses SHF_COMPRESSED.
+                 */
                 Data data();
 
+                void compression(unsigned);
+
+                void info(unsigned);
+
                 void link(unsigned);
 
-                std::string name() const;
+                Atom name() const;
 
                 const Parameters & parameters() const;
         };
@@ -82,7 +116,9 @@ namespace gpu
             private:
                 SectionTable();
 
-                void append(const std::string &);
+                void append(const Atom &);
+
+                void clear();
 
             public:
                 friend class File;
@@ -90,7 +126,7 @@ namespace gpu
 
                 ~SectionTable();
 
-                unsigned operator[] (const std::string &) const;
+                unsigned operator[] (const Atom &) const;
         };
     }
 }
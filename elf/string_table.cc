@@ -23,20 +23,87 @@
 #include <utils/stringify.hh>
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
+#include <tr1/unordered_map>
 
 namespace gpu
 {
     template <>
     struct Implementation<elf::StringTable>
     {
-        unsigned offset;
+        // strings that still await their offsets, in order of insertion
+        std::vector<Atom> pending;
 
-        std::vector<std::pair<std::string, unsigned> > entries;
+        // the offsets of all strings, by atom id
+        std::tr1::unordered_map<unsigned, unsigned> offsets;
+
+        // the offsets of the strings of a table that has been read, by text, so that they need not be interned
+        std::tr1::unordered_map<std::string, unsigned> read_offsets;
+
+        // the laid out table, valid once finalized
+        std::string contents;
+
+        bool finalized;
+
+        // a table that has been read, and is used in place until it changes
+        elf::Data source;
+
+        bool borrowed;
 
         Implementation() :
-            offset(1) // let the first char in a string table always be '\0'
+            contents(1, '\0'), // let the first char in a string table always be '\0'
+            finalized(false),
+            borrowed(false)
+        {
+        }
+
+        /// Copy a table that has been read, and index its strings.
+        void materialize()
+        {
+            if (! borrowed)
+                return;
+
+            const char * begin(static_cast<const char *>(source.buffer()));
+            contents.assign(begin, begin + source.size());
+            if (contents.empty() || ('\0' != contents[contents.size() - 1]))
+                contents.push_back('\0');
+
+            source = elf::Data();
+            borrowed = false;
+
+            unsigned current_offset(1);
+            while (current_offset < contents.size())
+            {
+                std::string s(contents.c_str() + current_offset);
+                if (! s.empty())
+                    read_offsets.insert(std::make_pair(s, current_offset));
+
+                current_offset += s.size() + 1;
+            }
+        }
+
+        /// Return the offset of a string that has already been laid out or read, or 0.
+        const unsigned * find(const Atom & s) const
         {
+            std::tr1::unordered_map<unsigned, unsigned>::const_iterator o(offsets.find(s.id()));
+            if (offsets.end() != o)
+                return &o->second;
+
+            if (read_offsets.empty())
+                return 0;
+
+            std::tr1::unordered_map<std::string, unsigned>::const_iterator r(read_offsets.find(s.str()));
+            if (read_offsets.end() != r)
+                return &r->second;
+
+            return 0;
+        }
+
+        void append(const Atom & s)
+        {
+            offsets[s.id()] = contents.size();
+            contents.append(s.str().c_str(), s.str().size() + 1);
         }
     };
 
@@ -44,35 +111,27 @@ namespace gpu
     {
         namespace internal
         {
-            struct StringComparator
+            struct ReverseStringComparator
             {
-                const std::string reference;
+                const std::vector<Atom> & strings;
 
-                StringComparator(const std::string & s) :
-                    reference(s)
+                ReverseStringComparator(const std::vector<Atom> & strings) :
+                    strings(strings)
                 {
                 }
 
-                bool operator() (const std::pair<const std::string, unsigned> & entry)
+                bool operator() (unsigned a, unsigned b) const
                 {
-                    return entry.first == reference;
+                    const std::string & x(strings[a].str()), & y(strings[b].str());
+
+                    return std::lexicographical_compare(x.rbegin(), x.rend(), y.rbegin(), y.rend());
                 }
             };
 
-            struct OffsetComparator
+            bool has_suffix(const std::string & s, const std::string & suffix)
             {
-                const unsigned reference;
-
-                OffsetComparator(unsigned o) :
-                    reference(o)
-                {
-                }
-
-                bool operator() (const std::pair<const std::string, unsigned> & entry)
-                {
-                    return entry.second == reference;
-                }
-            };
+                return (s.size() >= suffix.size()) && std::equal(suffix.rbegin(), suffix.rend(), s.rbegin());
+            }
         }
 
         StringTable::StringTable() :
@@ -84,62 +143,148 @@ namespace gpu
         {
         }
 
-        unsigned
-        StringTable::operator[] (const std::string & s)
+        void
+        StringTable::insert(const Atom & s)
         {
-            std::vector<std::pair<std::string, unsigned> >::const_iterator e(std::find_if(
-                        _imp->entries.begin(), _imp->entries.end(), internal::StringComparator(s)));
-            if (_imp->entries.end() != e)
-                return e->second;
+            if (s.empty())
+                return;
 
-            unsigned result(_imp->offset);
+            _imp->materialize();
 
-            _imp->entries.push_back(std::pair<std::string, unsigned>(s, result));
-            _imp->offset += s.size() + 1;
+            if (0 != _imp->find(s))
+                return;
 
-            return result;
+            if (_imp->finalized)
+            {
+                _imp->append(s);
+            }
+            else
+            {
+                _imp->offsets[s.id()] = 0;
+                _imp->pending.push_back(s);
+            }
         }
 
-        std::string
-        StringTable::operator[] (unsigned o)
+        void
+        StringTable::finalize()
         {
-            std::vector<std::pair<std::string, unsigned> >::const_iterator e(std::find_if(
-                        _imp->entries.begin(), _imp->entries.end(), internal::OffsetComparator(o)));
-            if (_imp->entries.end() != e)
-                return e->first;
+            if (_imp->finalized)
+                return;
 
-            throw InternalError("elf", "There is no string at offset '" + stringify(o) + "'");
+            const std::vector<Atom> & strings(_imp->pending);
+
+            // Sorted by their reversed text, every string directly precedes
+            // the strings that end in it, longest last.
+            std::vector<unsigned> order(strings.size());
+            for (unsigned i(0) ; i < order.size() ; ++i)
+                order[i] = i;
+
+            std::sort(order.begin(), order.end(), internal::ReverseStringComparator(strings));
+
+            // host[i] is the string whose bytes string i reuses
+            std::vector<unsigned> host(strings.size());
+            for (unsigned i(order.size()) ; i > 0 ; --i)
+            {
+                unsigned current(order[i - 1]);
+                host[current] = current;
+
+                if (i == order.size())
+                    continue;
+
+                unsigned previous(order[i]);
+                if (internal::has_suffix(strings[previous].str(), strings[current].str()))
+                    host[current] = host[previous];
+            }
+
+            for (unsigned i(0) ; i < strings.size() ; ++i)
+            {
+                if (host[i] == i)
+                    _imp->append(strings[i]);
+            }
+
+            for (unsigned i(0) ; i < strings.size() ; ++i)
+            {
+                if (host[i] == i)
+                    continue;
+
+                const Atom & h(strings[host[i]]);
+                _imp->offsets[strings[i].id()] = _imp->offsets[h.id()] + h.str().size() - strings[i].str().size();
+            }
+
+            _imp->pending.clear();
+            _imp->finalized = true;
         }
 
-        void
-        StringTable::read(const Data & data)
+        unsigned
+        StringTable::operator[] (const Atom & s)
         {
-            std::vector<char> raw_data(data.size());
-            data.read(0, &raw_data[0], data.size());
+            if (s.empty())
+                return 0;
 
-            unsigned current_offset(1);
-            while (current_offset < raw_data.size())
+            insert(s);
+            finalize();
+
+            return *_imp->find(s);
+        }
+
+        std::string
+        StringTable::operator[] (unsigned o)
+        {
+            finalize();
+
+            if (_imp->borrowed)
             {
-                std::string s(&raw_data[current_offset]);
-                _imp->entries.push_back(std::pair<std::string, unsigned>(s, current_offset));
-                current_offset += s.size() + 1;
+                const char * begin(static_cast<const char *>(_imp->source.buffer()));
+                unsigned size(_imp->source.size());
+                if (o >= size)
+                    throw InternalError("elf", "There is no string at offset '" + stringify(o) + "'");
+
+                const char * end(static_cast<const char *>(std::memchr(begin + o, '\0', size - o)));
+                if (0 == end)
+                    throw InternalError("elf", "The string at offset '" + stringify(o) + "' is not terminated");
+
+                return std::string(begin + o, end);
             }
 
-            _imp->offset = current_offset;
+            if (o >= _imp->contents.size())
+                throw InternalError("elf", "There is no string at offset '" + stringify(o) + "'");
+
+            return std::string(_imp->contents.c_str() + o);
+        }
+
+        void
+        StringTable::read(const Data & data)
+        {
+            // strings are looked up in place, and only indexed once the table changes
+            _imp->pending.clear();
+            _imp->offsets.clear();
+            _imp->read_offsets.clear();
+            _imp->contents.clear();
+            _imp->source = data;
+            _imp->borrowed = true;
+            _imp->finalized = true;
         }
 
         void
         StringTable::write(Data data)
         {
-            data.resize(_imp->offset);
+            _imp->materialize();
+            finalize();
 
-            unsigned current_offset(1);
-            for (std::vector<std::pair<std::string, unsigned> >::const_iterator e(_imp->entries.begin()), e_end(_imp->entries.end()) ;
-                e != e_end ; ++e)
-            {
-                data.write(current_offset, e->first.c_str(), e->first.size());
-                current_offset += e->first.size() + 1;
-            }
+            DataWriter writer(data);
+            writer.put(_imp->contents.data(), _imp->contents.size());
+        }
+
+        void
+        StringTable::clear()
+        {
+            _imp->pending.clear();
+            _imp->offsets.clear();
+            _imp->read_offsets.clear();
+            _imp->contents.assign(1, '\0');
+            _imp->finalized = false;
+            _imp->source = Data();
+            _imp->borrowed = false;
         }
     }
 }
@@ -21,6 +21,7 @@
 #define GPU_GUARD_ELF_STRING_TABLE_HH 1
 
 #include <elf/data.hh>
+#include <utils/atom.hh>
 #include <utils/private_implementation_pattern.hh>
 
 #include <string>
@@ -29,6 +30,16 @@ namespace gpu
 {
     namespace elf
     {
+        /**
+         * StringTable holds the contents of an ELF string table section.
+         *
+         * Offsets are laid out when the table is finalized, which happens at
+         * the latest when the first offset is asked for. All strings inserted
+         * until then are tail merged: a string that is a suffix of another one
+         * shares the longer string's bytes. Strings added after finalization
+         * are appended as they are. Copies of a StringTable share the same
+         * strings.
+         */
         class StringTable :
             public PrivateImplementationPattern<elf::StringTable>
         {
@@ -37,13 +48,25 @@ namespace gpu
 
                 ~StringTable();
 
-                unsigned operator[] (const std::string & item);
+                /// Add a string without asking for its offset.
+                void insert(const Atom & item);
 
+                /// Lay out all strings inserted so far, merging common suffixes.
+                void finalize();
+
+                /// Add a string if necessary, and return its offset.
+                unsigned operator[] (const Atom & item);
+
+                /// Return the string at the given offset.
                 std::string operator[] (unsigned offset);
 
+                /// Use the contents of an existing table, in place until the table changes.
                 void read(const Data &);
 
                 void write(Data data);
+
+                /// Remove all strings, keeping the allocations for reuse.
+                void clear();
         };
     }
 }
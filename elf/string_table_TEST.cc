@@ -18,7 +18,9 @@
  */
 
 #include <tests/tests.hh>
+#include <elf/data.hh>
 #include <elf/string_table.hh>
+#include <utils/exception.hh>
 #include <utils/stringify.hh>
 
 #include <string>
@@ -49,3 +51,95 @@ struct ElfStringTableTest :
         TEST_CHECK_EQUAL(string_table["!"], 16);
     }
 } elf_string_table_test;
+
+struct ElfStringTableMergeTest :
+    public Test
+{
+    ElfStringTableMergeTest() :
+        Test("elf_string_table_merge_test")
+    {
+    }
+
+    void run()
+    {
+        elf::StringTable string_table;
+
+        string_table.insert("loop");
+        string_table.insert(".text");
+        string_table.insert("inner_loop");
+        string_table.insert(".rel.text");
+        string_table.insert("outer_loop");
+        string_table.insert("text");
+        string_table.insert("loop");
+
+        // suffixes share the bytes of the longest string that ends in them
+        TEST_CHECK_EQUAL(string_table["inner_loop"], 1);
+        TEST_CHECK_EQUAL(string_table[".rel.text"], 12);
+        TEST_CHECK_EQUAL(string_table["outer_loop"], 22);
+        TEST_CHECK_EQUAL(string_table["loop"], 7);
+        TEST_CHECK_EQUAL(string_table[".text"], 16);
+        TEST_CHECK_EQUAL(string_table["text"], 17);
+        TEST_CHECK_EQUAL(string_table[""], 0);
+
+        // strings added after finalization are appended
+        TEST_CHECK_EQUAL(string_table["op"], 33);
+        TEST_CHECK_EQUAL(string_table["outer_loop"], 22);
+
+        TEST_CHECK_EQUAL(string_table[7], "loop");
+        TEST_CHECK_EQUAL(string_table[17], "text");
+        TEST_CHECK_THROWS(string_table[36], InternalError);
+
+        elf::Data data;
+        string_table.write(data);
+        TEST_CHECK_EQUAL(data.size(), 36);
+
+        elf::StringTable copy;
+        copy.read(data);
+        TEST_CHECK_EQUAL(copy[22], "outer_loop");
+        TEST_CHECK_EQUAL(copy[25], "er_loop");
+        TEST_CHECK_EQUAL(copy["outer_loop"], 22);
+        TEST_CHECK_EQUAL(copy["op"], 33);
+
+        // a cleared table starts over, and merges again
+        string_table.clear();
+        string_table.insert("inner_loop");
+        string_table.insert("loop");
+        TEST_CHECK_EQUAL(string_table["loop"], 7);
+        TEST_CHECK_THROWS(string_table[12], InternalError);
+
+        copy.clear();
+        TEST_CHECK_EQUAL(copy["op"], 1);
+    }
+} elf_string_table_merge_test;
+
+struct ElfStringTableReadTest :
+    public Test
+{
+    ElfStringTableReadTest() :
+        Test("elf_string_table_read_test")
+    {
+    }
+
+    void run()
+    {
+        static const char contents[] = "\0string_table_read_first\0string_table_read_second\0";
+
+        elf::Data data(sizeof(contents) - 1);
+        data.write(0, contents, sizeof(contents) - 1);
+
+        elf::StringTable string_table;
+        string_table.read(data);
+
+        // neither looking up nor extending a read table interns the strings it holds
+        unsigned count(Atom::count());
+        TEST_CHECK_EQUAL(string_table[25], "string_table_read_second");
+        TEST_CHECK_EQUAL(Atom::count(), count);
+
+        Atom appended("string_table_read_appended");
+        string_table.insert(appended);
+        TEST_CHECK_EQUAL(Atom::count(), count + 1);
+
+        TEST_CHECK_EQUAL(string_table[Atom("string_table_read_second")], 25);
+        TEST_CHECK_EQUAL(string_table[appended], 50);
+    }
+} elf_string_table_read_test;
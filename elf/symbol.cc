@@ -23,10 +23,10 @@ namespace gpu
 {
     namespace elf
     {
-        Symbol::Symbol(const std::string & name) :
+        Symbol::Symbol(const Atom & name) :
             bind(0),
             name(name),
-            section(""),
+            section(),
             size(0),
             type(0),
             value(0)
@@ -36,7 +36,7 @@ namespace gpu
         bool
         Symbol::operator< (const Symbol & other) const
         {
-            return name < other.name;
+            return name.str() < other.name.str();
         }
     }
 }
@@ -20,7 +20,7 @@
 #ifndef GPU_GUARD_ELF_SYMBOL_HH
 #define GPU_GUARD_ELF_SYMBOL_HH 1
 
-#include <string>
+#include <utils/atom.hh>
 
 namespace gpu
 {
@@ -30,9 +30,9 @@ namespace gpu
         {
             unsigned bind;
 
-            std::string name;
+            Atom name;
 
-            std::string section;
+            Atom section;
 
             unsigned size;
 
@@ -40,16 +40,16 @@ namespace gpu
 
             unsigned value;
 
-            Symbol(const std::string & name);
+            Symbol(const Atom & name);
 
             bool operator< (const Symbol &) const;
         };
 
         struct SymbolByName
         {
-            std::string reference;
+            Atom reference;
 
-            SymbolByName(const std::string & s) :
+            SymbolByName(const Atom & s) :
                 reference(s)
             {
             }
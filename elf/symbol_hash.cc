@@ -0,0 +1,229 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <elf/symbol_hash.hh>
+#include <utils/exception.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+
+#include <vector>
+
+#include <elf.h>
+
+namespace gpu
+{
+    template <>
+    struct Implementation<elf::SymbolHash>
+    {
+        // the hash section, which is used in place
+        elf::Data hash;
+
+        const unsigned * words;
+
+        unsigned size;
+
+        unsigned buckets;
+
+        unsigned offset;
+
+        unsigned bloom_size;
+
+        unsigned bloom_shift;
+
+        // the positions of the bloom filter, the buckets and the chains in words
+        unsigned bloom, bucket, chain;
+
+        elf::Data symtab;
+
+        elf::StringTable strtab;
+
+        Implementation(const elf::Data & hash, const elf::Data & symtab, const elf::StringTable & strtab) :
+            hash(hash),
+            words(static_cast<const unsigned *>(hash.buffer())),
+            size(hash.size() / 4),
+            symtab(symtab),
+            strtab(strtab)
+        {
+            if ((hash.size() % 4) || (size < 4))
+                throw InternalError("elf", "Malformed hash section: truncated header");
+
+            buckets = words[0];
+            offset = words[1];
+            bloom_size = words[2];
+            bloom_shift = words[3];
+
+            if ((0 == buckets) || (0 == offset))
+                throw InternalError("elf", "Malformed hash section: no buckets");
+
+            if ((0 == bloom_size) || (bloom_size & (bloom_size - 1)))
+                throw InternalError("elf", "Malformed hash section: bloom filter size is not a power of two");
+
+            bloom = 4;
+            bucket = bloom + bloom_size;
+            chain = bucket + buckets;
+
+            if ((bloom_size > size) || (buckets > size) || (chain > size))
+                throw InternalError("elf", "Malformed hash section: truncated tables");
+        }
+    };
+
+    namespace elf
+    {
+        namespace internal
+        {
+            // the number of bits per word of the bloom filter in ELFCLASS32
+            const unsigned bloom_word_bits(32);
+
+            unsigned log2_ceil(unsigned x)
+            {
+                unsigned result(0);
+
+                if (x <= 1)
+                    return result;
+
+                for (--x ; x != 0 ; x >>= 1)
+                    ++result;
+
+                return result;
+            }
+        }
+
+        unsigned
+        gnu_hash(const std::string & name)
+        {
+            unsigned result(5381);
+
+            for (std::string::const_iterator c(name.begin()), c_end(name.end()) ; c != c_end ; ++c)
+                result = result * 33 + static_cast<unsigned char>(*c);
+
+            return result;
+        }
+
+        SymbolHash::SymbolHash(const Data & hash, const Data & symtab, const StringTable & strtab) :
+            PrivateImplementationPattern<elf::SymbolHash>(new Implementation<elf::SymbolHash>(hash, symtab, strtab))
+        {
+        }
+
+        SymbolHash::~SymbolHash()
+        {
+        }
+
+        unsigned
+        SymbolHash::find(const std::string & name) const
+        {
+            const unsigned * words(_imp->words);
+            unsigned hash(gnu_hash(name));
+
+            unsigned word(words[_imp->bloom + (hash / internal::bloom_word_bits) % _imp->bloom_size]);
+            unsigned mask((1u << (hash % internal::bloom_word_bits))
+                    | (1u << ((hash >> _imp->bloom_shift) % internal::bloom_word_bits)));
+            if ((word & mask) != mask)
+                return 0;
+
+            unsigned index(words[_imp->bucket + hash % _imp->buckets]);
+            if (index < _imp->offset)
+                return 0;
+
+            unsigned symbols(_imp->symtab.size() / sizeof(Elf32_Sym));
+            for ( ; (_imp->chain + index - _imp->offset < _imp->size) && (index < symbols) ; ++index)
+            {
+                unsigned chain(words[_imp->chain + index - _imp->offset]);
+
+                if ((chain | 1) == (hash | 1))
+                {
+                    Elf32_Sym symbol;
+                    _imp->symtab.read(index * sizeof(Elf32_Sym), reinterpret_cast<char *>(&symbol), sizeof(Elf32_Sym));
+
+                    if (_imp->strtab[symbol.st_name] == name)
+                        return index;
+                }
+
+                if (chain & 1)
+                    break;
+            }
+
+            return 0;
+        }
+
+        unsigned
+        SymbolHash::buckets(unsigned symbols)
+        {
+            // the bucket counts of GNU ld, which picks the largest one not above the number of symbols
+            static const unsigned counts[] =
+            {
+                1, 3, 17, 37, 67, 97, 131, 197, 263, 521, 1031, 2053, 4099, 8209,
+                16411, 32771, 65537, 131101, 262147, 0
+            };
+
+            unsigned result(counts[0]);
+            for (unsigned i(0) ; 0 != counts[i] ; ++i)
+            {
+                result = counts[i];
+
+                if (symbols < counts[i + 1])
+                    break;
+            }
+
+            return result;
+        }
+
+        void
+        SymbolHash::write(const std::vector<unsigned> & hashes, unsigned offset, Data data)
+        {
+            // size the bloom filter as GNU ld does, with two bits per symbol
+            unsigned mask_bits(internal::log2_ceil(hashes.size()) + 1);
+            if (mask_bits < 3)
+                mask_bits = 5;
+            else if ((1u << (mask_bits - 2)) & hashes.size())
+                mask_bits += 3;
+            else
+                mask_bits += 2;
+
+            unsigned buckets(SymbolHash::buckets(hashes.size()));
+            unsigned bloom_size(1u << (mask_bits - 5));
+            unsigned bloom_shift(mask_bits);
+
+            // the section is filled in place
+            DataWriter writer(data);
+            unsigned * words(reinterpret_cast<unsigned *>(writer.reserve(4 * (4 + bloom_size + buckets + hashes.size()))));
+            words[0] = buckets;
+            words[1] = offset;
+            words[2] = bloom_size;
+            words[3] = bloom_shift;
+
+            unsigned * bloom(&words[4]), * bucket(bloom + bloom_size), * chain(bucket + buckets);
+            for (unsigned i(0) ; i < hashes.size() ; ++i)
+            {
+                unsigned hash(hashes[i]), b(hash % buckets);
+
+                bloom[(hash / internal::bloom_word_bits) % bloom_size] |= (1u << (hash % internal::bloom_word_bits))
+                    | (1u << ((hash >> bloom_shift) % internal::bloom_word_bits));
+
+                if (0 == bucket[b])
+                    bucket[b] = offset + i;
+                else if (hashes[i - 1] % buckets != b)
+                    throw InternalError("elf", "Hashed symbols are not sorted by bucket");
+
+                // the last hash of each bucket has its lowest bit set
+                chain[i] = hash & ~1u;
+                if ((i + 1 == hashes.size()) || (hashes[i + 1] % buckets != b))
+                    chain[i] |= 1;
+            }
+        }
+    }
+}
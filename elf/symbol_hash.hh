@@ -0,0 +1,71 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_ELF_SYMBOL_HASH_HH
+#define GPU_GUARD_ELF_SYMBOL_HASH_HH 1
+
+#include <elf/data.hh>
+#include <elf/string_table.hh>
+#include <utils/private_implementation_pattern.hh>
+
+#include <string>
+#include <vector>
+
+namespace gpu
+{
+    namespace elf
+    {
+        /// Return the hash of a symbol name, as used by .gnu.hash sections.
+        unsigned gnu_hash(const std::string & name);
+
+        /**
+         * SymbolHash finds symbols by name through a .gnu.hash section.
+         *
+         * The section holds a bloom filter, the first symbol of every bucket,
+         * and the hashes of all hashed symbols. These come last in the symbol
+         * table and are grouped by bucket. Most absent names are rejected by
+         * the bloom filter, and names are only compared if the hashes match.
+         */
+        class SymbolHash :
+            public PrivateImplementationPattern<elf::SymbolHash>
+        {
+            public:
+                /// Read the hash section of a symbol table and its string table.
+                SymbolHash(const Data & hash, const Data & symtab, const StringTable & strtab);
+
+                ~SymbolHash();
+
+                /// Return the index of the named symbol in the symbol table, or 0.
+                unsigned find(const std::string & name) const;
+
+                /// Return the number of buckets for a number of hashed symbols.
+                static unsigned buckets(unsigned symbols);
+
+                /**
+                 * Write a hash section.
+                 *
+                 * The hashes belong to the symbols from index offset on, and
+                 * must be sorted by bucket.
+                 */
+                static void write(const std::vector<unsigned> & hashes, unsigned offset, Data data);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,120 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <elf/data.hh>
+#include <elf/file.hh>
+#include <elf/string_table.hh>
+#include <elf/symbol_hash.hh>
+#include <elf/symbol_table.hh>
+#include <utils/exception.hh>
+#include <utils/stringify.hh>
+
+#include <string>
+
+#include <elf.h>
+
+using namespace gpu;
+using namespace tests;
+
+struct ElfSymbolHashTest :
+    public Test
+{
+    ElfSymbolHashTest() :
+        Test("elf_symbol_hash_test")
+    {
+    }
+
+    static elf::Symbol symbol(const std::string & name, const std::string & section, unsigned type = STT_NOTYPE,
+            unsigned bind = STB_GLOBAL)
+    {
+        elf::Symbol result(name);
+        result.section = section;
+        result.type = type;
+        result.bind = bind;
+
+        return result;
+    }
+
+    void run()
+    {
+        TEST_CHECK_EQUAL(elf::gnu_hash(""), 0x1505u);
+        TEST_CHECK_EQUAL(elf::gnu_hash("printf"), 0x156b2bb8u);
+        TEST_CHECK_EQUAL(elf::SymbolHash::buckets(0), 1u);
+        TEST_CHECK_EQUAL(elf::SymbolHash::buckets(20), 17u);
+        TEST_CHECK_EQUAL(elf::SymbolHash::buckets(5000), 4099u);
+
+        elf::File file(elf::File::create(elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(0xA600)
+                    .type(ET_REL)));
+        file.append(elf::Section(elf::Section::Parameters().name(".cf")));
+
+        elf::StringTable strtab;
+        elf::SymbolTable symtab(strtab);
+        symtab.enable_hash();
+
+        symtab.append(symbol(".cf", ".cf", STT_SECTION, STB_LOCAL));
+        for (unsigned i(0) ; i < 200 ; ++i)
+        {
+            symtab.append(symbol("kernel_" + stringify(i), ".cf"));
+        }
+        symtab.append(symbol("undefined", ""));
+        symtab.append(symbol(".Lloop", ".cf"));
+        symtab.append(symbol("local", ".cf", STT_NOTYPE, STB_LOCAL));
+
+        elf::Data symbols, hash;
+        symtab.write(file.section_table(), symbols);
+        symtab.write_hash(hash);
+
+        // local symbols come first, then undefined and .L symbols, none of which are hashed
+        TEST_CHECK_EQUAL(symtab[".cf"], 1u);
+        TEST_CHECK_EQUAL(symtab["local"], 2u);
+        TEST_CHECK_EQUAL(symtab["undefined"], 3u);
+        TEST_CHECK_EQUAL(symtab[".Lloop"], 4u);
+        TEST_CHECK_EQUAL(symtab.locals(), 3u);
+
+        elf::SymbolHash lookup(hash, symbols, strtab);
+        for (unsigned i(0) ; i < 200 ; ++i)
+        {
+            std::string name("kernel_" + stringify(i));
+            TEST_CHECK_EQUAL(lookup.find(name), symtab[name]);
+            TEST_CHECK(symtab[name] >= 5u);
+        }
+
+        TEST_CHECK_EQUAL(lookup.find(".cf"), 0u);
+        TEST_CHECK_EQUAL(lookup.find("undefined"), 0u);
+        TEST_CHECK_EQUAL(lookup.find(".Lloop"), 0u);
+        TEST_CHECK_EQUAL(lookup.find("local"), 0u);
+        TEST_CHECK_EQUAL(lookup.find("kernel_200"), 0u);
+        TEST_CHECK_EQUAL(lookup.find(""), 0u);
+
+        TEST_CHECK_THROWS(symtab.enable_hash(), InternalError);
+        TEST_CHECK_THROWS(symtab.append(symbol("late", ".cf")), InternalError);
+        TEST_CHECK_THROWS(elf::SymbolHash(elf::Data(8), symbols, strtab), InternalError);
+
+        // tables without hashes keep the order of insertion
+        elf::SymbolTable plain(strtab);
+        plain.append(symbol("b", ".cf"));
+        plain.append(symbol("a", ".cf"));
+        TEST_CHECK_EQUAL(plain["b"], 1u);
+        TEST_CHECK_EQUAL(plain["a"], 2u);
+        TEST_CHECK_THROWS(plain.write_hash(hash), InternalError);
+    }
+} elf_symbol_hash_test;
@@ -0,0 +1,191 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <elf/symbol_index.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+#include <utils/sequence-impl.hh>
+
+#include <algorithm>
+#include <map>
+#include <tr1/unordered_map>
+#include <vector>
+
+namespace gpu
+{
+    namespace elf
+    {
+        namespace internal
+        {
+            /// Orders indices of symbols by value, and then by index.
+            struct SymbolOrder
+            {
+                const std::vector<Symbol> & symbols;
+
+                SymbolOrder(const std::vector<Symbol> & symbols) :
+                    symbols(symbols)
+                {
+                }
+
+                bool operator() (unsigned a, unsigned b) const
+                {
+                    if (symbols[a].value != symbols[b].value)
+                        return symbols[a].value < symbols[b].value;
+
+                    return a < b;
+                }
+            };
+
+            /// The non-local symbols of one section.
+            struct SectionGlobals
+            {
+                std::vector<unsigned> indices;
+
+                bool sorted;
+
+                SectionGlobals() :
+                    sorted(true)
+                {
+                }
+            };
+        }
+    }
+
+    template <>
+    struct Implementation<elf::SymbolIndex>
+    {
+        std::vector<elf::Symbol> symbols;
+
+        /// Index of each symbol by the id of its name.
+        std::tr1::unordered_map<unsigned, unsigned> by_name;
+
+        /// Non-local symbols by section, sorted when first needed.
+        std::map<Atom, elf::internal::SectionGlobals> globals;
+
+        bool append(const elf::Symbol & symbol)
+        {
+            if (! by_name.insert(std::make_pair(symbol.name.id(), symbols.size())).second)
+                return false;
+
+            if (! symbol.name.has_prefix(".L"))
+            {
+                elf::internal::SectionGlobals & g(globals[symbol.section]);
+                if ((! g.indices.empty()) && (symbols[g.indices.back()].value > symbol.value))
+                    g.sorted = false;
+
+                g.indices.push_back(symbols.size());
+            }
+
+            symbols.push_back(symbol);
+
+            return true;
+        }
+
+        int find(const Atom & name) const
+        {
+            std::tr1::unordered_map<unsigned, unsigned>::const_iterator i(by_name.find(name.id()));
+            if (by_name.end() == i)
+                return -1;
+
+            return i->second;
+        }
+    };
+
+    namespace elf
+    {
+        SymbolIndex::SymbolIndex() :
+            PrivateImplementationPattern<elf::SymbolIndex>(new Implementation<elf::SymbolIndex>)
+        {
+        }
+
+        SymbolIndex::SymbolIndex(const Sequence<Symbol> & symbols) :
+            PrivateImplementationPattern<elf::SymbolIndex>(new Implementation<elf::SymbolIndex>)
+        {
+            _imp->symbols.reserve(symbols.size());
+            for (Sequence<Symbol>::Iterator s(symbols.begin()), s_end(symbols.end()) ; s != s_end ; ++s)
+            {
+                _imp->append(*s);
+            }
+        }
+
+        SymbolIndex::~SymbolIndex()
+        {
+        }
+
+        bool
+        SymbolIndex::append(const Symbol & symbol)
+        {
+            return _imp->append(symbol);
+        }
+
+        Symbol *
+        SymbolIndex::find(const Atom & name) const
+        {
+            int index(_imp->find(name));
+            if (index < 0)
+                return 0;
+
+            return &_imp->symbols[index];
+        }
+
+        const Symbol *
+        SymbolIndex::find_global_before(const Atom & name) const
+        {
+            int index(_imp->find(name));
+            if (index < 0)
+                return 0;
+
+            std::map<Atom, internal::SectionGlobals>::iterator g(_imp->globals.find(_imp->symbols[index].section));
+            if (_imp->globals.end() == g)
+                return 0;
+
+            internal::SymbolOrder order(_imp->symbols);
+            std::vector<unsigned> & indices(g->second.indices);
+            if (! g->second.sorted)
+            {
+                std::sort(indices.begin(), indices.end(), order);
+                g->second.sorted = true;
+            }
+
+            // the first global that comes after name, which can be name itself
+            std::vector<unsigned>::const_iterator i(std::upper_bound(indices.begin(), indices.end(), unsigned(index), order));
+            if (indices.begin() == i)
+                return 0;
+
+            return &_imp->symbols[*(i - 1)];
+        }
+
+        Sequence<Symbol>
+        SymbolIndex::symbols() const
+        {
+            Sequence<Symbol> result;
+            for (std::vector<Symbol>::const_iterator s(_imp->symbols.begin()), s_end(_imp->symbols.end()) ; s != s_end ; ++s)
+            {
+                result.append(*s);
+            }
+
+            return result;
+        }
+
+        unsigned
+        SymbolIndex::size() const
+        {
+            return _imp->symbols.size();
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_ELF_SYMBOL_INDEX_HH
+#define GPU_GUARD_ELF_SYMBOL_INDEX_HH 1
+
+#include <elf/symbol.hh>
+#include <utils/atom.hh>
+#include <utils/private_implementation_pattern.hh>
+#include <utils/sequence.hh>
+
+namespace gpu
+{
+    namespace elf
+    {
+        /**
+         * SymbolIndex holds symbols in the order they were added, and finds
+         * them by name in constant time.
+         *
+         * Names are unique: only the first symbol of any name is kept. Copies
+         * of a SymbolIndex share the same symbols.
+         */
+        class SymbolIndex :
+            public PrivateImplementationPattern<elf::SymbolIndex>
+        {
+            public:
+                SymbolIndex();
+
+                /// Index symbols, keeping the first of any name.
+                SymbolIndex(const Sequence<Symbol> & symbols);
+
+                ~SymbolIndex();
+
+                /// Add a symbol, unless one of the same name exists. Return whether it was added.
+                bool append(const Symbol & symbol);
+
+                /**
+                 * Return the symbol of the given name, or 0.
+                 *
+                 * The pointer stays valid until the next append.
+                 */
+                Symbol * find(const Atom & name) const;
+
+                /**
+                 * Return the last non-local symbol in the section of name that
+                 * does not come after name, or 0.
+                 *
+                 * Symbols are ordered by their value, and those of equal value
+                 * by the order they were added in. Local symbols are those with
+                 * a '.L' prefix.
+                 */
+                const Symbol * find_global_before(const Atom & name) const;
+
+                /// Return all symbols, in the order they were added.
+                Sequence<Symbol> symbols() const;
+
+                unsigned size() const;
+        };
+    }
+}
+
+#endif
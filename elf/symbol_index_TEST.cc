@@ -0,0 +1,103 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <elf/symbol_index.hh>
+#include <utils/sequence-impl.hh>
+#include <utils/stringify.hh>
+
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+struct ElfSymbolIndexTest :
+    public Test
+{
+    ElfSymbolIndexTest() :
+        Test("elf_symbol_index_test")
+    {
+    }
+
+    static elf::Symbol symbol(const std::string & name, const std::string & section, unsigned value)
+    {
+        elf::Symbol result(name);
+        result.section = section;
+        result.value = value;
+
+        return result;
+    }
+
+    Atom before(const elf::SymbolIndex & index, const std::string & name)
+    {
+        const elf::Symbol * result(index.find_global_before(Atom(name)));
+
+        return result ? result->name : Atom("<none>");
+    }
+
+    void run()
+    {
+        elf::SymbolIndex index;
+
+        TEST_CHECK(index.append(symbol(".cf", ".cf", 0)));
+        TEST_CHECK(index.append(symbol("main", ".cf", 0)));
+        TEST_CHECK(index.append(symbol(".L0", ".cf", 0)));
+        TEST_CHECK(index.append(symbol("second", ".cf", 16)));
+        TEST_CHECK(index.append(symbol(".L1", ".cf", 24)));
+        TEST_CHECK(index.append(symbol("other", ".alu", 8)));
+        TEST_CHECK(index.append(symbol("external", "", 0)));
+
+        // the first symbol of a name is kept
+        TEST_CHECK(! index.append(symbol("main", ".alu", 32)));
+        TEST_CHECK_EQUAL(index.size(), 7u);
+        TEST_CHECK_EQUAL(index.find(Atom("main"))->section, Atom(".cf"));
+        TEST_CHECK(0 == index.find(Atom("missing")));
+
+        // found symbols can be changed in place
+        index.find(Atom("second"))->size = 8;
+        TEST_CHECK_EQUAL(index.find(Atom("second"))->size, 8u);
+
+        TEST_CHECK_EQUAL(before(index, ".L0"), Atom("main"));
+        TEST_CHECK_EQUAL(before(index, ".L1"), Atom("second"));
+        TEST_CHECK_EQUAL(before(index, "second"), Atom("second"));
+        TEST_CHECK_EQUAL(before(index, "other"), Atom("other"));
+        TEST_CHECK_EQUAL(before(index, "missing"), Atom("<none>"));
+
+        // symbols that are added out of order are still found by value
+        TEST_CHECK(index.append(symbol("early", ".cf", 20)));
+        TEST_CHECK(index.append(symbol(".L2", ".cf", 22)));
+        TEST_CHECK_EQUAL(before(index, ".L2"), Atom("early"));
+        TEST_CHECK_EQUAL(before(index, ".L1"), Atom("early"));
+
+        Sequence<elf::Symbol> symbols(index.symbols());
+        TEST_CHECK_EQUAL(symbols.size(), 9u);
+        TEST_CHECK_EQUAL(symbols.first().name, Atom(".cf"));
+        TEST_CHECK_EQUAL(symbols.last().name, Atom(".L2"));
+
+        // many local labels
+        elf::SymbolIndex large;
+        large.append(symbol(".cf", ".cf", 0));
+        for (unsigned i(0) ; i < 100000 ; ++i)
+        {
+            large.append(symbol((0 == i % 1000 ? "f" : ".L") + stringify(i), ".cf", 8 * i));
+        }
+        TEST_CHECK_EQUAL(before(large, ".L54321"), Atom("f54000"));
+        TEST_CHECK_EQUAL(before(large, "f99000"), Atom("f99000"));
+    }
+} elf_symbol_index_test;
@@ -17,6 +17,7 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <elf/symbol_hash.hh>
 #include <elf/symbol_table.hh>
 #include <utils/exception.hh>
 #include <utils/private_implementation_pattern-impl.hh>
@@ -31,18 +32,102 @@
 
 namespace gpu
 {
+    namespace elf
+    {
+        namespace internal
+        {
+            struct HashBucketOrder
+            {
+                const unsigned buckets;
+
+                HashBucketOrder(unsigned buckets) :
+                    buckets(buckets)
+                {
+                }
+
+                bool operator() (const std::pair<unsigned, unsigned> & a, const std::pair<unsigned, unsigned> & b) const
+                {
+                    return (a.first % buckets) < (b.first % buckets);
+                }
+            };
+        }
+    }
+
     template <>
     struct Implementation<elf::SymbolTable>
     {
-        std::map<std::string, unsigned> map;
+        std::map<Atom, unsigned> map;
 
         std::vector<elf::Symbol> entries;
 
         elf::StringTable strtab;
 
+        bool hashed;
+
+        bool finalized;
+
+        // the hashes of the symbols from index hash_offset on
+        std::vector<unsigned> hashes;
+
+        unsigned hash_offset;
+
         Implementation(const elf::StringTable & strtab) :
-            strtab(strtab)
+            strtab(strtab),
+            hashed(false),
+            finalized(false),
+            hash_offset(0)
+        {
+        }
+
+        static bool hashable(const elf::Symbol & symbol)
         {
+            // only globals are looked up by name, local symbols and .L labels stay in the unhashed prefix
+            return (! symbol.name.empty()) && (! symbol.section.empty()) && (STT_SECTION != symbol.type)
+                && (STB_LOCAL != symbol.bind) && (! symbol.name.has_prefix(".L"));
+        }
+
+        void finalize()
+        {
+            if (finalized)
+                return;
+
+            finalized = true;
+
+            if (! hashed)
+                return;
+
+            // unhashed symbols come first, locals before globals, and hashed ones follow grouped by bucket
+            std::vector<elf::Symbol> unhashed, unhashed_globals;
+            std::vector<std::pair<unsigned, unsigned> > order; // hash and index of hashed symbols
+            for (unsigned i(0) ; i < entries.size() ; ++i)
+            {
+                if (hashable(entries[i]))
+                    order.push_back(std::make_pair(elf::gnu_hash(entries[i].name.str()), i));
+                else if (STB_LOCAL == entries[i].bind)
+                    unhashed.push_back(entries[i]);
+                else
+                    unhashed_globals.push_back(entries[i]);
+            }
+            unhashed.insert(unhashed.end(), unhashed_globals.begin(), unhashed_globals.end());
+
+            std::stable_sort(order.begin(), order.end(), elf::internal::HashBucketOrder(elf::SymbolHash::buckets(order.size())));
+
+            hash_offset = unhashed.size() + 1;
+            std::vector<elf::Symbol> sorted(unhashed);
+            for (std::vector<std::pair<unsigned, unsigned> >::const_iterator o(order.begin()), o_end(order.end()) ;
+                    o != o_end ; ++o)
+            {
+                hashes.push_back(o->first);
+                sorted.push_back(entries[o->second]);
+            }
+
+            entries.swap(sorted);
+
+            map.clear();
+            for (unsigned i(0) ; i < entries.size() ; ++i)
+            {
+                map.insert(std::pair<const Atom, unsigned>(entries[i].name, i + 1));
+            }
         }
     };
 
@@ -57,10 +142,21 @@ namespace gpu
         {
         }
 
+        void
+        SymbolTable::enable_hash()
+        {
+            if (_imp->finalized)
+                throw InternalError("elf", "Cannot hash a symbol table that has already been laid out");
+
+            _imp->hashed = true;
+        }
+
         unsigned
-        SymbolTable::operator[] (const std::string & name)
+        SymbolTable::operator[] (const Atom & name)
         {
-            std::map<std::string, unsigned>::const_iterator e(_imp->map.find(name)), e_end(_imp->map.end());
+            _imp->finalize();
+
+            std::map<Atom, unsigned>::const_iterator e(_imp->map.find(name)), e_end(_imp->map.end());
             if (e == e_end)
                 return 0;
 
@@ -70,7 +166,7 @@ namespace gpu
         void
         SymbolTable::append(const Symbol & symbol)
         {
-            std::map<std::string, unsigned>::const_iterator e(_imp->map.find(symbol.name)), e_end(_imp->map.end());
+            std::map<Atom, unsigned>::const_iterator e(_imp->map.find(symbol.name)), e_end(_imp->map.end());
             if (e != e_end)
             {
                 Symbol & existing(_imp->entries[e->second - 1]);
@@ -85,36 +181,68 @@ namespace gpu
                 return;
             }
 
+            if (_imp->finalized && _imp->hashed)
+                throw InternalError("elf", "Cannot append to a hashed symbol table that has already been laid out");
+
             _imp->entries.push_back(symbol);
-            _imp->map.insert(std::pair<const std::string, unsigned>(symbol.name, _imp->entries.size()));
+            _imp->strtab.insert(symbol.name);
+            _imp->map.insert(std::pair<const Atom, unsigned>(symbol.name, _imp->entries.size()));
         }
 
         void
         SymbolTable::write(const SectionTable & section_table, Data data)
         {
-            std::vector<Elf32_Sym> symbols;
+            _imp->finalize();
 
-            Elf32_Sym dummy;
-            memset(&dummy, 0, sizeof(dummy));
-            symbols.push_back(dummy);
+            DataWriter writer(data);
+
+            // the first symbol is always the null symbol
+            writer.reserve(sizeof(Elf32_Sym));
 
             for (std::vector<Symbol>::const_iterator s(_imp->entries.begin()), s_end(_imp->entries.end()) ;
                     s != s_end ; ++s)
             {
-                Elf32_Sym symbol;
-                symbol.st_name = _imp->strtab[s->name];
-                symbol.st_info = ELF32_ST_INFO(s->bind, s->type);
-                symbol.st_size = s->size;
-                symbol.st_value = s->value;
-                symbol.st_other = 0;
-                symbol.st_shndx = section_table[s->section];
-
-                symbols.push_back(symbol);
+                writer.put32(_imp->strtab[s->name]);
+                writer.put32(s->value);
+                writer.put32(s->size);
+                writer.put8(ELF32_ST_INFO(s->bind, s->type));
+                writer.put8(0);
+                writer.put16(section_table[s->section]);
             }
+        }
 
-            unsigned size(symbols.size() * sizeof(Elf32_Sym));
-            data.resize(size);
-            data.write(0, reinterpret_cast<char *>(&symbols[0]), size);
+        unsigned
+        SymbolTable::locals()
+        {
+            _imp->finalize();
+
+            unsigned result(_imp->entries.size());
+            while ((0 != result) && (STB_LOCAL != _imp->entries[result - 1].bind))
+                --result;
+
+            return result + 1;
+        }
+
+        void
+        SymbolTable::write_hash(Data data)
+        {
+            if (! _imp->hashed)
+                throw InternalError("elf", "Symbol table has no hash");
+
+            _imp->finalize();
+
+            SymbolHash::write(_imp->hashes, _imp->hash_offset, data);
+        }
+
+        void
+        SymbolTable::clear()
+        {
+            _imp->map.clear();
+            _imp->entries.clear();
+            _imp->hashed = false;
+            _imp->finalized = false;
+            _imp->hashes.clear();
+            _imp->hash_offset = 0;
         }
     }
 }
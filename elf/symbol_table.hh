@@ -24,14 +24,19 @@
 #include <elf/section.hh>
 #include <elf/string_table.hh>
 #include <elf/symbol.hh>
+#include <utils/atom.hh>
 #include <utils/private_implementation_pattern.hh>
 
-#include <string>
-
 namespace gpu
 {
     namespace elf
     {
+        /**
+         * SymbolTable holds the symbols of an object file.
+         *
+         * Symbol indices are fixed when the first one is asked for, or the
+         * table is written. Copies of a SymbolTable share the same symbols.
+         */
         class SymbolTable :
             public PrivateImplementationPattern<elf::SymbolTable>
         {
@@ -40,11 +45,37 @@ namespace gpu
 
                 ~SymbolTable();
 
-                unsigned operator[] (const std::string & name);
+                /**
+                 * Order the symbols for a .gnu.hash section, see SymbolHash.
+                 *
+                 * Only named, defined global symbols are hashed. Local symbols,
+                 * .L labels, section and undefined symbols come first, locals
+                 * before globals.
+                 *
+                 * Must be called before any symbol index is asked for.
+                 */
+                void enable_hash();
+
+                unsigned operator[] (const Atom & name);
 
                 void append(const Symbol & symbol);
 
                 void write(const SectionTable & section_table, Data data);
+
+                /**
+                 * Return one more than the index of the last local symbol, as
+                 * the sh_info of a symbol table section holds.
+                 */
+                unsigned locals();
+
+                /// Write the .gnu.hash section of a table with enable_hash.
+                void write_hash(Data data);
+
+                /**
+                 * Remove all symbols and disable the hash, keeping the
+                 * allocations for reuse. The string table is left as it is.
+                 */
+                void clear();
         };
     }
 }
@@ -17,54 +17,12 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/diagnostics.hh>
 #include <r6xx/alu_destination_gpr.hh>
 #include <r6xx/error.hh>
-#include <utils/destringify.hh>
+#include <r6xx/operand_lexer.hh>
 #include <utils/stringify.hh>
 
-namespace
-{
-    gpu::Enumeration<2> channel_from_suffix(const std::string & suffix)
-    {
-        try
-        {
-            switch (suffix[0])
-            {
-                case 'x':
-                case 'y':
-                case 'z':
-                    return gpu::Enumeration<2>(suffix[0] - 'x');
-
-                case 'w':
-                    return gpu::Enumeration<2>(3);
-            }
-        }
-        catch (gpu::EnumerationValueOutOfBoundsError & e)
-        {
-        }
-
-        throw gpu::r6xx::DestinationGPRSyntaxError("'" + gpu::stringify(suffix[0]) + "' is not a valid channel");
-    }
-
-    bool relative_from_suffix(const std::string & suffix)
-    {
-        bool result(false);
-
-        try
-        {
-            if (2 == suffix.size())
-                result = ('r' == suffix[1]);
-
-            return result;
-        }
-        catch (gpu::EnumerationValueOutOfBoundsError & e)
-        {
-        }
-
-        throw gpu::r6xx::DestinationGPRSyntaxError("'" + gpu::stringify(suffix[1]) + "' is not a address mode");
-    }
-}
-
 namespace gpu
 {
     namespace r6xx
@@ -78,45 +36,63 @@ namespace gpu
             {
             }
 
-            DestinationGPR
-            DestinationGPRParser::parse(const std::string & input)
+            ParseStatus
+            DestinationGPRParser::parse(const char * begin, const char * end, DestinationGPR & result, Diagnostics & diagnostics)
             {
-                const static std::string digits("0123456789");
-                const static std::string modes("ar");
+                LexedOperand operand;
+                ParseStatus status(OperandLexer::lex(begin, end, operand, diagnostics));
+                if (ps_success != status)
+                    return status;
+
+                if ((LexedOperand::gpr_operand != operand.kind) || operand.negated)
+                    return diagnostics.error(ps_syntax_error, "destination GPR needs to start with '$'");
+
+                if (operand.has_selector)
+                    return diagnostics.error(ps_syntax_error, "unexpected selector");
 
-                if (input.empty())
-                    throw InternalError("r6xx", "empty input");
+                if (! operand.has_channel)
+                    return diagnostics.error(ps_syntax_error, "no separator");
 
-                std::string operand(input);
-                if (4 > operand.size())
-                    throw DestinationGPRSyntaxError("too short for a destination GPR");
+                if (! Enumeration<7>::valid(operand.index))
+                    return diagnostics.error(ps_out_of_bounds, "register index out of bounds");
 
-                if ('$' != operand[0])
-                    throw DestinationGPRSyntaxError("destination GPR needs to start with '$'");
+                result = DestinationGPR(Enumeration<2>(operand.channel), Enumeration<7>(operand.index), operand.relative);
 
-                operand.erase(0, 1);
+                return ps_success;
+            }
 
-                std::string::size_type sep(operand.find('.'));
-                if (std::string::npos == sep)
-                    throw DestinationGPRSyntaxError("no separator");
+            DestinationGPR
+            DestinationGPRParser::parse(const char * begin, const char * end)
+            {
+                Diagnostics diagnostics;
+                DestinationGPR result(Enumeration<2>(0), Enumeration<7>(0), false);
 
-                std::string suffix(operand.substr(sep + 1));
-                operand.erase(sep);
+                switch (parse(begin, end, result, diagnostics))
+                {
+                    case ps_success:
+                        return result;
 
-                if (std::string::npos != operand.find_first_not_of(digits))
-                    throw DestinationGPRSyntaxError("'" + operand + "' is not a number");
+                    case ps_empty_input:
+                        throw InternalError("r6xx", diagnostics.last());
 
-                if ((suffix.empty()) || (2 < suffix.size()))
-                    throw DestinationGPRSyntaxError("invalid suffix '" + stringify(suffix) + "'");
+                    case ps_syntax_error:
+                    case ps_out_of_bounds:
+                        break;
+                }
 
-                Enumeration<2> channel(::channel_from_suffix(suffix));
-                bool relative(::relative_from_suffix(suffix));
-                unsigned index(destringify<unsigned>(operand));
+                throw DestinationGPRSyntaxError(diagnostics.last());
+            }
 
-                if (127 < index)
-                    throw DestinationGPRSyntaxError("register index out of bounds");
+            ParseStatus
+            DestinationGPRParser::parse(const std::string & input, DestinationGPR & result, Diagnostics & diagnostics)
+            {
+                return parse(input.data(), input.data() + input.size(), result, diagnostics);
+            }
 
-                return DestinationGPR(channel, Enumeration<7>(index), relative);
+            DestinationGPR
+            DestinationGPRParser::parse(const std::string & input)
+            {
+                return parse(input.data(), input.data() + input.size());
             }
 
             std::string
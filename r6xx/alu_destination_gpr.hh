@@ -20,6 +20,7 @@
 #ifndef GPU_GUARD_R6XX_ALU_DESTINATION_GPR_HH
 #define GPU_GUARD_R6XX_ALU_DESTINATION_GPR_HH 1
 
+#include <common/diagnostics.hh>
 #include <utils/enumeration.hh>
 
 namespace gpu
@@ -41,7 +42,22 @@ namespace gpu
 
             struct DestinationGPRParser
             {
+                /**
+                 * Parse input without throwing.
+                 *
+                 * On failure, a message is recorded in diagnostics and result
+                 * is left untouched.
+                 */
+                static ParseStatus parse(const std::string & input, DestinationGPR & result, Diagnostics & diagnostics);
+
+                /// Parse input, throwing DestinationGPRSyntaxError on failure.
                 static DestinationGPR parse(const std::string & input);
+
+                /// Parse the text [begin, end) without throwing, as with a string.
+                static ParseStatus parse(const char * begin, const char * end, DestinationGPR & result, Diagnostics & diagnostics);
+
+                /// Parse the text [begin, end), throwing DestinationGPRSyntaxError on failure.
+                static DestinationGPR parse(const char * begin, const char * end);
             };
 
             struct DestinationGPRPrinter
@@ -69,6 +69,28 @@ struct AluDestinationGPRParserTest :
         {
             TEST_CHECK_THROWS(r6xx::alu::DestinationGPRParser::parse(i->first), r6xx::DestinationGPRSyntaxError);
         }
+
+        Diagnostics diagnostics;
+        for (const DATA * i(valid_data_begin), * i_end(valid_data_end) ; i != i_end ; ++i)
+        {
+            r6xx::alu::DestinationGPR gpr(CHANNEL(0), INDEX(0), false);
+            TEST_CHECK_EQUAL(r6xx::alu::DestinationGPRParser::parse(i->first, gpr, diagnostics), ps_success);
+            TEST_CHECK_EQUAL(gpr.channel, i->second.channel);
+            TEST_CHECK_EQUAL(gpr.index, i->second.index);
+            TEST_CHECK_EQUAL(gpr.relative, i->second.relative);
+        }
+        TEST_CHECK(diagnostics.empty());
+
+        for (const DATA * i(invalid_data_begin), * i_end(invalid_data_end) ; i != i_end ; ++i)
+        {
+            r6xx::alu::DestinationGPR gpr(CHANNEL(0), INDEX(0), false);
+            TEST_CHECK(ps_success != r6xx::alu::DestinationGPRParser::parse(i->first, gpr, diagnostics));
+        }
+        TEST_CHECK_EQUAL(diagnostics.size(), unsigned(invalid_data_end - invalid_data_begin));
+        TEST_CHECK_EQUAL(diagnostics.message(1), "register index out of bounds");
+
+        diagnostics.clear();
+        TEST_CHECK(diagnostics.empty());
     }
 #undef DATA
 #undef DATA2
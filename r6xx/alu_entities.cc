@@ -22,13 +22,12 @@
 #include <common/expression.hh>
 #include <r6xx/alu_entities.hh>
 #include <r6xx/error.hh>
+#include <utils/perfect_hash.hh>
 #include <utils/sequence-impl.hh>
 #include <utils/stringify.hh>
 #include <utils/tuple.hh>
 #include <utils/visitor-impl.hh>
 
-#include <algorithm>
-
 namespace gpu
 {
     template
@@ -146,7 +145,7 @@ namespace gpu
                 static_cast<ConstVisits<IndexMode> *>(&v)->visit(*this);
             }
 
-            Label::Label(const std::string & t) :
+            Label::Label(const Atom & t) :
                 text(t)
             {
             }
@@ -161,9 +160,10 @@ namespace gpu
                 static_cast<ConstVisits<Label> *>(&v)->visit(*this);
             }
 
-            Size::Size(const std::string & s, const ExpressionPtr & e) :
+            Size::Size(const Atom & s, const ExpressionPtr & e) :
                 symbol(s),
-                expression(e)
+                expression(e),
+                compiled(e)
             {
             }
 
@@ -177,7 +177,7 @@ namespace gpu
                 static_cast<ConstVisits<Size> *>(&v)->visit(*this);
             }
 
-            Type::Type(const std::string & s, unsigned t) :
+            Type::Type(const Atom & s, unsigned t) :
                 symbol(s),
                 type(t)
             {
@@ -314,11 +314,9 @@ namespace gpu
                  * instruction slots
                  */
                 typedef Tuple<std::string, unsigned, unsigned, unsigned> Form2;
-                typedef TupleComparator<Form2, std::string, 1> Form2Comparator;
                 const static Form2 form2_instructions[] =
                 {
                     /* arithmetic */
-                    Form2("ashl",               0x72, 2, 1), // Alias for shl
                     Form2("ashr",               0x70, 2, 1),
                     /* float double */
                     Form2("d2f",                0x1c, 1, 2),
@@ -416,14 +414,14 @@ namespace gpu
                     Form2("not",                0x33, 1, 1),
                     Form2("or",                 0x31, 2, 1),
                     Form2("shl",                0x72, 2, 1),
+                    Form2("ashl",               0x72, 2, 1), // Alias for shl
                     Form2("shr",                0x71, 2, 1),
                     Form2("xor",                0x32, 2, 1),
                     /* general */
                     Form2("mov",                0x19, 1, 1),
                     Form2("nop",                0x1a, 0, 1)
                 };
-                const Form2 * form2_instructions_begin(form2_instructions);
-                const Form2 * form2_instructions_end(form2_instructions + sizeof(form2_instructions) / sizeof(Form2));
+                const static PerfectHash<Form2> form2_table(form2_instructions, form2_instructions + sizeof(form2_instructions) / sizeof(Form2));
 
                 /*
                  * mnemonic
@@ -431,7 +429,6 @@ namespace gpu
                  * slots
                  */
                 typedef Tuple<std::string, unsigned, unsigned> Form3;
-                typedef TupleComparator<Form3, std::string, 1> Form3Comparator;
                 const static Form3 form3_instructions[] =
                 {
                     /* float double */
@@ -460,102 +457,142 @@ namespace gpu
                     Form3("icmovge",            0x1e, 1),
                     Form3("icmovgt",            0x1d, 1)
                 };
-                const Form3 * form3_instructions_begin(form3_instructions);
-                const Form3 * form3_instructions_end(form3_instructions + sizeof(form3_instructions) / sizeof(Form3));
+                const static PerfectHash<Form3> form3_table(form3_instructions, form3_instructions + sizeof(form3_instructions) / sizeof(Form3));
+
+                enum DirectiveKind
+                {
+                    dk_groupend,
+                    dk_indexmode,
+                    dk_size,
+                    dk_type
+                };
+
+                /*
+                 * directive name
+                 * directive kind
+                 */
+                typedef Tuple<std::string, unsigned> KnownDirective;
+                const static KnownDirective known_directives[] =
+                {
+                    KnownDirective("groupend",      dk_groupend),
+                    KnownDirective("indexmode",     dk_indexmode),
+                    KnownDirective("size",          dk_size),
+                    KnownDirective("type",          dk_type)
+                };
+                const static PerfectHash<KnownDirective> directive_table(known_directives, known_directives + sizeof(known_directives) / sizeof(KnownDirective));
 
                 struct EntityConverter :
                     public AssemblyEntityVisitor
                 {
+                    Arena & arena;
+
                     EntityPtr result;
 
+                    EntityConverter(Arena & arena) :
+                        arena(arena),
+                        result(0)
+                    {
+                    }
+
                     void visit(const Comment &) { }
                     void visit(const Data &) { }
 
                     void visit(const Directive & d)
                     {
-                        if ("groupend" == d.name)
-                        {
-                            result = EntityPtr(new GroupEnd);
-                        }
-                        else if ("indexmode" == d.name)
+                        const KnownDirective * directive(directive_table.find(d.name));
+                        if (! directive)
+                            throw SyntaxError("invalid directive '." + d.name + "' in ALU section");
+
+                        switch (directive->second)
                         {
-                            unsigned mode(0xFF);
-                            if ("loop" == d.params)
-                            {
-                                mode = 4;
-                            }
-                            else if ("ar." == d.params.substr(0, 3))
-                            {
-                                char channel(d.params[3]);
-                                switch (channel)
+                            case dk_groupend:
+                                result = arena.make<GroupEnd>();
+                                break;
+
+                            case dk_indexmode:
                                 {
-                                    case 'w':
-                                        mode = 3;
-                                        break;
+                                    unsigned mode(0xFF);
+                                    if ("loop" == d.params)
+                                    {
+                                        mode = 4;
+                                    }
+                                    else if ("ar." == d.params.substr(0, 3))
+                                    {
+                                        char channel(d.params[3]);
+                                        switch (channel)
+                                        {
+                                            case 'w':
+                                                mode = 3;
+                                                break;
+
+                                            case 'x':
+                                            case 'y':
+                                            case 'z':
+                                                break;
+
+                                            default:
+                                                throw SyntaxError("invalid channel for address register index mode");
+                                        }
+                                    }
+
+                                    result = arena.make<IndexMode>(mode);
+                                }
+                                break;
 
-                                    case 'x':
-                                    case 'y':
-                                    case 'z':
-                                        break;
+                            case dk_size:
+                                {
+                                    Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
 
-                                    default:
-                                        throw SyntaxError("invalid channel for address register index mode");
+                                    result = arena.make<Size>(parameters.first, parameters.second);
                                 }
-                            }
-
-                            result = EntityPtr(new IndexMode(mode));
-                        }
-                        else if ("size" == d.name)
-                        {
-                            Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
+                                break;
 
-                            result = EntityPtr(new Size(parameters.first, parameters.second));
-                        }
-                        else if ("type" == d.name)
-                        {
-                            Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
+                            case dk_type:
+                                {
+                                    Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
 
-                            result = EntityPtr(new Type(parameters.first, parameters.second));
-                        }
-                        else
-                        {
-                            throw SyntaxError("invalid directive '." + d.name + "' in ALU section");
+                                    result = arena.make<Type>(parameters.first, parameters.second);
+                                }
+                                break;
                         }
                     }
 
                     void visit(const Instruction & i)
                     {
-                        const Form2 * form2(std::find_if(form2_instructions_begin, form2_instructions_end, Form2Comparator(i.mnemonic)));
-                        const Form3 * form3(std::find_if(form3_instructions_begin, form3_instructions_end, Form3Comparator(i.mnemonic)));
+                        InstructionTokens tokens(i);
 
-                        Sequence<std::string>::Iterator j(i.operands.begin()), j_end(i.operands.end());
+                        visit(tokens.lexed);
+                    }
 
-                        if (j == j_end)
-                            throw SyntaxError("no destination operand");
+                    void visit(const LexedInstruction & i)
+                    {
+                        const Form2 * form2(form2_table.find(i.mnemonic));
+                        const Form3 * form3(form2 ? 0 : form3_table.find(i.mnemonic));
 
-                        DestinationGPR destination(DestinationGPRParser::parse(*j));
+                        if (i.operands.empty())
+                            throw SyntaxError("no destination operand");
 
-                        ++j;
+                        DestinationGPR destination(DestinationGPRParser::parse(i.begin(0), i.end(0)));
 
                         Sequence<SourceOperandPtr> sources;
-                        for ( ; j != j_end ; ++j)
+                        for (unsigned j(1), j_end(i.operands.size()) ; j != j_end ; ++j)
                         {
-                            sources.append(SourceOperandParser::parse(*j));
+                            sources.append(SourceOperandParser::parse(i.begin(j), i.end(j), arena));
                         }
 
-                        if (form2 != form2_instructions_end)
+                        if (form2)
                         {
                             if (sources.size() != form2->third)
                                 throw SyntaxError("expected " + stringify(form2->third) + " source operands, got " + stringify(sources.size()));
 
-                            result = EntityPtr(new Form2Instruction(Enumeration<7>(form2->second), destination, sources, form2->fourth));
+                            result = arena.make<Form2Instruction>(Enumeration<7>(form2->second), destination, sources, form2->fourth);
                         }
-                        else if (form3 != form3_instructions_end)
+                        else if (form3)
                         {
                             if (3 != sources.size())
                                 throw SyntaxError("expected 3 source operands, got " + stringify(sources.size()));
 
-                            result = EntityPtr(new Form3Instruction(Enumeration<5>(form3->second), destination, sources, form3->third));
+                            result = arena.make<Form3Instruction>(Enumeration<5>(form3->second), destination, sources, form3->third);
                         }
                         else
                         {
@@ -565,28 +602,39 @@ namespace gpu
 
                     void visit(const gpu::Label & l)
                     {
-                        result = EntityPtr(new r6xx::alu::Label(l.text));
-                    }
-
-                    void visit(const gpu::Line & l)
-                    {
-                        SyntaxContext::Line(l.number);
+                        result = arena.make<r6xx::alu::Label>(l.text);
                     }
                 };
             }
 
+            Atom
+            Mnemonics::form2(unsigned opcode)
+            {
+                const internal::Form2 * form2(internal::form2_table.reverse(opcode));
+
+                return form2 ? Atom(form2->first) : Atom();
+            }
+
+            Atom
+            Mnemonics::form3(unsigned opcode)
+            {
+                const internal::Form3 * form3(internal::form3_table.reverse(opcode));
+
+                return form3 ? Atom(form3->first) : Atom();
+            }
+
             Sequence<EntityPtr>
-            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input)
+            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input, Arena & arena)
             {
                 Sequence<EntityPtr> result;
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
                 for (Sequence<AssemblyEntityPtr>::Iterator i(input.begin()), i_end(input.end()) ;
                         i != i_end ; ++i)
                 {
-                    converter.result = EntityPtr();
+                    converter.result = 0;
                     (*i)->accept(converter);
-                    if (EntityPtr() != converter.result)
+                    if (0 != converter.result)
                         result.append(converter.result);
                 }
 
@@ -594,12 +642,21 @@ namespace gpu
             }
 
             EntityPtr
-            EntityConverter::convert(const AssemblyEntityPtr & input)
+            EntityConverter::convert(const AssemblyEntity & input, Arena & arena)
+            {
+                internal::EntityConverter converter(arena);
+
+                input.accept(converter);
+
+                return converter.result;
+            }
+
+            EntityPtr
+            EntityConverter::convert(const LexedInstruction & input, Arena & arena)
             {
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
-                converter.result = EntityPtr();
-                input->accept(converter);
+                converter.visit(input);
 
                 return converter.result;
             }
@@ -21,10 +21,12 @@
 #define GPU_GUARD_R6XX_ALU_ENTITIES_HH 1
 
 #include <common/assembly_entities-fwd.hh>
-#include <common/expression-fwd.hh>
+#include <common/expression.hh>
 #include <r6xx/alu_entities-fwd.hh>
 #include <r6xx/alu_destination_gpr.hh>
 #include <r6xx/alu_source_operand.hh>
+#include <utils/arena.hh>
+#include <utils/atom.hh>
 #include <utils/enumeration.hh>
 #include <utils/sequence.hh>
 #include <utils/visitor.hh>
@@ -113,9 +115,9 @@ namespace gpu
             struct Label :
                 public Entity
             {
-                std::string text;
+                Atom text;
 
-                Label(const std::string &);
+                Label(const Atom &);
 
                 ~Label();
 
@@ -125,11 +127,14 @@ namespace gpu
             struct Size :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 ExpressionPtr expression;
 
-                Size(const std::string &, const ExpressionPtr &);
+                /// The expression, compiled once for all evaluations.
+                CompiledExpression compiled;
+
+                Size(const Atom &, const ExpressionPtr &);
 
                 ~Size();
 
@@ -139,11 +144,11 @@ namespace gpu
             struct Type :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 unsigned type;
 
-                Type(const std::string &, unsigned);
+                Type(const Atom &, unsigned);
 
                 ~Type();
 
@@ -152,9 +157,22 @@ namespace gpu
 
             struct EntityConverter
             {
-                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &);
+                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &, Arena &);
+
+                static EntityPtr convert(const AssemblyEntity &, Arena &);
+
+                /// Convert an instruction straight from its tokens.
+                static EntityPtr convert(const LexedInstruction &, Arena &);
+            };
+
+            /// Look up mnemonics by opcode, e.g. for disassembly.
+            struct Mnemonics
+            {
+                /// Return the canonical mnemonic of a Form2 opcode, or the empty atom.
+                static Atom form2(unsigned opcode);
 
-                static EntityPtr convert(const AssemblyEntityPtr &);
+                /// Return the mnemonic of a Form3 opcode, or the empty atom.
+                static Atom form3(unsigned opcode);
             };
 
             struct EntityPrinter
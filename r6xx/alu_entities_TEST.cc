@@ -64,9 +64,29 @@ struct AluEntitiesConverterTest :
             "GroupEnd()");
         std::stringstream input(text);
 
-        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input));
-        Sequence<r6xx::alu::EntityPtr> alu_entities(r6xx::alu::EntityConverter::convert(entities));
+        Arena arena;
+        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena));
+        Sequence<r6xx::alu::EntityPtr> alu_entities(r6xx::alu::EntityConverter::convert(entities, arena));
 
         TEST_CHECK_EQUAL(r6xx::alu::EntityPrinter::print(alu_entities), reference);
     }
 } alu_destination_gpr_parser_test;
+
+struct AluMnemonicsTest :
+    public Test
+{
+    AluMnemonicsTest() :
+        Test("alu_mnemonics_test")
+    {
+    }
+
+    virtual void run()
+    {
+        TEST_CHECK_EQUAL(r6xx::alu::Mnemonics::form2(0x00), "fadd");
+        TEST_CHECK_EQUAL(r6xx::alu::Mnemonics::form2(0x19), "mov");
+        TEST_CHECK_EQUAL(r6xx::alu::Mnemonics::form2(0x34), "iadd");
+        TEST_CHECK_EQUAL(r6xx::alu::Mnemonics::form2(0x72), "shl");
+        TEST_CHECK_EQUAL(r6xx::alu::Mnemonics::form3(0x10), "fmuladd");
+        TEST_CHECK(r6xx::alu::Mnemonics::form3(0x00).empty());
+    }
+} alu_mnemonics_test;
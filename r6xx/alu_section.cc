@@ -19,10 +19,14 @@
 
 #include <common/assembly_entities.hh>
 #include <common/expression.hh>
+#include <elf/data.hh>
+#include <elf/symbol_index.hh>
 #include <r6xx/alu_section.hh>
 #include <r6xx/error.hh>
+#include <utils/sequence-impl.hh>
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include <elf.h>
@@ -43,12 +47,16 @@ namespace gpu
                 struct SymbolScanner :
                     public alu::EntityVisitor
                 {
-                    Sequence<elf::Symbol> symbols;
+                    elf::SymbolIndex symbols;
 
                     unsigned current_offset;
 
+                    /// Evaluates all sizes, resolving each symbol only once.
+                    ExpressionEvaluator evaluator;
+
                     SymbolScanner(const Sequence<alu::EntityPtr> & alu_entities) :
-                        current_offset(0)
+                        current_offset(0),
+                        evaluator(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), this, std::tr1::placeholders::_1))
                     {
                         add_symbol(".alu", 0, STT_SECTION);
 
@@ -61,56 +69,46 @@ namespace gpu
                         set_symbol_size(".alu", current_offset);
                     }
 
-                    void add_symbol(const std::string & name, unsigned offset, unsigned type = 0)
+                    void add_symbol(const Atom & name, unsigned offset, unsigned type = 0)
                     {
                         elf::Symbol symbol(name);
                         symbol.section = ".alu";
                         symbol.type = type;
                         symbol.value = offset;
 
-                        if (symbols.end() != std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)))
-                            throw DuplicateSymbolError(name);
-
-                        symbols.append(symbol);
+                        if (! symbols.append(symbol))
+                            throw DuplicateSymbolError(name.str());
                     }
 
-                    void set_symbol_size(const std::string & name, unsigned size)
+                    void set_symbol_size(const Atom & name, unsigned size)
                     {
-                        elf::Symbol symbol(name);
-                        symbol.section = ".alu";
-
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->size = size;
                     }
 
-                    void set_symbol_type(const std::string & name, unsigned type)
+                    void set_symbol_type(const Atom & name, unsigned type)
                     {
-                        elf::Symbol symbol(name);
-                        symbol.section = ".alu";
-
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->type = type;
                     }
 
-                    unsigned symbol_lookup(const std::string & name)
+                    /// Return the value of a symbol, relative to its section if it is defined.
+                    RelocatableValue symbol_lookup(const Atom & name)
                     {
                         if ("." == name)
-                            return current_offset;
-
-                        elf::Symbol symbol(name);
-                        symbol.section = ".alu";
+                            return RelocatableValue(Atom(".alu"), current_offset);
 
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
-                        return s->value;
+                        return RelocatableValue(s->section, s->value);
                     }
 
 
@@ -137,8 +135,7 @@ namespace gpu
 
                     void visit(const alu::Size & s)
                     {
-                        ExpressionEvaluator e(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), *this, std::tr1::placeholders::_1));
-                        set_symbol_size(s.symbol, e.evaluate(s.expression));
+                        set_symbol_size(s.symbol, evaluator.evaluate(s.compiled));
                     }
 
                     void visit(const alu::Type & t)
@@ -308,7 +305,7 @@ namespace gpu
                     // ALU entity visitation
                     Enumeration<3> index_mode;
 
-                    std::vector<InstructionData> instructions;
+                    elf::DataWriter instructions;
 
                     Generator(const Sequence<alu::EntityPtr> & alu_entities) :
                         alu_section(elf::Section::Parameters()
@@ -316,7 +313,8 @@ namespace gpu
                                 .flags(SHF_ALLOC | SHF_EXECINSTR)
                                 .name(".alu")
                                 .type(SHT_PROGBITS)),
-                        index_mode(4)
+                        index_mode(4),
+                        instructions(alu_section.data())
                     {
                         for (Sequence<alu::EntityPtr>::Iterator i(alu_entities.begin()), i_end(alu_entities.end()) ;
                                 i != i_end ; ++i)
@@ -324,10 +322,6 @@ namespace gpu
                             (*i)->accept(*this);
                         }
 
-                        unsigned size(sizeof(InstructionData) * instructions.size());
-                        alu_section.data().resize(size);
-                        alu_section.data().write(0, reinterpret_cast<const char *>(&instructions[0]), size);
-
                         sections.append(alu_section);
                     }
 
@@ -370,7 +364,7 @@ namespace gpu
                         form2->dst_chan = i.destination.channel;
                         form2->dst_rel = i.destination.relative ? 1 : 0;
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                     }
 
                     void visit(const alu::Form3Instruction & i)
@@ -412,12 +406,20 @@ namespace gpu
                         form3->dst_chan = i.destination.channel;
                         form3->dst_rel = i.destination.relative ? 1 : 0;
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                     }
 
                     void visit(const alu::GroupEnd &)
                     {
-                        reinterpret_cast<Form2Data *>(&instructions.back())->last = 1;
+                        unsigned offset(instructions.size() - sizeof(InstructionData));
+                        InstructionData instruction(instructions.get64(offset));
+
+                        Form2Data form2;
+                        std::memcpy(&form2, &instruction, sizeof(InstructionData));
+                        form2.last = 1;
+                        std::memcpy(&instruction, &form2, sizeof(InstructionData));
+
+                        instructions.patch64(offset, instruction);
                     }
 
                     void visit(const alu::IndexMode & i)
@@ -436,20 +438,33 @@ namespace gpu
             }
 
             void
-            Section::append(const AssemblyEntityPtr & ptr)
+            Section::append(const AssemblyEntity & entity)
             {
-                EntityPtr converted(EntityConverter::convert(ptr));
+                EntityPtr converted(EntityConverter::convert(entity, arena));
 
-                if (0 != converted.get())
+                if (0 != converted)
                 {
                     entities.append(converted);
                 }
             }
 
-            std::string
+            void
+            Section::append(const LexedInstruction & instruction)
+            {
+                EntityPtr converted(EntityConverter::convert(instruction, arena));
+
+                if (0 != converted)
+                {
+                    entities.append(converted);
+                }
+            }
+
+            Atom
             Section::name() const
             {
-                return ".alu";
+                static const Atom name(".alu");
+
+                return name;
             }
 
             Sequence<elf::Section>
@@ -465,7 +480,7 @@ namespace gpu
             {
                 internal::SymbolScanner ss(entities);
 
-                return ss.symbols;
+                return ss.symbols.symbols();
             }
         }
     }
@@ -22,6 +22,7 @@
 
 #include <r6xx/alu_entities.hh>
 #include <r6xx/section.hh>
+#include <utils/arena.hh>
 #include <utils/sequence.hh>
 
 namespace gpu
@@ -33,15 +34,19 @@ namespace gpu
             struct Section :
                 public r6xx::Section
             {
+                Arena arena;
+
                 Sequence<EntityPtr> entities;
 
                 Section();
 
                 virtual ~Section();
 
-                virtual void append(const AssemblyEntityPtr &);
+                virtual void append(const AssemblyEntity &);
+
+                virtual void append(const LexedInstruction &);
 
-                virtual std::string name() const;
+                virtual Atom name() const;
 
                 virtual Sequence<elf::Section> sections(const elf::SymbolTable &, const Sequence<elf::Symbol> &) const;
 
@@ -20,8 +20,6 @@
 #ifndef GPU_GUARD_R6XX_ALU_SOURCE_OPERAND_FWD_HH
 #define GPU_GUARD_R6XX_ALU_SOURCE_OPERAND_FWD_HH 1
 
-#include <utils/memory.hh>
-
 namespace gpu
 {
     namespace r6xx
@@ -30,7 +28,8 @@ namespace gpu
         {
             struct SourceOperand;
 
-            typedef std::tr1::shared_ptr<SourceOperand> SourceOperandPtr;
+            /// SourceOperands are owned by the Arena they have been created in.
+            typedef const SourceOperand * SourceOperandPtr;
 
             struct SourceGPR;
 
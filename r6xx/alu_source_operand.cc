@@ -17,58 +17,16 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/diagnostics.hh>
 #include <r6xx/alu_source_operand.hh>
 #include <r6xx/error.hh>
-#include <utils/destringify.hh>
+#include <r6xx/operand_lexer.hh>
 #include <utils/exception.hh>
 #include <utils/enumeration.hh>
 #include <utils/hexify.hh>
 #include <utils/stringify.hh>
 #include <utils/visitor-impl.hh>
 
-namespace
-{
-    gpu::Enumeration<2> channel_from_suffix(const std::string & suffix)
-    {
-        try
-        {
-            switch (suffix[0])
-            {
-                case 'x':
-                case 'y':
-                case 'z':
-                    return gpu::Enumeration<2>(suffix[0] - 'x');
-
-                case 'w':
-                    return gpu::Enumeration<2>(3);
-            }
-        }
-        catch (gpu::EnumerationValueOutOfBoundsError & e)
-        {
-        }
-
-        throw gpu::r6xx::SourceOperandSyntaxError("'" + gpu::stringify(suffix[0]) + "' is not a valid channel");
-    }
-
-    bool relative_from_suffix(const std::string & suffix)
-    {
-        bool result(false);
-
-        try
-        {
-            if (2 == suffix.size())
-                result = ('r' == suffix[1]);
-
-            return result;
-        }
-        catch (gpu::EnumerationValueOutOfBoundsError & e)
-        {
-        }
-
-        throw gpu::r6xx::SourceOperandSyntaxError("'" + gpu::stringify(suffix[1]) + "' is not a address mode");
-    }
-}
-
 namespace gpu
 {
     template <>
@@ -168,109 +126,92 @@ namespace gpu
                 static_cast<ConstVisits<SourceLiteral> *>(&v)->visit(*this);
             }
 
-            SourceOperandPtr
-            SourceOperandParser::parse(const std::string & input)
+            ParseStatus
+            SourceOperandParser::parse(const char * begin, const char * end, Arena & arena, SourceOperandPtr & result, Diagnostics & diagnostics)
             {
-                const static std::string digits("0123456789");
-                const static std::string modes("ar");
-                const static std::string prefixes("$KC");
-
-                if (input.empty())
-                    throw InternalError("r6xx", "empty input");
+                LexedOperand operand;
+                ParseStatus status(OperandLexer::lex(begin, end, operand, diagnostics));
+                if (ps_success != status)
+                    return status;
 
-                SourceOperandPtr result;
-                std::string operand(input);
-
-                bool negate(false);
-                if ('-' == operand[0])
+                if (LexedOperand::literal_operand == operand.kind)
                 {
-                    negate = true;
-                    operand.erase(0, 1);
+                    result = arena.make<SourceLiteral>(Enumeration<32>(operand.literal));
+
+                    return ps_success;
                 }
 
-                if (operand.empty())
-                    throw SourceOperandSyntaxError("no main part");
+                if (operand.has_selector)
+                    return diagnostics.error(ps_syntax_error, "unexpected selector");
 
-                if (std::string::npos != prefixes.find(operand[0]))
+                if (! operand.has_channel)
+                    return diagnostics.error(ps_syntax_error, "no separator");
+
+                switch (operand.kind)
                 {
-                    if (operand.empty())
-                        throw SourceOperandSyntaxError("no main part");
-
-                    char prefix(operand[0]);
-                    operand.erase(0, 1);
-
-                    if (operand.empty())
-                        throw SourceOperandSyntaxError("no main part");
-
-                    std::string::size_type sep(operand.find('.'));
-                    if (std::string::npos == sep)
-                        throw SourceOperandSyntaxError("no separator");
-
-                    if (0 == sep)
-                        throw SourceOperandSyntaxError("no index part");
-
-                    std::string suffix(operand.substr(sep + 1));
-                    operand.erase(sep);
-
-                    if (std::string::npos != operand.find_first_not_of(digits))
-                        throw SourceOperandSyntaxError("'" + operand + "' is not a number");
-
-                    if ((suffix.empty()) || (2 < suffix.size()))
-                        throw SourceOperandSyntaxError("invalid suffix '" + stringify(suffix) + "'");
-
-                    Enumeration<2> channel(::channel_from_suffix(suffix));
-                    bool relative(::relative_from_suffix(suffix));
-                    unsigned index(destringify<unsigned>(operand));
-
-                    try
-                    {
-                        if ('$' == prefix) // GPR
-                        {
-                            result = SourceOperandPtr(new SourceGPR(channel, Enumeration<7>(index), negate, relative));
-                        }
-                        else if ('K' == prefix) // KCache register
-                        {
-                            result = SourceOperandPtr(new SourceKCache(channel, Enumeration<6>(index), negate, relative));
-                        }
-                        else if ('C' == prefix) // Constant file register
-                        {
-                            result = SourceOperandPtr(new SourceCFile(channel, Enumeration<8>(index), negate, relative));
-                        }
+                    case LexedOperand::gpr_operand:
+                        if (! Enumeration<7>::valid(operand.index))
+                            break;
 
-                        return result;
-                    }
-                    catch (EnumerationValueOutOfBoundsError & e)
-                    {
-                        throw SourceOperandSyntaxError("index out of bounds: " + stringify(index));
-                    }
+                        result = arena.make<SourceGPR>(Enumeration<2>(operand.channel), Enumeration<7>(operand.index),
+                                operand.negated, operand.relative);
+                        return ps_success;
+
+                    case LexedOperand::kcache_operand:
+                        if (! Enumeration<6>::valid(operand.index))
+                            break;
+
+                        result = arena.make<SourceKCache>(Enumeration<2>(operand.channel), Enumeration<6>(operand.index),
+                                operand.negated, operand.relative);
+                        return ps_success;
+
+                    case LexedOperand::cfile_operand:
+                        if (! Enumeration<8>::valid(operand.index))
+                            break;
+
+                        result = arena.make<SourceCFile>(Enumeration<2>(operand.channel), Enumeration<8>(operand.index),
+                                operand.negated, operand.relative);
+                        return ps_success;
+
+                    case LexedOperand::literal_operand:
+                        break;
                 }
-                else // Constant or Literal
+
+                return diagnostics.error(ps_out_of_bounds, "index out of bounds: " + stringify(operand.index));
+            }
+
+            SourceOperandPtr
+            SourceOperandParser::parse(const char * begin, const char * end, Arena & arena)
+            {
+                Diagnostics diagnostics;
+                SourceOperandPtr result(0);
+
+                switch (parse(begin, end, arena, result, diagnostics))
                 {
-                    Enumeration<32> data(0);
-
-                    if (std::string::npos != input.find('.')) // Float literal
-                    {
-                        float value(destringify<float>(input));
-                        data = Enumeration<32>(*reinterpret_cast<unsigned *>(&value));
-
-                    }
-                    else if ('u' == input[input.size() - 1]) // Unsigned integer
-                    {
-                        if (negate)
-                            throw SourceOperandSyntaxError("negative sign in unsigned interger literal");
-
-                        data = Enumeration<32>(destringify<unsigned>(input.substr(0, input.size() - 1)));
-                    }
-                    else // Signed integer
-                    {
-                        signed value(destringify<signed>(input));
-                        data = Enumeration<32>(*reinterpret_cast<unsigned *>(&value));
-                    }
-
-                    return SourceOperandPtr(new SourceLiteral(data));
+                    case ps_success:
+                        return result;
+
+                    case ps_empty_input:
+                        throw InternalError("r6xx", diagnostics.last());
+
+                    case ps_syntax_error:
+                    case ps_out_of_bounds:
+                        break;
                 }
 
-                throw InternalError("r6xx", "Unhandled operand");
+                throw SourceOperandSyntaxError(diagnostics.last());
+            }
+
+            ParseStatus
+            SourceOperandParser::parse(const std::string & input, Arena & arena, SourceOperandPtr & result, Diagnostics & diagnostics)
+            {
+                return parse(input.data(), input.data() + input.size(), arena, result, diagnostics);
+            }
+
+            SourceOperandPtr
+            SourceOperandParser::parse(const std::string & input, Arena & arena)
+            {
+                return parse(input.data(), input.data() + input.size(), arena);
             }
 
             void
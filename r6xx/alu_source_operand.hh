@@ -20,7 +20,9 @@
 #ifndef GPU_GUARD_R6XX_ALU_SOURCE_OPERAND_HH
 #define GPU_GUARD_R6XX_ALU_SOURCE_OPERAND_HH 1
 
+#include <common/diagnostics.hh>
 #include <r6xx/alu_source_operand-fwd.hh>
+#include <utils/arena.hh>
 #include <utils/enumeration.hh>
 #include <utils/visitor.hh>
 
@@ -106,11 +108,24 @@ namespace gpu
                 void accept(SourceOperandVisitor & v) const;
             };
 
-            typedef std::tr1::shared_ptr<SourceOperand> SourceOperandPtr;
-
             struct SourceOperandParser
             {
-                static SourceOperandPtr parse(const std::string & operand);
+                /**
+                 * Parse operand without throwing.
+                 *
+                 * On success, result is created in arena. Otherwise, a message
+                 * is recorded in diagnostics and result is left untouched.
+                 */
+                static ParseStatus parse(const std::string & operand, Arena & arena, SourceOperandPtr & result, Diagnostics & diagnostics);
+
+                /// Parse operand, throwing SourceOperandSyntaxError on failure.
+                static SourceOperandPtr parse(const std::string & operand, Arena & arena);
+
+                /// Parse the text [begin, end) without throwing, as with a string.
+                static ParseStatus parse(const char * begin, const char * end, Arena & arena, SourceOperandPtr & result, Diagnostics & diagnostics);
+
+                /// Parse the text [begin, end), throwing SourceOperandSyntaxError on failure.
+                static SourceOperandPtr parse(const char * begin, const char * end, Arena & arena);
             };
 
             class SourceOperandPrinter :
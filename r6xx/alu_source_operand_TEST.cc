@@ -65,16 +65,42 @@ struct AluSourceOperandParserTest :
         const static DATA * invalid_data_end(invalid_data_begin + sizeof(invalid_data) / sizeof(DATA));
 
         r6xx::alu::SourceOperandPrinter p;
+        Arena arena;
 
         for (const DATA * i(valid_data_begin), * i_end(valid_data_end) ; i != i_end ; ++i)
         {
-            TEST_CHECK_EQUAL(p.print(r6xx::alu::SourceOperandParser::parse(i->first)), i->second);
+            TEST_CHECK_EQUAL(p.print(r6xx::alu::SourceOperandParser::parse(i->first, arena)), i->second);
         }
 
         for (const DATA * i(invalid_data_begin), * i_end(invalid_data_end) ; i != i_end ; ++i)
         {
-            TEST_CHECK_THROWS(r6xx::alu::SourceOperandParser::parse(i->first), r6xx::SourceOperandSyntaxError);
+            TEST_CHECK_THROWS(r6xx::alu::SourceOperandParser::parse(i->first, arena), r6xx::SourceOperandSyntaxError);
         }
+
+        // the status interface agrees with the throwing one, and records one message per failure
+        Diagnostics diagnostics;
+        for (const DATA * i(valid_data_begin), * i_end(valid_data_end) ; i != i_end ; ++i)
+        {
+            r6xx::alu::SourceOperandPtr operand(0);
+            TEST_CHECK_EQUAL(r6xx::alu::SourceOperandParser::parse(i->first, arena, operand, diagnostics), ps_success);
+            TEST_CHECK_EQUAL(p.print(operand), i->second);
+        }
+        TEST_CHECK(diagnostics.empty());
+
+        for (const DATA * i(invalid_data_begin), * i_end(invalid_data_end) ; i != i_end ; ++i)
+        {
+            r6xx::alu::SourceOperandPtr operand(0);
+            TEST_CHECK(ps_success != r6xx::alu::SourceOperandParser::parse(i->first, arena, operand, diagnostics));
+            TEST_CHECK(0 == operand);
+        }
+        TEST_CHECK_EQUAL(diagnostics.size(), unsigned(invalid_data_end - invalid_data_begin));
+
+        r6xx::alu::SourceOperandPtr operand(0);
+        TEST_CHECK_EQUAL(r6xx::alu::SourceOperandParser::parse("$128.x", arena, operand, diagnostics), ps_out_of_bounds);
+        TEST_CHECK_EQUAL(diagnostics.last(), "index out of bounds: 128");
+        TEST_CHECK_EQUAL(r6xx::alu::SourceOperandParser::parse("$0.q", arena, operand, diagnostics), ps_syntax_error);
+        TEST_CHECK_EQUAL(diagnostics.last(), "'q' is not a valid channel");
+        TEST_CHECK_EQUAL(r6xx::alu::SourceOperandParser::parse("", arena, operand, diagnostics), ps_empty_input);
     }
 #undef DATA
 } alu_source_operand_parser_test;
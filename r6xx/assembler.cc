@@ -17,17 +17,24 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/assembly_parser.hh>
 #include <elf/file.hh>
 #include <elf/string_table.hh>
 #include <elf/symbol_table.hh>
 #include <r6xx/assembler.hh>
 #include <r6xx/error.hh>
+#include <r6xx/kernel_image.hh>
 #include <r6xx/section.hh>
+#include <utils/mapped_file.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 #include <utils/sequence-impl.hh>
 
 #include <algorithm>
+#include <istream>
 #include <list>
+#include <streambuf>
+#include <string>
+#include <vector>
 
 #include <elf.h>
 
@@ -40,57 +47,37 @@ namespace gpu
 
         Sequence<elf::Symbol> symbols;
 
-        elf::StringTable strtab;
-
-        elf::SymbolTable symtab;
-
-        Implementation() :
-            symtab(strtab)
+        Implementation(const Sequence<gpu::SectionPtr> & sections) :
+            sections(sections)
         {
-        }
-    };
-
-    namespace r6xx
-    {
-        Assembler::Assembler(const Sequence<std::tr1::shared_ptr<AssemblyEntity> > & entities) :
-            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>)
-        {
-            _imp->sections = SectionConverter::convert(entities);
-
-            for (Sequence<gpu::SectionPtr>::Iterator i(_imp->sections.begin()), i_end(_imp->sections.end()) ;
+            for (Sequence<gpu::SectionPtr>::Iterator i(sections.begin()), i_end(sections.end()) ;
                     i != i_end ; ++i)
             {
-                _imp->symbols.append((*i)->symbols());
+                symbols.append((*i)->symbols());
             }
         }
 
-        Assembler::~Assembler()
+        /// Emit the object file into file, using the given, empty tables.
+        void emit(elf::File & file, elf::StringTable & strtab, elf::SymbolTable & symtab, bool symbol_hash) const
         {
-        }
-
-        void
-        Assembler::write(const std::string & filename) const
-        {
-            elf::File file(elf::File::create(elf::File::Parameters()
-                        .data(ELFDATA2LSB)
-                        .machine(0xA600)
-                        .type(ET_REL)));
+            if (symbol_hash)
+                symtab.enable_hash();
 
             // write symbols to symbol table
-            for (Sequence<elf::Symbol>::Iterator s(_imp->symbols.begin()), s_end(_imp->symbols.end()) ;
+            for (Sequence<elf::Symbol>::Iterator s(symbols.begin()), s_end(symbols.end()) ;
                     s != s_end ; ++s)
             {
-                if (".L" == s->name.substr(0, 2))
+                if (s->name.has_prefix(".L"))
                     continue;
 
-                _imp->symtab.append(*s);
+                symtab.append(*s);
             }
 
             // generate and emit instructions
-            for (Sequence<gpu::SectionPtr>::Iterator i(_imp->sections.begin()), i_end(_imp->sections.end()) ;
+            for (Sequence<gpu::SectionPtr>::Iterator i(sections.begin()), i_end(sections.end()) ;
                     i != i_end ; ++i)
             {
-                file.append((*i)->sections(_imp->symtab, _imp->symbols));
+                file.append((*i)->sections(symtab, symbols));
             }
 
             // string table
@@ -121,12 +108,188 @@ namespace gpu
             }
 
             // emit symbols
-            _imp->symtab.write(file.section_table(), symtab_section.data());
+            symtab.write(file.section_table(), symtab_section.data());
+            symtab_section.info(symtab.locals());
+
+            if (symbol_hash)
+            {
+                elf::Section hash_section(elf::Section::Parameters()
+                        .alignment(0x4)
+                        .flags(0)
+                        .link(file.index(symtab_section))
+                        .name(".gnu.hash")
+                        .type(SHT_GNU_HASH));
+                file.append(hash_section);
+
+                symtab.write_hash(hash_section.data());
+            }
 
             // emit strings
-            _imp->strtab.write(strtab_section.data());
+            strtab.write(strtab_section.data());
+        }
+    };
+
+    namespace r6xx
+    {
+        namespace internal
+        {
+            /// Return the parameters of the object files of all assemblers.
+            static elf::File::Parameters object_parameters()
+            {
+                return elf::File::Parameters()
+                    .data(ELFDATA2LSB)
+                    .machine(0xA600)
+                    .type(ET_REL);
+            }
+
+            /// SourceBuffer reads source text in place, where std::istringstream would copy it.
+            class SourceBuffer :
+                public std::streambuf
+            {
+                public:
+                    SourceBuffer(const std::string & source)
+                    {
+                        char * begin(const_cast<char *>(source.data()));
+                        setg(begin, begin, begin + source.size());
+                    }
+            };
+        }
+
+        Assembler::Assembler(const Sequence<AssemblyEntityPtr> & entities) :
+            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>(SectionConverter::convert(entities)))
+        {
+        }
+
+        Assembler::Assembler(const Sequence<AssemblyEntityPtr> & entities, const LineTable & lines) :
+            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>(SectionConverter::convert(entities, lines)))
+        {
+        }
+
+        static Sequence<gpu::SectionPtr> convert_stream(std::istream & input)
+        {
+            SectionConverter converter;
+
+            AssemblyParser::parse(input, converter);
+
+            return converter.sections();
+        }
+
+        Assembler::Assembler(std::istream & input) :
+            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>(convert_stream(input)))
+        {
+        }
+
+        static Sequence<gpu::SectionPtr> convert_file(const MappedFile & input)
+        {
+            SectionConverter converter;
+
+            AssemblyParser::parse(input, converter);
+
+            return converter.sections();
+        }
+
+        Assembler::Assembler(const MappedFile & input) :
+            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>(convert_file(input)))
+        {
+        }
+
+        Assembler::Assembler(const KernelImage & image) :
+            PrivateImplementationPattern<r6xx::Assembler>(new Implementation<r6xx::Assembler>(image.sections()))
+        {
+        }
+
+        Assembler::~Assembler()
+        {
+        }
+
+        void
+        Assembler::save(const std::string & filename) const
+        {
+            KernelImage::write(_imp->sections, filename);
+        }
+
+        elf::File
+        Assembler::object(bool symbol_hash) const
+        {
+            elf::File file(elf::File::create(internal::object_parameters()));
+            elf::StringTable strtab;
+            elf::SymbolTable symtab(strtab);
+
+            _imp->emit(file, strtab, symtab, symbol_hash);
+
+            return file;
+        }
+
+        void
+        Assembler::write(const std::string & filename, bool symbol_hash) const
+        {
+            object(symbol_hash).write(filename);
+        }
+
+        void
+        Assembler::write(int fd, bool symbol_hash) const
+        {
+            object(symbol_hash).write(fd);
+        }
+
+        void
+        Assembler::write(std::vector<char> & buffer, bool symbol_hash) const
+        {
+            object(symbol_hash).write(buffer);
+        }
+    }
+
+    template <>
+    struct Implementation<r6xx::AssemblerContext>
+    {
+        elf::File file;
+
+        elf::StringTable strtab;
+
+        elf::SymbolTable symtab;
+
+        std::vector<char> object;
+
+        Implementation() :
+            file(elf::File::create(r6xx::internal::object_parameters())),
+            symtab(strtab)
+        {
+        }
+    };
+
+    namespace r6xx
+    {
+        AssemblerContext::AssemblerContext() :
+            PrivateImplementationPattern<r6xx::AssemblerContext>(new Implementation<r6xx::AssemblerContext>)
+        {
+        }
+
+        AssemblerContext::~AssemblerContext()
+        {
+        }
+
+        const std::vector<char> &
+        AssemblerContext::assemble(std::istream & input, bool symbol_hash)
+        {
+            Implementation<r6xx::Assembler> assembler(convert_stream(input));
+
+            _imp->file.clear();
+            _imp->strtab.clear();
+            _imp->symtab.clear();
+
+            assembler.emit(_imp->file, _imp->strtab, _imp->symtab, symbol_hash);
+            _imp->file.write(_imp->object);
+
+            return _imp->object;
+        }
+
+        const std::vector<char> &
+        AssemblerContext::assemble(const std::string & source, bool symbol_hash)
+        {
+            internal::SourceBuffer buffer(source);
+            std::istream input(&buffer);
 
-            file.write(filename);
+            return assemble(input, symbol_hash);
         }
     }
 }
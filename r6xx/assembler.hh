@@ -21,23 +21,96 @@
 #define GPU_GUARD_R6XX_ASSEMBLER_HH 1
 
 #include <common/assembly_entities-fwd.hh>
+#include <common/line_table.hh>
+#include <elf/file.hh>
 #include <r6xx/section.hh>
 #include <utils/private_implementation_pattern.hh>
 #include <utils/sequence.hh>
 
+#include <istream>
+#include <string>
+#include <vector>
+
 namespace gpu
 {
+    class MappedFile;
+
     namespace r6xx
     {
+        class KernelImage;
+
         class Assembler :
             public PrivateImplementationPattern<Assembler>
         {
             public:
-                Assembler(const Sequence<std::tr1::shared_ptr<AssemblyEntity> > & entities);
+                Assembler(const Sequence<AssemblyEntityPtr> & entities);
+
+                /// Assemble a parsed sequence, reporting errors at the lines recorded in lines.
+                Assembler(const Sequence<AssemblyEntityPtr> & entities, const LineTable & lines);
+
+                /**
+                 * Assemble source from a stream.
+                 *
+                 * Entities are handed to their sections while parsing, so
+                 * no complete sequence of AssemblyEntities is ever built.
+                 */
+                Assembler(std::istream & input);
+
+                /// Assemble a memory-mapped source file, as with the stream constructor.
+                Assembler(const MappedFile & input);
+
+                /// Assemble the precompiled sections of a kernel image.
+                Assembler(const KernelImage & image);
 
                 ~Assembler();
 
-                void write(const std::string & filename) const;
+                /**
+                 * Return the relocatable object file, without writing it.
+                 *
+                 * With symbol_hash, a .gnu.hash section lets loaders find
+                 * symbols by name without walking .symtab, see elf::SymbolHash.
+                 */
+                elf::File object(bool symbol_hash = false) const;
+
+                /// Write a relocatable object file, see object().
+                void write(const std::string & filename, bool symbol_hash = false) const;
+
+                /// Write a relocatable object file to an open file descriptor, see elf::File::write(int).
+                void write(int fd, bool symbol_hash = false) const;
+
+                /// Write a relocatable object file into buffer, which is resized to fit.
+                void write(std::vector<char> & buffer, bool symbol_hash = false) const;
+
+                /// Save the converted sections as a kernel image, see KernelImage.
+                void save(const std::string & filename) const;
+        };
+
+        /**
+         * AssemblerContext assembles one source after another into object
+         * files in memory, for callers that load kernels right away.
+         *
+         * The object file, its string and symbol tables and the output
+         * buffer are kept from one job to the next, and are cleared rather
+         * than freed in between.
+         */
+        class AssemblerContext :
+            public PrivateImplementationPattern<AssemblerContext>
+        {
+            public:
+                AssemblerContext();
+
+                ~AssemblerContext();
+
+                /**
+                 * Assemble source from a stream, and return the relocatable
+                 * object file, see Assembler::object().
+                 *
+                 * The bytes stay valid until the next job.
+                 */
+                const std::vector<char> & assemble(std::istream & input, bool symbol_hash = false);
+
+                /// Assemble source text in place, as with the stream version.
+                const std::vector<char> & assemble(const std::string & source, bool symbol_hash = false);
         };
     }
 }
@@ -0,0 +1,274 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/assembly_parser.hh>
+#include <common/kernel_template.hh>
+#include <r6xx/assembler.hh>
+#include <r6xx/kernel_image.hh>
+#include <utils/arena.hh>
+#include <utils/destringify.hh>
+#include <utils/exception.hh>
+#include <utils/mapped_file.hh>
+#include <utils/sequence-impl.hh>
+#include <utils/stringify.hh>
+
+#include <cstdlib>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+using namespace gpu;
+
+namespace
+{
+    /*
+     * SyntheticSource generates a large ALU kernel on the fly, so that the
+     * input text itself does not contribute to the peak memory usage.
+     *
+     * An unrolled source holds one group of instructions in a .rept block
+     * instead, which expands to as many lines as the plain source.
+     */
+    class SyntheticSource :
+        public std::streambuf
+    {
+        private:
+            const unsigned _lines;
+
+            const bool _unrolled;
+
+            unsigned _current;
+
+            std::string _line;
+
+            void generate()
+            {
+                static const char * const channels("xyzw");
+
+                if (0 == _current)
+                {
+                    _line = ".section .alu\nkernel:\n";
+
+                    if (_unrolled)
+                    {
+                        _line += ".rept " + stringify((_lines - 2) / 5) + "\n";
+                        for (unsigned i(1) ; i < 5 ; ++i)
+                        {
+                            _line += "\tfadd $" + stringify(i) + "." + channels[i % 4]
+                                + ", $" + stringify(i + 1) + "." + channels[i % 4]
+                                + ", $" + stringify(i + 2) + "." + channels[i % 4] + "\n";
+                        }
+                        _line += ".groupend # end of group\n.endr\n";
+                        _current = _lines - 2;
+                    }
+                }
+                else if (_current + 1 == _lines)
+                {
+                    _line = ".size kernel, .-kernel\n.section .cf\nmain:\n\talu kernel\n.programend\n";
+                }
+                else if (0 == _current % 5)
+                {
+                    _line = ".groupend # end of group\n";
+                }
+                else
+                {
+                    char channel(channels[_current % 4]);
+
+                    _line = "\tfadd $" + stringify(_current % 128) + "." + channel
+                        + ", $" + stringify((_current + 1) % 128) + "." + channel
+                        + ", $" + stringify((_current + 2) % 128) + "." + channel + "\n";
+                }
+            }
+
+        protected:
+            virtual int_type underflow()
+            {
+                while (gptr() == egptr())
+                {
+                    if (_current >= _lines)
+                        return traits_type::eof();
+
+                    generate();
+                    ++_current;
+
+                    char * begin(const_cast<char *>(_line.data()));
+                    setg(begin, begin, begin + _line.size());
+                }
+
+                return traits_type::to_int_type(*gptr());
+            }
+
+        public:
+            SyntheticSource(unsigned lines, bool unrolled) :
+                _lines(lines < 2 ? 2 : lines),
+                _unrolled(unrolled),
+                _current(0)
+            {
+            }
+    };
+
+    double now()
+    {
+        struct timeval tv;
+        ::gettimeofday(&tv, 0);
+
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    /// Number of kernel variants that are assembled in the variants and template modes.
+    const unsigned variants(16);
+
+    /// Return the synthetic source, with one group that uses register reg inserted at its start.
+    std::string variant_source(unsigned lines, const std::string & reg)
+    {
+        SyntheticSource source(lines, false);
+        std::istream input(&source);
+        std::string result((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        std::string::size_type kernel(result.find("kernel:\n") + 8);
+        result.insert(kernel, "\tfadd $" + reg + ".x, $1.x, $2.x\n.groupend\n");
+
+        return result;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    std::string mode("stream");
+    unsigned lines(10000000);
+
+    if (argc > 1)
+        mode = argv[1];
+
+    if (argc > 2)
+        lines = destringify<unsigned>(argv[2]);
+
+    if ((argc > 3) || (("stream" != mode) && ("sequence" != mode) && ("rept" != mode)
+                && ("variants" != mode) && ("template" != mode) && ("image" != mode)
+                && ("file" != mode) && ("memory" != mode)))
+    {
+        std::cerr << "Usage: " << argv[0] << " [stream|sequence|rept|variants|template|image|file|memory] [LINES]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        SyntheticSource source(lines, "rept" == mode);
+        std::istream input(&source);
+
+        const std::string image_name("assembler_BENCHMARK.image");
+        if ("image" == mode)
+        {
+            // precompile untimed, as a build would
+            r6xx::Assembler assembler(input);
+            assembler.save(image_name);
+        }
+
+        unsigned long bytes(0);
+        double start(now());
+
+        if ("variants" == mode)
+        {
+            // each variant goes through the whole text path
+            for (unsigned i(0) ; i < variants ; ++i)
+            {
+                std::stringstream variant(variant_source(lines, stringify(i)));
+                r6xx::Assembler assembler(variant);
+            }
+        }
+        else if ("template" == mode)
+        {
+            std::stringstream text(".param reg, 0\n" + variant_source(lines, "\\reg"));
+            KernelTemplate kernel(text);
+
+            for (unsigned i(0) ; i < variants ; ++i)
+            {
+                KernelTemplate::Bindings bindings;
+                bindings["reg"] = stringify(i);
+
+                Arena arena;
+                LineTable lines;
+                Sequence<AssemblyEntityPtr> entities(kernel.instantiate(bindings, arena, lines));
+                r6xx::Assembler assembler(entities, lines);
+            }
+        }
+        else if ("file" == mode)
+        {
+            // each variant takes a round trip through the filesystem, as a loader would
+            const std::string object_name("assembler_BENCHMARK.o");
+            for (unsigned i(0) ; i < variants ; ++i)
+            {
+                std::stringstream variant(variant_source(lines, stringify(i)));
+                r6xx::Assembler assembler(variant);
+                assembler.write(object_name);
+
+                MappedFile object(object_name);
+                bytes += object.size();
+            }
+        }
+        else if ("memory" == mode)
+        {
+            r6xx::AssemblerContext context;
+            for (unsigned i(0) ; i < variants ; ++i)
+            {
+                bytes += context.assemble(variant_source(lines, stringify(i))).size();
+            }
+        }
+        else if ("image" == mode)
+        {
+            r6xx::KernelImage image(image_name);
+            r6xx::Assembler assembler(image);
+        }
+        else if ("sequence" != mode)
+        {
+            r6xx::Assembler assembler(input);
+        }
+        else
+        {
+            Arena arena;
+            LineTable lines;
+            Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+            r6xx::Assembler assembler(entities, lines);
+        }
+
+        double stop(now());
+
+        struct rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+
+        std::cout << "mode: " << mode << std::endl;
+        std::cout << "lines: " << lines << std::endl;
+        std::cout << "time: " << (stop - start) << " s" << std::endl;
+        if (0 != bytes)
+            std::cout << "objects: " << variants << " of " << bytes / variants << " bytes, " << (stop - start) / variants * 1e6 << " us each" << std::endl;
+        std::cout << "peak rss: " << usage.ru_maxrss << " kB" << std::endl;
+    }
+    catch (Exception & e)
+    {
+        std::cerr << "Caught exception: " << e.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -21,13 +21,21 @@
 #include <common/assembly_entities.hh>
 #include <common/assembly_parser.hh>
 #include <common/syntax.hh>
+#include <elf/file.hh>
+#include <elf/symbol.hh>
 #include <r6xx/assembler.hh>
 #include <r6xx/section.hh>
+#include <utils/mapped_file.hh>
 #include <utils/memory.hh>
 #include <utils/sequence-impl.hh>
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <elf.h>
 
 using namespace gpu;
 using namespace tests;
@@ -40,20 +48,122 @@ struct AssemblerTest :
     {
     }
 
+    std::string read_file(const std::string & name)
+    {
+        std::ifstream file(name.c_str(), std::ios_base::in | std::ios_base::binary);
+        std::stringstream result;
+
+        result << file.rdbuf();
+
+        return result.str();
+    }
+
     void run_one(const std::string & s)
     {
         std::string input_name(std::string(GPU_SRCDIR) + "/r6xx/assembler_TEST_DATA/" + s + ".s");
         SyntaxContext::File f(input_name);
         std::fstream input(input_name.c_str(), std::ios_base::in);
 
-        Sequence<std::tr1::shared_ptr<AssemblyEntity> > entities(AssemblyParser::parse(input));
-        r6xx::Assembler a(entities);
+        Arena arena;
+        LineTable lines;
+        Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+        r6xx::Assembler a(entities, lines);
+
+        std::string output_name(std::string(GPU_BUILDDIR) + "/r6xx/assembler_TEST_" + s);
+        a.write(output_name + ".output");
+
+        // streaming from a stream and from a mapped file needs to produce identical output
+        std::fstream stream_input(input_name.c_str(), std::ios_base::in);
+        r6xx::Assembler b(stream_input);
+        b.write(output_name + "_stream.output");
+        TEST_CHECK_EQUAL(read_file(output_name + ".output"), read_file(output_name + "_stream.output"));
+
+        r6xx::Assembler c((MappedFile(input_name)));
+        c.write(output_name + "_mapped.output");
+        TEST_CHECK_EQUAL(read_file(output_name + ".output"), read_file(output_name + "_mapped.output"));
+
+        // as does writing into memory, also for repeated jobs of a context
+        std::string expected(read_file(output_name + ".output"));
+        std::vector<char> buffer;
+        c.write(buffer);
+        TEST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), expected);
+
+        std::string source(read_file(input_name));
+        r6xx::AssemblerContext context;
+        for (unsigned i(0) ; i < 3 ; ++i)
+        {
+            const std::vector<char> & object(context.assemble(source));
+            TEST_CHECK_EQUAL(std::string(object.begin(), object.end()), expected);
+        }
+
+        // a job with a hash leaves nothing behind for the next one
+        TEST_CHECK(context.assemble(source, true).size() > expected.size());
+        const std::vector<char> & object(context.assemble(source));
+        TEST_CHECK_EQUAL(std::string(object.begin(), object.end()), expected);
 
-        a.write(std::string(GPU_BUILDDIR) + "/r6xx/assembler_TEST_" + s + ".output");
+        // hashing keeps the binding of all symbols, and locals come first
+        check_locals(buffer);
+        c.write(buffer, true);
+        check_locals(buffer);
+    }
+
+    /// Check that the sh_info of the symbol table of object separates its local symbols from the others.
+    void check_locals(const std::vector<char> & object)
+    {
+        Elf32_Ehdr ehdr;
+        std::memcpy(&ehdr, &object[0], sizeof(Elf32_Ehdr));
+
+        for (unsigned i(1) ; i < ehdr.e_shnum ; ++i)
+        {
+            Elf32_Shdr shdr;
+            std::memcpy(&shdr, &object[ehdr.e_shoff + i * sizeof(Elf32_Shdr)], sizeof(Elf32_Shdr));
+            if (SHT_SYMTAB != shdr.sh_type)
+                continue;
+
+            TEST_CHECK(shdr.sh_info >= 1u);
+            for (unsigned j(1) ; j < shdr.sh_size / sizeof(Elf32_Sym) ; ++j)
+            {
+                Elf32_Sym sym;
+                std::memcpy(&sym, &object[shdr.sh_offset + j * sizeof(Elf32_Sym)], sizeof(Elf32_Sym));
+                TEST_CHECK_EQUAL(j < shdr.sh_info, STB_LOCAL == ELF32_ST_BIND(sym.st_info));
+            }
+        }
+    }
+
+    std::string error_message(const std::string & source, bool streaming)
+    {
+        SyntaxContext::File f("error.s");
+        std::stringstream input(source);
+
+        try
+        {
+            if (streaming)
+            {
+                r6xx::Assembler a(input);
+            }
+            else
+            {
+                Arena arena;
+                LineTable lines;
+                Sequence<AssemblyEntityPtr> entities(AssemblyParser::parse(input, arena, lines));
+                r6xx::Assembler a(entities, lines);
+            }
+        }
+        catch (SyntaxError & e)
+        {
+            return e.message();
+        }
+
+        return "";
     }
 
     virtual void run()
     {
         run_one("minimal");
+
+        // errors need to point at the offending line, not at the last line parsed
+        std::string source("\t.alu\n\tfoo R0.x, R1.x\n\t.cf\n\n");
+        TEST_CHECK_EQUAL(error_message(source, true).substr(0, 10), "error.s:2:");
+        TEST_CHECK_EQUAL(error_message(source, false).substr(0, 10), "error.s:2:");
     }
 } assembler_test;
@@ -22,14 +22,13 @@
 #include <common/expression.hh>
 #include <r6xx/cf_entities.hh>
 #include <r6xx/error.hh>
-#include <utils/destringify.hh>
+#include <utils/number_parser.hh>
+#include <utils/perfect_hash.hh>
 #include <utils/sequence-impl.hh>
 #include <utils/stringify.hh>
 #include <utils/tuple.hh>
 #include <utils/visitor-impl.hh>
 
-#include <algorithm>
-
 namespace gpu
 {
     template
@@ -91,7 +90,7 @@ namespace gpu
             {
             }
 
-            ALUClause::ALUClause(const Enumeration<4> & opcode, const std::string & clause) :
+            ALUClause::ALUClause(const Enumeration<4> & opcode, const Atom & clause) :
                 clause(clause),
                 opcode(opcode)
             {
@@ -107,7 +106,7 @@ namespace gpu
                 static_cast<ConstVisits<ALUClause> *>(&v)->visit(*this);
             }
 
-            BranchInstruction::BranchInstruction(const Enumeration<7> & opcode, const std::string & target, unsigned count) :
+            BranchInstruction::BranchInstruction(const Enumeration<7> & opcode, const Atom & target, unsigned count) :
                 count(count),
                 opcode(opcode),
                 target(target)
@@ -124,7 +123,7 @@ namespace gpu
                 static_cast<ConstVisits<BranchInstruction> *>(&v)->visit(*this);
             }
 
-            Label::Label(const std::string & t) :
+            Label::Label(const Atom & t) :
                 text(t)
             {
             }
@@ -139,7 +138,7 @@ namespace gpu
                 static_cast<ConstVisits<Label> *>(&v)->visit(*this);
             }
 
-            LoopInstruction::LoopInstruction(const Enumeration<7> & opcode, const std::string & target, const std::string & counter) :
+            LoopInstruction::LoopInstruction(const Enumeration<7> & opcode, const Atom & target, const Atom & counter) :
                 counter(counter),
                 opcode(opcode),
                 target(target)
@@ -184,9 +183,10 @@ namespace gpu
                 static_cast<ConstVisits<ProgramEnd> *>(&v)->visit(*this);
             }
 
-            Size::Size(const std::string & s, const ExpressionPtr & e) :
+            Size::Size(const Atom & s, const ExpressionPtr & e) :
                 symbol(s),
-                expression(e)
+                expression(e),
+                compiled(e)
             {
             }
 
@@ -200,7 +200,7 @@ namespace gpu
                 static_cast<ConstVisits<Size> *>(&v)->visit(*this);
             }
 
-            Type::Type(const std::string & s, unsigned t) :
+            Type::Type(const Atom & s, unsigned t) :
                 symbol(s),
                 type(t)
             {
@@ -216,7 +216,7 @@ namespace gpu
                 static_cast<ConstVisits<Type> *>(&v)->visit(*this);
             }
 
-            TextureFetchClause::TextureFetchClause(const std::string & clause) :
+            TextureFetchClause::TextureFetchClause(const Atom & clause) :
                 clause(clause)
             {
             }
@@ -337,7 +337,6 @@ namespace gpu
                  * opcode
                  */
                 typedef Tuple<std::string, unsigned> AClause;
-                typedef TupleComparator<AClause, std::string, 1> AClauseComparator;
                 const static AClause aclause_instructions[] =
                 {
                     AClause("alu",                    0x08),
@@ -348,15 +347,13 @@ namespace gpu
                     AClause("alu_pop_twice_after",    0x0b),
                     AClause("alu_push_before",        0x09)
                 };
-                const static AClause * aclause_instructions_begin(aclause_instructions);
-                const static AClause * aclause_instructions_end(aclause_instructions + sizeof(aclause_instructions) / sizeof(AClause));
+                const static PerfectHash<AClause> aclause_table(aclause_instructions, aclause_instructions + sizeof(aclause_instructions) / sizeof(AClause));
 
                 /*
                  * mnemonic
                  * opcode
                  */
                 typedef Tuple<std::string, unsigned> Branch;
-                typedef TupleComparator<Branch, std::string, 1> BranchComparator;
                 const static Branch branch_instructions[] =
                 {
                     Branch("call",      0x0d),
@@ -366,8 +363,7 @@ namespace gpu
                     Branch("push",      0x0a),
                     Branch("return",    0x0e)
                 };
-                const static Branch * branch_instructions_begin(branch_instructions);
-                const static Branch * branch_instructions_end(branch_instructions + sizeof(branch_instructions) / sizeof(Branch));
+                const static PerfectHash<Branch> branch_table(branch_instructions, branch_instructions + sizeof(branch_instructions) / sizeof(Branch));
 
                 /*
                  * mnemonic
@@ -375,7 +371,6 @@ namespace gpu
                  * needs counter?
                  */
                 typedef Tuple<std::string, unsigned, bool> Loop;
-                typedef TupleComparator<Loop, std::string, 1> LoopComparator;
                 const static Loop loop_instructions[] =
                 {
                     Loop("loop_break",          0x09, false),
@@ -384,68 +379,110 @@ namespace gpu
                     Loop("loop_start",          0x04, true),
                     Loop("loop_start_no_al",    0x07, false)
                 };
-                const static Loop * loop_instructions_begin(loop_instructions);
-                const static Loop * loop_instructions_end(loop_instructions + sizeof(loop_instructions) / sizeof(Loop));
+                const static PerfectHash<Loop> loop_table(loop_instructions, loop_instructions + sizeof(loop_instructions) / sizeof(Loop));
+
+                enum DirectiveKind
+                {
+                    dk_programend,
+                    dk_size,
+                    dk_type
+                };
+
+                /*
+                 * directive name
+                 * directive kind
+                 */
+                typedef Tuple<std::string, unsigned> KnownDirective;
+                const static KnownDirective known_directives[] =
+                {
+                    KnownDirective("programend",    dk_programend),
+                    KnownDirective("size",          dk_size),
+                    KnownDirective("type",          dk_type)
+                };
+                const static PerfectHash<KnownDirective> directive_table(known_directives, known_directives + sizeof(known_directives) / sizeof(KnownDirective));
 
                 struct EntityConverter :
                     public AssemblyEntityVisitor
                 {
+                    Arena & arena;
+
                     EntityPtr result;
 
+                    EntityConverter(Arena & arena) :
+                        arena(arena),
+                        result(0)
+                    {
+                    }
+
                     void visit(const Comment &) { }
                     void visit(const Data &) { }
 
                     void visit(const Directive & d)
                     {
-                        if ("programend" == d.name)
-                        {
-                            if (! d.params.empty())
-                                throw SyntaxError("the '.programend' directive does not take parameters");
+                        const KnownDirective * directive(directive_table.find(d.name));
+                        if (! directive)
+                            throw SyntaxError("unknown directive '." + d.name + "' in control flow section");
 
-                            result = EntityPtr(new ProgramEnd);
-                        }
-                        else if ("size" == d.name)
+                        switch (directive->second)
                         {
-                            Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
+                            case dk_programend:
+                                if (! d.params.empty())
+                                    throw SyntaxError("the '.programend' directive does not take parameters");
 
-                            result = EntityPtr(new Size(parameters.first, parameters.second));
-                        }
-                        else if ("type" == d.name)
-                        {
-                            Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
+                                result = arena.make<ProgramEnd>();
+                                break;
 
-                            result = EntityPtr(new Type(parameters.first, parameters.second));
-                        }
-                        else
-                        {
-                            throw SyntaxError("unknown directive '." + d.name + "' in control flow section");
+                            case dk_size:
+                                {
+                                    Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
+
+                                    result = arena.make<Size>(parameters.first, parameters.second);
+                                }
+                                break;
+
+                            case dk_type:
+                                {
+                                    Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
+
+                                    result = arena.make<Type>(parameters.first, parameters.second);
+                                }
+                                break;
                         }
                     }
 
                     void visit(const Instruction & i)
                     {
-                        const AClause * aclause(std::find_if(aclause_instructions_begin, aclause_instructions_end, AClauseComparator(i.mnemonic)));
-                        const Branch * branch(std::find_if(branch_instructions_begin, branch_instructions_end, BranchComparator(i.mnemonic)));
-                        const Loop * loop(std::find_if(loop_instructions_begin, loop_instructions_end, LoopComparator(i.mnemonic)));
+                        InstructionTokens tokens(i);
 
-                        if (aclause != aclause_instructions_end)
+                        visit(tokens.lexed);
+                    }
+
+                    void visit(const LexedInstruction & i)
+                    {
+                        const AClause * aclause(aclause_table.find(i.mnemonic));
+                        const Branch * branch(branch_table.find(i.mnemonic));
+                        const Loop * loop(loop_table.find(i.mnemonic));
+
+                        if (aclause)
                         {
                             if (1 != i.operands.size())
                                 throw SyntaxError("expected 1 source operand, got " + stringify(i.operands.size()));
 
-                            result = EntityPtr(new ALUClause(Enumeration<4>(aclause->second), i.operands.first()));
+                            result = arena.make<ALUClause>(Enumeration<4>(aclause->second), i.operand(0));
                         }
-                        else if (branch != branch_instructions_end)
+                        else if (branch)
                         {
                             if (2 != i.operands.size())
                                 throw SyntaxError("expected 2 source operands, got " + stringify(i.operands.size()));
 
-                            std::string target(i.operands.first());
-                            unsigned count(destringify<unsigned>(i.operands.last()));
+                            std::string target(i.operand(0));
+                            unsigned count;
+                            if (! NumberParser::parse(i.begin(1), i.end(1), count))
+                                throw SyntaxError("'" + i.operand(1) + "' is not a valid count");
 
-                            result = EntityPtr(new BranchInstruction(Enumeration<7>(branch->second), target, count));
+                            result = arena.make<BranchInstruction>(Enumeration<7>(branch->second), target, count);
                         }
-                        else if (loop != loop_instructions_end)
+                        else if (loop)
                         {
                             unsigned operand_count(loop->third ? 2 : 1);
                             if (i.operands.size() != operand_count)
@@ -453,23 +490,23 @@ namespace gpu
 
                             std::string counter("");
                             if (loop->third)
-                                counter = i.operands.last();
+                                counter = i.operand(1);
 
-                            result = EntityPtr(new LoopInstruction(Enumeration<7>(loop->second), i.operands.first(), counter));
+                            result = arena.make<LoopInstruction>(Enumeration<7>(loop->second), i.operand(0), counter);
                         }
                         else if ("nop" == i.mnemonic)
                         {
                             if (0 != i.operands.size())
                                 throw SyntaxError("'nop' takes no operands");
 
-                            result = EntityPtr(new NopInstruction);
+                            result = arena.make<NopInstruction>();
                         }
                         else if ("tex" == i.mnemonic)
                         {
                             if (1 != i.operands.size())
                                 throw SyntaxError("expected 1 source operand, got " + stringify(i.operands.size()));
 
-                            result = EntityPtr(new TextureFetchClause(i.operands.first()));
+                            result = arena.make<TextureFetchClause>(i.operand(0));
                         }
                         else
                         {
@@ -479,28 +516,47 @@ namespace gpu
 
                     void visit(const gpu::Label & l)
                     {
-                        result = EntityPtr(new r6xx::cf::Label(l.text));
-                    }
-
-                    void visit(const gpu::Line & l)
-                    {
-                        SyntaxContext::Line(l.number);
+                        result = arena.make<r6xx::cf::Label>(l.text);
                     }
                 };
             }
 
+            Atom
+            Mnemonics::alu_clause(unsigned opcode)
+            {
+                const internal::AClause * aclause(internal::aclause_table.reverse(opcode));
+
+                return aclause ? Atom(aclause->first) : Atom();
+            }
+
+            Atom
+            Mnemonics::branch(unsigned opcode)
+            {
+                const internal::Branch * branch(internal::branch_table.reverse(opcode));
+
+                return branch ? Atom(branch->first) : Atom();
+            }
+
+            Atom
+            Mnemonics::loop(unsigned opcode)
+            {
+                const internal::Loop * loop(internal::loop_table.reverse(opcode));
+
+                return loop ? Atom(loop->first) : Atom();
+            }
+
             Sequence<EntityPtr>
-            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input)
+            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input, Arena & arena)
             {
                 Sequence<EntityPtr> result;
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
                 for (Sequence<AssemblyEntityPtr>::Iterator i(input.begin()), i_end(input.end()) ;
                         i != i_end ; ++i)
                 {
-                    converter.result = EntityPtr();
+                    converter.result = 0;
                     (*i)->accept(converter);
-                    if (EntityPtr() != converter.result)
+                    if (0 != converter.result)
                         result.append(converter.result);
                 }
 
@@ -508,12 +564,21 @@ namespace gpu
             }
 
             EntityPtr
-            EntityConverter::convert(const AssemblyEntityPtr & input)
+            EntityConverter::convert(const AssemblyEntity & input, Arena & arena)
+            {
+                internal::EntityConverter converter(arena);
+
+                input.accept(converter);
+
+                return converter.result;
+            }
+
+            EntityPtr
+            EntityConverter::convert(const LexedInstruction & input, Arena & arena)
             {
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
-                converter.result = EntityPtr();
-                input->accept(converter);
+                converter.visit(input);
 
                 return converter.result;
             }
@@ -21,8 +21,10 @@
 #define GPU_GUARD_R6XX_CF_ENTITIES_HH 1
 
 #include <common/assembly_entities-fwd.hh>
-#include <common/expression-fwd.hh>
+#include <common/expression.hh>
 #include <r6xx/cf_entities-fwd.hh>
+#include <utils/arena.hh>
+#include <utils/atom.hh>
 #include <utils/enumeration.hh>
 #include <utils/sequence.hh>
 #include <utils/visitor.hh>
@@ -49,11 +51,11 @@ namespace gpu
             struct ALUClause :
                 public Entity
             {
-                std::string clause;
+                Atom clause;
 
                 Enumeration<4> opcode;
 
-                ALUClause(const Enumeration<4> & opcode, const std::string &);
+                ALUClause(const Enumeration<4> & opcode, const Atom &);
 
                 ~ALUClause();
 
@@ -67,9 +69,9 @@ namespace gpu
 
                 Enumeration<7> opcode;
 
-                std::string target;
+                Atom target;
 
-                BranchInstruction(const Enumeration<7> & opcode, const std::string & target, unsigned count);
+                BranchInstruction(const Enumeration<7> & opcode, const Atom & target, unsigned count);
 
                 ~BranchInstruction();
 
@@ -79,9 +81,9 @@ namespace gpu
             struct Label :
                 public Entity
             {
-                std::string text;
+                Atom text;
 
-                Label(const std::string &);
+                Label(const Atom &);
 
                 ~Label();
 
@@ -91,13 +93,13 @@ namespace gpu
             struct LoopInstruction :
                 public Entity
             {
-                std::string counter;
+                Atom counter;
 
                 Enumeration<7> opcode;
 
-                std::string target;
+                Atom target;
 
-                LoopInstruction(const Enumeration<7> & opcode, const std::string & target, const std::string & counter);
+                LoopInstruction(const Enumeration<7> & opcode, const Atom & target, const Atom & counter);
 
                 ~LoopInstruction();
 
@@ -127,11 +129,14 @@ namespace gpu
             struct Size :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 ExpressionPtr expression;
 
-                Size(const std::string &, const ExpressionPtr &);
+                /// The expression, compiled once for all evaluations.
+                CompiledExpression compiled;
+
+                Size(const Atom &, const ExpressionPtr &);
 
                 ~Size();
 
@@ -141,11 +146,11 @@ namespace gpu
             struct Type :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 unsigned type;
 
-                Type(const std::string &, unsigned);
+                Type(const Atom &, unsigned);
 
                 ~Type();
 
@@ -155,9 +160,9 @@ namespace gpu
             struct TextureFetchClause :
                 public Entity
             {
-                std::string clause;
+                Atom clause;
 
-                TextureFetchClause(const std::string &);
+                TextureFetchClause(const Atom &);
 
                 ~TextureFetchClause();
 
@@ -166,9 +171,25 @@ namespace gpu
 
             struct EntityConverter
             {
-                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &);
+                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &, Arena &);
+
+                static EntityPtr convert(const AssemblyEntity &, Arena &);
+
+                /// Convert an instruction straight from its tokens.
+                static EntityPtr convert(const LexedInstruction &, Arena &);
+            };
+
+            /// Look up mnemonics by opcode, e.g. for disassembly.
+            struct Mnemonics
+            {
+                /// Return the mnemonic of an ALU clause opcode, or the empty atom.
+                static Atom alu_clause(unsigned opcode);
+
+                /// Return the mnemonic of a branch opcode, or the empty atom.
+                static Atom branch(unsigned opcode);
 
-                static EntityPtr convert(const AssemblyEntityPtr &);
+                /// Return the mnemonic of a loop opcode, or the empty atom.
+                static Atom loop(unsigned opcode);
             };
 
             struct EntityPrinter
@@ -19,7 +19,9 @@
 
 #include <common/assembly_entities.hh>
 #include <common/expression.hh>
+#include <elf/data.hh>
 #include <elf/relocation_table.hh>
+#include <elf/symbol_index.hh>
 #include <r6xx/cf_section.hh>
 #include <r6xx/error.hh>
 #include <r6xx/relocation.hh>
@@ -47,12 +49,16 @@ namespace gpu
                 struct SymbolScanner :
                     public cf::EntityVisitor
                 {
-                    Sequence<elf::Symbol> symbols;
+                    elf::SymbolIndex symbols;
 
                     unsigned current_offset;
 
+                    /// Evaluates all sizes, resolving each symbol only once.
+                    ExpressionEvaluator evaluator;
+
                     SymbolScanner(const Sequence<cf::EntityPtr> & cf_entities) :
-                        current_offset(0)
+                        current_offset(0),
+                        evaluator(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), this, std::tr1::placeholders::_1))
                     {
                         add_symbol(".cf", 0, STT_SECTION);
 
@@ -65,58 +71,58 @@ namespace gpu
                         set_symbol_size(".cf", current_offset);
                     }
 
-                    void add_undefined_symbol(const std::string & name, unsigned type)
+                    void add_undefined_symbol(const Atom & name, unsigned type)
                     {
                         elf::Symbol symbol(name);
                         symbol.type = type;
 
-                        if (symbols.end() != std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)))
-                            throw DuplicateSymbolError(name);
-
-                        symbols.append(symbol);
+                        if (! symbols.append(symbol))
+                            throw DuplicateSymbolError(name.str());
                     }
 
-                    void add_symbol(const std::string & name, unsigned offset, unsigned type = 0)
+                    void add_symbol(const Atom & name, unsigned offset, unsigned type = 0)
                     {
                         elf::Symbol symbol(name);
                         symbol.section = ".cf";
                         symbol.type = type;
                         symbol.value = offset;
 
-                        if (symbols.end() != std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)))
-                            throw DuplicateSymbolError(name);
-
-                        symbols.append(symbol);
+                        if (! symbols.append(symbol))
+                            throw DuplicateSymbolError(name.str());
                     }
 
-                    void set_symbol_size(const std::string & name, unsigned size)
+                    void set_symbol_size(const Atom & name, unsigned size)
                     {
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->size = size;
                     }
 
-                    void set_symbol_type(const std::string & name, unsigned type)
+                    void set_symbol_type(const Atom & name, unsigned type)
                     {
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->type = type;
                     }
 
-                    unsigned symbol_lookup(const std::string & name)
+                    /// Return the value of a symbol, relative to its section if it is defined.
+                    RelocatableValue symbol_lookup(const Atom & name)
                     {
                         if ("." == name)
-                            return current_offset;
+                            return RelocatableValue(Atom(".cf"), current_offset);
 
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
-                        return s->value;
+                        if (s->section.empty())
+                            return RelocatableValue(name, 0);
+
+                        return RelocatableValue(s->section, s->value);
                     }
 
                     // cf::EntityVisitor
@@ -154,8 +160,7 @@ namespace gpu
 
                     void visit(const cf::Size & s)
                     {
-                        ExpressionEvaluator e(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), *this, std::tr1::placeholders::_1));
-                        set_symbol_size(s.symbol, e.evaluate(s.expression));
+                        set_symbol_size(s.symbol, evaluator.evaluate(s.compiled));
                     }
 
                     void visit(const cf::Type & t)
@@ -223,13 +228,13 @@ namespace gpu
 
                     elf::Section cf_text;
 
-                    std::vector<InstructionData> instructions;
+                    elf::DataWriter instructions;
 
                     InstructionType last_type;
 
                     elf::RelocationTable reltab;
 
-                    Sequence<elf::Symbol> symbols;
+                    elf::SymbolIndex symbols;
 
                     Generator(const Sequence<cf::EntityPtr> & cf_entities, const elf::SymbolTable & symtab, const Sequence<elf::Symbol> & symbols) :
                         cf_rel(elf::Section::Parameters()
@@ -241,6 +246,7 @@ namespace gpu
                                 .flags(SHF_ALLOC | SHF_EXECINSTR)
                                 .name(".cf")
                                 .type(SHT_PROGBITS)),
+                        instructions(cf_text.data()),
                         last_type(it_none),
                         reltab(symtab),
                         symbols(symbols)
@@ -251,43 +257,33 @@ namespace gpu
                             (*i)->accept(*this);
                         }
 
-                        unsigned size(sizeof(InstructionData) * instructions.size());
-                        cf_text.data().resize(size);
-                        cf_text.data().write(0, reinterpret_cast<const char *>(&instructions[0]), size);
-
                         reltab.write(cf_rel.data());
                     }
 
-                    unsigned offset_of(const std::string & local_symbol, const std::string & section)
+                    unsigned offset_of(const Atom & local_symbol, const Atom & section)
                     {
-                        Sequence<elf::Symbol>::Iterator i(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(local_symbol)));
-                        if (symbols.end() == i)
-                            throw UnresolvedSymbolError(local_symbol);
+                        const elf::Symbol * i(symbols.find(local_symbol));
+                        if (0 == i)
+                            throw UnresolvedSymbolError(local_symbol.str());
 
                         if (section != i->section)
-                            throw InternalError("r6xx", "local symbol '" + local_symbol + "' not in section '" + section + "' as expected");
+                            throw InternalError("r6xx", "local symbol '" + local_symbol.str() + "' not in section '" + section.str() + "' as expected");
 
                         return i->value;
                     }
 
-                    std::string find_symbol_before(const std::string & symbol, const std::string & section)
+                    Atom find_symbol_before(const Atom & symbol, const Atom & section)
                     {
-                        Sequence<elf::Symbol>::Iterator result(symbols.begin());
+                        const elf::Symbol * s(symbols.find(symbol));
+                        const elf::Symbol * result(0);
 
-                        for (Sequence<elf::Symbol>::Iterator s(symbols.begin()), s_end(symbols.end()) ;
-                                s != s_end ; ++s)
-                        {
-                            if (section != s->section)
-                                continue;
-
-                            if (".L" != s->name.substr(0, 2))
-                                result = s;
+                        if ((0 != s) && (section == s->section))
+                            result = symbols.find_global_before(symbol);
 
-                            if (symbol == s->name)
-                                return result->name;
-                        }
+                        if (0 == result)
+                            throw InternalError("r6xx", "Did not find symbol before '" + symbol.str() + "'");
 
-                        throw InternalError("r6xx", "Did not find symbol before '" + symbol + "'");
+                        return result->name;
                     }
 
                     // cf::EntityVisitor
@@ -299,7 +295,7 @@ namespace gpu
                     {
                         // Relocations
                         // TODO KCache relocations
-                        unsigned offset(instructions.size() * sizeof(InstructionData));
+                        unsigned offset(instructions.size());
                         reltab.append(elf::Relocation(offset, a.clause, cfrel_alu_clause, 0));
 
                         // Microcode
@@ -310,19 +306,19 @@ namespace gpu
                         ad->whole_quad_mode = 0;
                         ad->barrier = 0;
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                         last_type = it_alu;
                     }
 
                     void visit(const cf::BranchInstruction & b)
                     {
-                        bool local_branch(".L" == b.target.substr(0, 2));
+                        bool local_branch(b.target.has_prefix(".L"));
 
                         // Relocations
-                        unsigned offset(instructions.size() * sizeof(InstructionData));
+                        unsigned offset(instructions.size());
                         if (local_branch)
                         {
-                            std::string symbol(find_symbol_before(b.target, ".cf"));
+                            Atom symbol(find_symbol_before(b.target, ".cf"));
                             unsigned addend(offset_of(b.target, ".cf") - offset_of(symbol, ".cf"));
 
                             reltab.append(elf::Relocation(offset, symbol, cfrel_pic, addend));
@@ -361,22 +357,22 @@ namespace gpu
                         }
                         while (false);
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                         last_type = it_default;
                     }
 
                     void visit(const cf::LoopInstruction & i)
                     {
-                        bool local_branch(".L" == i.target.substr(0, 2));
+                        bool local_branch(i.target.has_prefix(".L"));
                         bool needs_cf_const(false);
                         if ((0x4 == i.opcode) || (0x7 == i.opcode))
                             needs_cf_const = true;
 
                         // Relocations
-                        unsigned offset(instructions.size() * sizeof(InstructionData));
+                        unsigned offset(instructions.size());
                         if (local_branch)
                         {
-                            std::string symbol(find_symbol_before(i.target, ".cf"));
+                            Atom symbol(find_symbol_before(i.target, ".cf"));
                             unsigned addend(offset_of(i.target, ".cf") - offset_of(symbol, ".cf"));
 
                             reltab.append(elf::Relocation(offset, symbol, cfrel_pic, addend));
@@ -398,13 +394,13 @@ namespace gpu
                         dd->cf_const = needs_cf_const ? (1 << 5) - 1 : 0;
                         dd->opcode = i.opcode;
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                         last_type = it_default;
                     }
 
                     void visit(const cf::NopInstruction &)
                     {
-                        instructions.push_back(InstructionData(0));
+                        instructions.put64(InstructionData(0));
                         last_type = it_default;
                     }
 
@@ -414,11 +410,12 @@ namespace gpu
                         // Push a nop instruction in that case
                         if (it_default != last_type)
                         {
-                            instructions.push_back(InstructionData(0));
+                            instructions.put64(InstructionData(0));
                             last_type = it_default;
                         }
 
-                        instructions.back() |= (1 << 21);
+                        unsigned last(instructions.size() - sizeof(InstructionData));
+                        instructions.patch64(last, instructions.get64(last) | (1 << 21));
                     }
 
                     void visit(const cf::TextureFetchClause &)
@@ -427,7 +424,7 @@ namespace gpu
                         // TODO Count + Address relocation
                         InstructionData instruction(0);
 
-                        instructions.push_back(instruction);
+                        instructions.put64(instruction);
                         last_type = it_default;
                     }
                 };
@@ -442,20 +439,33 @@ namespace gpu
             }
 
             void
-            Section::append(const AssemblyEntityPtr & ptr)
+            Section::append(const AssemblyEntity & entity)
             {
-                EntityPtr converted(EntityConverter::convert(ptr));
+                EntityPtr converted(EntityConverter::convert(entity, arena));
 
-                if (0 != converted.get())
+                if (0 != converted)
                 {
                     entities.append(converted);
                 }
             }
 
-            std::string
+            void
+            Section::append(const LexedInstruction & instruction)
+            {
+                EntityPtr converted(EntityConverter::convert(instruction, arena));
+
+                if (0 != converted)
+                {
+                    entities.append(converted);
+                }
+            }
+
+            Atom
             Section::name() const
             {
-                return ".cf";
+                static const Atom name(".cf");
+
+                return name;
             }
 
             Sequence<elf::Symbol>
@@ -463,7 +473,7 @@ namespace gpu
             {
                 internal::SymbolScanner ss(entities);
 
-                return ss.symbols;
+                return ss.symbols.symbols();
             }
 
             Sequence<elf::Section>
@@ -62,5 +62,10 @@ namespace gpu
             Exception("No such symbol: '" + symbol + "'")
         {
         }
+
+        InvalidKernelImageError::InvalidKernelImageError(const std::string & filename, const std::string & reason) :
+            Exception("Invalid kernel image '" + filename + "': " + reason)
+        {
+        }
     }
 }
@@ -81,6 +81,13 @@ namespace gpu
             public:
                 UnresolvedSymbolError(const std::string & symbol);
         };
+
+        class InvalidKernelImageError :
+            public Exception
+        {
+            public:
+                InvalidKernelImageError(const std::string & filename, const std::string & reason);
+        };
     }
 }
 
@@ -0,0 +1,1228 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/expression.hh>
+#include <common/gpgpu_data_entities.hh>
+#include <common/gpgpu_data_section.hh>
+#include <r6xx/alu_section.hh>
+#include <r6xx/cf_section.hh>
+#include <r6xx/error.hh>
+#include <r6xx/kernel_image.hh>
+#include <r6xx/tex_section.hh>
+#include <utils/exception.hh>
+#include <utils/mapped_file.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+#include <utils/sequence-impl.hh>
+#include <utils/stringify.hh>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace gpu
+{
+    namespace r6xx
+    {
+        namespace image
+        {
+            /*
+             * Layout of an image:
+             *
+             *   Header
+             *   SectionEntry[section_count]
+             *   uint32_t records[record_words]
+             *   char strings[string_bytes], padded with zeros to 4 bytes
+             *
+             * Every record starts with a word holding its type in the upper
+             * 8 bits and its length in words, including this word, in the
+             * lower 24 bits. Strings are referenced by their offset into
+             * the string table, where offset 0 is the empty string.
+             */
+            static const char magic[8] = { 'R', '6', 'X', 'X', 'K', 'I', 'M', 'G' };
+
+            static const uint32_t version(1);
+
+            static const uint32_t byte_order(0x01020304);
+
+            struct Header
+            {
+                char magic[8];
+
+                uint32_t version;
+
+                uint32_t byte_order;
+
+                uint32_t section_count;
+
+                uint32_t record_words;
+
+                uint32_t string_bytes;
+
+                /// FNV-1a hash of everything after the header.
+                uint32_t checksum;
+            };
+
+            struct SectionEntry
+            {
+                uint32_t name;
+
+                uint32_t first;
+
+                uint32_t words;
+            };
+
+            enum RecordType
+            {
+                rt_label = 1,
+                rt_size,
+                rt_type,
+                rt_alu_form2,
+                rt_alu_form3,
+                rt_alu_group_end,
+                rt_alu_index_mode,
+                rt_cf_alu_clause,
+                rt_cf_branch,
+                rt_cf_loop,
+                rt_cf_nop,
+                rt_cf_program_end,
+                rt_cf_texture_fetch_clause,
+                rt_tex_load,
+                rt_data_buffer,
+                rt_data_counter
+            };
+
+            /// Operand kinds of ALU instruction records.
+            enum OperandKind
+            {
+                ok_gpr = 0,
+                ok_kcache,
+                ok_cfile,
+                ok_literal
+            };
+
+            /// Node kinds of expressions in Size records, in prefix order.
+            enum NodeKind
+            {
+                nk_value = 0,
+                nk_variable,
+                nk_sum,
+                nk_difference,
+                nk_operation ///< The operand is the Operation::Operator.
+            };
+
+            static const unsigned max_expression_depth(256);
+
+            static uint32_t record_header(RecordType type, unsigned length)
+            {
+                return (type << 24) | length;
+            }
+
+            static uint32_t hash(const char * begin, const char * end)
+            {
+                uint32_t result(2166136261u);
+                for (const char * c(begin) ; c != end ; ++c)
+                {
+                    result ^= static_cast<unsigned char>(*c);
+                    result *= 16777619u;
+                }
+
+                return result;
+            }
+
+            static unsigned padding(unsigned size)
+            {
+                return (4 - size % 4) % 4;
+            }
+
+            /// Collects the records and strings of an image while writing it.
+            struct Records
+            {
+                std::vector<uint32_t> words;
+
+                std::string strings;
+
+                std::map<Atom, uint32_t> offsets;
+
+                Records() :
+                    strings(1, '\0')
+                {
+                }
+
+                uint32_t string(const Atom & text)
+                {
+                    if (text.empty())
+                        return 0;
+
+                    std::map<Atom, uint32_t>::const_iterator o(offsets.find(text));
+                    if (offsets.end() != o)
+                        return o->second;
+
+                    uint32_t result(strings.size());
+                    strings.append(text.str());
+                    strings.append(1, '\0');
+                    offsets[text] = result;
+
+                    return result;
+                }
+
+                /// Start a record, returning the index of its header word.
+                unsigned begin(RecordType type)
+                {
+                    unsigned result(words.size());
+                    words.push_back(record_header(type, 0));
+
+                    return result;
+                }
+
+                void end(unsigned record)
+                {
+                    words[record] |= words.size() - record;
+                }
+
+                void simple(RecordType type)
+                {
+                    words.push_back(record_header(type, 1));
+                }
+
+                void simple(RecordType type, uint32_t argument)
+                {
+                    words.push_back(record_header(type, 2));
+                    words.push_back(argument);
+                }
+            };
+
+            class ExpressionWriter :
+                public ExpressionVisitor
+            {
+                private:
+                    Records & _records;
+
+                public:
+                    ExpressionWriter(Records & records) :
+                        _records(records)
+                    {
+                    }
+
+                    void visit(Difference & d)
+                    {
+                        _records.words.push_back(nk_difference);
+                        _records.words.push_back(0);
+                        d.left_hand_side()->accept(*this);
+                        d.right_hand_side()->accept(*this);
+                    }
+
+                    void visit(Operation & o)
+                    {
+                        _records.words.push_back(nk_operation);
+                        _records.words.push_back(o.op());
+                        o.left_hand_side()->accept(*this);
+                        o.right_hand_side()->accept(*this);
+                    }
+
+                    void visit(Sum & s)
+                    {
+                        _records.words.push_back(nk_sum);
+                        _records.words.push_back(0);
+                        s.left_hand_side()->accept(*this);
+                        s.right_hand_side()->accept(*this);
+                    }
+
+                    void visit(Value & v)
+                    {
+                        _records.words.push_back(nk_value);
+                        _records.words.push_back(v.value());
+                    }
+
+                    void visit(Variable & v)
+                    {
+                        _records.words.push_back(nk_variable);
+                        _records.words.push_back(_records.string(Atom(v.variable())));
+                    }
+            };
+
+            static void write_size(Records & records, const Atom & symbol, const ExpressionPtr & expression)
+            {
+                unsigned record(records.begin(rt_size));
+                records.words.push_back(records.string(symbol));
+
+                ExpressionWriter writer(records);
+                expression->accept(writer);
+
+                records.end(record);
+            }
+
+            static void write_type(Records & records, const Atom & symbol, unsigned type)
+            {
+                records.words.push_back(record_header(rt_type, 3));
+                records.words.push_back(records.string(symbol));
+                records.words.push_back(type);
+            }
+
+            class ALUWriter :
+                public alu::EntityVisitor,
+                public alu::SourceOperandVisitor
+            {
+                private:
+                    Records & _records;
+
+                    void instruction(RecordType type, unsigned opcode, const alu::DestinationGPR & d, unsigned slots,
+                            const Sequence<alu::SourceOperandPtr> & sources)
+                    {
+                        unsigned record(_records.begin(type));
+                        _records.words.push_back(opcode);
+                        _records.words.push_back(d.index | (d.channel << 8) | (d.relative << 16));
+                        _records.words.push_back(slots);
+
+                        for (Sequence<alu::SourceOperandPtr>::Iterator s(sources.begin()), s_end(sources.end()) ;
+                                s != s_end ; ++s)
+                        {
+                            (*s)->accept(*this);
+                        }
+
+                        _records.end(record);
+                    }
+
+                    void operand(OperandKind kind, unsigned channel, bool negated, bool relative, uint32_t value)
+                    {
+                        _records.words.push_back(kind | (channel << 8) | (negated << 16) | (relative << 17));
+                        _records.words.push_back(value);
+                    }
+
+                public:
+                    ALUWriter(Records & records) :
+                        _records(records)
+                    {
+                    }
+
+                    void visit(const alu::Form2Instruction & i)
+                    {
+                        instruction(rt_alu_form2, i.opcode, i.destination, i.slots, i.sources);
+                    }
+
+                    void visit(const alu::Form3Instruction & i)
+                    {
+                        instruction(rt_alu_form3, i.opcode, i.destination, i.slots, i.sources);
+                    }
+
+                    void visit(const alu::GroupEnd &)
+                    {
+                        _records.simple(rt_alu_group_end);
+                    }
+
+                    void visit(const alu::IndexMode & m)
+                    {
+                        _records.simple(rt_alu_index_mode, m.mode);
+                    }
+
+                    void visit(const alu::Label & l)
+                    {
+                        _records.simple(rt_label, _records.string(l.text));
+                    }
+
+                    void visit(const alu::Size & s)
+                    {
+                        write_size(_records, s.symbol, s.expression);
+                    }
+
+                    void visit(const alu::Type & t)
+                    {
+                        write_type(_records, t.symbol, t.type);
+                    }
+
+                    void visit(const alu::SourceGPR & s)
+                    {
+                        operand(ok_gpr, s.channel, s.negated, s.relative, s.index);
+                    }
+
+                    void visit(const alu::SourceKCache & s)
+                    {
+                        operand(ok_kcache, s.channel, s.negated, s.relative, s.index);
+                    }
+
+                    void visit(const alu::SourceCFile & s)
+                    {
+                        operand(ok_cfile, s.channel, s.negated, s.relative, s.index);
+                    }
+
+                    void visit(const alu::SourceLiteral & s)
+                    {
+                        operand(ok_literal, 0, false, false, s.data);
+                    }
+            };
+
+            class CFWriter :
+                public cf::EntityVisitor
+            {
+                private:
+                    Records & _records;
+
+                public:
+                    CFWriter(Records & records) :
+                        _records(records)
+                    {
+                    }
+
+                    void visit(const cf::ALUClause & c)
+                    {
+                        _records.words.push_back(record_header(rt_cf_alu_clause, 3));
+                        _records.words.push_back(c.opcode);
+                        _records.words.push_back(_records.string(c.clause));
+                    }
+
+                    void visit(const cf::BranchInstruction & b)
+                    {
+                        _records.words.push_back(record_header(rt_cf_branch, 4));
+                        _records.words.push_back(b.opcode);
+                        _records.words.push_back(_records.string(b.target));
+                        _records.words.push_back(b.count);
+                    }
+
+                    void visit(const cf::Label & l)
+                    {
+                        _records.simple(rt_label, _records.string(l.text));
+                    }
+
+                    void visit(const cf::LoopInstruction & l)
+                    {
+                        _records.words.push_back(record_header(rt_cf_loop, 4));
+                        _records.words.push_back(l.opcode);
+                        _records.words.push_back(_records.string(l.target));
+                        _records.words.push_back(_records.string(l.counter));
+                    }
+
+                    void visit(const cf::NopInstruction &)
+                    {
+                        _records.simple(rt_cf_nop);
+                    }
+
+                    void visit(const cf::ProgramEnd &)
+                    {
+                        _records.simple(rt_cf_program_end);
+                    }
+
+                    void visit(const cf::Size & s)
+                    {
+                        write_size(_records, s.symbol, s.expression);
+                    }
+
+                    void visit(const cf::Type & t)
+                    {
+                        write_type(_records, t.symbol, t.type);
+                    }
+
+                    void visit(const cf::TextureFetchClause & c)
+                    {
+                        _records.simple(rt_cf_texture_fetch_clause, _records.string(c.clause));
+                    }
+            };
+
+            class TEXWriter :
+                public tex::EntityVisitor
+            {
+                private:
+                    Records & _records;
+
+                public:
+                    TEXWriter(Records & records) :
+                        _records(records)
+                    {
+                    }
+
+                    void visit(const tex::Label & l)
+                    {
+                        _records.simple(rt_label, _records.string(l.text));
+                    }
+
+                    void visit(const tex::LoadInstruction & i)
+                    {
+                        const tex::DestinationGPR::Selector & s(i.destination.selector);
+
+                        _records.words.push_back(record_header(rt_tex_load, 5));
+                        _records.words.push_back(i.opcode);
+                        _records.words.push_back(i.destination.index | (i.destination.relative << 8));
+                        _records.words.push_back(s.first | (s.second << 8) | (s.third << 16) | (s.fourth << 24));
+                        _records.words.push_back(i.source.index | (i.source.relative << 8));
+                    }
+
+                    void visit(const tex::Size & s)
+                    {
+                        write_size(_records, s.symbol, s.expression);
+                    }
+
+                    void visit(const tex::Type & t)
+                    {
+                        write_type(_records, t.symbol, t.type);
+                    }
+            };
+
+            class DataWriter :
+                public common::DataEntityVisitor
+            {
+                private:
+                    Records & _records;
+
+                public:
+                    DataWriter(Records & records) :
+                        _records(records)
+                    {
+                    }
+
+                    void visit(const common::Buffer & b)
+                    {
+                        _records.simple(rt_data_buffer, _records.string(b.name));
+                    }
+
+                    void visit(const common::Counter & c)
+                    {
+                        _records.simple(rt_data_counter, _records.string(c.name));
+                    }
+            };
+
+            template <typename Visitor_, typename EntityPtr_>
+            void write_entities(Records & records, const Sequence<EntityPtr_> & entities)
+            {
+                Visitor_ writer(records);
+                for (typename Sequence<EntityPtr_>::Iterator e(entities.begin()), e_end(entities.end()) ;
+                        e != e_end ; ++e)
+                {
+                    (*e)->accept(writer);
+                }
+            }
+
+            enum SectionKind
+            {
+                sk_alu,
+                sk_cf,
+                sk_tex,
+                sk_data,
+                sk_other
+            };
+
+            static SectionKind kind_of(gpu::Section & section)
+            {
+                if (dynamic_cast<alu::Section *>(&section))
+                    return sk_alu;
+
+                if (dynamic_cast<cf::Section *>(&section))
+                    return sk_cf;
+
+                if (dynamic_cast<tex::Section *>(&section))
+                    return sk_tex;
+
+                if (dynamic_cast<common::GPGPUDataSection *>(&section))
+                    return sk_data;
+
+                return sk_other;
+            }
+
+            /// Checks records of an image that is being loaded.
+            struct Checker
+            {
+                const std::string & filename;
+
+                const char * strings;
+
+                uint32_t string_bytes;
+
+                Checker(const std::string & filename, const char * strings, uint32_t string_bytes) :
+                    filename(filename),
+                    strings(strings),
+                    string_bytes(string_bytes)
+                {
+                }
+
+                void fail(const std::string & reason) const
+                {
+                    throw InvalidKernelImageError(filename, reason);
+                }
+
+                void check(bool condition, const char * reason) const
+                {
+                    if (! condition)
+                        fail(reason);
+                }
+
+                void string(uint32_t offset) const
+                {
+                    if (offset >= string_bytes)
+                        fail("string offset " + stringify(offset) + " is out of bounds");
+                }
+
+                void expression(const uint32_t *& node, const uint32_t * end, unsigned depth) const
+                {
+                    check(depth < max_expression_depth, "expression is nested too deeply");
+                    check(end - node >= 2, "expression is truncated");
+
+                    uint32_t kind(node[0]), operand(node[1]);
+                    node += 2;
+                    switch (kind)
+                    {
+                        case nk_value:
+                            return;
+
+                        case nk_variable:
+                            string(operand);
+                            return;
+
+                        case nk_sum:
+                        case nk_difference:
+                            check(0 == operand, "sum or difference node has an operand");
+                            expression(node, end, depth + 1);
+                            expression(node, end, depth + 1);
+                            return;
+
+                        case nk_operation:
+                            check(operand <= Operation::remainder, "unknown operator");
+                            expression(node, end, depth + 1);
+                            expression(node, end, depth + 1);
+                            return;
+                    }
+
+                    fail("unknown expression node " + stringify(kind));
+                }
+
+                void alu_operands(const uint32_t * operand, const uint32_t * end) const
+                {
+                    for ( ; operand != end ; operand += 2)
+                    {
+                        uint32_t kind(operand[0] & 0xff), channel((operand[0] >> 8) & 0xff), value(operand[1]);
+
+                        check(0 == (operand[0] >> 18), "source operand has unknown flags");
+                        check(Enumeration<2>::valid(channel), "source channel is out of bounds");
+                        switch (kind)
+                        {
+                            case ok_gpr:
+                                check(Enumeration<7>::valid(value), "source GPR is out of bounds");
+                                continue;
+
+                            case ok_kcache:
+                                check(Enumeration<6>::valid(value), "kcache index is out of bounds");
+                                continue;
+
+                            case ok_cfile:
+                                check(Enumeration<8>::valid(value), "cfile index is out of bounds");
+                                continue;
+
+                            case ok_literal:
+                                check(0 == (operand[0] >> 8), "literal operand has flags");
+                                continue;
+                        }
+
+                        fail("unknown source operand kind " + stringify(kind));
+                    }
+                }
+
+                void alu_instruction(const uint32_t * record, unsigned length) const
+                {
+                    uint32_t destination(record[2]);
+
+                    check(Enumeration<7>::valid(destination & 0xff), "destination GPR is out of bounds");
+                    check(Enumeration<2>::valid((destination >> 8) & 0xff), "destination channel is out of bounds");
+                    check(0 == (destination >> 17), "destination has unknown flags");
+
+                    alu_operands(record + 4, record + length);
+                }
+
+                void tex_gpr(uint32_t gpr) const
+                {
+                    check(Enumeration<7>::valid(gpr & 0xff), "texture GPR is out of bounds");
+                    check(0 == (gpr >> 9), "texture GPR has unknown flags");
+                }
+
+                /// Check one record of a section of the given kind.
+                void record(SectionKind kind, const uint32_t * record, unsigned length) const
+                {
+                    RecordType type(static_cast<RecordType>(record[0] >> 24));
+                    bool fixed(true);
+                    unsigned expected(0);
+
+                    switch (type)
+                    {
+                        case rt_label:
+                            check(sk_alu == kind || sk_cf == kind || sk_tex == kind, "label outside of a code section");
+                            expected = 2;
+                            break;
+
+                        case rt_size:
+                            check(sk_alu == kind || sk_cf == kind || sk_tex == kind, "size outside of a code section");
+                            fixed = false;
+                            break;
+
+                        case rt_type:
+                            check(sk_alu == kind || sk_cf == kind || sk_tex == kind, "type outside of a code section");
+                            expected = 3;
+                            break;
+
+                        case rt_alu_form2:
+                        case rt_alu_form3:
+                            check(sk_alu == kind, "ALU instruction outside of .alu");
+                            fixed = false;
+                            break;
+
+                        case rt_alu_group_end:
+                            check(sk_alu == kind, "group end outside of .alu");
+                            expected = 1;
+                            break;
+
+                        case rt_alu_index_mode:
+                            check(sk_alu == kind, "index mode outside of .alu");
+                            expected = 2;
+                            break;
+
+                        case rt_cf_alu_clause:
+                            check(sk_cf == kind, "ALU clause outside of .cf");
+                            expected = 3;
+                            break;
+
+                        case rt_cf_branch:
+                        case rt_cf_loop:
+                            check(sk_cf == kind, "CF instruction outside of .cf");
+                            expected = 4;
+                            break;
+
+                        case rt_cf_nop:
+                        case rt_cf_program_end:
+                            check(sk_cf == kind, "CF instruction outside of .cf");
+                            expected = 1;
+                            break;
+
+                        case rt_cf_texture_fetch_clause:
+                            check(sk_cf == kind, "texture fetch clause outside of .cf");
+                            expected = 2;
+                            break;
+
+                        case rt_tex_load:
+                            check(sk_tex == kind, "TEX instruction outside of .tex");
+                            expected = 5;
+                            break;
+
+                        case rt_data_buffer:
+                        case rt_data_counter:
+                            check(sk_data == kind, "data entity outside of a data section");
+                            expected = 2;
+                            break;
+
+                        default:
+                            fail("unknown record type " + stringify(unsigned(type)));
+                    }
+
+                    if (fixed && (length != expected))
+                        fail("record of type " + stringify(unsigned(type)) + " has length " + stringify(length));
+
+                    switch (type)
+                    {
+                        case rt_label:
+                        case rt_cf_texture_fetch_clause:
+                        case rt_data_buffer:
+                        case rt_data_counter:
+                            string(record[1]);
+                            break;
+
+                        case rt_size:
+                            {
+                                check(length >= 2, "size record is truncated");
+                                string(record[1]);
+
+                                const uint32_t * node(record + 2), * end(record + length);
+                                expression(node, end, 0);
+                                check(node == end, "size record has trailing words");
+                            }
+                            break;
+
+                        case rt_type:
+                            string(record[1]);
+                            break;
+
+                        case rt_alu_form2:
+                            if ((length < 4) || (length > 8) || (0 != length % 2))
+                                fail("form2 instruction has length " + stringify(length));
+                            check(Enumeration<7>::valid(record[1]), "form2 opcode is out of bounds");
+                            alu_instruction(record, length);
+                            break;
+
+                        case rt_alu_form3:
+                            if (10 != length)
+                                fail("form3 instruction has length " + stringify(length));
+                            check(Enumeration<5>::valid(record[1]), "form3 opcode is out of bounds");
+                            alu_instruction(record, length);
+                            break;
+
+                        case rt_alu_index_mode:
+                            check(Enumeration<3>::valid(record[1]), "index mode is out of bounds");
+                            break;
+
+                        case rt_cf_alu_clause:
+                            check(Enumeration<4>::valid(record[1]), "ALU clause opcode is out of bounds");
+                            string(record[2]);
+                            break;
+
+                        case rt_cf_branch:
+                            check(Enumeration<7>::valid(record[1]), "branch opcode is out of bounds");
+                            string(record[2]);
+                            break;
+
+                        case rt_cf_loop:
+                            check(Enumeration<7>::valid(record[1]), "loop opcode is out of bounds");
+                            string(record[2]);
+                            string(record[3]);
+                            break;
+
+                        case rt_tex_load:
+                            check(Enumeration<5>::valid(record[1]), "load opcode is out of bounds");
+                            tex_gpr(record[2]);
+                            for (unsigned shift(0) ; shift < 32 ; shift += 8)
+                                check(Enumeration<3>::valid((record[3] >> shift) & 0xff), "selector is out of bounds");
+                            tex_gpr(record[4]);
+                            break;
+
+                        default:
+                            break;
+                    }
+                }
+            };
+
+            /// Creates the entities of checked records.
+            struct Builder
+            {
+                const char * strings;
+
+                Builder(const char * strings) :
+                    strings(strings)
+                {
+                }
+
+                Atom string(uint32_t offset) const
+                {
+                    return offset ? Atom(strings + offset) : Atom();
+                }
+
+                ExpressionPtr expression(const uint32_t *& node) const
+                {
+                    uint32_t kind(node[0]), operand(node[1]);
+                    node += 2;
+                    switch (kind)
+                    {
+                        case nk_value:
+                            return ExpressionPtr(new Value(operand));
+
+                        case nk_variable:
+                            return ExpressionPtr(new Variable(string(operand).str()));
+
+                        case nk_sum:
+                            {
+                                ExpressionPtr lhs(expression(node));
+                                ExpressionPtr rhs(expression(node));
+
+                                return ExpressionPtr(new Sum(lhs, rhs));
+                            }
+
+                        case nk_difference:
+                            {
+                                ExpressionPtr lhs(expression(node));
+                                ExpressionPtr rhs(expression(node));
+
+                                return ExpressionPtr(new Difference(lhs, rhs));
+                            }
+
+                        case nk_operation:
+                            {
+                                ExpressionPtr lhs(expression(node));
+                                ExpressionPtr rhs(expression(node));
+
+                                return ExpressionPtr(new Operation(static_cast<Operation::Operator>(operand), lhs, rhs));
+                            }
+                    }
+
+                    throw InternalError("r6xx", "unchecked expression node in kernel image");
+                }
+
+                ExpressionPtr size(const uint32_t * record) const
+                {
+                    const uint32_t * node(record + 2);
+
+                    return expression(node);
+                }
+
+                alu::SourceOperandPtr operand(const uint32_t * operand, Arena & arena) const
+                {
+                    Enumeration<2> channel((operand[0] >> 8) & 0xff);
+                    bool negated(operand[0] & (1 << 16)), relative(operand[0] & (1 << 17));
+
+                    switch (operand[0] & 0xff)
+                    {
+                        case ok_gpr:
+                            return arena.make<alu::SourceGPR>(channel, Enumeration<7>(operand[1]), negated, relative);
+
+                        case ok_kcache:
+                            return arena.make<alu::SourceKCache>(channel, Enumeration<6>(operand[1]), negated, relative);
+
+                        case ok_cfile:
+                            return arena.make<alu::SourceCFile>(channel, Enumeration<8>(operand[1]), negated, relative);
+
+                        case ok_literal:
+                            return arena.make<alu::SourceLiteral>(Enumeration<32>(operand[1]));
+                    }
+
+                    throw InternalError("r6xx", "unchecked source operand in kernel image");
+                }
+
+                void alu(const uint32_t * record, unsigned length, alu::Section & section) const
+                {
+                    Arena & arena(section.arena);
+                    alu::EntityPtr result(0);
+
+                    switch (record[0] >> 24)
+                    {
+                        case rt_label:
+                            result = arena.make<alu::Label>(string(record[1]));
+                            break;
+
+                        case rt_size:
+                            result = arena.make<alu::Size>(string(record[1]), size(record));
+                            break;
+
+                        case rt_type:
+                            result = arena.make<alu::Type>(string(record[1]), record[2]);
+                            break;
+
+                        case rt_alu_form2:
+                        case rt_alu_form3:
+                            {
+                                alu::DestinationGPR destination(Enumeration<2>((record[2] >> 8) & 0xff),
+                                        Enumeration<7>(record[2] & 0xff), record[2] & (1 << 16));
+                                Sequence<alu::SourceOperandPtr> sources;
+                                for (const uint32_t * o(record + 4), * o_end(record + length) ; o != o_end ; o += 2)
+                                {
+                                    sources.append(operand(o, arena));
+                                }
+
+                                if (rt_alu_form2 == (record[0] >> 24))
+                                    result = arena.make<alu::Form2Instruction>(Enumeration<7>(record[1]), destination, sources, record[3]);
+                                else
+                                    result = arena.make<alu::Form3Instruction>(Enumeration<5>(record[1]), destination, sources, record[3]);
+                            }
+                            break;
+
+                        case rt_alu_group_end:
+                            result = arena.make<alu::GroupEnd>();
+                            break;
+
+                        case rt_alu_index_mode:
+                            result = arena.make<alu::IndexMode>(record[1]);
+                            break;
+                    }
+
+                    section.entities.append(result);
+                }
+
+                void cf(const uint32_t * record, cf::Section & section) const
+                {
+                    Arena & arena(section.arena);
+                    cf::EntityPtr result(0);
+
+                    switch (record[0] >> 24)
+                    {
+                        case rt_label:
+                            result = arena.make<cf::Label>(string(record[1]));
+                            break;
+
+                        case rt_size:
+                            result = arena.make<cf::Size>(string(record[1]), size(record));
+                            break;
+
+                        case rt_type:
+                            result = arena.make<cf::Type>(string(record[1]), record[2]);
+                            break;
+
+                        case rt_cf_alu_clause:
+                            result = arena.make<cf::ALUClause>(Enumeration<4>(record[1]), string(record[2]));
+                            break;
+
+                        case rt_cf_branch:
+                            result = arena.make<cf::BranchInstruction>(Enumeration<7>(record[1]), string(record[2]), record[3]);
+                            break;
+
+                        case rt_cf_loop:
+                            result = arena.make<cf::LoopInstruction>(Enumeration<7>(record[1]), string(record[2]), string(record[3]));
+                            break;
+
+                        case rt_cf_nop:
+                            result = arena.make<cf::NopInstruction>();
+                            break;
+
+                        case rt_cf_program_end:
+                            result = arena.make<cf::ProgramEnd>();
+                            break;
+
+                        case rt_cf_texture_fetch_clause:
+                            result = arena.make<cf::TextureFetchClause>(string(record[1]));
+                            break;
+                    }
+
+                    section.entities.append(result);
+                }
+
+                void tex(const uint32_t * record, tex::Section & section) const
+                {
+                    Arena & arena(section.arena);
+                    tex::EntityPtr result(0);
+
+                    switch (record[0] >> 24)
+                    {
+                        case rt_label:
+                            result = arena.make<tex::Label>(string(record[1]));
+                            break;
+
+                        case rt_size:
+                            result = arena.make<tex::Size>(string(record[1]), size(record));
+                            break;
+
+                        case rt_type:
+                            result = arena.make<tex::Type>(string(record[1]), record[2]);
+                            break;
+
+                        case rt_tex_load:
+                            {
+                                tex::DestinationGPR::Selector selector(Enumeration<3>(record[3] & 0xff),
+                                        Enumeration<3>((record[3] >> 8) & 0xff),
+                                        Enumeration<3>((record[3] >> 16) & 0xff),
+                                        Enumeration<3>((record[3] >> 24) & 0xff));
+                                tex::DestinationGPR destination(Enumeration<7>(record[2] & 0xff), record[2] & (1 << 8), selector);
+                                tex::SourceGPR source(Enumeration<7>(record[4] & 0xff), record[4] & (1 << 8));
+
+                                result = arena.make<tex::LoadInstruction>(Enumeration<5>(record[1]), destination, source);
+                            }
+                            break;
+                    }
+
+                    section.entities.append(result);
+                }
+
+                void data(const uint32_t * record, common::GPGPUDataSection & section) const
+                {
+                    if (rt_data_buffer == (record[0] >> 24))
+                        section.entities.append(section.arena.make<common::Buffer>(string(record[1])));
+                    else
+                        section.entities.append(section.arena.make<common::Counter>(string(record[1])));
+                }
+            };
+        }
+    }
+
+    template <>
+    struct Implementation<r6xx::KernelImage>
+    {
+        MappedFile file;
+
+        const r6xx::image::Header * header;
+
+        const r6xx::image::SectionEntry * sections;
+
+        const uint32_t * records;
+
+        const char * strings;
+
+        Implementation(const std::string & filename) :
+            file(filename)
+        {
+            using namespace r6xx::image;
+
+            Checker checker(filename, 0, 0);
+
+            checker.check(file.size() >= sizeof(Header), "file is too short for a header");
+            header = reinterpret_cast<const Header *>(file.begin());
+
+            checker.check(0 == std::memcmp(header->magic, magic, sizeof(magic)), "bad magic");
+            checker.check(byte_order == header->byte_order, "image was written with a different byte order");
+            if (version != header->version)
+                checker.fail("unsupported version " + stringify(header->version));
+            checker.check(header->string_bytes > 0, "string table is empty");
+
+            unsigned long size(sizeof(Header));
+            size += sizeof(SectionEntry) * static_cast<unsigned long>(header->section_count);
+            size += 4 * static_cast<unsigned long>(header->record_words);
+            size += header->string_bytes + padding(header->string_bytes);
+            if (size != file.size())
+                checker.fail("file size " + stringify(file.size()) + " does not match " + stringify(size));
+
+            checker.check(header->checksum == hash(file.begin() + sizeof(Header), file.end()), "checksum mismatch");
+
+            sections = reinterpret_cast<const SectionEntry *>(file.begin() + sizeof(Header));
+            records = reinterpret_cast<const uint32_t *>(sections + header->section_count);
+            strings = reinterpret_cast<const char *>(records + header->record_words);
+
+            checker.strings = strings;
+            checker.string_bytes = header->string_bytes;
+            checker.check(0 == strings[0], "string table does not start with the empty string");
+            checker.check(0 == strings[header->string_bytes - 1], "string table is not terminated");
+
+            for (const SectionEntry * s(sections), * s_end(sections + header->section_count) ; s != s_end ; ++s)
+            {
+                checker.string(s->name);
+                std::string name(strings + s->name);
+                if (! r6xx::Section::valid(name))
+                    checker.fail("'" + name + "' is not a valid section name");
+                if ((s->first > header->record_words) || (s->words > header->record_words - s->first))
+                    checker.fail("records of section '" + name + "' are out of bounds");
+
+                SectionKind kind(kind_of(*r6xx::Section::make(name)));
+                for (const uint32_t * r(records + s->first), * r_end(records + s->first + s->words) ; r != r_end ; )
+                {
+                    unsigned length(*r & 0xffffff);
+                    if ((0 == length) || (length > unsigned(r_end - r)))
+                        checker.fail("record of section '" + name + "' is out of bounds");
+
+                    checker.record(kind, r, length);
+                    r += length;
+                }
+            }
+        }
+    };
+
+    namespace r6xx
+    {
+        KernelImage::KernelImage(const std::string & filename) :
+            PrivateImplementationPattern<KernelImage>(new Implementation<KernelImage>(filename))
+        {
+        }
+
+        KernelImage::~KernelImage()
+        {
+        }
+
+        Sequence<gpu::SectionPtr>
+        KernelImage::sections() const
+        {
+            using namespace image;
+
+            Sequence<gpu::SectionPtr> result;
+            Builder builder(_imp->strings);
+
+            for (const SectionEntry * s(_imp->sections), * s_end(_imp->sections + _imp->header->section_count) ; s != s_end ; ++s)
+            {
+                gpu::SectionPtr section(r6xx::Section::make(_imp->strings + s->name));
+                SectionKind kind(kind_of(*section));
+
+                for (const uint32_t * r(_imp->records + s->first), * r_end(_imp->records + s->first + s->words) ; r != r_end ; )
+                {
+                    unsigned length(*r & 0xffffff);
+
+                    switch (kind)
+                    {
+                        case sk_alu:
+                            builder.alu(r, length, static_cast<alu::Section &>(*section));
+                            break;
+
+                        case sk_cf:
+                            builder.cf(r, static_cast<cf::Section &>(*section));
+                            break;
+
+                        case sk_tex:
+                            builder.tex(r, static_cast<tex::Section &>(*section));
+                            break;
+
+                        case sk_data:
+                            builder.data(r, static_cast<common::GPGPUDataSection &>(*section));
+                            break;
+
+                        case sk_other:
+                            break;
+                    }
+
+                    r += length;
+                }
+
+                result.append(section);
+            }
+
+            return result;
+        }
+
+        void
+        KernelImage::write(const Sequence<gpu::SectionPtr> & sections, const std::string & filename)
+        {
+            using namespace image;
+
+            Records records;
+            std::vector<SectionEntry> entries;
+
+            for (Sequence<gpu::SectionPtr>::Iterator s(sections.begin()), s_end(sections.end()) ;
+                    s != s_end ; ++s)
+            {
+                SectionEntry entry;
+                entry.name = records.string((*s)->name());
+                entry.first = records.words.size();
+
+                switch (kind_of(**s))
+                {
+                    case sk_alu:
+                        write_entities<ALUWriter>(records, static_cast<const alu::Section &>(**s).entities);
+                        break;
+
+                    case sk_cf:
+                        write_entities<CFWriter>(records, static_cast<const cf::Section &>(**s).entities);
+                        break;
+
+                    case sk_tex:
+                        write_entities<TEXWriter>(records, static_cast<const tex::Section &>(**s).entities);
+                        break;
+
+                    case sk_data:
+                        write_entities<DataWriter>(records, static_cast<const common::GPGPUDataSection &>(**s).entities);
+                        break;
+
+                    case sk_other:
+                        break;
+                }
+
+                entry.words = records.words.size() - entry.first;
+                entries.push_back(entry);
+            }
+
+            Header header;
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.version = version;
+            header.byte_order = byte_order;
+            header.section_count = entries.size();
+            header.record_words = records.words.size();
+            header.string_bytes = records.strings.size();
+            records.strings.append(padding(records.strings.size()), '\0');
+
+            std::string body;
+            if (! entries.empty())
+                body.append(reinterpret_cast<const char *>(&entries[0]), sizeof(SectionEntry) * entries.size());
+            if (! records.words.empty())
+                body.append(reinterpret_cast<const char *>(&records.words[0]), 4 * records.words.size());
+            body.append(records.strings);
+            header.checksum = hash(body.data(), body.data() + body.size());
+
+            std::ofstream output(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            output.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+            output.write(body.data(), body.size());
+            output.close();
+
+            if (! output)
+                throw InternalError("r6xx", "Cannot write kernel image '" + filename + "'");
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_R6XX_KERNEL_IMAGE_HH
+#define GPU_GUARD_R6XX_KERNEL_IMAGE_HH 1
+
+#include <common/section.hh>
+#include <utils/private_implementation_pattern.hh>
+#include <utils/sequence.hh>
+
+#include <string>
+
+namespace gpu
+{
+    namespace r6xx
+    {
+        /**
+         * KernelImage is a precompiled kernel: the converted entities of all
+         * sections of an Assembler, in a compact binary form.
+         *
+         * An image consists of a header, a table of sections, the entity
+         * records of all sections and a table of strings. Records are
+         * sequences of 32 bit words in host byte order, which start with a
+         * word holding their type and length, so an image can be mapped and
+         * walked in place. Loading an image validates all of it, and then
+         * creates the backend entities straight from their records.
+         *
+         * Images record a version and the byte order they were written
+         * in, and are rejected if either does not match.
+         */
+        class KernelImage :
+            public PrivateImplementationPattern<KernelImage>
+        {
+            public:
+                /// Map and validate the image in filename.
+                KernelImage(const std::string & filename);
+
+                ~KernelImage();
+
+                /// Return new sections that hold the entities of the image.
+                Sequence<gpu::SectionPtr> sections() const;
+
+                /// Write the entities of sections as an image to filename.
+                static void write(const Sequence<gpu::SectionPtr> & sections, const std::string & filename);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,193 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <r6xx/assembler.hh>
+#include <r6xx/error.hh>
+#include <r6xx/kernel_image.hh>
+#include <utils/mapped_file.hh>
+#include <utils/sequence-impl.hh>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <stdint.h>
+
+using namespace gpu;
+using namespace tests;
+
+struct KernelImageTest :
+    public Test
+{
+    /// Offsets into the header and the first section entry of an image.
+    enum
+    {
+        section_count = 16,
+        record_words = 20,
+        string_bytes = 24,
+        header_size = 32,
+        section_name = header_size,
+        section_first = header_size + 4,
+        section_words = header_size + 8
+    };
+
+    KernelImageTest() :
+        Test("kernel_image_test")
+    {
+    }
+
+    std::string read_file(const std::string & name)
+    {
+        std::ifstream file(name.c_str(), std::ios_base::in | std::ios_base::binary);
+        std::stringstream result;
+
+        result << file.rdbuf();
+
+        return result.str();
+    }
+
+    void write_file(const std::string & name, const std::string & contents)
+    {
+        std::ofstream file(name.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+        file << contents;
+    }
+
+    /// Assemble a source, and check that its image assembles to the same object.
+    std::string round_trip(const std::string & name, std::istream & input)
+    {
+        std::string output_name(std::string(GPU_BUILDDIR) + "/r6xx/kernel_image_TEST_" + name);
+
+        r6xx::Assembler a(input);
+        a.write(output_name + ".output");
+        a.save(output_name + ".image");
+
+        r6xx::KernelImage image(output_name + ".image");
+        r6xx::Assembler b(image);
+        b.write(output_name + "_image.output");
+        TEST_CHECK_EQUAL(read_file(output_name + ".output"), read_file(output_name + "_image.output"));
+
+        // an image of a loaded image is identical to the original
+        b.save(output_name + "_copy.image");
+        TEST_CHECK_EQUAL(read_file(output_name + ".image"), read_file(output_name + "_copy.image"));
+
+        return output_name + ".image";
+    }
+
+    uint32_t word(const std::string & contents, unsigned offset)
+    {
+        uint32_t result;
+        std::memcpy(&result, contents.data() + offset, sizeof(uint32_t));
+
+        return result;
+    }
+
+    /// Overwrite a word of an image, and update its checksum so that only the validation of its contents can catch it.
+    std::string patch(const std::string & contents, unsigned offset, uint32_t value)
+    {
+        std::string result(contents);
+        std::memcpy(&result[offset], &value, sizeof(uint32_t));
+
+        // FNV-1a hash of everything after the header, which ends with the checksum
+        uint32_t checksum(2166136261u);
+        for (std::string::const_iterator c(result.begin() + header_size), c_end(result.end()) ; c != c_end ; ++c)
+        {
+            checksum ^= static_cast<unsigned char>(*c);
+            checksum *= 16777619u;
+        }
+        std::memcpy(&result[header_size - sizeof(uint32_t)], &checksum, sizeof(uint32_t));
+
+        return result;
+    }
+
+    bool rejected(const std::string & name, const std::string & contents)
+    {
+        write_file(name, contents);
+
+        try
+        {
+            r6xx::KernelImage image(name);
+        }
+        catch (r6xx::InvalidKernelImageError &)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    virtual void run()
+    {
+        std::fstream minimal((std::string(GPU_SRCDIR) + "/r6xx/assembler_TEST_DATA/minimal.s").c_str(), std::ios_base::in);
+        round_trip("minimal", minimal);
+
+        std::stringstream operands(
+                ".section .alu\n"
+                "first:\n"
+                "\tfadd $1.x, K0.z, -C3.xr\n"
+                "\tfmul $2.y, 10u, -1.5\n"
+                "\tdmuladd $3.z, $1.x, -$2.y, K63.w\n"
+                ".groupend\n"
+                "second:\n"
+                "\tfadd $4.w, $3.z, 2.0\n"
+                ".groupend\n"
+                ".size first, (second - first) * 2 + 4\n"
+                ".section .cf\n"
+                "main:\n"
+                "\talu_push_before first\n"
+                "\tjump .L0, 1\n"
+                "\talu second\n"
+                ".L0:\n"
+                "\tnop\n"
+                ".programend\n"
+                ".type main, \"func\"\n"
+                ".size main, .-main\n");
+        std::string image(round_trip("operands", operands));
+
+        // damaged images are rejected, not trusted
+        std::string contents(read_file(image)), name(std::string(GPU_BUILDDIR) + "/r6xx/kernel_image_TEST_damaged.image");
+        TEST_CHECK(! rejected(name, contents));
+        TEST_CHECK(rejected(name, ""));
+        TEST_CHECK(rejected(name, contents.substr(0, contents.size() - 4)));
+        TEST_CHECK(rejected(name, contents + std::string(4, '\0')));
+
+        std::string corrupted(contents);
+        corrupted[corrupted.size() / 2] ^= 0x10;
+        TEST_CHECK(rejected(name, corrupted));
+
+        std::string bad_magic(contents);
+        bad_magic[0] = 'X';
+        TEST_CHECK(rejected(name, bad_magic));
+
+        // as are damaged records behind a valid checksum
+        uint32_t words(word(contents, record_words)), strings(word(contents, string_bytes));
+        uint32_t first(word(contents, section_first)), length(word(contents, section_words));
+        unsigned record(header_size + 12 * word(contents, section_count) + 4 * first);
+        TEST_CHECK(! rejected(name, patch(contents, section_first, first)));
+        TEST_CHECK(rejected(name, patch(contents, section_name, strings)));
+        TEST_CHECK(rejected(name, patch(contents, section_first, words + 1)));
+        TEST_CHECK(rejected(name, patch(contents, section_words, words - first + 1)));
+        TEST_CHECK(rejected(name, patch(contents, record, word(contents, record) & 0xff000000)));
+        TEST_CHECK(rejected(name, patch(contents, record, (word(contents, record) & 0xff000000) | (length + 1))));
+        TEST_CHECK(rejected(name, patch(contents, record, (255u << 24) | (word(contents, record) & 0xffffff))));
+
+        TEST_CHECK_THROWS(r6xx::KernelImage(name + ".missing"), MappedFileError);
+    }
+} kernel_image_test;
@@ -0,0 +1,272 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <common/diagnostics.hh>
+#include <r6xx/operand_lexer.hh>
+#include <utils/number_parser.hh>
+#include <utils/stringify.hh>
+
+#include <algorithm>
+#include <cstring>
+
+namespace gpu
+{
+    namespace r6xx
+    {
+        namespace internal
+        {
+            enum CharacterClass
+            {
+                cc_other = 0,
+                cc_digit,
+                cc_dot,
+                cc_open,
+                cc_close,
+                cc_channel,
+                cc_mask,
+                cc_mode,
+                cc_last
+            };
+
+            /*
+             * The states of a register operand after its prefix. Transitions
+             * to one of the error states end lexing with the respective
+             * message.
+             */
+            enum State
+            {
+                s_prefix = 0,
+                s_index,
+                s_dot,
+                s_channel,
+                s_selector,
+                s_selected,
+                s_mode,
+                s_last,
+
+                e_number = s_last,
+                e_channel,
+                e_suffix,
+                e_close,
+                e_element,
+                e_mode
+            };
+
+            const static unsigned char transitions[s_last][cc_last] =
+            {
+                /*                other      digit       dot        open        close       channel     mask        mode */
+                /* prefix   */ {  e_number,  s_index,    e_number,  e_number,   e_number,   e_number,   e_number,   e_number  },
+                /* index    */ {  e_number,  s_index,    s_dot,     s_selector, e_close,    e_number,   e_number,   s_mode    },
+                /* dot      */ {  e_channel, e_channel,  e_channel, e_channel,  e_channel,  s_channel,  e_channel,  e_channel },
+                /* channel  */ {  e_suffix,  e_suffix,   e_suffix,  e_suffix,   e_suffix,   e_suffix,   e_suffix,   s_mode    },
+                /* selector */ {  e_element, s_selector, e_element, e_element,  s_selected, s_selector, s_selector, e_element },
+                /* selected */ {  e_mode,    e_mode,     e_mode,    e_mode,     e_mode,     e_mode,     e_mode,     s_mode    },
+                /* mode     */ {  e_mode,    e_mode,     e_mode,    e_mode,     e_mode,     e_mode,     e_mode,     e_mode    }
+            };
+
+            /// Marks characters that do not name a selector element.
+            const static unsigned char no_element(6);
+
+            struct CharacterTables
+            {
+                unsigned char classes[256];
+
+                /// The selector element, or for 'x' to 'w' the channel, that each character names.
+                unsigned char elements[256];
+
+                CharacterTables()
+                {
+                    std::memset(classes, cc_other, sizeof(classes));
+                    std::memset(elements, no_element, sizeof(elements));
+
+                    for (unsigned c('0') ; c <= '9' ; ++c)
+                        classes[c] = cc_digit;
+
+                    classes[unsigned('.')] = cc_dot;
+                    classes[unsigned('[')] = cc_open;
+                    classes[unsigned(']')] = cc_close;
+                    classes[unsigned('x')] = classes[unsigned('y')] = classes[unsigned('z')] = classes[unsigned('w')] = cc_channel;
+                    classes[unsigned('m')] = cc_mask;
+                    classes[unsigned('a')] = classes[unsigned('r')] = cc_mode;
+
+                    elements[unsigned('x')] = 0;
+                    elements[unsigned('y')] = 1;
+                    elements[unsigned('z')] = 2;
+                    elements[unsigned('w')] = 3;
+                    elements[unsigned('0')] = 4;
+                    elements[unsigned('1')] = 5;
+                    elements[unsigned('m')] = 7;
+                }
+            };
+
+            static ParseStatus lex_literal(const char * begin, const char * end, LexedOperand & result, Diagnostics & diagnostics)
+            {
+                result.kind = LexedOperand::literal_operand;
+
+                if (end != std::find(begin, end, '.')) // Float literal
+                {
+                    float value;
+                    if (! NumberParser::parse(begin, end, value))
+                        return diagnostics.error(ps_syntax_error, "'" + std::string(begin, end) + "' is not a float literal");
+
+                    std::memcpy(&result.literal, &value, sizeof(value));
+                }
+                else if ('u' == *(end - 1)) // Unsigned integer
+                {
+                    if (result.negated)
+                        return diagnostics.error(ps_syntax_error, "negative sign in unsigned interger literal");
+
+                    if (! NumberParser::parse(begin, end - 1, result.literal))
+                        return diagnostics.error(ps_syntax_error, "'" + std::string(begin, end) + "' is not an unsigned integer literal");
+                }
+                else // Signed integer
+                {
+                    signed value;
+                    if (! NumberParser::parse(begin, end, value))
+                        return diagnostics.error(ps_syntax_error, "'" + std::string(begin, end) + "' is not an integer literal");
+
+                    std::memcpy(&result.literal, &value, sizeof(value));
+                }
+
+                return ps_success;
+            }
+        }
+
+        ParseStatus
+        OperandLexer::lex(const char * begin, const char * end, LexedOperand & result, Diagnostics & diagnostics)
+        {
+            const static internal::CharacterTables tables;
+
+            if (begin == end)
+                return diagnostics.error(ps_empty_input, "empty input");
+
+            result = LexedOperand();
+
+            const char * c(begin);
+            if ('-' == *c)
+            {
+                result.negated = true;
+                ++c;
+            }
+
+            if (c == end)
+                return diagnostics.error(ps_syntax_error, "no main part");
+
+            switch (*c)
+            {
+                case '$':
+                    result.kind = LexedOperand::gpr_operand;
+                    break;
+
+                case 'K':
+                    result.kind = LexedOperand::kcache_operand;
+                    break;
+
+                case 'C':
+                    result.kind = LexedOperand::cfile_operand;
+                    break;
+
+                default:
+                    return internal::lex_literal(begin, end, result, diagnostics);
+            }
+
+            const char * const index_begin(++c);
+            unsigned state(internal::s_prefix);
+            for ( ; c != end ; ++c)
+            {
+                const unsigned char u(*c);
+                const unsigned next(internal::transitions[state][tables.classes[u]]);
+
+                switch (next)
+                {
+                    case internal::s_index:
+                        if (result.index >= 429496729u)
+                            return diagnostics.error(ps_out_of_bounds, "index out of range: '"
+                                    + std::string(index_begin, std::find_first_of(c, end, ".[", ".[" + 2)) + "'");
+
+                        result.index = 10 * result.index + (u - '0');
+                        break;
+
+                    case internal::s_channel:
+                        result.has_channel = true;
+                        result.channel = tables.elements[u];
+                        break;
+
+                    case internal::s_selector:
+                        if (internal::s_index == state)
+                        {
+                            result.has_selector = true;
+                        }
+                        else if (internal::no_element == tables.elements[u])
+                        {
+                            return diagnostics.error(ps_syntax_error, "invalid selector element '" + stringify(*c) + "'");
+                        }
+                        else if (4 == result.selector_size)
+                        {
+                            return diagnostics.error(ps_syntax_error, "selector has more than four elements");
+                        }
+                        else
+                        {
+                            result.selector[result.selector_size++] = tables.elements[u];
+                        }
+                        break;
+
+                    case internal::s_mode:
+                        result.relative = ('r' == u);
+                        break;
+
+                    case internal::e_number:
+                        return diagnostics.error(ps_syntax_error, "'"
+                                + std::string(index_begin, std::find_first_of(c, end, ".[", ".[" + 2)) + "' is not a number");
+
+                    case internal::e_channel:
+                        return diagnostics.error(ps_syntax_error, "'" + stringify(*c) + "' is not a valid channel");
+
+                    case internal::e_suffix:
+                        return diagnostics.error(ps_syntax_error, "invalid suffix '" + std::string(c - 1, end) + "'");
+
+                    case internal::e_close:
+                        return diagnostics.error(ps_syntax_error, "unexpected ']'");
+
+                    case internal::e_element:
+                        return diagnostics.error(ps_syntax_error, "invalid selector element '" + stringify(*c) + "'");
+
+                    case internal::e_mode:
+                        return diagnostics.error(ps_syntax_error, "invalid address mode '" + stringify(*c) + "'");
+                }
+
+                state = next;
+            }
+
+            switch (state)
+            {
+                case internal::s_prefix:
+                    return diagnostics.error(ps_syntax_error, "no index part");
+
+                case internal::s_dot:
+                    return diagnostics.error(ps_syntax_error, "no channel");
+
+                case internal::s_selector:
+                    return diagnostics.error(ps_syntax_error, "unterminated selector");
+            }
+
+            return ps_success;
+        }
+    }
+}
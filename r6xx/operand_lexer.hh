@@ -0,0 +1,91 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_R6XX_OPERAND_LEXER_HH
+#define GPU_GUARD_R6XX_OPERAND_LEXER_HH 1
+
+#include <common/diagnostics.hh>
+
+namespace gpu
+{
+    namespace r6xx
+    {
+        /**
+         * LexedOperand describes one ALU or TEX operand.
+         *
+         * Registers are written as an optional '-', a prefix of '$' (GPR),
+         * 'K' (KCache) or 'C' (constant file), and a decimal index. The index
+         * may be followed by a '.' and a channel, or by a selector of up to
+         * four elements in brackets, and finally by an address mode of 'a'
+         * (absolute) or 'r' (relative).
+         *
+         * Anything else is a literal, whose bits are held in literal.
+         */
+        struct LexedOperand
+        {
+            enum Kind
+            {
+                literal_operand,
+                gpr_operand,
+                kcache_operand,
+                cfile_operand
+            };
+
+            Kind kind;
+
+            bool negated;
+
+            bool relative;
+
+            bool has_channel;
+
+            bool has_selector;
+
+            unsigned char channel;
+
+            unsigned char selector_size;
+
+            unsigned char selector[4];
+
+            unsigned index;
+
+            unsigned literal;
+        };
+
+        /**
+         * OperandLexer classifies an operand in a single pass over its
+         * characters, driven by a character class and a state transition
+         * table.
+         *
+         * It only checks the syntax that all operands have in common. Which
+         * kinds and parts are allowed is up to the individual parsers.
+         */
+        struct OperandLexer
+        {
+            /**
+             * Lex the characters in [begin, end) into result.
+             *
+             * On failure, a message is recorded in diagnostics.
+             */
+            static ParseStatus lex(const char * begin, const char * end, LexedOperand & result, Diagnostics & diagnostics);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,108 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <r6xx/operand_lexer.hh>
+
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+struct OperandLexerTest :
+    public Test
+{
+    OperandLexerTest() :
+        Test("operand_lexer_test")
+    {
+    }
+
+    ParseStatus lex(const std::string & input, r6xx::LexedOperand & result, Diagnostics & diagnostics)
+    {
+        return r6xx::OperandLexer::lex(input.data(), input.data() + input.size(), result, diagnostics);
+    }
+
+    virtual void run()
+    {
+        Diagnostics diagnostics;
+        r6xx::LexedOperand o;
+
+        TEST_CHECK_EQUAL(lex("-K17.wr", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.kind, r6xx::LexedOperand::kcache_operand);
+        TEST_CHECK(o.negated);
+        TEST_CHECK(o.relative);
+        TEST_CHECK(o.has_channel);
+        TEST_CHECK(! o.has_selector);
+        TEST_CHECK_EQUAL(unsigned(o.channel), 3u);
+        TEST_CHECK_EQUAL(o.index, 17u);
+
+        TEST_CHECK_EQUAL(lex("$12[w0m]a", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.kind, r6xx::LexedOperand::gpr_operand);
+        TEST_CHECK(! o.negated);
+        TEST_CHECK(! o.relative);
+        TEST_CHECK(! o.has_channel);
+        TEST_CHECK(o.has_selector);
+        TEST_CHECK_EQUAL(unsigned(o.selector_size), 3u);
+        TEST_CHECK_EQUAL(unsigned(o.selector[0]), 3u);
+        TEST_CHECK_EQUAL(unsigned(o.selector[1]), 4u);
+        TEST_CHECK_EQUAL(unsigned(o.selector[2]), 7u);
+        TEST_CHECK_EQUAL(o.index, 12u);
+
+        TEST_CHECK_EQUAL(lex("C255", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.kind, r6xx::LexedOperand::cfile_operand);
+        TEST_CHECK_EQUAL(o.index, 255u);
+
+        TEST_CHECK_EQUAL(lex("-2", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.kind, r6xx::LexedOperand::literal_operand);
+        TEST_CHECK_EQUAL(o.literal, 0xfffffffeu);
+
+        TEST_CHECK_EQUAL(lex("0.5", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.literal, 0x3f000000u);
+
+        TEST_CHECK_EQUAL(lex("7u", o, diagnostics), ps_success);
+        TEST_CHECK_EQUAL(o.literal, 7u);
+        TEST_CHECK(diagnostics.empty());
+
+        const char * const invalid[][2] =
+        {
+            { "",               "empty input" },
+            { "-",              "no main part" },
+            { "$",              "no index part" },
+            { "$1.",            "no channel" },
+            { "$1[xy",          "unterminated selector" },
+            { "$1]",            "unexpected ']'" },
+            { "$-1.x",          "'-1' is not a number" },
+            { "$1.q",           "'q' is not a valid channel" },
+            { "$1.xyz",         "invalid suffix 'xyz'" },
+            { "$1[x2]",         "invalid selector element '2'" },
+            { "$1[xyzwx]",      "selector has more than four elements" },
+            { "$1[x]ra",        "invalid address mode 'a'" },
+            { "$99999999999.x", "index out of range: '99999999999'" },
+            { "-1u",            "negative sign in unsigned interger literal" },
+            { "1.x",            "'1.x' is not a float literal" }
+        };
+
+        for (unsigned i(0) ; i < sizeof(invalid) / sizeof(invalid[0]) ; ++i)
+        {
+            TEST_CHECK(ps_success != lex(invalid[i][0], o, diagnostics));
+            TEST_CHECK_EQUAL(diagnostics.last(), invalid[i][1]);
+        }
+        TEST_CHECK_EQUAL(diagnostics.size(), sizeof(invalid) / sizeof(invalid[0]));
+    }
+} operand_lexer_test;
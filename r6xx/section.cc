@@ -18,13 +18,16 @@
  */
 
 #include <common/assembly_entities.hh>
+#include <common/syntax.hh>
 #include <r6xx/alu_section.hh>
 #include <r6xx/cf_section.hh>
 #include <r6xx/error.hh>
 #include <r6xx/section.hh>
 #include <r6xx/tex_section.hh>
+#include <utils/perfect_hash.hh>
 #include <utils/private_implementation_pattern-impl.hh>
 #include <utils/sequence-impl.hh>
+#include <utils/tuple.hh>
 #include <utils/wrapped_forward_iterator-impl.hh>
 
 #include <algorithm>
@@ -79,105 +82,173 @@ namespace gpu
             return (section_names_end != std::find(section_names_begin, section_names_end, name)) || SectionFactory::valid(name);
         }
 
+    }
+
+    namespace r6xx
+    {
         namespace internal
         {
-            struct ConversionStage :
-                public AssemblyEntityVisitor
+            enum DirectiveKind
             {
-                Sequence<gpu::SectionPtr> sections;
-                std::list<SectionPtr> stack;
+                dk_popsection,
+                dk_pushsection,
+                dk_section
+            };
 
-                ConversionStage()
-                {
-                    sections.append(Section::make(".cf"));
-                    stack.push_back(sections.last());
-                }
+            /*
+             * directive name
+             * directive kind
+             */
+            typedef Tuple<std::string, unsigned> KnownDirective;
+            const static KnownDirective known_directives[] =
+            {
+                KnownDirective("popsection",    dk_popsection),
+                KnownDirective("pushsection",   dk_pushsection),
+                KnownDirective("section",       dk_section)
+            };
+            const static PerfectHash<KnownDirective> directive_table(known_directives, known_directives + sizeof(known_directives) / sizeof(KnownDirective));
+        }
+    }
 
-                bool balanced()
-                {
-                    return (stack.size() == 1);
-                }
+    template <>
+    struct Implementation<r6xx::SectionConverter>
+    {
+        Sequence<SectionPtr> sections;
 
-                void visit(const Comment & c)
-                {
-                    stack.back()->append(make_shared_ptr(new Comment(c)));
-                }
+        std::list<SectionPtr> stack;
 
-                void visit(const Data & d)
-                {
-                    stack.back()->append(make_shared_ptr(new Data(d)));
-                }
+        Implementation()
+        {
+            sections.append(r6xx::Section::make(".cf"));
+            stack.push_back(sections.last());
+        }
 
-                void visit(const Instruction & i)
-                {
-                    stack.back()->append(make_shared_ptr(new Instruction(i)));
-                }
+        SectionPtr find_or_add(const Atom & name)
+        {
+            Sequence<SectionPtr>::Iterator s(std::find_if(sections.begin(), sections.end(), r6xx::SectionByName(name)));
+            if (sections.end() != s)
+                return *s;
 
-                void visit(const Label & l)
-                {
-                    stack.back()->append(make_shared_ptr(new Label(l)));
-                }
+            sections.append(r6xx::Section::make(name.str()));
 
-                void visit(const Line & l)
-                {
-                    SyntaxContext::Line(l.number);
-                }
+            return sections.last();
+        }
+    };
 
-                gpu::SectionPtr find_or_add(const std::string & name)
-                {
-                    Sequence<SectionPtr>::Iterator s(std::find_if(sections.begin(), sections.end(), r6xx::SectionByName(name)));
-                    if (sections.end() != s)
-                        return *s;
+    namespace r6xx
+    {
+        SectionConverter::SectionConverter() :
+            PrivateImplementationPattern<SectionConverter>(new Implementation<SectionConverter>)
+        {
+        }
 
-                    sections.append(Section::make(name));
+        SectionConverter::~SectionConverter()
+        {
+        }
 
-                    return sections.last();
-                }
+        void
+        SectionConverter::visit(const Comment & c)
+        {
+            _imp->stack.back()->append(c);
+        }
 
-                void visit(const Directive & d)
+        void
+        SectionConverter::visit(const Data & d)
+        {
+            _imp->stack.back()->append(d);
+        }
+
+        void
+        SectionConverter::visit(const Instruction & i)
+        {
+            _imp->stack.back()->append(i);
+        }
+
+        void
+        SectionConverter::visit(const Label & l)
+        {
+            _imp->stack.back()->append(l);
+        }
+
+        void
+        SectionConverter::visit(const LexedInstruction & i)
+        {
+            _imp->stack.back()->append(i);
+        }
+
+        void
+        SectionConverter::visit(const Directive & d)
+        {
+            if (const internal::KnownDirective * directive = internal::directive_table.find(d.name))
+            {
+                switch (directive->second)
                 {
-                    if ("section" == d.name)
-                    {
-                        stack.back() = find_or_add(d.params);
-                    }
-                    else if ("pushsection" == d.name)
-                    {
-                        stack.push_back(find_or_add(d.params));
-                    }
-                    else if ("popsection" == d.name)
-                    {
-                        if (stack.size() == 1)
-                            throw r6xx::UnbalancedSectionStackError();
-
-                        stack.pop_back();
-                    }
-                    else if (r6xx::Section::valid("." + d.name))
-                    {
-                        stack.back() = find_or_add("." + d.name);
-                    }
-                    else
-                    {
-                        stack.back()->append(make_shared_ptr(new Directive(d)));
-                    }
+                    case internal::dk_section:
+                        _imp->stack.back() = _imp->find_or_add(d.params);
+                        break;
+
+                    case internal::dk_pushsection:
+                        _imp->stack.push_back(_imp->find_or_add(d.params));
+                        break;
+
+                    case internal::dk_popsection:
+                        if (_imp->stack.size() == 1)
+                            throw UnbalancedSectionStackError();
+
+                        _imp->stack.pop_back();
+                        break;
                 }
-            };
+            }
+            else if (Section::valid("." + d.name.str()))
+            {
+                _imp->stack.back() = _imp->find_or_add("." + d.name.str());
+            }
+            else
+            {
+                _imp->stack.back()->append(d);
+            }
+        }
+
+        Sequence<SectionPtr>
+        SectionConverter::sections() const
+        {
+            if (1 != _imp->stack.size())
+                throw UnbalancedSectionStackError();
+
+            return _imp->sections;
         }
 
         Sequence<SectionPtr>
         SectionConverter::convert(const Sequence<AssemblyEntityPtr> & input)
         {
-            internal::ConversionStage cs;
+            SectionConverter converter;
 
-            for (Sequence<std::tr1::shared_ptr<AssemblyEntity> >::Iterator e(input.begin()), e_end(input.end()) ;
+            for (Sequence<AssemblyEntityPtr>::Iterator e(input.begin()), e_end(input.end()) ;
                     e != e_end ; ++e)
             {
-                (*e)->accept(cs);
+                (*e)->accept(converter);
             }
 
-            if (! cs.balanced())
-                throw UnbalancedSectionStackError();
+            return converter.sections();
+        }
+
+        Sequence<SectionPtr>
+        SectionConverter::convert(const Sequence<AssemblyEntityPtr> & input, const LineTable & lines)
+        {
+            SectionConverter converter;
+            unsigned index(0);
+
+            {
+                SyntaxContext::Lines l(lines, index);
+
+                for (Sequence<AssemblyEntityPtr>::Iterator e(input.begin()), e_end(input.end()) ;
+                        e != e_end ; ++e, ++index)
+                {
+                    (*e)->accept(converter);
+                }
+            }
 
-            return cs.sections;
+            return converter.sections();
         }
     }
 }
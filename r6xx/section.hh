@@ -20,7 +20,8 @@
 #ifndef GPU_GUARD_R6XX_SECTION_HH
 #define GPU_GUARD_R6XX_SECTION_HH 1
 
-#include <common/assembly_entities-fwd.hh>
+#include <common/assembly_entities.hh>
+#include <common/line_table.hh>
 #include <common/section.hh>
 #include <elf/section.hh>
 #include <elf/symbol.hh>
@@ -48,10 +49,10 @@ namespace gpu
         class SectionByName
         {
             private:
-                const std::string _name;
+                const Atom _name;
 
             public:
-                SectionByName(const std::string & name) :
+                SectionByName(const Atom & name) :
                     _name(name)
                 {
                 }
@@ -62,9 +63,42 @@ namespace gpu
                 }
         };
 
-        struct SectionConverter
+        /**
+         * SectionConverter distributes AssemblyEntities to their sections.
+         *
+         * It can either convert a whole sequence at once, or serve as the
+         * sink of a streaming AssemblyParser::parse, in which case no generic
+         * entity outlives its own visit. Instructions are then converted by
+         * their sections straight from the tokens of the source.
+         */
+        class SectionConverter :
+            public LexedEntityVisitor,
+            public PrivateImplementationPattern<SectionConverter>
         {
-            static Sequence<SectionPtr> convert(const Sequence<AssemblyEntityPtr> &);
+            public:
+                SectionConverter();
+
+                ~SectionConverter();
+
+                void visit(const Comment &);
+
+                void visit(const Data &);
+
+                void visit(const Directive &);
+
+                void visit(const Instruction &);
+
+                void visit(const Label &);
+
+                void visit(const LexedInstruction &);
+
+                /// Return all sections, after checking that the section stack is balanced.
+                Sequence<SectionPtr> sections() const;
+
+                static Sequence<SectionPtr> convert(const Sequence<AssemblyEntityPtr> &);
+
+                /// Convert a whole sequence, reporting errors at the lines recorded in lines.
+                static Sequence<SectionPtr> convert(const Sequence<AssemblyEntityPtr> &, const LineTable & lines);
         };
     }
 }
@@ -17,135 +17,87 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/diagnostics.hh>
 #include <r6xx/tex_destination_gpr.hh>
 #include <r6xx/error.hh>
-#include <utils/destringify.hh>
+#include <r6xx/operand_lexer.hh>
 #include <utils/stringify.hh>
 
+#include <algorithm>
+
 namespace gpu
 {
     namespace r6xx
     {
         namespace tex
         {
-            static bool relative_from_char(char c)
+            DestinationGPR::DestinationGPR(const Enumeration<7> & i, bool r, const Selector & s) :
+                index(i),
+                relative(r),
+                selector(s)
             {
-                if ('r' == c)
-                    return true;
-                else if ('a' == c)
-                    return false;
-                else
-                    throw DestinationGPRSyntaxError("invalid address mode '" + stringify(c) + "'");
             }
 
-            static Enumeration<3> selector_element_from_char(char c)
+            ParseStatus
+            DestinationGPRParser::parse(const char * begin, const char * end, DestinationGPR & result, Diagnostics & diagnostics)
             {
-                switch (c)
-                {
-                    case 'x':
-                    case 'y':
-                    case 'z':
-                        return Enumeration<3>(c - 'x');
+                LexedOperand operand;
+                ParseStatus status(OperandLexer::lex(begin, end, operand, diagnostics));
+                if (ps_success != status)
+                    return status;
 
-                    case 'w':
-                        return Enumeration<3>(3);
+                if ((LexedOperand::gpr_operand != operand.kind) || operand.negated)
+                    return diagnostics.error(ps_syntax_error, "destination GPR needs to start with '$'");
 
-                    case '0':
-                        return Enumeration<3>(4);
+                if (operand.has_channel)
+                    return diagnostics.error(ps_syntax_error, "unexpected channel in destination GPR");
 
-                    case '1':
-                        return Enumeration<3>(5);
+                if (! Enumeration<7>::valid(operand.index))
+                    return diagnostics.error(ps_out_of_bounds, "register index out of bounds");
 
-                    case 'm':
-                        return Enumeration<3>(7);
+                // Elements missing from the selector keep their identity
+                unsigned selector[4] = { 0, 1, 2, 3 };
+                std::copy(operand.selector, operand.selector + operand.selector_size, selector);
 
-                    default:
-                        throw DestinationGPRSyntaxError("invalid selector element '" + stringify(c) + "'");
-                }
+                result = DestinationGPR(Enumeration<7>(operand.index), operand.relative, DestinationGPR::Selector(Enumeration<3>(selector[0]),
+                            Enumeration<3>(selector[1]), Enumeration<3>(selector[2]), Enumeration<3>(selector[3])));
+
+                return ps_success;
             }
 
-            static DestinationGPR::Selector selector_from_string(const std::string & input)
+            DestinationGPR
+            DestinationGPRParser::parse(const char * begin, const char * end)
             {
-                DestinationGPR::Selector result(Enumeration<3>(0), Enumeration<3>(1), Enumeration<3>(2), Enumeration<3>(3));
-                std::string str(input);
-
-                std::string::size_type size(str.size());
-
-                if (size > 6)
-                    throw DestinationGPRSyntaxError("'" + str + "' is too long for a valid selector");
-
-                str.erase(size - 1);
-                str.erase(0, 1);
-                size -= 2;
+                Diagnostics diagnostics;
+                DestinationGPR result(Enumeration<7>(0), false, DestinationGPR::Selector(Enumeration<3>(0),
+                            Enumeration<3>(1), Enumeration<3>(2), Enumeration<3>(3)));
 
-                switch (size)
+                switch (parse(begin, end, result, diagnostics))
                 {
-                    case 4:
-                        result.fourth = selector_element_from_char(str[3]);
-                    case 3:
-                        result.third = selector_element_from_char(str[2]);
-                    case 2:
-                        result.second = selector_element_from_char(str[1]);
-                    case 1:
-                        result.first = selector_element_from_char(str[0]);
-                    case 0:
+                    case ps_success:
                         return result;
+
+                    case ps_empty_input:
+                        throw InternalError("r6xx", diagnostics.last());
+
+                    case ps_syntax_error:
+                    case ps_out_of_bounds:
+                        break;
                 }
 
-                throw InternalError("r6xx", "selector_from_string went haywire");
+                throw DestinationGPRSyntaxError(diagnostics.last());
             }
 
-            DestinationGPR::DestinationGPR(const Enumeration<7> & i, bool r, const Selector & s) :
-                index(i),
-                relative(r),
-                selector(s)
+            ParseStatus
+            DestinationGPRParser::parse(const std::string & input, DestinationGPR & result, Diagnostics & diagnostics)
             {
+                return parse(input.data(), input.data() + input.size(), result, diagnostics);
             }
 
             DestinationGPR
             DestinationGPRParser::parse(const std::string & input)
             {
-                const static std::string digits("0123456789");
-                const static std::string modes("ar");
-
-                if (input.empty())
-                    throw InternalError("r6xx", "empty input");
-
-                std::string operand(input);
-                if (2 > operand.size())
-                    throw DestinationGPRSyntaxError("too short for a destination GPR");
-
-                if ('$' != operand[0])
-                    throw DestinationGPRSyntaxError("destination GPR needs to start with '$'");
-
-                operand.erase(0, 1);
-
-                std::string::size_type sel_begin(operand.find('['));
-                std::string::size_type sel_end(operand.find(']'));
-
-                if ((std::string::npos != sel_begin) && (std::string::npos == sel_end))
-                    throw DestinationGPRSyntaxError("unterminated selector");
-
-                if ((std::string::npos == sel_begin) && (std::string::npos != sel_end))
-                    throw DestinationGPRSyntaxError("unexpected ']'");
-
-                DestinationGPR::Selector selector(selector_from_string(operand.substr(sel_begin, sel_end)));
-                std::string suffix(operand.substr(sel_end + 1));
-                operand.erase(sel_begin);
-
-                bool relative(false);
-                if (! suffix.empty())
-                    relative = relative_from_char(suffix[0]);
-
-                if (std::string::npos != operand.find_first_not_of(digits))
-                    throw DestinationGPRSyntaxError("register index '" + operand + "' is not a number");
-
-                unsigned index(destringify<unsigned>(operand));
-
-                if (127 < index)
-                    throw DestinationGPRSyntaxError("register index out of bounds");
-
-                return DestinationGPR(Enumeration<7>(index), relative, selector);
+                return parse(input.data(), input.data() + input.size());
             }
 
             std::string
@@ -0,0 +1,71 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <r6xx/error.hh>
+#include <r6xx/tex_destination_gpr.hh>
+
+using namespace gpu;
+using namespace tests;
+
+struct TexDestinationGPRParserTest :
+    public Test
+{
+    TexDestinationGPRParserTest() :
+        Test("tex_destination_gpr_test")
+    {
+    }
+
+    void check(const std::string & input, unsigned index, bool relative, unsigned x, unsigned y, unsigned z, unsigned w)
+    {
+        r6xx::tex::DestinationGPR gpr(r6xx::tex::DestinationGPRParser::parse(input));
+        TEST_CHECK_EQUAL(gpr.index, index);
+        TEST_CHECK_EQUAL(gpr.relative, relative);
+        TEST_CHECK_EQUAL(gpr.selector.first, x);
+        TEST_CHECK_EQUAL(gpr.selector.second, y);
+        TEST_CHECK_EQUAL(gpr.selector.third, z);
+        TEST_CHECK_EQUAL(gpr.selector.fourth, w);
+    }
+
+    virtual void run()
+    {
+        check("$0[xyzw]",   0,   false, 0, 1, 2, 3);
+        check("$12[wzyx]r", 12,  true,  3, 2, 1, 0);
+        check("$127[01m]",  127, false, 4, 5, 7, 3);
+        check("$5[]a",      5,   false, 0, 1, 2, 3);
+        check("$7",         7,   false, 0, 1, 2, 3);
+        check("$8r",        8,   true,  0, 1, 2, 3);
+
+        TEST_CHECK_THROWS(r6xx::tex::DestinationGPRParser::parse("$0[xyzw"), r6xx::DestinationGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::DestinationGPRParser::parse("$0xyzw]"), r6xx::DestinationGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::DestinationGPRParser::parse("$0[xyzwx]"), r6xx::DestinationGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::DestinationGPRParser::parse("$0[xq]"), r6xx::DestinationGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::DestinationGPRParser::parse("$128[x]"), r6xx::DestinationGPRSyntaxError);
+
+        Diagnostics diagnostics;
+        r6xx::tex::DestinationGPR gpr(r6xx::tex::DestinationGPRParser::parse("$1[x]"));
+        TEST_CHECK_EQUAL(r6xx::tex::DestinationGPRParser::parse("$0[xq]", gpr, diagnostics), ps_syntax_error);
+        TEST_CHECK_EQUAL(diagnostics.last(), "invalid selector element 'q'");
+        TEST_CHECK_EQUAL(r6xx::tex::DestinationGPRParser::parse("$0[x]q", gpr, diagnostics), ps_syntax_error);
+        TEST_CHECK_EQUAL(diagnostics.last(), "invalid address mode 'q'");
+        TEST_CHECK_EQUAL(r6xx::tex::DestinationGPRParser::parse("$200[x]", gpr, diagnostics), ps_out_of_bounds);
+        TEST_CHECK_EQUAL(diagnostics.size(), 3u);
+        TEST_CHECK_EQUAL(gpr.index, 1u);
+    }
+} tex_destination_gpr_parser_test;
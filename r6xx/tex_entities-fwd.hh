@@ -20,8 +20,6 @@
 #ifndef GPU_GUARD_R6XX_TEX_ENTITIES_FWD_HH
 #define GPU_GUARD_R6XX_TEX_ENTITIES_FWD_HH 1
 
-#include <utils/memory.hh>
-
 namespace gpu
 {
     namespace r6xx
@@ -30,7 +28,8 @@ namespace gpu
         {
             struct Entity;
 
-            typedef std::tr1::shared_ptr<Entity> EntityPtr;
+            /// Entities are owned by the Arena of their section.
+            typedef const Entity * EntityPtr;
 
             struct Label;
 
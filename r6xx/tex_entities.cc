@@ -22,13 +22,12 @@
 #include <common/expression.hh>
 #include <r6xx/tex_entities.hh>
 #include <r6xx/error.hh>
+#include <utils/perfect_hash.hh>
 #include <utils/sequence-impl.hh>
 #include <utils/stringify.hh>
 #include <utils/tuple.hh>
 #include <utils/visitor-impl.hh>
 
-#include <algorithm>
-
 namespace gpu
 {
     template
@@ -65,7 +64,7 @@ namespace gpu
             {
             }
 
-            Label::Label(const std::string & t) :
+            Label::Label(const Atom & t) :
                 text(t)
             {
             }
@@ -97,9 +96,10 @@ namespace gpu
                 static_cast<ConstVisits<LoadInstruction> *>(&v)->visit(*this);
             }
 
-            Size::Size(const std::string & s, const ExpressionPtr & e) :
+            Size::Size(const Atom & s, const ExpressionPtr & e) :
                 symbol(s),
-                expression(e)
+                expression(e),
+                compiled(e)
             {
             }
 
@@ -113,7 +113,7 @@ namespace gpu
                 static_cast<ConstVisits<Size> *>(&v)->visit(*this);
             }
 
-            Type::Type(const std::string & s, unsigned t) :
+            Type::Type(const Atom & s, unsigned t) :
                 symbol(s),
                 type(t)
             {
@@ -208,57 +208,94 @@ namespace gpu
                  * opcode
                  */
                 typedef Tuple<std::string, unsigned> Load;
-                typedef TupleComparator<Load, std::string, 1> LoadComparator;
                 const static Load load_instructions[] =
                 {
                     Load("ld", 3)
                 };
-                const static Load * load_instructions_begin(load_instructions);
-                const static Load * load_instructions_end(load_instructions + sizeof(load_instructions) / sizeof(Load));
+                const static PerfectHash<Load> load_table(load_instructions, load_instructions + sizeof(load_instructions) / sizeof(Load));
+
+                enum DirectiveKind
+                {
+                    dk_size,
+                    dk_type
+                };
+
+                /*
+                 * directive name
+                 * directive kind
+                 */
+                typedef Tuple<std::string, unsigned> KnownDirective;
+                const static KnownDirective known_directives[] =
+                {
+                    KnownDirective("size",          dk_size),
+                    KnownDirective("type",          dk_type)
+                };
+                const static PerfectHash<KnownDirective> directive_table(known_directives, known_directives + sizeof(known_directives) / sizeof(KnownDirective));
 
                 struct EntityConverter :
                     public AssemblyEntityVisitor
                 {
+                    Arena & arena;
+
                     EntityPtr result;
 
+                    EntityConverter(Arena & arena) :
+                        arena(arena),
+                        result(0)
+                    {
+                    }
+
                     void visit(const Comment &) { }
                     void visit(const Data &) { }
 
                     void visit(const Directive & d)
                     {
-                        if ("size" == d.name)
-                        {
-                            Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
+                        const KnownDirective * directive(directive_table.find(d.name));
+                        if (! directive)
+                            throw SyntaxError("unknown directive '." + d.name + "' in texture fetch section");
 
-                            result = EntityPtr(new Size(parameters.first, parameters.second));
-                        }
-                        else if ("type" == d.name)
+                        switch (directive->second)
                         {
-                            Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
+                            case dk_size:
+                                {
+                                    Tuple<std::string, ExpressionPtr> parameters(SizeParser::parse(d.params));
 
-                            result = EntityPtr(new Type(parameters.first, parameters.second));
-                        }
-                        else
-                        {
-                            throw SyntaxError("unknown directive '." + d.name + "' in texture fetch section");
+                                    result = arena.make<Size>(parameters.first, parameters.second);
+                                }
+                                break;
+
+                            case dk_type:
+                                {
+                                    Tuple<std::string, unsigned> parameters(TypeParser::parse(d.params));
+
+                                    result = arena.make<Type>(parameters.first, parameters.second);
+                                }
+                                break;
                         }
                     }
 
                     void visit(const Instruction & i)
                     {
-                        const Load * load(std::find_if(load_instructions_begin, load_instructions_end, LoadComparator(i.mnemonic)));
+                        InstructionTokens tokens(i);
+
+                        visit(tokens.lexed);
+                    }
+
+                    void visit(const LexedInstruction & i)
+                    {
+                        const Load * load(load_table.find(i.mnemonic));
 
-                        if (load != load_instructions_end)
+                        if (load)
                         {
                             if (2 != i.operands.size())
                                 throw SyntaxError("expected 2 operands, got " + stringify(i.operands.size()));
 
-                            DestinationGPR destination(DestinationGPRParser::parse(i.operands.first()));
-                            SourceGPR source(SourceGPRParser::parse(i.operands.last()));
+                            DestinationGPR destination(DestinationGPRParser::parse(i.begin(0), i.end(0)));
+                            SourceGPR source(SourceGPRParser::parse(i.begin(1), i.end(1)));
                             // TODO
                             // - resource id
 
-                            result = EntityPtr(new LoadInstruction(Enumeration<5>(load->second), destination, source));
+                            result = arena.make<LoadInstruction>(Enumeration<5>(load->second), destination, source);
                         }
                         else
                         {
@@ -268,28 +305,31 @@ namespace gpu
 
                     void visit(const gpu::Label & l)
                     {
-                        result = EntityPtr(new r6xx::tex::Label(l.text));
-                    }
-
-                    void visit(const gpu::Line & l)
-                    {
-                        SyntaxContext::Line(l.number);
+                        result = arena.make<r6xx::tex::Label>(l.text);
                     }
                 };
             }
 
+            Atom
+            Mnemonics::load(unsigned opcode)
+            {
+                const internal::Load * load(internal::load_table.reverse(opcode));
+
+                return load ? Atom(load->first) : Atom();
+            }
+
             Sequence<EntityPtr>
-            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input)
+            EntityConverter::convert(const Sequence<AssemblyEntityPtr> & input, Arena & arena)
             {
                 Sequence<EntityPtr> result;
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
                 for (Sequence<AssemblyEntityPtr>::Iterator i(input.begin()), i_end(input.end()) ;
                         i != i_end ; ++i)
                 {
-                    converter.result = EntityPtr();
+                    converter.result = 0;
                     (*i)->accept(converter);
-                    if (EntityPtr() != converter.result)
+                    if (0 != converter.result)
                         result.append(converter.result);
                 }
 
@@ -297,12 +337,21 @@ namespace gpu
             }
 
             EntityPtr
-            EntityConverter::convert(const AssemblyEntityPtr & input)
+            EntityConverter::convert(const AssemblyEntity & input, Arena & arena)
+            {
+                internal::EntityConverter converter(arena);
+
+                input.accept(converter);
+
+                return converter.result;
+            }
+
+            EntityPtr
+            EntityConverter::convert(const LexedInstruction & input, Arena & arena)
             {
-                internal::EntityConverter converter;
+                internal::EntityConverter converter(arena);
 
-                converter.result = EntityPtr();
-                input->accept(converter);
+                converter.visit(input);
 
                 return converter.result;
             }
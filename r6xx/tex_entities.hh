@@ -21,10 +21,12 @@
 #define GPU_GUARD_R6XX_TEX_ENTITIES_HH 1
 
 #include <common/assembly_entities-fwd.hh>
-#include <common/expression-fwd.hh>
+#include <common/expression.hh>
 #include <r6xx/tex_entities-fwd.hh>
 #include <r6xx/tex_destination_gpr.hh>
 #include <r6xx/tex_source_gpr.hh>
+#include <utils/arena.hh>
+#include <utils/atom.hh>
 #include <utils/enumeration.hh>
 #include <utils/sequence.hh>
 #include <utils/visitor.hh>
@@ -51,9 +53,9 @@ namespace gpu
             struct Label :
                 public Entity
             {
-                std::string text;
+                Atom text;
 
-                Label(const std::string &);
+                Label(const Atom &);
 
                 ~Label();
 
@@ -79,11 +81,14 @@ namespace gpu
             struct Size :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 ExpressionPtr expression;
 
-                Size(const std::string &, const ExpressionPtr &);
+                /// The expression, compiled once for all evaluations.
+                CompiledExpression compiled;
+
+                Size(const Atom &, const ExpressionPtr &);
 
                 ~Size();
 
@@ -93,11 +98,11 @@ namespace gpu
             struct Type :
                 public Entity
             {
-                std::string symbol;
+                Atom symbol;
 
                 unsigned type;
 
-                Type(const std::string &, unsigned);
+                Type(const Atom &, unsigned);
 
                 ~Type();
 
@@ -106,9 +111,19 @@ namespace gpu
 
             struct EntityConverter
             {
-                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &);
+                static Sequence<EntityPtr> convert(const Sequence<AssemblyEntityPtr> &, Arena &);
+
+                static EntityPtr convert(const AssemblyEntity &, Arena &);
 
-                static EntityPtr convert(const AssemblyEntityPtr &);
+                /// Convert an instruction straight from its tokens.
+                static EntityPtr convert(const LexedInstruction &, Arena &);
+            };
+
+            /// Look up mnemonics by opcode, e.g. for disassembly.
+            struct Mnemonics
+            {
+                /// Return the mnemonic of a load opcode, or the empty atom.
+                static Atom load(unsigned opcode);
             };
 
             struct EntityPrinter
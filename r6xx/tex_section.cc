@@ -19,6 +19,7 @@
 
 #include <common/assembly_entities.hh>
 #include <common/expression.hh>
+#include <elf/symbol_index.hh>
 #include <r6xx/error.hh>
 #include <r6xx/tex_section.hh>
 #include <utils/sequence-impl.hh>
@@ -43,12 +44,16 @@ namespace gpu
                 struct SymbolScanner :
                     public tex::EntityVisitor
                 {
-                    Sequence<elf::Symbol> symbols;
+                    elf::SymbolIndex symbols;
 
                     unsigned current_offset;
 
+                    /// Evaluates all sizes, resolving each symbol only once.
+                    ExpressionEvaluator evaluator;
+
                     SymbolScanner(const Sequence<tex::EntityPtr> & tex_entities) :
-                        current_offset(0)
+                        current_offset(0),
+                        evaluator(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), this, std::tr1::placeholders::_1))
                     {
                         add_symbol(".tex", 0, STT_SECTION);
 
@@ -61,47 +66,46 @@ namespace gpu
                         set_symbol_size(".tex", current_offset);
                     }
 
-                    void add_symbol(const std::string & name, unsigned offset, unsigned type = 0)
+                    void add_symbol(const Atom & name, unsigned offset, unsigned type = 0)
                     {
                         elf::Symbol symbol(name);
                         symbol.section = ".tex";
                         symbol.type = type;
                         symbol.value = offset;
 
-                        if (symbols.end() != std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)))
-                            throw DuplicateSymbolError(name);
-
-                        symbols.append(symbol);
+                        if (! symbols.append(symbol))
+                            throw DuplicateSymbolError(name.str());
                     }
 
-                    void set_symbol_size(const std::string & name, unsigned size)
+                    void set_symbol_size(const Atom & name, unsigned size)
                     {
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->size = size;
                     }
 
-                    void set_symbol_type(const std::string & name, unsigned type)
+                    void set_symbol_type(const Atom & name, unsigned type)
                     {
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
                         s->type = type;
                     }
 
-                    unsigned symbol_lookup(const std::string & name)
+                    /// Return the value of a symbol, relative to its section if it is defined.
+                    RelocatableValue symbol_lookup(const Atom & name)
                     {
                         if ("." == name)
-                            return current_offset;
+                            return RelocatableValue(Atom(".tex"), current_offset);
 
-                        Sequence<elf::Symbol>::Iterator s(std::find_if(symbols.begin(), symbols.end(), elf::SymbolByName(name)));
-                        if (symbols.end() == s)
-                            throw UnresolvedSymbolError(name);
+                        elf::Symbol * s(symbols.find(name));
+                        if (0 == s)
+                            throw UnresolvedSymbolError(name.str());
 
-                        return s->value;
+                        return RelocatableValue(s->section, s->value);
                     }
 
                     // tex::EntityVisitor
@@ -117,8 +121,7 @@ namespace gpu
 
                     void visit(const tex::Size & s)
                     {
-                        ExpressionEvaluator e(std::tr1::bind(std::tr1::mem_fn(&SymbolScanner::symbol_lookup), *this, std::tr1::placeholders::_1));
-                        set_symbol_size(s.symbol, e.evaluate(s.expression));
+                        set_symbol_size(s.symbol, evaluator.evaluate(s.compiled));
                     }
 
                     void visit(const tex::Type & t)
@@ -137,20 +140,33 @@ namespace gpu
             }
 
             void
-            Section::append(const AssemblyEntityPtr & ptr)
+            Section::append(const AssemblyEntity & entity)
             {
-                EntityPtr converted(EntityConverter::convert(ptr));
+                EntityPtr converted(EntityConverter::convert(entity, arena));
 
-                if (0 != converted.get())
+                if (0 != converted)
                 {
                     entities.append(converted);
                 }
             }
 
-            std::string
+            void
+            Section::append(const LexedInstruction & instruction)
+            {
+                EntityPtr converted(EntityConverter::convert(instruction, arena));
+
+                if (0 != converted)
+                {
+                    entities.append(converted);
+                }
+            }
+
+            Atom
             Section::name() const
             {
-                return ".tex";
+                static const Atom name(".tex");
+
+                return name;
             }
 
             Sequence<elf::Section>
@@ -173,7 +189,7 @@ namespace gpu
             {
                 internal::SymbolScanner ss(entities);
 
-                return ss.symbols;
+                return ss.symbols.symbols();
             }
         }
     }
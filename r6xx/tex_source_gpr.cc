@@ -17,9 +17,10 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <common/diagnostics.hh>
 #include <r6xx/tex_source_gpr.hh>
 #include <r6xx/error.hh>
-#include <utils/destringify.hh>
+#include <r6xx/operand_lexer.hh>
 #include <utils/stringify.hh>
 
 namespace gpu
@@ -34,50 +35,60 @@ namespace gpu
             {
             }
 
-            SourceGPR
-            SourceGPRParser::parse(const std::string & input)
+            ParseStatus
+            SourceGPRParser::parse(const char * begin, const char * end, SourceGPR & result, Diagnostics & diagnostics)
             {
-                const static std::string digits("0123456789");
-                const static std::string modes("ar");
+                LexedOperand operand;
+                ParseStatus status(OperandLexer::lex(begin, end, operand, diagnostics));
+                if (ps_success != status)
+                    return status;
+
+                if ((LexedOperand::gpr_operand != operand.kind) || operand.negated)
+                    return diagnostics.error(ps_syntax_error, "source GPR needs to start with '$'");
+
+                if (operand.has_channel || operand.has_selector)
+                    return diagnostics.error(ps_syntax_error, "unexpected suffix after source GPR index");
 
-                if (input.empty())
-                    throw InternalError("r6xx", "empty input");
+                if (! Enumeration<7>::valid(operand.index))
+                    return diagnostics.error(ps_out_of_bounds, "register index out of bounds");
 
-                std::string operand(input);
-                if (2 > operand.size())
-                    throw SourceGPRSyntaxError("too short for a source GPR");
+                result = SourceGPR(Enumeration<7>(operand.index), operand.relative);
 
-                if ('$' != operand[0])
-                    throw SourceGPRSyntaxError("destination GPR needs to start with '$'");
+                return ps_success;
+            }
 
-                operand.erase(0, 1);
+            SourceGPR
+            SourceGPRParser::parse(const char * begin, const char * end)
+            {
+                Diagnostics diagnostics;
+                SourceGPR result(Enumeration<7>(0), false);
 
-                bool relative(false);
-                std::string::size_type suffix_begin(operand.find_last_not_of(digits));
-                if ((operand.size() - 1) == suffix_begin)
+                switch (parse(begin, end, result, diagnostics))
                 {
-                    char suffix(operand[suffix_begin]);
-                    operand.erase(suffix_begin);
-
-                    if ('r' == suffix)
-                    {
-                        relative = true;
-                    }
-                    else if ('a' != suffix)
-                    {
-                        throw SourceGPRSyntaxError("invalid address mode '" + stringify(operand[suffix_begin]) + "'");
-                    }
-                }
+                    case ps_success:
+                        return result;
 
-                if (std::string::npos != operand.find_first_not_of(digits))
-                    throw SourceGPRSyntaxError("'" + operand + "' is not a number");
+                    case ps_empty_input:
+                        throw InternalError("r6xx", diagnostics.last());
 
-                unsigned index(destringify<unsigned>(operand));
+                    case ps_syntax_error:
+                    case ps_out_of_bounds:
+                        break;
+                }
+
+                throw SourceGPRSyntaxError(diagnostics.last());
+            }
 
-                if (127 < index)
-                    throw SourceGPRSyntaxError("register index out of bounds");
+            ParseStatus
+            SourceGPRParser::parse(const std::string & input, SourceGPR & result, Diagnostics & diagnostics)
+            {
+                return parse(input.data(), input.data() + input.size(), result, diagnostics);
+            }
 
-                return SourceGPR(Enumeration<7>(index), relative);
+            SourceGPR
+            SourceGPRParser::parse(const std::string & input)
+            {
+                return parse(input.data(), input.data() + input.size());
             }
 
             std::string
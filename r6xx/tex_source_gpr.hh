@@ -20,6 +20,7 @@
 #ifndef GPU_GUARD_R6XX_TEX_SOURCE_GPR_HH
 #define GPU_GUARD_R6XX_TEX_SOURCE_GPR_HH 1
 
+#include <common/diagnostics.hh>
 #include <utils/enumeration.hh>
 
 namespace gpu
@@ -39,7 +40,22 @@ namespace gpu
 
             struct SourceGPRParser
             {
+                /**
+                 * Parse input without throwing.
+                 *
+                 * On failure, a message is recorded in diagnostics and result
+                 * is left untouched.
+                 */
+                static ParseStatus parse(const std::string & input, SourceGPR & result, Diagnostics & diagnostics);
+
+                /// Parse input, throwing SourceGPRSyntaxError on failure.
                 static SourceGPR parse(const std::string & input);
+
+                /// Parse the text [begin, end) without throwing, as with a string.
+                static ParseStatus parse(const char * begin, const char * end, SourceGPR & result, Diagnostics & diagnostics);
+
+                /// Parse the text [begin, end), throwing SourceGPRSyntaxError on failure.
+                static SourceGPR parse(const char * begin, const char * end);
             };
 
             struct SourceGPRPrinter
@@ -0,0 +1,62 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <r6xx/error.hh>
+#include <r6xx/tex_source_gpr.hh>
+
+using namespace gpu;
+using namespace tests;
+
+struct TexSourceGPRParserTest :
+    public Test
+{
+    TexSourceGPRParserTest() :
+        Test("tex_source_gpr_test")
+    {
+    }
+
+    virtual void run()
+    {
+        r6xx::tex::SourceGPR gpr(r6xx::tex::SourceGPRParser::parse("$127"));
+        TEST_CHECK_EQUAL(gpr.index, 127u);
+        TEST_CHECK_EQUAL(gpr.relative, false);
+
+        gpr = r6xx::tex::SourceGPRParser::parse("$3r");
+        TEST_CHECK_EQUAL(gpr.index, 3u);
+        TEST_CHECK_EQUAL(gpr.relative, true);
+
+        gpr = r6xx::tex::SourceGPRParser::parse("$4a");
+        TEST_CHECK_EQUAL(gpr.index, 4u);
+        TEST_CHECK_EQUAL(gpr.relative, false);
+
+        TEST_CHECK_THROWS(r6xx::tex::SourceGPRParser::parse("$128"), r6xx::SourceGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::SourceGPRParser::parse("$1q"), r6xx::SourceGPRSyntaxError);
+        TEST_CHECK_THROWS(r6xx::tex::SourceGPRParser::parse("R1"), r6xx::SourceGPRSyntaxError);
+
+        Diagnostics diagnostics;
+        TEST_CHECK_EQUAL(r6xx::tex::SourceGPRParser::parse("$1q", gpr, diagnostics), ps_syntax_error);
+        TEST_CHECK_EQUAL(diagnostics.last(), "'1q' is not a number");
+        TEST_CHECK_EQUAL(r6xx::tex::SourceGPRParser::parse("$x1", gpr, diagnostics), ps_syntax_error);
+        TEST_CHECK_EQUAL(diagnostics.last(), "'x1' is not a number");
+        TEST_CHECK_EQUAL(r6xx::tex::SourceGPRParser::parse("$128", gpr, diagnostics), ps_out_of_bounds);
+        TEST_CHECK_EQUAL(diagnostics.size(), 3u);
+        TEST_CHECK_EQUAL(gpr.index, 4u);
+    }
+} tex_source_gpr_parser_test;
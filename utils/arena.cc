@@ -0,0 +1,160 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <utils/arena.hh>
+#include <utils/exception.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+
+#include <cstdlib>
+#include <list>
+
+namespace gpu
+{
+    namespace internal
+    {
+        struct ArenaBlock
+        {
+            ArenaBlock * previous;
+        };
+
+        struct ArenaFinalizer
+        {
+            void (* finalizer)(void *);
+
+            void * object;
+
+            ArenaFinalizer * previous;
+        };
+    }
+
+    template <>
+    struct Implementation<Arena>
+    {
+        const unsigned block_size;
+
+        internal::ArenaBlock * blocks;
+
+        internal::ArenaFinalizer * finalizers;
+
+        char * current;
+
+        char * limit;
+
+        unsigned long size;
+
+        std::list<Arena> attached;
+
+        Implementation(unsigned b) :
+            block_size(b),
+            blocks(0),
+            finalizers(0),
+            current(0),
+            limit(0),
+            size(0)
+        {
+        }
+
+        ~Implementation()
+        {
+            for (internal::ArenaFinalizer * f(finalizers) ; f ; f = f->previous)
+            {
+                f->finalizer(f->object);
+            }
+
+            while (blocks)
+            {
+                internal::ArenaBlock * previous(blocks->previous);
+                std::free(blocks);
+                blocks = previous;
+            }
+        }
+
+        void grow(unsigned minimum)
+        {
+            unsigned payload(minimum > block_size ? minimum : block_size);
+
+            internal::ArenaBlock * block(static_cast<internal::ArenaBlock *>(std::malloc(sizeof(internal::ArenaBlock) + payload)));
+            if (! block)
+                throw std::bad_alloc();
+
+            block->previous = blocks;
+            blocks = block;
+
+            current = reinterpret_cast<char *>(block + 1);
+            limit = current + payload;
+        }
+    };
+
+    Arena::Arena(unsigned block_size) :
+        PrivateImplementationPattern<Arena>(new Implementation<Arena>(block_size))
+    {
+    }
+
+    Arena::~Arena()
+    {
+    }
+
+    void *
+    Arena::allocate(unsigned size, unsigned alignment)
+    {
+        if ((0 == alignment) || (0 != (alignment & (alignment - 1))))
+            throw InternalError("utils", "Arena alignment must be a power of two");
+
+        std::size_t mask(alignment - 1);
+        char * result(reinterpret_cast<char *>((reinterpret_cast<std::size_t>(_imp->current) + mask) & ~mask));
+
+        if ((0 == _imp->current) || (result + size > _imp->limit))
+        {
+            _imp->grow(size + alignment);
+            result = reinterpret_cast<char *>((reinterpret_cast<std::size_t>(_imp->current) + mask) & ~mask);
+        }
+
+        _imp->current = result + size;
+        _imp->size += size;
+
+        return result;
+    }
+
+    void
+    Arena::add_finalizer(void (* finalizer)(void *), void * object)
+    {
+        internal::ArenaFinalizer * f(static_cast<internal::ArenaFinalizer *>(allocate(sizeof(internal::ArenaFinalizer),
+                        std::tr1::alignment_of<internal::ArenaFinalizer>::value)));
+
+        f->finalizer = finalizer;
+        f->object = object;
+        f->previous = _imp->finalizers;
+        _imp->finalizers = f;
+    }
+
+    void
+    Arena::attach(const Arena & other)
+    {
+        if (other._imp.get() == _imp.get())
+            throw InternalError("utils", "Cannot attach an Arena to itself");
+
+        _imp->attached.push_back(other);
+    }
+
+    unsigned long
+    Arena::size() const
+    {
+        return _imp->size;
+    }
+}
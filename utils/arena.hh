@@ -0,0 +1,109 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_UTILS_ARENA_HH
+#define GPU_GUARD_UTILS_ARENA_HH 1
+
+#include <utils/private_implementation_pattern.hh>
+
+#include <new>
+#include <tr1/type_traits>
+
+namespace gpu
+{
+    /**
+     * Arena is a bump allocator for objects that share one lifetime.
+     *
+     * Objects are placement-constructed into large contiguous blocks. They
+     * are never freed individually; instead, all objects are destroyed (in
+     * reverse order of creation) and all blocks are released at once when the
+     * last copy of the Arena goes away.
+     */
+    class Arena :
+        public PrivateImplementationPattern<Arena>
+    {
+        private:
+            template <typename T_> static void _destroy(void * object)
+            {
+                static_cast<T_ *>(object)->~T_();
+            }
+
+            template <typename T_> T_ * _finalize(T_ * object)
+            {
+                if (! std::tr1::has_trivial_destructor<T_>::value)
+                    add_finalizer(&Arena::_destroy<T_>, object);
+
+                return object;
+            }
+
+            template <typename T_> void * _allocate()
+            {
+                return allocate(sizeof(T_), std::tr1::alignment_of<T_>::value);
+            }
+
+        public:
+            Arena(unsigned block_size = 64 * 1024);
+
+            ~Arena();
+
+            /// Return size bytes of uninitialised memory, aligned to alignment.
+            void * allocate(unsigned size, unsigned alignment);
+
+            /// Have finalizer run on object when the arena is destroyed.
+            void add_finalizer(void (* finalizer)(void *), void * object);
+
+            /// Keep other alive for as long as this arena lives.
+            void attach(const Arena & other);
+
+            /// Return the number of bytes handed out so far.
+            unsigned long size() const;
+
+            /// \name Object construction
+            /// \{
+
+            template <typename T_> T_ * make()
+            {
+                return _finalize(new (_allocate<T_>()) T_());
+            }
+
+            template <typename T_, typename A1_> T_ * make(const A1_ & a1)
+            {
+                return _finalize(new (_allocate<T_>()) T_(a1));
+            }
+
+            template <typename T_, typename A1_, typename A2_> T_ * make(const A1_ & a1, const A2_ & a2)
+            {
+                return _finalize(new (_allocate<T_>()) T_(a1, a2));
+            }
+
+            template <typename T_, typename A1_, typename A2_, typename A3_> T_ * make(const A1_ & a1, const A2_ & a2, const A3_ & a3)
+            {
+                return _finalize(new (_allocate<T_>()) T_(a1, a2, a3));
+            }
+
+            template <typename T_, typename A1_, typename A2_, typename A3_, typename A4_> T_ * make(const A1_ & a1, const A2_ & a2, const A3_ & a3, const A4_ & a4)
+            {
+                return _finalize(new (_allocate<T_>()) T_(a1, a2, a3, a4));
+            }
+
+            /// \}
+    };
+}
+
+#endif
@@ -0,0 +1,95 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <tests/tests.hh>
+#include <utils/arena.hh>
+#include <utils/exception.hh>
+
+#include <string>
+#include <vector>
+
+using namespace gpu;
+using namespace tests;
+
+namespace
+{
+    struct Tracked
+    {
+        std::vector<unsigned> * destroyed;
+
+        unsigned id;
+
+        std::string text;
+
+        Tracked(std::vector<unsigned> * d, unsigned i, const std::string & t) :
+            destroyed(d),
+            id(i),
+            text(t)
+        {
+        }
+
+        ~Tracked()
+        {
+            destroyed->push_back(id);
+        }
+    };
+}
+
+struct ArenaTest :
+    public Test
+{
+    ArenaTest() :
+        Test("arena_test")
+    {
+    }
+
+    virtual void run()
+    {
+        std::vector<unsigned> destroyed;
+
+        {
+            Arena arena(64);
+
+            double * d(arena.make<double>(1.5));
+            TEST_CHECK_EQUAL(*d, 1.5);
+            TEST_CHECK_EQUAL(reinterpret_cast<std::size_t>(d) % std::tr1::alignment_of<double>::value, 0);
+
+            char * c(arena.make<char>('x'));
+            TEST_CHECK_EQUAL(*c, 'x');
+
+            Tracked * t1(arena.make<Tracked>(&destroyed, 1u, std::string("first")));
+            // larger than a whole block
+            char * buffer(static_cast<char *>(arena.allocate(1000, 16)));
+            buffer[999] = 'y';
+            Tracked * t2(arena.make<Tracked>(&destroyed, 2u, std::string("second")));
+
+            TEST_CHECK_EQUAL(t1->text, "first");
+            TEST_CHECK_EQUAL(t2->text, "second");
+            TEST_CHECK_EQUAL(reinterpret_cast<std::size_t>(buffer) % 16, 0);
+            TEST_CHECK(arena.size() >= 1000);
+            TEST_CHECK(destroyed.empty());
+
+            TEST_CHECK_THROWS(arena.allocate(8, 3), InternalError);
+        }
+
+        TEST_CHECK_EQUAL(destroyed.size(), 2);
+        TEST_CHECK_EQUAL(destroyed[0], 2);
+        TEST_CHECK_EQUAL(destroyed[1], 1);
+    }
+} arena_test;
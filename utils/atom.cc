@@ -0,0 +1,209 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <utils/atom.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#include <pthread.h>
+
+namespace gpu
+{
+    namespace
+    {
+        /*
+         * The table consists of plain data only, so that it is ready before any
+         * static constructor runs and atoms can be created during static
+         * initialisation. Entries are never freed.
+         */
+        pthread_rwlock_t atom_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+        internal::AtomEntry ** atom_buckets = 0;
+
+        std::size_t atom_bucket_count = 0;
+
+        unsigned atom_count = 0;
+
+        // FNV-1a
+        std::size_t hash_of(const char * begin, const char * end)
+        {
+            std::size_t result(2166136261u);
+
+            for ( ; begin != end ; ++begin)
+            {
+                result ^= static_cast<unsigned char>(*begin);
+                result *= 16777619u;
+            }
+
+            return result;
+        }
+
+        const internal::AtomEntry * find(const char * begin, const char * end, std::size_t hash)
+        {
+            if (0 == atom_bucket_count)
+                return 0;
+
+            std::size_t length(end - begin);
+            for (const internal::AtomEntry * e(atom_buckets[hash % atom_bucket_count]) ; e ; e = e->next)
+            {
+                if ((e->hash == hash) && (e->text.size() == length) && (0 == std::memcmp(e->text.data(), begin, length)))
+                    return e;
+            }
+
+            return 0;
+        }
+
+        void grow()
+        {
+            std::size_t bucket_count(atom_bucket_count ? 2 * atom_bucket_count : 1024);
+            internal::AtomEntry ** buckets(new internal::AtomEntry *[bucket_count]);
+            std::fill(buckets, buckets + bucket_count, static_cast<internal::AtomEntry *>(0));
+
+            for (std::size_t b(0) ; b < atom_bucket_count ; ++b)
+            {
+                for (internal::AtomEntry * e(atom_buckets[b]), * next(0) ; e ; e = next)
+                {
+                    next = e->next;
+                    e->next = buckets[e->hash % bucket_count];
+                    buckets[e->hash % bucket_count] = e;
+                }
+            }
+
+            delete[] atom_buckets;
+            atom_buckets = buckets;
+            atom_bucket_count = bucket_count;
+        }
+
+        class ReadLock
+        {
+            public:
+                ReadLock() { pthread_rwlock_rdlock(&atom_lock); }
+
+                ~ReadLock() { pthread_rwlock_unlock(&atom_lock); }
+        };
+
+        class WriteLock
+        {
+            public:
+                WriteLock() { pthread_rwlock_wrlock(&atom_lock); }
+
+                ~WriteLock() { pthread_rwlock_unlock(&atom_lock); }
+        };
+    }
+
+    namespace internal
+    {
+        AtomEntry::AtomEntry(const char * begin, const char * end, std::size_t hash, unsigned id) :
+            text(begin, end),
+            hash(hash),
+            id(id),
+            next(0)
+        {
+        }
+    }
+
+    const internal::AtomEntry *
+    Atom::_intern(const char * begin, const char * end)
+    {
+        if (begin == end)
+            return 0;
+
+        std::size_t hash(hash_of(begin, end));
+
+        // Most lookups hit atoms that exist already, and only need to share the table.
+        {
+            ReadLock lock;
+
+            if (const internal::AtomEntry * result = find(begin, end, hash))
+                return result;
+        }
+
+        WriteLock lock;
+
+        // Another thread might have interned the same string in the meantime.
+        if (const internal::AtomEntry * result = find(begin, end, hash))
+            return result;
+
+        if (atom_count >= atom_bucket_count)
+            grow();
+
+        internal::AtomEntry * result(new internal::AtomEntry(begin, end, hash, atom_count + 1));
+        result->next = atom_buckets[hash % atom_bucket_count];
+        atom_buckets[hash % atom_bucket_count] = result;
+        ++atom_count;
+
+        return result;
+    }
+
+    Atom::Atom(const std::string & text) :
+        _entry(_intern(text.data(), text.data() + text.size()))
+    {
+    }
+
+    Atom::Atom(const char * text) :
+        _entry(_intern(text, text + std::strlen(text)))
+    {
+    }
+
+    Atom::Atom(const char * begin, const char * end) :
+        _entry(_intern(begin, end))
+    {
+    }
+
+    const std::string &
+    Atom::str() const
+    {
+        static const std::string empty;
+
+        return _entry ? _entry->text : empty;
+    }
+
+    bool
+    Atom::has_prefix(const char * prefix) const
+    {
+        return 0 == str().compare(0, std::strlen(prefix), prefix);
+    }
+
+    unsigned
+    Atom::count()
+    {
+        ReadLock lock;
+
+        return atom_count;
+    }
+
+    bool
+    operator== (const Atom & lhs, const std::string & rhs)
+    {
+        return lhs.str() == rhs;
+    }
+
+    bool
+    operator== (const Atom & lhs, const char * rhs)
+    {
+        return lhs.str() == rhs;
+    }
+
+    std::ostream &
+    operator<< (std::ostream & lhs, const Atom & rhs)
+    {
+        return lhs << rhs.str();
+    }
+}
@@ -0,0 +1,154 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef GPU_GUARD_UTILS_ATOM_HH
+#define GPU_GUARD_UTILS_ATOM_HH 1
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace gpu
+{
+    namespace internal
+    {
+        struct AtomEntry
+        {
+            const std::string text;
+
+            const std::size_t hash;
+
+            const unsigned id;
+
+            AtomEntry * next;
+
+            AtomEntry(const char * begin, const char * end, std::size_t hash, unsigned id);
+        };
+    }
+
+    /**
+     * Atom is an interned string.
+     *
+     * Every distinct string is stored exactly once in a process-wide table, so
+     * atoms are as cheap to copy as a pointer and compare by identity. The
+     * table is guarded by a read-write lock and never shrinks, so atoms can be
+     * shared freely between concurrent assembly jobs and stay valid for the
+     * lifetime of the process.
+     *
+     * Since interned strings are never freed, code that handles strings from
+     * outside, such as the tables of object files being read, keeps them as
+     * std::string and only creates atoms for the names it is asked for.
+     */
+    class Atom
+    {
+        private:
+            /// The entry of this atom, or 0 for the empty string.
+            const internal::AtomEntry * _entry;
+
+            static const internal::AtomEntry * _intern(const char * begin, const char * end);
+
+        public:
+            /// Construct the empty atom.
+            Atom() :
+                _entry(0)
+            {
+            }
+
+            Atom(const std::string & text);
+
+            Atom(const char * text);
+
+            Atom(const char * begin, const char * end);
+
+            /// Return the interned text.
+            const std::string & str() const;
+
+            /// Return a dense, process-wide unique id; 0 for the empty atom.
+            unsigned id() const
+            {
+                return _entry ? _entry->id : 0;
+            }
+
+            std::size_t hash() const
+            {
+                return _entry ? _entry->hash : 0;
+            }
+
+            bool empty() const
+            {
+                return 0 == _entry;
+            }
+
+            /// Return whether the text starts with prefix, without copying it.
+            bool has_prefix(const char * prefix) const;
+
+            /// \name Comparison by identity
+            /// \{
+
+            bool operator== (const Atom & other) const
+            {
+                return _entry == other._entry;
+            }
+
+            bool operator!= (const Atom & other) const
+            {
+                return _entry != other._entry;
+            }
+
+            /// Order atoms by id. This is an order of interning, not a lexical one.
+            bool operator< (const Atom & other) const
+            {
+                return id() < other.id();
+            }
+
+            /// \}
+
+            /// Return the number of distinct non-empty strings interned so far.
+            static unsigned count();
+    };
+
+    /// \name Comparison with plain strings, without interning them
+    /// \{
+
+    bool operator== (const Atom & lhs, const std::string & rhs);
+    bool operator== (const Atom & lhs, const char * rhs);
+
+    inline bool operator== (const std::string & lhs, const Atom & rhs) { return rhs == lhs; }
+    inline bool operator== (const char * lhs, const Atom & rhs) { return rhs == lhs; }
+
+    inline bool operator!= (const Atom & lhs, const std::string & rhs) { return ! (lhs == rhs); }
+    inline bool operator!= (const Atom & lhs, const char * rhs) { return ! (lhs == rhs); }
+    inline bool operator!= (const std::string & lhs, const Atom & rhs) { return ! (rhs == lhs); }
+    inline bool operator!= (const char * lhs, const Atom & rhs) { return ! (rhs == lhs); }
+
+    /// \}
+
+    /// \name Concatenation with plain strings, e.g. for diagnostics
+    /// \{
+
+    inline std::string operator+ (const std::string & lhs, const Atom & rhs) { return lhs + rhs.str(); }
+    inline std::string operator+ (const char * lhs, const Atom & rhs) { return lhs + rhs.str(); }
+    inline std::string operator+ (const Atom & lhs, const std::string & rhs) { return lhs.str() + rhs; }
+    inline std::string operator+ (const Atom & lhs, const char * rhs) { return lhs.str() + rhs; }
+
+    /// \}
+
+    std::ostream & operator<< (std::ostream &, const Atom &);
+}
+
+#endif
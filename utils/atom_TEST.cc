@@ -0,0 +1,107 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <tests/tests.hh>
+#include <utils/atom.hh>
+#include <utils/stringify.hh>
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+using namespace gpu;
+using namespace tests;
+
+namespace
+{
+    struct InternJob
+    {
+        std::vector<Atom> atoms;
+
+        static void * run(void * argument)
+        {
+            InternJob * job(static_cast<InternJob *>(argument));
+
+            for (unsigned i(0) ; i < 1000 ; ++i)
+            {
+                job->atoms.push_back(Atom("atom_test_" + stringify(i)));
+            }
+
+            return 0;
+        }
+    };
+}
+
+struct AtomTest :
+    public Test
+{
+    AtomTest() :
+        Test("atom_test")
+    {
+    }
+
+    virtual void run()
+    {
+        std::string text(".Lfoo");
+        Atom a(text), b(".Lfoo"), c(text.data(), text.data() + text.size()), d("foo");
+
+        TEST_CHECK(a == b);
+        TEST_CHECK(a == c);
+        TEST_CHECK(a != d);
+        TEST_CHECK(&a.str() == &b.str());
+        TEST_CHECK_EQUAL(a.id(), b.id());
+        TEST_CHECK(a.id() != d.id());
+        TEST_CHECK_EQUAL(a.str(), ".Lfoo");
+
+        TEST_CHECK(a == ".Lfoo");
+        TEST_CHECK(".Lfoo" == a);
+        TEST_CHECK(a == text);
+        TEST_CHECK(a != "foo");
+
+        TEST_CHECK(a.has_prefix(".L"));
+        TEST_CHECK(! d.has_prefix(".L"));
+        TEST_CHECK(! Atom(".").has_prefix(".L"));
+
+        Atom empty;
+        TEST_CHECK(empty.empty());
+        TEST_CHECK(empty == Atom(""));
+        TEST_CHECK_EQUAL(empty.id(), 0);
+        TEST_CHECK_EQUAL(empty.str(), "");
+        TEST_CHECK(! a.empty());
+
+        // concurrent interning yields the very same atoms
+        InternJob jobs[4];
+        pthread_t threads[4];
+        for (unsigned j(0) ; j < 4 ; ++j)
+            TEST_CHECK_EQUAL(pthread_create(&threads[j], 0, &InternJob::run, &jobs[j]), 0);
+
+        for (unsigned j(0) ; j < 4 ; ++j)
+            pthread_join(threads[j], 0);
+
+        unsigned count(Atom::count());
+        for (unsigned j(1) ; j < 4 ; ++j)
+        {
+            TEST_CHECK(jobs[0].atoms == jobs[j].atoms);
+        }
+        TEST_CHECK_EQUAL(jobs[0].atoms[123].str(), "atom_test_123");
+
+        Atom("atom_test_999");
+        TEST_CHECK_EQUAL(Atom::count(), count);
+    }
+} atom_test;
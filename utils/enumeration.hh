@@ -41,10 +41,16 @@ namespace gpu
             explicit Enumeration(unsigned value) :
                 _value(value)
             {
-                if (value >= (1L << width_))
+                if (! valid(value))
                     throw EnumerationValueOutOfBoundsError(_value, width_);
             }
 
+            /// Return whether value fits into width_ bits, without throwing.
+            static bool valid(unsigned value)
+            {
+                return value < (1L << width_);
+            }
+
             ~Enumeration()
             {
             }
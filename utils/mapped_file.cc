@@ -0,0 +1,130 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <utils/mapped_file.hh>
+#include <utils/private_implementation_pattern-impl.hh>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gpu
+{
+    MappedFileError::MappedFileError(const std::string & filename, const std::string & reason) :
+        Exception("Could not map file '" + filename + "': " + reason)
+    {
+    }
+
+    template <>
+    struct Implementation<MappedFile>
+    {
+        std::string filename;
+
+        char * data;
+
+        unsigned size;
+
+        Implementation(const std::string & f) :
+            filename(f),
+            data(0),
+            size(0)
+        {
+            int fd(::open(filename.c_str(), O_RDONLY));
+            if (-1 == fd)
+                throw MappedFileError(filename, std::strerror(errno));
+
+            struct stat s;
+            if (-1 == ::fstat(fd, &s))
+            {
+                int e(errno);
+                ::close(fd);
+                throw MappedFileError(filename, std::strerror(e));
+            }
+
+            // sizes and offsets into mapped files are unsigned throughout
+            if (s.st_size > off_t(UINT_MAX))
+            {
+                ::close(fd);
+                throw MappedFileError(filename, "File is too large");
+            }
+
+            size = s.st_size;
+            if (0 != size)
+            {
+                void * p(::mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0));
+                if (MAP_FAILED == p)
+                {
+                    int e(errno);
+                    ::close(fd);
+                    throw MappedFileError(filename, std::strerror(e));
+                }
+
+                data = static_cast<char *>(p);
+                ::madvise(data, size, MADV_SEQUENTIAL);
+            }
+
+            // The mapping keeps its own reference to the file.
+            ::close(fd);
+        }
+
+        ~Implementation()
+        {
+            if (0 != data)
+                ::munmap(data, size);
+        }
+    };
+
+    MappedFile::MappedFile(const std::string & filename) :
+        PrivateImplementationPattern<MappedFile>(new Implementation<MappedFile>(filename))
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+    }
+
+    const char *
+    MappedFile::begin() const
+    {
+        return _imp->data;
+    }
+
+    const char *
+    MappedFile::end() const
+    {
+        return _imp->data + _imp->size;
+    }
+
+    std::string
+    MappedFile::filename() const
+    {
+        return _imp->filename;
+    }
+
+    unsigned
+    MappedFile::size() const
+    {
+        return _imp->size;
+    }
+}
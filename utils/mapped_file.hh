@@ -0,0 +1,62 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GPU_GUARD_UTILS_MAPPED_FILE_HH
+#define GPU_GUARD_UTILS_MAPPED_FILE_HH 1
+
+#include <utils/exception.hh>
+#include <utils/private_implementation_pattern.hh>
+
+#include <string>
+
+namespace gpu
+{
+    struct MappedFileError :
+        public Exception
+    {
+        MappedFileError(const std::string & filename, const std::string & reason);
+    };
+
+    /**
+     * MappedFile maps a whole file read-only into memory.
+     *
+     * Copies of a MappedFile share the same mapping, which stays valid until
+     * the last copy is gone.
+     */
+    class MappedFile :
+        public PrivateImplementationPattern<MappedFile>
+    {
+        public:
+            MappedFile(const std::string & filename);
+
+            ~MappedFile();
+
+            /// Return the first byte of the mapped file, or 0 for empty files.
+            const char * begin() const;
+
+            /// Return one past the last byte of the mapped file.
+            const char * end() const;
+
+            std::string filename() const;
+
+            unsigned size() const;
+    };
+}
+
+#endif
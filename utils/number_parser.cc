@@ -0,0 +1,322 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <utils/number_parser.hh>
+
+#include <cfloat>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <locale.h>
+
+namespace gpu
+{
+    namespace
+    {
+        bool parse_magnitude(const char * begin, const char * end, unsigned long limit, unsigned long & result)
+        {
+            unsigned base(10);
+            if ((end - begin > 2) && ('0' == begin[0]) && (('x' == begin[1]) || ('X' == begin[1])))
+            {
+                base = 16;
+                begin += 2;
+            }
+
+            if (begin == end)
+                return false;
+
+            result = 0;
+            for ( ; begin != end ; ++begin)
+            {
+                unsigned digit;
+                if (('0' <= *begin) && (*begin <= '9'))
+                    digit = *begin - '0';
+                else if ((16 == base) && ('a' <= *begin) && (*begin <= 'f'))
+                    digit = *begin - 'a' + 10;
+                else if ((16 == base) && ('A' <= *begin) && (*begin <= 'F'))
+                    digit = *begin - 'A' + 10;
+                else
+                    return false;
+
+                if (result > (limit - digit) / base)
+                    return false;
+
+                result = result * base + digit;
+            }
+
+            return true;
+        }
+
+        /*
+         * Parse a signed integer whose magnitude must not exceed max, or max + 1
+         * if it is negative.
+         */
+        bool parse_signed(const char * begin, const char * end, unsigned long max, bool & negative, unsigned long & magnitude)
+        {
+            negative = false;
+            if ((begin != end) && (('+' == *begin) || ('-' == *begin)))
+            {
+                negative = ('-' == *begin);
+                ++begin;
+            }
+
+            return parse_magnitude(begin, end, negative ? max + 1 : max, magnitude);
+        }
+
+        template <typename T_> struct FloatTraits;
+
+        template <> struct FloatTraits<float>
+        {
+            // Largest mantissa and power of ten that are both exact in a float.
+            static const unsigned long long max_mantissa = 1ULL << 24;
+            static const int max_exponent = 10;
+
+            static float power(unsigned exponent)
+            {
+                static const float powers[] =
+                {
+                    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+                };
+
+                return powers[exponent];
+            }
+
+            static float convert(const char * text, char ** end, locale_t locale)
+            {
+                return ::strtof_l(text, end, locale);
+            }
+        };
+
+        template <> struct FloatTraits<double>
+        {
+            static const unsigned long long max_mantissa = 1ULL << 53;
+            static const int max_exponent = 22;
+
+            static double power(unsigned exponent)
+            {
+                static const double powers[] =
+                {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                };
+
+                return powers[exponent];
+            }
+
+            static double convert(const char * text, char ** end, locale_t locale)
+            {
+                return ::strtod_l(text, end, locale);
+            }
+        };
+
+        template <typename T_> bool parse_float(const char * begin, const char * end, T_ & result)
+        {
+            const char * p(begin);
+
+            bool negative(false);
+            if ((p != end) && (('+' == *p) || ('-' == *p)))
+            {
+                negative = ('-' == *p);
+                ++p;
+            }
+
+            // Collect up to 19 significant digits, which always fit into the mantissa.
+            unsigned long long mantissa(0);
+            unsigned digits(0), significant_digits(0);
+            int exponent(0);
+            bool truncated(false);
+
+            for ( ; (p != end) && ('0' <= *p) && (*p <= '9') ; ++p, ++digits)
+            {
+                if ((0 == mantissa) && ('0' == *p))
+                    continue;
+
+                if (significant_digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    ++significant_digits;
+                }
+                else
+                {
+                    truncated |= ('0' != *p);
+                    ++exponent;
+                }
+            }
+
+            if ((p != end) && ('.' == *p))
+            {
+                for (++p ; (p != end) && ('0' <= *p) && (*p <= '9') ; ++p, ++digits)
+                {
+                    if ((0 == mantissa) && ('0' == *p))
+                    {
+                        --exponent;
+                        continue;
+                    }
+
+                    if (significant_digits < 19)
+                    {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        ++significant_digits;
+                        --exponent;
+                    }
+                    else
+                    {
+                        truncated |= ('0' != *p);
+                    }
+                }
+            }
+
+            if (0 == digits)
+                return false;
+
+            if ((p != end) && (('e' == *p) || ('E' == *p)))
+            {
+                ++p;
+
+                bool negative_exponent(false);
+                if ((p != end) && (('+' == *p) || ('-' == *p)))
+                {
+                    negative_exponent = ('-' == *p);
+                    ++p;
+                }
+
+                if (p == end)
+                    return false;
+
+                int explicit_exponent(0);
+                for ( ; (p != end) && ('0' <= *p) && (*p <= '9') ; ++p)
+                {
+                    if (explicit_exponent < 100000)
+                        explicit_exponent = explicit_exponent * 10 + (*p - '0');
+                }
+
+                exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+            }
+
+            if (p != end)
+                return false;
+
+            if (0 == mantissa)
+            {
+                result = negative ? -T_(0) : T_(0);
+                return true;
+            }
+
+#if FLT_EVAL_METHOD == 0
+            /*
+             * Clinger's fast path: if both the mantissa and the power of ten are
+             * exact, a single multiplication or division rounds correctly.
+             */
+            if ((! truncated) && (mantissa <= FloatTraits<T_>::max_mantissa)
+                    && (-FloatTraits<T_>::max_exponent <= exponent) && (exponent <= FloatTraits<T_>::max_exponent))
+            {
+                T_ value(static_cast<T_>(mantissa));
+                if (exponent < 0)
+                    value /= FloatTraits<T_>::power(-exponent);
+                else
+                    value *= FloatTraits<T_>::power(exponent);
+
+                result = negative ? -value : value;
+                return true;
+            }
+#endif
+
+            // Fall back to the C library, using the "C" locale regardless of the global one.
+            static const locale_t c_locale(::newlocale(LC_ALL_MASK, "C", 0));
+
+            char buffer[128];
+            std::string long_text;
+            const char * text(buffer);
+            std::size_t length(end - begin);
+            if (length < sizeof(buffer))
+            {
+                std::memcpy(buffer, begin, length);
+                buffer[length] = '\0';
+            }
+            else
+            {
+                long_text.assign(begin, end);
+                text = long_text.c_str();
+            }
+
+            char * text_end(0);
+            T_ value(FloatTraits<T_>::convert(text, &text_end, c_locale));
+            if (text_end != text + length)
+                return false;
+
+            // Reject overflow, but accept underflow to denormals or zero.
+            if ((value > std::numeric_limits<T_>::max()) || (value < -std::numeric_limits<T_>::max()))
+                return false;
+
+            result = value;
+            return true;
+        }
+    }
+
+    bool
+    NumberParser::parse(const char * begin, const char * end, long & result)
+    {
+        bool negative;
+        unsigned long magnitude;
+        if (! parse_signed(begin, end, LONG_MAX, negative, magnitude))
+            return false;
+
+        result = negative ? -static_cast<long>(magnitude - 1) - 1 : static_cast<long>(magnitude);
+        return true;
+    }
+
+    bool
+    NumberParser::parse(const char * begin, const char * end, signed & result)
+    {
+        bool negative;
+        unsigned long magnitude;
+        if (! parse_signed(begin, end, INT_MAX, negative, magnitude))
+            return false;
+
+        result = negative ? -static_cast<signed>(magnitude - 1) - 1 : static_cast<signed>(magnitude);
+        return true;
+    }
+
+    bool
+    NumberParser::parse(const char * begin, const char * end, unsigned & result)
+    {
+        if ((begin != end) && ('+' == *begin))
+            ++begin;
+
+        unsigned long magnitude;
+        if (! parse_magnitude(begin, end, UINT_MAX, magnitude))
+            return false;
+
+        result = magnitude;
+        return true;
+    }
+
+    bool
+    NumberParser::parse(const char * begin, const char * end, float & result)
+    {
+        return parse_float(begin, end, result);
+    }
+
+    bool
+    NumberParser::parse(const char * begin, const char * end, double & result)
+    {
+        return parse_float(begin, end, result);
+    }
+}
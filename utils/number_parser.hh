@@ -0,0 +1,57 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef GPU_GUARD_UTILS_NUMBER_PARSER_HH
+#define GPU_GUARD_UTILS_NUMBER_PARSER_HH 1
+
+#include <string>
+
+namespace gpu
+{
+    /**
+     * NumberParser converts numeric literals without streams, locales or heap
+     * allocations.
+     *
+     * Integers are written in decimal or, with a '0x' prefix, in hexadecimal,
+     * and may carry a sign. Floating point literals are decimal, with an
+     * optional fraction and exponent, and are rounded exactly as IEEE 754
+     * demands. Every function consumes the whole range and returns false if
+     * it does not hold a literal of the requested type, or if the value does
+     * not fit into it.
+     */
+    struct NumberParser
+    {
+        static bool parse(const char * begin, const char * end, long & result);
+
+        static bool parse(const char * begin, const char * end, signed & result);
+
+        /// Parse a non-negative integer; a leading '-' is rejected.
+        static bool parse(const char * begin, const char * end, unsigned & result);
+
+        static bool parse(const char * begin, const char * end, float & result);
+
+        static bool parse(const char * begin, const char * end, double & result);
+
+        template <typename T_> static bool parse(const std::string & input, T_ & result)
+        {
+            return parse(input.data(), input.data() + input.size(), result);
+        }
+    };
+}
+
+#endif
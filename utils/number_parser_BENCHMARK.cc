@@ -0,0 +1,118 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <utils/destringify.hh>
+#include <utils/number_parser.hh>
+#include <utils/stringify.hh>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+using namespace gpu;
+
+namespace
+{
+    double now()
+    {
+        struct timeval tv;
+        ::gettimeofday(&tv, 0);
+
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    /*
+     * Literals as they appear in unrolled kernels: filter weights, offsets
+     * and sizes.
+     */
+    std::vector<std::string> make_literals(unsigned count, bool floats)
+    {
+        std::vector<std::string> result;
+        unsigned seed(4711);
+
+        for (unsigned i(0) ; i < count ; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            int value(int(seed >> 8) % 2000000 - 1000000);
+
+            if (floats)
+                result.push_back(stringify(value / 65536.0f));
+            else
+                result.push_back(stringify(value));
+        }
+
+        return result;
+    }
+
+    template <typename T_> void compare(const std::string & name, const std::vector<std::string> & literals)
+    {
+        T_ checksum_destringify(0), checksum_number_parser(0);
+
+        double start(now());
+        for (std::vector<std::string>::const_iterator l(literals.begin()), l_end(literals.end()) ; l != l_end ; ++l)
+        {
+            checksum_destringify += destringify<T_>(*l);
+        }
+        double middle(now());
+        for (std::vector<std::string>::const_iterator l(literals.begin()), l_end(literals.end()) ; l != l_end ; ++l)
+        {
+            T_ value;
+            if (! NumberParser::parse(*l, value))
+                throw DestringifyError(*l);
+
+            checksum_number_parser += value;
+        }
+        double stop(now());
+
+        std::cout << name << ": destringify " << (middle - start) << " s, NumberParser " << (stop - middle) << " s, speedup "
+            << (middle - start) / (stop - middle) << (checksum_destringify == checksum_number_parser ? "" : " (MISMATCH)") << std::endl;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned count(1000000);
+
+    if (argc > 1)
+        count = destringify<unsigned>(argv[1]);
+
+    if (argc > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [LITERALS]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        std::vector<std::string> integers(make_literals(count, false)), floats(make_literals(count, true));
+
+        compare<signed>("signed", integers);
+        compare<long>("long", integers);
+        compare<float>("float", floats);
+    }
+    catch (Exception & e)
+    {
+        std::cerr << "Caught exception: " << e.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <tests/tests.hh>
+#include <utils/number_parser.hh>
+#include <utils/stringify.hh>
+
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace gpu;
+using namespace tests;
+
+namespace
+{
+    template <typename T_> bool parses(const std::string & input, T_ expected)
+    {
+        T_ result;
+
+        return NumberParser::parse(input, result) && (result == expected);
+    }
+
+    template <typename T_> bool rejects(const std::string & input)
+    {
+        T_ result;
+
+        return ! NumberParser::parse(input, result);
+    }
+
+    unsigned bits(float f)
+    {
+        unsigned result;
+        std::memcpy(&result, &f, sizeof(result));
+
+        return result;
+    }
+}
+
+struct NumberParserIntegerTest :
+    public Test
+{
+    NumberParserIntegerTest() :
+        Test("number_parser_integer_test")
+    {
+    }
+
+    virtual void run()
+    {
+        TEST_CHECK(parses<long>("0", 0));
+        TEST_CHECK(parses<long>("-17", -17));
+        TEST_CHECK(parses<long>("+17", 17));
+        TEST_CHECK(parses<long>("0x1234", 0x1234));
+        TEST_CHECK(parses<long>("0XaBcD", 0xabcd));
+        TEST_CHECK(parses<long>("-0x10", -16));
+        TEST_CHECK(parses<long>(stringify(LONG_MAX), LONG_MAX));
+        TEST_CHECK(parses<long>(stringify(LONG_MIN), LONG_MIN));
+        TEST_CHECK(rejects<long>(stringify(LONG_MAX) + "0"));
+        TEST_CHECK(rejects<long>(""));
+        TEST_CHECK(rejects<long>("-"));
+        TEST_CHECK(rejects<long>("0x"));
+        TEST_CHECK(rejects<long>("0xg"));
+        TEST_CHECK(rejects<long>("12a"));
+        TEST_CHECK(rejects<long>(" 12"));
+        TEST_CHECK(rejects<long>("main"));
+
+        TEST_CHECK(parses<signed>("2147483647", 2147483647));
+        TEST_CHECK(parses<signed>("-2147483648", INT_MIN));
+        TEST_CHECK(rejects<signed>("2147483648"));
+        TEST_CHECK(rejects<signed>("-2147483649"));
+
+        TEST_CHECK(parses<unsigned>("4294967295", 4294967295u));
+        TEST_CHECK(parses<unsigned>("0xffffffff", 0xffffffffu));
+        TEST_CHECK(rejects<unsigned>("4294967296"));
+        TEST_CHECK(rejects<unsigned>("-1"));
+    }
+} number_parser_integer_test;
+
+struct NumberParserFloatTest :
+    public Test
+{
+    NumberParserFloatTest() :
+        Test("number_parser_float_test")
+    {
+    }
+
+    virtual void run()
+    {
+        float f(0.0f);
+
+        TEST_CHECK(NumberParser::parse(std::string("1.1"), f));
+        TEST_CHECK_EQUAL(bits(f), 0x3f8ccccdu);
+        TEST_CHECK(NumberParser::parse(std::string("-1.1"), f));
+        TEST_CHECK_EQUAL(bits(f), 0xbf8ccccdu);
+        TEST_CHECK(NumberParser::parse(std::string("-0.0"), f));
+        TEST_CHECK_EQUAL(bits(f), 0x80000000u);
+
+        TEST_CHECK(parses<float>(".5", 0.5f));
+        TEST_CHECK(parses<float>("2.", 2.0f));
+        TEST_CHECK(parses<float>("1e3", 1000.0f));
+        TEST_CHECK(parses<float>("1.5E-1", 0.15f));
+        TEST_CHECK(parses<float>("3.4028235e38", 3.4028235e38f));
+        TEST_CHECK(rejects<float>("1e39"));
+        TEST_CHECK(parses<float>("1e-50", 0.0f));
+        TEST_CHECK(rejects<float>("."));
+        TEST_CHECK(rejects<float>("1.0f"));
+        TEST_CHECK(rejects<float>("1e"));
+        TEST_CHECK(rejects<float>("1e+"));
+        TEST_CHECK(rejects<float>("0x1p3"));
+        TEST_CHECK(rejects<float>("nan"));
+
+        // halfway cases and cases beyond the fast path have to round like strtod
+        const char * const hard_cases[] =
+        {
+            "16777217",
+            "16777219",
+            "7.038531e-26",
+            "1.00000005960464477539062500001",
+            "0.000000000000000000000000000000000000011754942807573642917278829910357665133228589927589904276829631184250030649651730385585324256680905818939208984375",
+            "123456789012345678901234567890",
+            "8.589973e9",
+            "1.17549435e-38",
+            "1.4e-45",
+            "9007199254740993"
+        };
+
+        for (unsigned i(0) ; i < sizeof(hard_cases) / sizeof(hard_cases[0]) ; ++i)
+        {
+            TEST_CHECK(NumberParser::parse(std::string(hard_cases[i]), f));
+            TEST_CHECK_EQUAL(bits(f), bits(std::strtof(hard_cases[i], 0)));
+
+            double d;
+            TEST_CHECK(NumberParser::parse(std::string(hard_cases[i]), d));
+            TEST_CHECK_EQUAL(d, std::strtod(hard_cases[i], 0));
+        }
+
+        // pseudo-random literals of all shapes
+        unsigned seed(12345);
+        for (unsigned i(0) ; i < 20000 ; ++i)
+        {
+            std::string text;
+            unsigned digits(1 + (seed >> 16) % 12);
+            for (unsigned j(0) ; j < digits ; ++j)
+            {
+                seed = seed * 1103515245 + 12345;
+                text += char('0' + (seed >> 16) % 10);
+            }
+
+            seed = seed * 1103515245 + 12345;
+            text.insert((seed >> 16) % (digits + 1), ".");
+
+            seed = seed * 1103515245 + 12345;
+            if (0 == (seed >> 16) % 3)
+                text += "e" + stringify(int((seed >> 18) % 60) - 30);
+
+            float reference(std::strtof(text.c_str(), 0));
+            if (HUGE_VALF == reference)
+            {
+                TEST_CHECK(rejects<float>(text));
+                continue;
+            }
+
+            TEST_CHECK(NumberParser::parse(text, f));
+            TEST_CHECK_EQUAL(bits(f), bits(reference));
+        }
+    }
+} number_parser_float_test;
@@ -0,0 +1,185 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef GPU_GUARD_UTILS_PERFECT_HASH_HH
+#define GPU_GUARD_UTILS_PERFECT_HASH_HH 1
+
+#include <utils/atom.hh>
+#include <utils/exception.hh>
+
+#include <algorithm>
+#include <vector>
+
+namespace gpu
+{
+    /**
+     * PerfectHash indexes a fixed table of entries by their first member.
+     *
+     * When constructed, it searches a displacement for every bucket of keys
+     * until all key atoms fall into distinct slots (hash and displace). A
+     * lookup then mixes the atom's precomputed hash and does a single pointer
+     * comparison. Entries can also be found in reverse by their second member,
+     * e.g. by opcode; the first entry with a given value wins, so aliases
+     * belong after their canonical entry.
+     *
+     * The C++ dialect we use has no constant expressions, so tables are built
+     * during static initialisation instead of at compile time.
+     */
+    template <typename Entry_> class PerfectHash
+    {
+        private:
+            std::vector<unsigned> _displacements;
+
+            std::vector<Atom> _keys;
+
+            std::vector<const Entry_ *> _entries;
+
+            std::vector<const Entry_ *> _reverse;
+
+            unsigned long _mask;
+
+            static unsigned long long _mix(unsigned long long hash, unsigned long long seed)
+            {
+                hash ^= seed * 0x9e3779b97f4a7c15ULL;
+                hash ^= hash >> 33;
+                hash *= 0xff51afd7ed558ccdULL;
+                hash ^= hash >> 33;
+                hash *= 0xc4ceb9fe1a85ec53ULL;
+                hash ^= hash >> 33;
+
+                return hash;
+            }
+
+            static bool _larger(const std::vector<unsigned> & a, const std::vector<unsigned> & b)
+            {
+                return a.size() > b.size();
+            }
+
+            bool _build(const std::vector<Atom> & keys, const std::vector<const Entry_ *> & entries, unsigned long size)
+            {
+                std::vector<std::vector<unsigned> > buckets(_displacements.size());
+                for (unsigned k(0) ; k < keys.size() ; ++k)
+                {
+                    buckets[_mix(keys[k].hash(), 0) % buckets.size()].push_back(k);
+                }
+
+                for (unsigned b(0) ; b < buckets.size() ; ++b)
+                {
+                    buckets[b].insert(buckets[b].begin(), b);
+                }
+                std::stable_sort(buckets.begin(), buckets.end(), &PerfectHash::_larger);
+
+                _mask = size - 1;
+                _keys.assign(size, Atom());
+                _entries.assign(size, static_cast<const Entry_ *>(0));
+
+                // Place the largest buckets first, while most slots are still free.
+                for (typename std::vector<std::vector<unsigned> >::const_iterator b(buckets.begin()), b_end(buckets.end()) ;
+                        (b != b_end) && (b->size() > 1) ; ++b)
+                {
+                    unsigned displacement(1);
+                    for ( ; displacement < 4096 ; ++displacement)
+                    {
+                        std::vector<unsigned long> slots;
+                        for (std::vector<unsigned>::const_iterator k(b->begin() + 1), k_end(b->end()) ; k != k_end ; ++k)
+                        {
+                            unsigned long slot(_mix(keys[*k].hash(), displacement) & _mask);
+                            if ((0 != _entries[slot]) || (slots.end() != std::find(slots.begin(), slots.end(), slot)))
+                                break;
+
+                            slots.push_back(slot);
+                        }
+
+                        if (slots.size() + 1 != b->size())
+                            continue;
+
+                        for (unsigned i(0) ; i < slots.size() ; ++i)
+                        {
+                            _keys[slots[i]] = keys[(*b)[i + 1]];
+                            _entries[slots[i]] = entries[(*b)[i + 1]];
+                        }
+
+                        break;
+                    }
+
+                    if (4096 == displacement)
+                        return false;
+
+                    _displacements[b->front()] = displacement;
+                }
+
+                return true;
+            }
+
+        public:
+            PerfectHash(const Entry_ * begin, const Entry_ * end) :
+                _displacements((end - begin) / 2 + 1, 0),
+                _mask(0)
+            {
+                std::vector<Atom> keys;
+                std::vector<const Entry_ *> entries;
+
+                for (const Entry_ * e(begin) ; e != end ; ++e)
+                {
+                    Atom key(e->first);
+                    if (key.empty())
+                        throw InternalError("utils", "PerfectHash: empty key");
+
+                    if (keys.end() != std::find(keys.begin(), keys.end(), key))
+                        throw InternalError("utils", "PerfectHash: duplicate key '" + key.str() + "'");
+
+                    keys.push_back(key);
+                    entries.push_back(e);
+
+                    unsigned value(e->second);
+                    if (_reverse.size() <= value)
+                        _reverse.resize(value + 1, 0);
+
+                    if (0 == _reverse[value])
+                        _reverse[value] = e;
+                }
+
+                unsigned long size(4);
+                while (size < 2 * keys.size())
+                    size *= 2;
+
+                for ( ; ! _build(keys, entries, size) ; size *= 2)
+                {
+                    if (size > 64 * keys.size())
+                        throw InternalError("utils", "PerfectHash: could not separate keys");
+                }
+            }
+
+            /// Return the entry whose first member equals key, or 0.
+            const Entry_ * find(const Atom & key) const
+            {
+                unsigned long long hash(key.hash());
+                unsigned long slot(_mix(hash, _displacements[_mix(hash, 0) % _displacements.size()]) & _mask);
+
+                return (_keys[slot] == key) ? _entries[slot] : 0;
+            }
+
+            /// Return the first entry whose second member equals value, or 0.
+            const Entry_ * reverse(unsigned value) const
+            {
+                return (value < _reverse.size()) ? _reverse[value] : 0;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,93 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Danny van Dyk <danny.dyk@tu-dortmund.de>
+ *
+ * This file is part of the GPU Toolchain. GPU Toolchain is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * GPU Toolchain is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <tests/tests.hh>
+#include <utils/exception.hh>
+#include <utils/perfect_hash.hh>
+#include <utils/stringify.hh>
+#include <utils/tuple.hh>
+
+#include <string>
+#include <vector>
+
+using namespace gpu;
+using namespace tests;
+
+struct PerfectHashTest :
+    public Test
+{
+    PerfectHashTest() :
+        Test("perfect_hash_test")
+    {
+    }
+
+    virtual void run()
+    {
+        typedef Tuple<std::string, unsigned> Entry;
+
+        {
+            const Entry entries[] =
+            {
+                Entry("iadd",   0x34),
+                Entry("mov",    0x19),
+                Entry("nop",    0x1a),
+                Entry("uadd",   0x34) // Alias for iadd
+            };
+            PerfectHash<Entry> table(entries, entries + sizeof(entries) / sizeof(Entry));
+
+            for (unsigned i(0) ; i < sizeof(entries) / sizeof(Entry) ; ++i)
+            {
+                TEST_CHECK_EQUAL(table.find(Atom(entries[i].first)), &entries[i]);
+            }
+
+            TEST_CHECK(0 == table.find(Atom("add")));
+            TEST_CHECK(0 == table.find(Atom()));
+
+            TEST_CHECK_EQUAL(table.reverse(0x34)->first, "iadd");
+            TEST_CHECK_EQUAL(table.reverse(0x19)->first, "mov");
+            TEST_CHECK(0 == table.reverse(0x18));
+            TEST_CHECK(0 == table.reverse(0x100));
+        }
+
+        {
+            std::vector<Entry> entries;
+            for (unsigned i(0) ; i < 500 ; ++i)
+            {
+                entries.push_back(Entry("mnemonic" + stringify(i), i));
+            }
+            PerfectHash<Entry> table(&entries[0], &entries[0] + entries.size());
+
+            for (unsigned i(0) ; i < entries.size() ; ++i)
+            {
+                TEST_CHECK_EQUAL(table.find(Atom("mnemonic" + stringify(i))), &entries[i]);
+                TEST_CHECK_EQUAL(table.reverse(i), &entries[i]);
+            }
+            TEST_CHECK(0 == table.find(Atom("mnemonic500")));
+        }
+
+        {
+            const Entry entries[] =
+            {
+                Entry("mov",    0x19),
+                Entry("mov",    0x1a)
+            };
+
+            TEST_CHECK_THROWS(PerfectHash<Entry>(entries, entries + 2), InternalError);
+        }
+    }
+} perfect_hash_test;